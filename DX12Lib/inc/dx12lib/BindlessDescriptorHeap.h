@@ -0,0 +1,114 @@
+#pragma once
+
+#include "DescriptorAllocatorPage.h"
+#include "DescriptorFreeList.h"
+
+#include "d3dx12.h"
+
+#include <wrl.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+/*
+ * The bindless descriptor heap is a single large shader visible CBV_SRV_UAV descriptor heap.
+ * Textures and shader resource views get a stable index in this heap when they are created so that
+ * shaders can fetch them by index from an unbounded descriptor table instead of copying the descriptors
+ * to a descriptor table before every draw. The DynamicDescriptorHeap also takes its blocks from this heap
+ * so that the same descriptor heap stays bound on the command list.
+ */
+namespace DX12_Library
+{
+
+class Device;
+
+class BindlessDescriptorHeap
+{
+public:
+    // Returned for resources that don't have a bindless descriptor.
+    static const uint32_t InvalidIndex = 0xffffffff;
+
+    // The default number of descriptors in the bindless descriptor heap.
+    static const uint32_t DefaultNumDescriptors = 262144;
+
+    /**
+     * Allocate a number of contiguous descriptors in the bindless descriptor heap.
+     *
+     * @returns The index of the first descriptor.
+     */
+    uint32_t Allocate( uint32_t numDescriptors = 1 );
+
+    /**
+     * Return descriptors to the bindless descriptor heap.
+     * The descriptors are only reused once the command queues have finished
+     * all of the work that was submitted before they were freed.
+     */
+    void Free( uint32_t index, uint32_t numDescriptors = 1 );
+
+    /**
+     * Return the freed descriptors that are no longer in use by the GPU.
+     */
+    void ReleaseStaleDescriptors();
+
+    /**
+     * Copy a CPU visible descriptor into the bindless descriptor heap.
+     */
+    void CopyDescriptor( uint32_t index, D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor );
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCPUDescriptorHandle( uint32_t index = 0 ) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandle( uint32_t index = 0 ) const;
+
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> GetD3D12DescriptorHeap() const
+    {
+        return m_d3d12DescriptorHeap;
+    }
+
+    uint32_t GetNumDescriptors() const
+    {
+        return m_NumDescriptors;
+    }
+
+protected:
+    friend class std::default_delete<BindlessDescriptorHeap>;
+
+    BindlessDescriptorHeap( Device& device, uint32_t numDescriptors = DefaultNumDescriptors );
+    virtual ~BindlessDescriptorHeap() = default;
+
+private:
+    struct StaleDescriptorInfo
+    {
+        StaleDescriptorInfo( uint32_t index, uint32_t size,
+                             const DescriptorAllocatorPage::QueueFenceValues& fenceValues )
+        : Index( index )
+        , Size( size )
+        , FenceValues( fenceValues )
+        {}
+
+        // The index of the first descriptor.
+        uint32_t Index;
+        // The number of descriptors.
+        uint32_t Size;
+        // The descriptors can be reused once these fence values are reached.
+        DescriptorAllocatorPage::QueueFenceValues FenceValues;
+    };
+
+    // Return the stale descriptors whose fences have completed to the free list.
+    // The allocation mutex must be held by the caller.
+    void ReleaseCompletedDescriptors();
+
+    Device& m_Device;
+
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12DescriptorHeap;
+    CD3DX12_CPU_DESCRIPTOR_HANDLE                m_BaseCPUDescriptor;
+    CD3DX12_GPU_DESCRIPTOR_HANDLE                m_BaseGPUDescriptor;
+    uint32_t                                     m_DescriptorHandleIncrementSize;
+    uint32_t                                     m_NumDescriptors;
+
+    DescriptorFreeList              m_FreeList;
+    std::queue<StaleDescriptorInfo> m_StaleDescriptors;
+
+    std::mutex m_AllocationMutex;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace DX12_Library
+{
+/*
+ * The buffer block allocator keeps track of ranges of bytes in a list of large blocks.
+ * Allocations are placed in the first block that has a free range that is large enough
+ * (best fit inside of the block) so that the first blocks are filled up and the last blocks
+ * become good candidates for defragmentation.
+ *
+ * This class does not depend on D3D12 and only deals with block indices, offsets and sizes.
+ * The StaticBufferAllocator creates the GPU memory for the blocks.
+ */
+class BufferBlockAllocator
+{
+public:
+    // Returned for allocations that could not be satisfied.
+    static const uint32_t InvalidBlock = 0xffffffff;
+
+    struct Allocation
+    {
+        uint32_t BlockIndex = InvalidBlock;
+        size_t   Offset     = 0;
+        size_t   Size       = 0;
+
+        bool IsValid() const
+        {
+            return BlockIndex != InvalidBlock;
+        }
+    };
+
+    /**
+     * How well a block is used.
+     */
+    struct BlockOccupancy
+    {
+        size_t   Size;
+        size_t   UsedSize;
+        size_t   LargestFreeRange;
+        uint32_t NumAllocations;
+    };
+
+    /**
+     * Totals for all blocks.
+     */
+    struct Statistics
+    {
+        uint32_t NumBlocks;
+        uint32_t NumAllocations;
+        size_t   TotalSize;
+        size_t   UsedSize;
+        size_t   LargestFreeRange;
+    };
+
+    /**
+     * @param blockSize The size of a block. Allocations that are larger than this
+     * get a block of their own.
+     */
+    explicit BufferBlockAllocator( size_t blockSize );
+
+    /**
+     * Allocate a range of bytes. A new block is added if none of the existing blocks
+     * have room for the allocation. Check GetNumBlocks to see if a block was added.
+     *
+     * @param alignment Must be a power of two.
+     */
+    Allocation Allocate( size_t size, size_t alignment );
+
+    /**
+     * Return a range to the block it was allocated from.
+     * The range is merged with any adjacent free ranges.
+     */
+    void Free( const Allocation& allocation );
+
+    uint32_t GetNumBlocks() const
+    {
+        return static_cast<uint32_t>( m_Blocks.size() );
+    }
+
+    size_t GetBlockSize( uint32_t blockIndex ) const
+    {
+        return m_Blocks[blockIndex].Size;
+    }
+
+    BlockOccupancy GetBlockOccupancy( uint32_t blockIndex ) const;
+    Statistics     GetStatistics() const;
+
+    /**
+     * Defragmentation hooks.
+     * A defragmentation pass picks a candidate block, moves each of its allocations to another
+     * block with Relocate, copies the data, and frees the old allocations once the GPU is done with them.
+     */
+
+    /**
+     * Find the least occupied block whose allocations fit in the free space of the other blocks.
+     * Returns InvalidBlock if no block should be defragmented.
+     */
+    uint32_t FindDefragmentationCandidate() const;
+
+    /**
+     * Get the allocations of a block, sorted by offset.
+     */
+    std::vector<Allocation> GetAllocations( uint32_t blockIndex ) const;
+
+    /**
+     * Allocate a range with the same size in a different block that is at least as occupied as
+     * the block of the given allocation. No blocks are added and the original allocation is not freed.
+     * Returns an invalid allocation if there is no room.
+     */
+    Allocation Relocate( const Allocation& allocation, size_t alignment );
+
+private:
+    struct Block
+    {
+        size_t Size;
+        size_t UsedSize;
+
+        // Free ranges by offset and by size.
+        std::map<size_t, size_t>      FreeRanges;
+        std::multimap<size_t, size_t> FreeRangesBySize;
+
+        // Allocated ranges by offset.
+        std::map<size_t, size_t> Allocations;
+    };
+
+    // Try to allocate from a single block. Returns false if the block doesn't have a range that is large enough.
+    bool AllocateFromBlock( uint32_t blockIndex, size_t size, size_t alignment, Allocation& allocation );
+
+    void AddFreeRange( Block& block, size_t offset, size_t size );
+    void RemoveFreeRange( Block& block, std::map<size_t, size_t>::iterator iter );
+
+    size_t             m_BlockSize;
+    std::vector<Block> m_Blocks;
+};
+}  // namespace DX12_Library
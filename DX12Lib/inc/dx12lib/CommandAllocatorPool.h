@@ -0,0 +1,107 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+/*
+ * The command allocator pool hands out the command allocators of a command queue. A command list
+ * acquires an allocator when it is reset and releases it with the fence value of the
+ * ExecuteCommandLists call that submitted it. The allocator is reset and reused as soon as the
+ * GPU reaches that fence value, so allocators are not tied to a command list and command lists
+ * that are waiting to be reused don't hold on to an allocator.
+ *
+ * Allocators keep the memory of their largest recording, so the most recently used allocators are
+ * reused first and allocators that are not used for a while are released.
+ */
+namespace DX12_Library
+{
+
+class CommandQueue;
+class Device;
+
+class CommandAllocatorPool
+{
+public:
+    // Allocators that were not acquired in this many acquires are released.
+    static const uint64_t MaxUnusedAcquires = 256;
+
+    struct Statistics
+    {
+        // All allocators of the pool.
+        uint32_t NumAllocators;
+        uint32_t PeakNumAllocators;
+        // Allocators that are recording or waiting for the GPU.
+        uint32_t NumActiveAllocators;
+        // Allocators that were submitted and are waiting for the GPU.
+        uint32_t NumInFlightAllocators;
+        // Allocators that are ready to be reused.
+        uint32_t NumAvailableAllocators;
+        // The totals since the pool was created.
+        uint64_t NumCreatedAllocators;
+        uint64_t NumReusedAllocators;
+        uint64_t NumReleasedAllocators;
+    };
+
+    /**
+     * Get an allocator that is not used by the GPU or another command list.
+     * The allocator is reset and ready to be used by a command list.
+     */
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Acquire();
+
+    /**
+     * Return an allocator to the pool. The allocator is reused as soon as the
+     * command queue reaches the fence value. Use a fence value of 0 for allocators
+     * that were never executed.
+     */
+    void Release( Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator, uint64_t fenceValue );
+
+    Statistics GetStatistics() const;
+
+protected:
+    friend class std::default_delete<CommandAllocatorPool>;
+
+    CommandAllocatorPool( Device& device, CommandQueue& commandQueue, D3D12_COMMAND_LIST_TYPE type );
+    virtual ~CommandAllocatorPool() = default;
+
+private:
+    struct InFlightAllocator
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocator;
+        uint64_t                                       FenceValue;
+    };
+
+    struct AvailableAllocator
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocator;
+        // The number of acquires when the allocator was last acquired.
+        uint64_t LastAcquire;
+    };
+
+    // Move the in-flight allocators that the GPU is done with to the available allocators
+    // and release the allocators that were not used for a while.
+    // The mutex must be held by the caller.
+    void ReleaseCompletedAllocators();
+
+    Device&                 m_Device;
+    CommandQueue&           m_CommandQueue;
+    D3D12_COMMAND_LIST_TYPE m_CommandListType;
+
+    // The fence values of a queue only increase, so the in-flight allocators are sorted by fence value.
+    std::deque<InFlightAllocator> m_InFlightAllocators;
+    // The most recently used allocators are at the back.
+    std::deque<AvailableAllocator> m_AvailableAllocators;
+
+    uint32_t m_NumAllocators;
+    uint32_t m_PeakNumAllocators;
+    uint64_t m_NumAcquires;
+    uint64_t m_NumCreatedAllocators;
+    uint64_t m_NumReleasedAllocators;
+
+    mutable std::mutex m_Mutex;
+};
+}  // namespace DX12_Library
@@ -1,6 +1,11 @@
 #pragma once
 
 
+#include "DynamicDescriptorHeap.h"
+#include "MipGenerator.h"
+#include "StaticBufferAllocator.h"
+#include "SyncPoint.h"
+#include "UploadManager.h"
 #include "VertexTypes.h"
 
 #include <DirectXMath.h>
@@ -11,6 +16,7 @@
 #include <map>         // for std::map
 #include <memory>      // for std::unique_ptr
 #include <mutex>       // for std::mutex
+#include <string>      // for std::string
 #include <vector>      // for std::vector
 /*
  * The command list is a list of drawing or state-changing
@@ -21,11 +27,14 @@ namespace DX12_Library
 
 class Buffer;
 class ByteAddressBuffer;
+class CommandStream;
+class CommandStreamObjects;
 class ConstantBuffer;
 class ConstantBufferView;
 class Device;
 class DynamicDescriptorHeap;
 class GenerateMipsPSO;
+class GpuProfiler;
 class IndexBuffer;
 class PanoToCubemapPSO;
 class PipelineStateObject;
@@ -83,6 +92,17 @@ public:
     void TransitionBarrier( Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES stateAfter,
                             UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, bool flushBarriers = false );
 
+    /**
+     * Begin a split transition of a resource. Use this after the last use of a resource in its current state
+     * if the resource is not needed in the new state until much later. The GPU can perform the transition
+     * in the meantime. The transition ends with the next TransitionBarrier of the resource, which must be
+     * done before the resource is used again.
+     *
+     * If the split transition ends before any other work is recorded, a normal barrier is used instead.
+     */
+    void BeginTransitionBarrier( const std::shared_ptr<Resource>& resource, D3D12_RESOURCE_STATES stateAfter,
+                                 UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+
     /**
      * Add a UAV barrier to ensure that any writes to a resource have completed
      * before reading from the resource.
@@ -282,7 +302,9 @@ public:
     /**
      * Generate mips for the texture.
      * The first subresource is used to generate the mip chain.
-     * Mips are automatically generated for textures loaded from files.
+     * Mips are automatically generated for textures loaded from files. The mips of loaded textures
+     * and the mips that are generated on copy command lists are generated by the mip generator of the
+     * device on the compute queue (see MipGenerator).
      */
     void GenerateMips( const std::shared_ptr<Texture>& texture );
 
@@ -297,6 +319,13 @@ public:
     void CopyTextureSubresource( const std::shared_ptr<Texture>& texture, uint32_t firstSubresource,
                                  uint32_t numSubresources, D3D12_SUBRESOURCE_DATA* subresourceData );
 
+    /**
+     * The command list uses the results of a submission to another command queue (for example, a resource
+     * that was written on the compute queue). The command queue waits for the sync point on the GPU before
+     * the command list is executed. Only the latest sync point of each queue is kept.
+     */
+    void AddDependency( const SyncPoint& syncPoint );
+
     /**
      * Set a dynamic constant buffer data to an inline descriptor in the root
      * signature.
@@ -456,6 +485,22 @@ public:
                                                                    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
                                 UINT firstSubresource = 0,
                                 UINT numSubresources  = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+    /**
+     * Use a texture through its index in the bindless descriptor heap.
+     * The texture is transitioned to the requested state and kept alive while the command
+     * list is in-flight but no descriptors are copied.
+     *
+     * @returns The index of the texture's SRV in the bindless descriptor heap.
+     */
+    uint32_t SetBindlessShaderResourceView( const std::shared_ptr<Texture>& texture,
+                                            D3D12_RESOURCE_STATES           stateAfter =
+                                                D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+                                                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+    uint32_t SetBindlessShaderResourceView( const std::shared_ptr<ShaderResourceView>& srv,
+                                            D3D12_RESOURCE_STATES                      stateAfter =
+                                                D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+                                                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+
     /**
      * Set the UAV on the graphics pipeline.
      */
@@ -479,6 +524,49 @@ public:
      */
     void SetRenderTarget( const RenderTarget& renderTarget );
 
+    /**
+     * Bind the render target, viewports, scissor rectangles, root signatures, pipeline state and
+     * primitive topology that are bound to another command list. This is used to continue recording
+     * the work of a command list on multiple command lists. The root arguments are not inherited.
+     * Profile scopes that are begun on this command list are nested in the open scopes of the other command list.
+     */
+    void InheritState( const CommandList& commandList );
+
+    /**
+     * Begin a GPU timestamp scope. Scopes that are begun while another scope of the command list is open
+     * are nested in it. Every scope must be ended on the same command list, unless the open scopes are
+     * continued on another command list (see ContinueProfileScopes).
+     * The scope is not measured if the command list is not a command list of the queue of the profiler.
+     */
+    void BeginProfileScope( GpuProfiler& profiler, const std::string& name );
+
+    /**
+     * End the innermost open GPU timestamp scope of the command list.
+     */
+    void EndProfileScope();
+
+    /**
+     * Move the open GPU timestamp scopes of another command list to this command list, so that they are
+     * ended on this command list. This is used when the work of a scope is continued on a command list that
+     * is executed after the other command list.
+     */
+    void ContinueProfileScopes( CommandList& commandList );
+
+    /**
+     * Begin capturing the commands that are recorded on the command list into a command stream.
+     * The commands are still recorded on the command list. Only the commands that a command stream can
+     * record are captured (barriers, copies, state, root arguments, SRVs, draws and dispatches); commands
+     * that are used internally by another captured command are not captured twice.
+     *
+     * @param objects The table that maps the objects of the commands to the handles in the stream.
+     */
+    void BeginCapture( CommandStream& commandStream, CommandStreamObjects& objects );
+
+    /**
+     * Stop capturing commands. Capturing also stops when the command list is reset for a new recording.
+     */
+    void EndCapture();
+
     /**
      * Draw geometry.
      */
@@ -491,9 +579,17 @@ public:
      */
     void Dispatch( uint32_t numGroupsX, uint32_t numGroupsY = 1, uint32_t numGroupsZ = 1 );
 
+    /**
+     * Get the descriptor table cache counters of the dynamic descriptor heap for the given descriptor heap type.
+     */
+    DynamicDescriptorHeap::Statistics GetDynamicDescriptorHeapStatistics( D3D12_DESCRIPTOR_HEAP_TYPE heapType ) const;
+
 protected:
     friend class CommandQueue;
     friend class DynamicDescriptorHeap;
+    friend class MipGenerator;
+    friend class TransientTextureAllocator;
+    friend class UploadManager;
     friend class std::default_delete<CommandList>;
 
     CommandList( Device& device, D3D12_COMMAND_LIST_TYPE type );
@@ -516,6 +612,7 @@ protected:
     /**
      * Reset the command list. This should only be called by the CommandQueue
      * before the command list is returned from CommandQueue::GetCommandList.
+     * The command list acquires a command allocator from the command allocator pool of the queue.
      */
     void Reset();
 
@@ -530,7 +627,7 @@ protected:
      */
     void SetDescriptorHeap( D3D12_DESCRIPTOR_HEAP_TYPE heapType, ID3D12DescriptorHeap* heap );
 
-    std::shared_ptr<CommandList> GetGenerateMipsCommandList() const
+    std::shared_ptr<CommandList> GetComputeCommandList() const
     {
         return m_ComputeCommandList;
     }
@@ -567,19 +664,72 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource> CopyBuffer( size_t bufferSize, const void* bufferData,
                                                        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE );
 
+    // Copy the contents of a CPU buffer to a range of a static buffer block.
+    StaticBufferAllocator::Allocation CopyStaticBuffer( StaticBufferAllocator::BufferType type, size_t bufferSize,
+                                                        const void* bufferData );
+
     // Binds the current descriptor heaps to the command list.
     void BindDescriptorHeaps();
 
+    // The command list must not be executed before the upload is finished.
+    void AddUploadDependency( const UploadManager::Ticket& ticket );
+
+    // The command list must not be executed before the mips are generated.
+    void AddMipDependency( const MipGenerator::Ticket& ticket );
+
+    // Captures a command into the command stream unless capturing is off or the command is called by
+    // another captured command (e.g. the barriers of SetShaderResourceView).
+    class CaptureScope
+    {
+    public:
+        explicit CaptureScope( CommandList& commandList )
+        : m_CommandList( commandList )
+        , m_CommandStream( commandList.m_CaptureDepth++ == 0 ? commandList.m_CommandStream : nullptr )
+        {}
+
+        ~CaptureScope()
+        {
+            --m_CommandList.m_CaptureDepth;
+        }
+
+        CommandStream* operator->() const
+        {
+            return m_CommandStream;
+        }
+
+        explicit operator bool() const
+        {
+            return m_CommandStream != nullptr;
+        }
+
+        // The table of the objects that the captured commands use.
+        CommandStreamObjects& Objects() const
+        {
+            return *m_CommandList.m_CommandStreamObjects;
+        }
+
+    private:
+        CommandList&   m_CommandList;
+        CommandStream* m_CommandStream;
+    };
+
+    // Bind the unbounded descriptor tables of the root signature to the bindless descriptor heap.
+    void BindBindlessDescriptorTables(
+        const std::shared_ptr<RootSignature>&                                                rootSignature,
+        std::function<void( ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE )> setFunc );
+
     // The device that is used to create this command list.
     Device&                                            m_Device;
     D3D12_COMMAND_LIST_TYPE                            m_d3d12CommandListType;
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> m_d3d12CommandList;
+    // The command allocator of the current recording. It is returned to the command allocator pool
+    // of the queue when the command list is executed.
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator>     m_d3d12CommandAllocator;
 
-    // For copy queues, it may be necessary to generate mips while loading textures.
-    // Mips can't be generated on copy queues but must be generated on compute or
-    // direct queues. In this case, a Compute command list is generated and executed
-    // after the copy queue is finished uploading the first sub resource.
+    // For copy queues, it may be necessary to convert textures while loading them
+    // (for example, PanoToCubemap). This can't be done on copy queues but must be done
+    // on compute or direct queues. In this case, a Compute command list is generated and
+    // executed after the copy command list. Mips are generated by the mip generator instead.
     std::shared_ptr<CommandList> m_ComputeCommandList;
 
     // Keep track of the currently bound root signatures to minimize root
@@ -588,10 +738,44 @@ private:
     // Keep track of the currently bond pipeline state object to minimize PSO changes.
     ID3D12PipelineState* m_PipelineState;
 
+    // The state that other command lists can inherit (see InheritState).
+    std::vector<std::shared_ptr<Texture>> m_RenderTargetTextures;
+    std::vector<D3D12_VIEWPORT>           m_Viewports;
+    std::vector<D3D12_RECT>               m_ScissorRects;
+    std::shared_ptr<RootSignature>        m_GraphicsRootSignature;
+    std::shared_ptr<RootSignature>        m_ComputeRootSignature;
+    std::shared_ptr<PipelineStateObject>  m_PipelineStateObject;
+    D3D_PRIMITIVE_TOPOLOGY                m_PrimitiveTopology;
+
+    // The open GPU timestamp scopes. The first m_NumInheritedProfileScopes scopes are open scopes
+    // of the command list that the state was inherited from and are not ended on this command list.
+    struct ProfileScope
+    {
+        GpuProfiler* Profiler;
+        uint32_t     Scope;
+    };
+    std::vector<ProfileScope> m_ProfileScopes;
+    size_t                    m_NumInheritedProfileScopes;
+
+    // The command stream that the commands are captured into (if any), the table of the objects of the
+    // captured commands and the number of captured commands that are currently being recorded.
+    CommandStream*        m_CommandStream;
+    CommandStreamObjects* m_CommandStreamObjects;
+    uint32_t              m_CaptureDepth;
+
     // Resource created in an upload heap. Useful for drawing of dynamic geometry
     // or for uploading constant buffer data that changes every draw call.
     std::unique_ptr<UploadBuffer> m_UploadBuffer;
 
+    // The latest upload on the copy queue that this command list depends on.
+    // The command queue waits for it before executing the command list.
+    UploadManager::Ticket m_UploadTicket;
+    // The latest mip generation batch that this command list depends on.
+    // The command queue waits for it before executing the command list.
+    MipGenerator::Ticket m_MipTicket;
+    // The submissions to other queues that this command list depends on (at most one per queue).
+    std::vector<SyncPoint> m_Dependencies;
+
     // Resource state tracker is used by the command list to track (per command list)
     // the current state of a resource. The resource state tracker also tracks the
     // global state of a resource in order to minimize resource state transitions.
@@ -620,9 +804,18 @@ private:
     // reset.
     TrackedObjects m_TrackedObjects;
 
+    // A texture that was loaded from a file.
+    struct CachedTexture
+    {
+        ID3D12Resource* Resource;
+        // The upload of the texture data. Command lists that use the cached texture
+        // must wait for it like the command list that loaded it.
+        UploadManager::Ticket UploadTicket;
+    };
+
     // Keep track of loaded textures to avoid loading the same texture multiple times.
-    static std::map<std::wstring, ID3D12Resource*> ms_TextureCache;
-    static std::mutex                              ms_TextureCacheMutex;
+    static std::map<std::wstring, CachedTexture> ms_TextureCache;
+    static std::mutex                            ms_TextureCacheMutex;
 };
 
 // Definition for inline functions.
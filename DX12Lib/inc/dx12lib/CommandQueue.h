@@ -3,11 +3,14 @@
 #include <d3d12.h>  // For ID3D12CommandQueue, ID3D12Device2, and ID3D12Fence
 #include <wrl.h>    // For Microsoft::WRL::ComPtr
 
-#include <atomic>              // For std::atomic_bool
+#include <atomic>              // For std::atomic_uint64_t
 #include <condition_variable>  // For std::condition_variable.
 #include <cstdint>             // For uint64_t
+#include <memory>              // For std::unique_ptr
+#include <mutex>               // For std::mutex
 
-#include "ThreadSafeQueue.h"
+#include "MPMCQueue.h"
+#include "SyncPoint.h"
 /*
  * The command queue keeps an order of what command lists get executed and when they
  * get executed based on the current work load. The main goal is allow the bundelling of
@@ -16,12 +19,25 @@
 namespace DX12_Library
 {
 
+class CommandAllocatorPool;
 class CommandList;
 class Device;
+class UploadRingBuffer;
 
 class CommandQueue
 {
 public:
+    struct Statistics
+    {
+        // The time (in seconds) that the queue had no command lists in flight.
+        double IdleTime;
+        // The time (in seconds) that threads were blocked in WaitForFenceValue, including the
+        // thread that processes the in-flight command lists.
+        double FenceWaitTime;
+        // The number of waits that had to block.
+        uint64_t NumFenceWaits;
+    };
+
     // Get an available command list from the command queue.
     // The command allocator is used to reserve memory for recording the GPU command. The command allocator cannot be
     // reused until all the GPU commands stored are executed on the GPU. One command allocator needed per render frame
@@ -30,26 +46,60 @@ public:
     std::shared_ptr<CommandList> GetCommandList();
 
     // Execute a command list.
-    // Returns the fence value to wait for for this command list.
+    // Returns the sync point to wait for for this command list.
     // Synchronization objects
     // Fence is an object used to synchonize commands issued to the Command Queue
     // It is recommended to create one fence object for each command queue to avoid problems with synchronization
     // Frame Fence Values are used to keep track of fence values that were used to single the command queue
     // IMPORTANT:If fence object doesnt reach a fence value specified for the frame the CPU thread will stall until
     // the fence value is reached which could cause drop in performance.
-    uint64_t ExecuteCommandList( std::shared_ptr<CommandList> commandList );
-    uint64_t ExecuteCommandLists( const std::vector<std::shared_ptr<CommandList>>& commandLists );
+    // The queue waits (on the GPU) for the dependencies of the command lists (see CommandList::AddDependency)
+    // before they are executed.
+    SyncPoint ExecuteCommandList( std::shared_ptr<CommandList> commandList );
+    SyncPoint ExecuteCommandLists( const std::vector<std::shared_ptr<CommandList>>& commandLists );
 
     uint64_t Signal();
     bool     IsFenceComplete( uint64_t fenceValue );
+
+    // The last fence value that was signaled on this queue.
+    uint64_t GetFenceValue() const;
+    // The last fence value that was reached by the GPU.
+    uint64_t GetCompletedFenceValue() const;
+
+    // Block the calling thread until the GPU reaches the fence value.
     void     WaitForFenceValue( uint64_t fenceValue );
     void     Flush();
 
-    // Wait for another command queue to finish.
+    // Wait until the command lists in flight are finished and destroy the command lists that are kept for reuse.
+    // The device calls this for all command queues before any of them is destroyed.
+    void ReleaseCommandLists();
+
+    // Wait for another command queue to finish all of the work that was submitted so far.
+    // Prefer waiting for the sync point of the work that is needed.
     void Wait( const CommandQueue& other );
+    // Wait for another command queue to reach a fence value.
+    void Wait( const CommandQueue& other, uint64_t fenceValue );
+    // Wait for a submission to another command queue. Sync points of this queue and
+    // invalid sync points are ignored, since the queue executes its own work in order.
+    void Wait( const SyncPoint& syncPoint );
 
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
 
+    // The totals since the queue was created.
+    Statistics GetStatistics() const;
+
+    // The command allocators that are shared by the command lists of this queue.
+    CommandAllocatorPool& GetCommandAllocatorPool()
+    {
+        return *m_CommandAllocatorPool;
+    }
+
+    // The upload ring buffer that is shared by the command lists of this queue.
+    UploadRingBuffer& GetUploadRingBuffer()
+    {
+        return *m_UploadRingBuffer;
+    }
+
 protected:
     friend class std::default_delete<CommandQueue>;
 
@@ -58,6 +108,11 @@ protected:
     virtual ~CommandQueue();
 
 private:
+    // The number of command lists that can be in flight before ExecuteCommandLists blocks.
+    static const size_t MaxInFlightCommandLists = 1024;
+    // The number of command lists that are kept for reuse.
+    static const size_t MaxAvailableCommandLists = 256;
+
     // Free any command lists that are finished processing on the command queue.
     void ProccessInFlightCommandLists();
 
@@ -72,13 +127,31 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Fence>        m_d3d12Fence;
     std::atomic_uint64_t                       m_FenceValue;
 
-    ThreadSafeQueue<CommandListEntry>             m_InFlightCommandLists;
-    ThreadSafeQueue<std::shared_ptr<CommandList>> m_AvailableCommandLists;
+    // Serializes the submissions to the command queue.
+    std::mutex m_SubmitMutex;
+
+    // Must outlive the command lists since they return their blocks when they are destroyed.
+    std::unique_ptr<UploadRingBuffer> m_UploadRingBuffer;
+    std::unique_ptr<CommandAllocatorPool> m_CommandAllocatorPool;
 
-    // A thread to process in-flight command lists.
+    // Executing command lists blocks while the in-flight queue is full. Command lists that
+    // don't fit in the available queue are released instead of being reused.
+    MPMCQueue<CommandListEntry>             m_InFlightCommandLists;
+    MPMCQueue<std::shared_ptr<CommandList>> m_AvailableCommandLists;
+    // The command lists that were executed but not processed by the thread yet.
+    std::atomic_size_t m_NumInFlightCommandLists;
+
+    // A thread to process in-flight command lists. It sleeps in the in-flight queue until command
+    // lists are executed and blocks on the fence until they are finished. An entry without a
+    // command list stops the thread.
     std::thread             m_ProcessInFlightCommandListsThread;
-    std::atomic_bool        m_bProcessInFlightCommandLists;
+    // Flush waits until all in-flight command lists are processed.
     std::mutex              m_ProcessInFlightCommandListsThreadMutex;
     std::condition_variable m_ProcessInFlightCommandListsThreadCV;
+
+    // The statistics are stored in nanoseconds.
+    std::atomic_uint64_t m_IdleTime;
+    std::atomic_uint64_t m_FenceWaitTime;
+    std::atomic_uint64_t m_NumFenceWaits;
 };
 }  // namespace DX12_Library
\ No newline at end of file
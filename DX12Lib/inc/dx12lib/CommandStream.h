@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * A command stream records the draws, binds, barriers and copies of a command list in a compact byte stream.
+ * Every command is a small header followed by its arguments. Constants and dynamic buffer data are copied
+ * into the stream.
+ *
+ * The stream doesn't depend on Direct3D 12. The objects that a command uses (resources, pipeline states,
+ * root signatures, ...) are referred to by handles, and the resource states, primitive topologies,
+ * viewports and scissor rectangles are stored as plain values with the same values and layout as the
+ * Direct3D 12 types. A CommandStreamObjects table maps the objects of a command list to handles and back,
+ * see CommandList::BeginCapture.
+ *
+ * A stream can be replayed into any command backend:
+ * - into a command list, to execute it on the GPU (see CommandStreamObjects::Replay),
+ * - into a NullCommandBackend, which validates the state of the commands and counts the work without a GPU.
+ *
+ * The recording functions have the same names as the functions of the command list.
+ */
+namespace DX12_Library
+{
+
+/**
+ * The handle of an object that a command uses. Handles are indices of the objects, so objects of
+ * different types can have the same handle.
+ */
+using CommandObjectHandle = uint32_t;
+
+constexpr CommandObjectHandle InvalidCommandObject = UINT32_MAX;
+
+/**
+ * Applies to all subresources of a resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES).
+ */
+constexpr uint32_t AllSubresources = UINT32_MAX;
+
+/**
+ * The layout of D3D12_VIEWPORT.
+ */
+struct CommandViewport
+{
+    float TopLeftX;
+    float TopLeftY;
+    float Width;
+    float Height;
+    float MinDepth;
+    float MaxDepth;
+};
+
+/**
+ * The layout of D3D12_RECT.
+ */
+struct CommandRect
+{
+    int32_t Left;
+    int32_t Top;
+    int32_t Right;
+    int32_t Bottom;
+};
+
+/**
+ * The interface that a command stream is replayed into. Resource states are D3D12_RESOURCE_STATES and
+ * primitive topologies are D3D_PRIMITIVE_TOPOLOGY values.
+ */
+class CommandBackend
+{
+public:
+    virtual ~CommandBackend() = default;
+
+    // Barriers.
+    virtual void TransitionBarrier( CommandObjectHandle resource, uint32_t stateAfter, uint32_t subresource ) = 0;
+    virtual void UAVBarrier( CommandObjectHandle resource )                                                 = 0;
+    virtual void AliasingBarrier( CommandObjectHandle beforeResource, CommandObjectHandle afterResource )   = 0;
+
+    // Copies.
+    virtual void CopyResource( CommandObjectHandle dstRes, CommandObjectHandle srcRes ) = 0;
+    virtual void ResolveSubresource( CommandObjectHandle dstRes, CommandObjectHandle srcRes, uint32_t dstSubresource,
+                                     uint32_t srcSubresource )                          = 0;
+
+    // Pipeline state.
+    virtual void SetPipelineState( CommandObjectHandle pipelineState )                        = 0;
+    virtual void SetGraphicsRootSignature( CommandObjectHandle rootSignature )                = 0;
+    virtual void SetComputeRootSignature( CommandObjectHandle rootSignature )                 = 0;
+    virtual void SetPrimitiveTopology( uint32_t primitiveTopology )                           = 0;
+    virtual void SetVertexBuffer( uint32_t slot, CommandObjectHandle vertexBuffer )           = 0;
+    virtual void SetIndexBuffer( CommandObjectHandle indexBuffer )                            = 0;
+    virtual void SetViewports( const CommandViewport* viewports, uint32_t numViewports )      = 0;
+    virtual void SetScissorRects( const CommandRect* scissorRects, uint32_t numScissorRects ) = 0;
+    // The textures are indexed by attachment point (see AttachmentPoint), unused attachment points are
+    // InvalidCommandObject.
+    virtual void SetRenderTarget( const CommandObjectHandle* textures, uint32_t numTextures ) = 0;
+
+    // Root arguments.
+    virtual void SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                            const void* constants ) = 0;
+    virtual void SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                           const void* constants ) = 0;
+    virtual void SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes,
+                                                   const void* bufferData ) = 0;
+    virtual void SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
+                                                     const void* bufferData ) = 0;
+    virtual void SetShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
+                                        CommandObjectHandle srv, uint32_t stateAfter, uint32_t firstSubresource,
+                                        uint32_t numSubresources ) = 0;
+    virtual void SetTextureShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
+                                               CommandObjectHandle texture, uint32_t stateAfter,
+                                               uint32_t firstSubresource, uint32_t numSubresources ) = 0;
+    virtual void SetBindlessShaderResourceView( CommandObjectHandle srv, uint32_t stateAfter )            = 0;
+    virtual void SetBindlessTextureShaderResourceView( CommandObjectHandle texture, uint32_t stateAfter ) = 0;
+
+    // Work.
+    virtual void Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex,
+                       uint32_t startInstance ) = 0;
+    virtual void DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                              uint32_t startInstance ) = 0;
+    virtual void Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ ) = 0;
+};
+
+class CommandStream
+{
+public:
+    CommandStream();
+    ~CommandStream();
+
+    // Barriers.
+    void TransitionBarrier( CommandObjectHandle resource, uint32_t stateAfter, uint32_t subresource = AllSubresources );
+    void UAVBarrier( CommandObjectHandle resource = InvalidCommandObject );
+    void AliasingBarrier( CommandObjectHandle beforeResource = InvalidCommandObject,
+                          CommandObjectHandle afterResource  = InvalidCommandObject );
+
+    // Copies.
+    void CopyResource( CommandObjectHandle dstRes, CommandObjectHandle srcRes );
+    void ResolveSubresource( CommandObjectHandle dstRes, CommandObjectHandle srcRes, uint32_t dstSubresource = 0,
+                             uint32_t srcSubresource = 0 );
+
+    // Pipeline state.
+    void SetPipelineState( CommandObjectHandle pipelineState );
+    void SetGraphicsRootSignature( CommandObjectHandle rootSignature );
+    void SetComputeRootSignature( CommandObjectHandle rootSignature );
+    void SetPrimitiveTopology( uint32_t primitiveTopology );
+    void SetVertexBuffer( uint32_t slot, CommandObjectHandle vertexBuffer );
+    void SetIndexBuffer( CommandObjectHandle indexBuffer );
+    void SetViewports( const CommandViewport* viewports, uint32_t numViewports );
+    void SetScissorRects( const CommandRect* scissorRects, uint32_t numScissorRects );
+    void SetRenderTarget( const CommandObjectHandle* textures, uint32_t numTextures );
+
+    // Root arguments.
+    void SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants );
+    void SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants );
+    void SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes, const void* bufferData );
+    void SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
+                                             const void* bufferData );
+    void SetShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset, CommandObjectHandle srv,
+                                uint32_t stateAfter, uint32_t firstSubresource, uint32_t numSubresources );
+    void SetTextureShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
+                                       CommandObjectHandle texture, uint32_t stateAfter, uint32_t firstSubresource,
+                                       uint32_t numSubresources );
+    void SetBindlessShaderResourceView( CommandObjectHandle srv, uint32_t stateAfter );
+    void SetBindlessTextureShaderResourceView( CommandObjectHandle texture, uint32_t stateAfter );
+
+    // Work.
+    void Draw( uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t startVertex = 0, uint32_t startInstance = 0 );
+    void DrawIndexed( uint32_t indexCount, uint32_t instanceCount = 1, uint32_t startIndex = 0, int32_t baseVertex = 0,
+                      uint32_t startInstance = 0 );
+    void Dispatch( uint32_t numGroupsX, uint32_t numGroupsY = 1, uint32_t numGroupsZ = 1 );
+
+    /**
+     * Replay the commands in the order they were recorded.
+     */
+    void Replay( CommandBackend& backend ) const;
+
+    /**
+     * Remove all commands. The memory of the stream is kept.
+     */
+    void Clear();
+
+    size_t GetNumCommands() const
+    {
+        return m_NumCommands;
+    }
+
+    /**
+     * Get the size of the commands in bytes.
+     */
+    size_t GetSizeInBytes() const
+    {
+        return m_Data.size();
+    }
+
+private:
+    // Append a command with its arguments and optional data that follows the arguments.
+    template<typename Args>
+    void Write( uint8_t type, const Args& args, const void* data = nullptr, size_t dataSize = 0 );
+
+    std::vector<uint8_t> m_Data;
+    size_t               m_NumCommands;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "CommandStream.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * The command stream objects map the objects that the commands of a command stream use (resources,
+ * pipeline states, root signatures, ...) to handles and back. Every object is stored once, so the table
+ * also keeps the objects alive until it is cleared. The handles of an object type are the indices of the
+ * objects of that type.
+ *
+ * The objects are captured together with the commands of a command list:
+ *
+ *   CommandStream        commandStream;
+ *   CommandStreamObjects objects;
+ *   commandList->BeginCapture( commandStream, objects );
+ *   // Record commands.
+ *   commandList->EndCapture();
+ *
+ *   // Replay the commands into another command list.
+ *   objects.Replay( commandStream, *otherCommandList );
+ *
+ *   // Or validate them without a GPU.
+ *   NullCommandBackend backend;
+ *   objects.Describe( backend );
+ *   commandStream.Replay( backend );
+ */
+namespace DX12_Library
+{
+
+class CommandList;
+class IndexBuffer;
+class NullCommandBackend;
+class PipelineStateObject;
+class Resource;
+class RootSignature;
+class ShaderResourceView;
+class Texture;
+class VertexBuffer;
+
+class CommandStreamObjects
+{
+public:
+    CommandStreamObjects();
+    ~CommandStreamObjects();
+
+    /**
+     * Get the handle of an object. The object is added if it isn't in the table.
+     * A null object has the handle InvalidCommandObject.
+     */
+    CommandObjectHandle AddResource( const std::shared_ptr<Resource>& resource );
+    CommandObjectHandle AddTexture( const std::shared_ptr<Texture>& texture );
+    CommandObjectHandle AddPipelineState( const std::shared_ptr<PipelineStateObject>& pipelineState );
+    CommandObjectHandle AddRootSignature( const std::shared_ptr<RootSignature>& rootSignature );
+    CommandObjectHandle AddVertexBuffer( const std::shared_ptr<VertexBuffer>& vertexBuffer );
+    CommandObjectHandle AddIndexBuffer( const std::shared_ptr<IndexBuffer>& indexBuffer );
+    CommandObjectHandle AddShaderResourceView( const std::shared_ptr<ShaderResourceView>& srv );
+
+    /**
+     * Get the object of a handle. Returns null for InvalidCommandObject.
+     */
+    const std::shared_ptr<Resource>&            GetResource( CommandObjectHandle handle ) const;
+    const std::shared_ptr<Texture>&             GetTexture( CommandObjectHandle handle ) const;
+    const std::shared_ptr<PipelineStateObject>& GetPipelineState( CommandObjectHandle handle ) const;
+    const std::shared_ptr<RootSignature>&       GetRootSignature( CommandObjectHandle handle ) const;
+    const std::shared_ptr<VertexBuffer>&        GetVertexBuffer( CommandObjectHandle handle ) const;
+    const std::shared_ptr<IndexBuffer>&         GetIndexBuffer( CommandObjectHandle handle ) const;
+    const std::shared_ptr<ShaderResourceView>&  GetShaderResourceView( CommandObjectHandle handle ) const;
+
+    /**
+     * Replay the commands of a command stream that refer to these objects into a command list.
+     */
+    void Replay( const CommandStream& commandStream, CommandList& commandList ) const;
+
+    /**
+     * Describe the root signatures and index buffers to a null backend, so that it can validate the
+     * root parameter indices and index ranges of the commands.
+     */
+    void Describe( NullCommandBackend& backend ) const;
+
+    /**
+     * Remove and release all objects.
+     */
+    void Clear();
+
+private:
+    // The objects of one type.
+    template<typename T>
+    struct ObjectTable
+    {
+        std::vector<std::shared_ptr<T>>        Objects;
+        std::unordered_map<const T*, uint32_t> Indices;
+        // Consecutive commands often use the same object, so the last object is checked before the map.
+        uint32_t LastIndex = InvalidCommandObject;
+
+        CommandObjectHandle       Add( const std::shared_ptr<T>& object );
+        const std::shared_ptr<T>& Get( CommandObjectHandle handle ) const;
+        void                      Clear();
+    };
+
+    ObjectTable<Resource>            m_Resources;
+    ObjectTable<Texture>             m_Textures;
+    ObjectTable<PipelineStateObject> m_PipelineStates;
+    ObjectTable<RootSignature>       m_RootSignatures;
+    ObjectTable<VertexBuffer>        m_VertexBuffers;
+    ObjectTable<IndexBuffer>         m_IndexBuffers;
+    ObjectTable<ShaderResourceView>  m_ShaderResourceViews;
+};
+}  // namespace DX12_Library
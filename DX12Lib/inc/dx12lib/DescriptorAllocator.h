@@ -4,6 +4,7 @@
 
 #include "d3dx12.h"
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -24,10 +25,35 @@ public:
     DX12_Library::DescriptorAllocation Allocate( uint32_t numDescriptors = 1 );
 
     /**
-     * When the frame has completed, the stale descriptors can be released.
+     * Release the stale descriptors that are no longer in use by the GPU.
+     * Stale descriptors are also released automatically before a new page is created.
      */
     void ReleaseStaleDescriptors();
 
+    /**
+     * Counters that show how often the shared pages had to be accessed.
+     */
+    struct Statistics
+    {
+        // Total number of calls to Allocate.
+        uint64_t NumAllocations;
+        // Single descriptor allocations that were served from a thread's magazine without locking the shared pages.
+        uint64_t NumMagazineHits;
+        // Number of times a thread's magazine was refilled from the shared pages.
+        uint64_t NumMagazineRefills;
+        // Number of times the allocation mutex was acquired.
+        uint64_t NumLocks;
+        // Number of times the allocation mutex was already held by another thread.
+        uint64_t NumContendedLocks;
+        // Number of stale descriptors that were returned to the pages.
+        uint64_t NumReleasedDescriptors;
+    };
+
+    Statistics GetStatistics() const;
+
+    // The number of single descriptors that are cached per thread.
+    static const uint32_t MagazineSize = 32;
+
 protected:
     friend class std::default_delete<DescriptorAllocator>;
 
@@ -43,10 +69,69 @@ private:
     // Alias of std::vector of Descriptor Allocator Pages
     using DescriptorHeapPool = std::vector<std::shared_ptr<DescriptorAllocatorPage>>;
 
+    // A per-thread cache of single descriptors.
+    // Magazines are used by the thread that owns them so that allocating a single descriptor
+    // does not touch the shared pages. The magazine is shared with the allocator so that it
+    // can return the cached descriptors when it is destroyed before the thread. When the thread
+    // exits, the remaining descriptors are returned to their pages.
+    struct Magazine
+    {
+        Magazine()
+        : Count( 0 )
+        , NumAllocations( 0 )
+        , NumHits( 0 )
+        , IsOrphaned( false )
+        , IsThreadExited( false )
+        {}
+
+        // Return the cached descriptors to their pages.
+        // The magazine mutex must be held by the caller.
+        void Drain()
+        {
+            while ( Count > 0 )
+            {
+                Descriptors[--Count] = DescriptorAllocation();
+            }
+        }
+
+        // Held by the owning thread while it refills the magazine and by the allocator or the exiting
+        // thread while they drain it. Taking a descriptor from a filled magazine needs no lock.
+        std::mutex           Mutex;
+        uint32_t             Count;
+        DescriptorAllocation Descriptors[MagazineSize];
+        // Only written by the owning thread and summed by GetStatistics, so that the single
+        // descriptor path does not update counters that are shared between threads.
+        std::atomic_uint64_t NumAllocations;
+        std::atomic_uint64_t NumHits;
+        // Set with release semantics after the allocator drained the magazine in its destructor.
+        std::atomic_bool IsOrphaned;
+        // Set when the owning thread has exited. The counters don't change anymore.
+        std::atomic_bool IsThreadExited;
+    };
+
     // Internal method that is used to create a new allocator page if
     // there are no pages in the allocator pool to satisfy the allocation request.
     std::shared_ptr<DescriptorAllocatorPage> CreateAllocatorPage();
 
+    // Allocate descriptors from the shared pages.
+    // The allocation mutex must be held by the caller.
+    DescriptorAllocation AllocateFromPages( uint32_t numDescriptors );
+
+    // Allocate a number of single descriptors from the shared pages, taking every page lock once.
+    // The allocation mutex must be held by the caller.
+    void AllocateSinglesFromPages( DescriptorAllocation* descriptors, uint32_t numDescriptors );
+
+    // Return the stale descriptors of all pages whose fences have completed.
+    // The allocation mutex must be held by the caller.
+    // Returns the number of descriptors that were released.
+    uint32_t ReleaseCompletedDescriptors();
+
+    // Get (or create) the calling thread's magazine for this allocator.
+    Magazine& GetThreadMagazine();
+
+    // Acquire the allocation mutex and update the contention counters.
+    std::unique_lock<std::mutex> LockAllocationMutex();
+
     // The device that was use to create this DescriptorAllocator.
     Device&                    m_Device;
     D3D12_DESCRIPTOR_HEAP_TYPE m_HeapType;
@@ -60,6 +145,23 @@ private:
     // DescriptorAllocatorPage that can satisfy the requested allocation.
     std::set<size_t> m_AvailableHeaps;
 
-    std::mutex m_AllocationMutex;
+    // Unique identifier used to find the thread's magazine for this allocator.
+    uint64_t m_AllocatorID;
+    // Magazines of all threads that allocated from this allocator.
+    // The magazines of exited threads are removed when a new magazine is added.
+    std::vector<std::shared_ptr<Magazine>> m_Magazines;
+
+    // The counters below are protected by the allocation mutex.
+    // Allocations of the magazines of exited threads.
+    uint64_t m_NumRetiredAllocations;
+    uint64_t m_NumRetiredMagazineHits;
+    // Allocations of more than one descriptor.
+    uint64_t m_NumRangeAllocations;
+    uint64_t m_NumMagazineRefills;
+    uint64_t m_NumLocks;
+    uint64_t m_NumContendedLocks;
+    uint64_t m_NumReleasedDescriptors;
+
+    mutable std::mutex m_AllocationMutex;
 };
 }  // namespace DX12_Library
\ No newline at end of file
@@ -1,15 +1,18 @@
 #pragma once
 
 #include "DescriptorAllocation.h"
+#include "DescriptorFreeList.h"
 
 #include <d3d12.h>
 
 #include <wrl.h>
 
-#include <map>
+#include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 namespace DX12_Library
 {
@@ -19,6 +22,26 @@ class Device;
 class DescriptorAllocatorPage : public std::enable_shared_from_this<DescriptorAllocatorPage>
 {
 public:
+    // Fence values of the direct, compute and copy command queues of the device.
+    using QueueFenceValues = std::array<uint64_t, 3>;
+
+    /**
+     * Get the last fence values that were signaled on every command queue of the device.
+     */
+    static QueueFenceValues GetSignaledFenceValues( Device& device );
+
+    /**
+     * Get the fence values that have been reached by the GPU on every command queue of the device.
+     */
+    static QueueFenceValues GetCompletedFenceValues( Device& device );
+
+    /**
+     * Get a counter that is incremented whenever freed descriptors of any page are returned to
+     * a free list. After that, the descriptors can be allocated and written again, so copies of
+     * descriptors that were made before (see DynamicDescriptorHeap) may be out of date.
+     */
+    static uint64_t GetReleaseGeneration();
+
     D3D12_DESCRIPTOR_HEAP_TYPE GetHeapType() const;
 
     /**
@@ -39,18 +62,31 @@ public:
      */
     DescriptorAllocation Allocate( uint32_t numDescriptors );
 
+    /**
+     * Allocate up to numDescriptors single descriptors from this descriptor heap while
+     * taking the lock only once. The descriptors are taken from one contiguous block if
+     * there is one that is large enough.
+     *
+     * @returns The number of descriptors that were written to the descriptors array.
+     */
+    uint32_t AllocateSingles( DescriptorAllocation* descriptors, uint32_t numDescriptors );
+
     /**
      * Return a descriptor back to the heap.
-     * frameNumber Stale descriptors are not freed directly, but put
-     * on a stale allocations queue. Stale allocations are returned to the heap
-     * using the DescriptorAllocatorPage::ReleaseStaleAllocations method.
+     * Stale descriptors are not freed directly, but put on a stale allocations queue
+     * together with the last fence value that was signaled on every command queue.
+     * Stale allocations are returned to the heap using the
+     * DescriptorAllocatorPage::ReleaseStaleDescriptors method once those fences have completed.
      */
     void Free( DescriptorAllocation&& descriptorHandle );
 
     /**
-     * Returned the stale descriptors back to the descriptor heap.
+     * Return the stale descriptors whose fence values have been reached back to the descriptor heap.
+     * Stale descriptors that may still be in use by the GPU stay in the queue.
+     *
+     * @returns The number of descriptors that were returned to the heap.
      */
-    void ReleaseStaleDescriptors();
+    uint32_t ReleaseStaleDescriptors( const QueueFenceValues& completedFenceValues );
 
 protected:
     DescriptorAllocatorPage( Device& device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors );
@@ -59,9 +95,6 @@ protected:
     // Compute the offset of the descriptor handle from the start of the heap.
     uint32_t ComputeOffset( D3D12_CPU_DESCRIPTOR_HANDLE handle );
 
-    // Adds a new block to the free list.
-    void AddNewBlock( uint32_t offset, uint32_t numDescriptors );
-
     // Free a block of descriptors.
     // This will also merge free blocks in the free list to form larger blocks
     // that can be reused.
@@ -73,55 +106,46 @@ private:
     // The number of descriptors that are available.
     using SizeType = uint32_t;
 
-    struct FreeBlockInfo;
-    // A map that lists the free blocks by the offset within the descriptor heap.
-    using FreeListByOffset = std::map<OffsetType, FreeBlockInfo>;
-
-    // A map that lists the free blocks by size.
-    // Needs to be a multimap since multiple blocks can have the same size.
-    using FreeListBySize = std::multimap<SizeType, FreeListByOffset::iterator>;
-
-    struct FreeBlockInfo
-    {
-        FreeBlockInfo( SizeType size )
-        : Size( size )
-        {}
-
-        SizeType                 Size;
-        FreeListBySize::iterator FreeListBySizeIt;
-    };
-
     struct StaleDescriptorInfo
     {
-        StaleDescriptorInfo( OffsetType offset, SizeType size )
+        StaleDescriptorInfo( OffsetType offset, SizeType size, const QueueFenceValues& fenceValues )
         : Offset( offset )
         , Size( size )
+        , FenceValues( fenceValues )
         {}
 
         // The offset within the descriptor heap.
         OffsetType Offset;
         // The number of descriptors
         SizeType Size;
+        // The descriptors can be reused once these fence values are reached.
+        QueueFenceValues FenceValues;
     };
 
     // Device that was used to create the descriptor heap.
     Device& m_Device;
 
-    // Stale descriptors are queued for release until the frame that they were freed
-    // has completed.
+    // Stale descriptors are queued for release until the fences that were signaled
+    // when they were freed have completed. Fence values only increase, so
+    // the queue is sorted by the fence values.
     using StaleDescriptorQueue = std::queue<StaleDescriptorInfo>;
 
-    FreeListByOffset     m_FreeListByOffset;
-    FreeListBySize       m_FreeListBySize;
+    // Tracks the free blocks of the descriptor heap.
+    DescriptorFreeList   m_FreeList;
     StaleDescriptorQueue m_StaleDescriptors;
+    // Stale descriptors that are released together are sorted by offset
+    // before they are returned to the free list.
+    // The storage is reused to avoid allocating memory when releasing descriptors.
+    std::vector<StaleDescriptorInfo> m_ReleaseBatch;
 
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12DescriptorHeap;
     D3D12_DESCRIPTOR_HEAP_TYPE                   m_HeapType;
     CD3DX12_CPU_DESCRIPTOR_HANDLE                m_BaseDescriptor;
     uint32_t                                     m_DescriptorHandleIncrementSize;
     uint32_t                                     m_NumDescriptorsInHeap;
-    uint32_t                                     m_NumFreeHandles;
 
     std::mutex m_AllocationMutex;
+
+    static std::atomic_uint64_t ms_ReleaseGeneration;
 };
 }  // namespace DX12_Library
\ No newline at end of file
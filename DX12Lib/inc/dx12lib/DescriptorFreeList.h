@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace DX12_Library
+{
+/*
+ * A two-level segregated-fit (TLSF) free list used to manage the descriptors
+ * of a single DescriptorAllocatorPage.
+ *
+ * Free blocks are binned by size in a first level (power of two) and a second level
+ * (linear subdivision of that power of two) with a bitmap per level, so finding a
+ * suitable block, splitting it and coalescing a freed block with its neighbours are
+ * all constant time operations. All block bookkeeping is stored in arrays indexed by
+ * the descriptor offset which are allocated once on construction, so no memory is
+ * allocated when allocating or freeing descriptors.
+ *
+ * This class does not depend on D3D12 and only deals with offsets and sizes.
+ */
+class DescriptorFreeList
+{
+public:
+    // Returned from Allocate if the request could not be satisfied.
+    static const uint32_t InvalidOffset = 0xffffffff;
+
+    explicit DescriptorFreeList( uint32_t capacity );
+
+    /**
+     * Allocate a contiguous range of descriptors.
+     *
+     * @returns The offset of the first descriptor in the range or InvalidOffset
+     * if there is no free block large enough to satisfy the request.
+     */
+    uint32_t Allocate( uint32_t numDescriptors );
+
+    /**
+     * Return a range of descriptors to the free list.
+     * The range is merged with any adjacent free blocks.
+     */
+    void Free( uint32_t offset, uint32_t numDescriptors );
+
+    /**
+     * Check to see if a block large enough to satisfy the request can be found.
+     */
+    bool HasSpace( uint32_t numDescriptors ) const;
+
+    uint32_t NumFreeHandles() const
+    {
+        return m_NumFreeHandles;
+    }
+
+    uint32_t GetCapacity() const
+    {
+        return m_Capacity;
+    }
+
+private:
+    // Number of second level bins per first level bin (expressed as a power of two).
+    static const uint32_t SLIndexLog2 = 4;
+    static const uint32_t SLCount     = 1u << SLIndexLog2;
+    // Sizes smaller than SLCount are mapped linearly into the first bin.
+    static const uint32_t FLCount = 32 - SLIndexLog2 + 1;
+
+    struct Block
+    {
+        // The number of descriptors in the block (only valid at the start of a block).
+        uint32_t Size;
+        // Previous and next free blocks in the same bin.
+        uint32_t PrevFree;
+        uint32_t NextFree;
+        // Only true at the start of a block that is currently in the free list.
+        bool IsFree;
+    };
+
+    // Compute the bin indices for a block of the given size.
+    static void MappingInsert( uint32_t size, uint32_t& fl, uint32_t& sl );
+    // Compute the bin indices of the first bin that only contains blocks of (at least) the given size.
+    static void MappingSearch( uint32_t size, uint32_t& fl, uint32_t& sl );
+
+    // Find a non-empty bin starting from ( fl, sl ). Returns false if none was found.
+    bool FindSuitableBin( uint32_t& fl, uint32_t& sl ) const;
+    // Slow path: search the bin that the request maps to for a block that is large enough.
+    // Only used if FindSuitableBin fails.
+    uint32_t FindInExactBin( uint32_t size ) const;
+
+    void InsertFreeBlock( uint32_t offset, uint32_t size );
+    void RemoveFreeBlock( uint32_t offset );
+
+    uint32_t m_Capacity;
+    uint32_t m_NumFreeHandles;
+
+    // Bit i is set if m_SLBitmap[i] is non-zero.
+    uint32_t m_FLBitmap;
+    // Bit j of m_SLBitmap[i] is set if the bin ( i, j ) is non-empty.
+    uint32_t m_SLBitmap[FLCount];
+    // The first free block in each bin.
+    uint32_t m_BinHeads[FLCount][SLCount];
+
+    // Block headers indexed by the offset of the start of the block.
+    std::vector<Block> m_Blocks;
+    // For free blocks, maps the offset of the last descriptor to the start of the block.
+    // Used to find the free block that precedes a freed range.
+    std::vector<uint32_t> m_BlockStart;
+};
+}  // namespace DX12_Library
@@ -3,6 +3,10 @@
 #pragma once
 
 #include "DescriptorAllocation.h"
+#include "DescriptorAllocator.h"
+#include "ResourceStateTracker.h"
+#include "StaticBufferAllocator.h"
+#include "UploadRingBuffer.h"
 
 #include "d3dx12.h"
 #include <dxgi1_6.h>
@@ -18,15 +22,19 @@ namespace DX12_Library
 {
 
 class Adapter;
+class BindlessDescriptorHeap;
 class ByteAddressBuffer;
 class CommandQueue;
 class CommandList;
 class ConstantBuffer;
 class ConstantBufferView;
 class DescriptorAllocator;
+class GpuProfiler;
 class GUI;
 class IndexBuffer;
+class ParallelCommandRecorder;
 class PipelineStateObject;
+class RenderGraph;
 class RenderTarget;
 class Resource;
 class RootSignature;
@@ -35,7 +43,10 @@ class ShaderResourceView;
 class StructuredBuffer;
 class SwapChain;
 class Texture;
+class TransientTextureAllocator;
 class UnorderedAccessView;
+class MipGenerator;
+class UploadManager;
 class VertexBuffer;
 
 class Device
@@ -52,8 +63,11 @@ public:
     /**
      * Create a new DX12 device using the provided adapter.
      * If no adapter is specified, then the highest performance adapter will be  chosen.
+     * If enableBindless is true, textures and shader resource views get a stable index in a
+     * shader visible bindless descriptor heap. Bindless is only enabled if the adapter supports
+     * resource binding tier 2 or higher.
      */
-    static std::shared_ptr<Device> Create( std::shared_ptr<Adapter> adapter = nullptr );
+    static std::shared_ptr<Device> Create( std::shared_ptr<Adapter> adapter = nullptr, bool enableBindless = false );
 
     /**
      * Get a description of the adapter that was used to create the device.
@@ -65,6 +79,54 @@ public:
      */
     DescriptorAllocation AllocateDescriptors( D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors = 1 );
 
+    /**
+     * Get the allocation and lock contention counters of a descriptor allocator.
+     */
+    DescriptorAllocator::Statistics GetDescriptorAllocatorStatistics( D3D12_DESCRIPTOR_HEAP_TYPE type ) const;
+
+    /**
+     * Get the current and peak upload heap memory of a command queue.
+     */
+    UploadRingBuffer::Statistics GetUploadStatistics( D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT );
+
+    /**
+     * Get the number of barriers that were recorded and removed in the previous frame.
+     */
+    ResourceStateTracker::Statistics GetResourceBarrierStatistics() const;
+
+    /**
+     * Get the upload manager that batches buffer and texture uploads on the copy queue.
+     */
+    UploadManager& GetUploadManager()
+    {
+        return *m_UploadManager;
+    }
+
+    /**
+     * Get the mip generator that batches the mip generation of loaded textures on the compute queue.
+     */
+    MipGenerator& GetMipGenerator()
+    {
+        return *m_MipGenerator;
+    }
+
+    /**
+     * Get the allocator that places static vertex and index data in large default heap buffers.
+     */
+    StaticBufferAllocator& GetStaticBufferAllocator()
+    {
+        return *m_StaticBufferAllocator;
+    }
+
+    /**
+     * Get the bindless descriptor heap.
+     * Returns nullptr if bindless descriptors are not enabled.
+     */
+    BindlessDescriptorHeap* GetBindlessDescriptorHeap() const
+    {
+        return m_BindlessDescriptorHeap.get();
+    }
+
     /**
      * Gets the size of the handle increment for the given type of descriptor heap.
      */
@@ -121,10 +183,14 @@ public:
     std::shared_ptr<IndexBuffer> CreateIndexBuffer( size_t numIndicies, DXGI_FORMAT indexFormat );
     std::shared_ptr<IndexBuffer> CreateIndexBuffer( Microsoft::WRL::ComPtr<ID3D12Resource> resource, size_t numIndices,
                                                     DXGI_FORMAT indexFormat );
+    std::shared_ptr<IndexBuffer> CreateIndexBuffer( const StaticBufferAllocator::Allocation& allocation,
+                                                    size_t numIndices, DXGI_FORMAT indexFormat );
 
     std::shared_ptr<VertexBuffer> CreateVertexBuffer( size_t numVertices, size_t vertexStride );
     std::shared_ptr<VertexBuffer> CreateVertexBuffer( Microsoft::WRL::ComPtr<ID3D12Resource> resource,
                                                       size_t numVertices, size_t vertexStride );
+    std::shared_ptr<VertexBuffer> CreateVertexBuffer( const StaticBufferAllocator::Allocation& allocation,
+                                                      size_t numVertices, size_t vertexStride );
 
     std::shared_ptr<RootSignature> CreateRootSignature( const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc );
 
@@ -149,13 +215,42 @@ public:
                                    const std::shared_ptr<Resource>&        counterResource = nullptr,
                                    const D3D12_UNORDERED_ACCESS_VIEW_DESC* uav             = nullptr );
 
+    /**
+     * Create an allocator for render targets and depth buffers that are only used during a part of a frame.
+     */
+    std::shared_ptr<TransientTextureAllocator> CreateTransientTextureAllocator( size_t heapSize = _64MB );
+
+    /**
+     * Create a recorder that records command lists on multiple threads.
+     *
+     * @param numThreads The number of worker threads. If it is 0, one thread less than the
+     * number of hardware threads is used.
+     */
+    std::shared_ptr<ParallelCommandRecorder> CreateParallelCommandRecorder( uint32_t numThreads = 0 );
+
+    /**
+     * Create a profiler that measures the GPU time of scopes on a command queue.
+     *
+     * @param numFrames The number of frames before the timestamps of a frame are read back.
+     * @param maxScopesPerFrame The number of scopes that can be measured in a frame.
+     */
+    std::shared_ptr<GpuProfiler> CreateGpuProfiler( D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                    uint32_t numFrames = 3, uint32_t maxScopesPerFrame = 256 );
+
+    /**
+     * Create a render graph that places its transient textures with the given allocator.
+     */
+    std::shared_ptr<RenderGraph> CreateRenderGraph( TransientTextureAllocator& transientTextureAllocator );
+
     /**
      * Flush all command queues.
      */
     void Flush();
 
     /**
-     * Release stale descriptors. This should only be called with a completed frame counter.
+     * Release the stale descriptors that are no longer referenced by any command queue.
+     * Stale descriptors are tagged with the fence values of the command queues when they are freed
+     * so this can be called at any time.
      */
     void ReleaseStaleDescriptors();
 
@@ -194,7 +289,7 @@ public:
         D3D12_MULTISAMPLE_QUALITY_LEVEL_FLAGS flags = D3D12_MULTISAMPLE_QUALITY_LEVELS_FLAG_NONE ) const;
 
 protected:
-    explicit Device( std::shared_ptr<Adapter> adapter );
+    Device( std::shared_ptr<Adapter> adapter, bool enableBindless );
     virtual ~Device();
 
     std::shared_ptr<PipelineStateObject>
@@ -214,6 +309,18 @@ private:
     // Descriptor allocators.
     std::unique_ptr<DescriptorAllocator> m_DescriptorAllocators[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
+    // Shader visible descriptor heap for bindless resources (optional).
+    std::unique_ptr<BindlessDescriptorHeap> m_BindlessDescriptorHeap;
+
+    // Batches uploads on the copy queue. Must be destroyed before the command queues.
+    std::unique_ptr<UploadManager> m_UploadManager;
+
+    // Batches mip generation on the compute queue. Must be destroyed before the upload manager.
+    std::unique_ptr<MipGenerator> m_MipGenerator;
+
+    // Sub-allocates static vertex and index buffers.
+    std::unique_ptr<StaticBufferAllocator> m_StaticBufferAllocator;
+
     D3D_ROOT_SIGNATURE_VERSION m_HighestRootSignatureVersion;
 };
 }  // namespace DX12_Library
\ No newline at end of file
@@ -5,8 +5,10 @@
 #include <wrl.h>
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <queue>
+#include <vector>
 /*
  * A dynamic descriptor is a shader visible(resource ready to render) descriptor heap, divided into two parts.
  * These descriptors are used for some transition resources that their descriptor table cannot reuse due to being
@@ -15,6 +17,7 @@
 namespace DX12_Library
 {
 
+class BindlessDescriptorHeap;
 class Device;
 class CommandList;
 class RootSignature;
@@ -88,17 +91,48 @@ public:
      */
     void Reset();
 
+    /**
+     * Counters for the descriptor table cache.
+     */
+    struct Statistics
+    {
+        // Descriptor tables that were already copied to the GPU visible descriptor heap.
+        uint64_t NumTableCacheHits;
+        // Descriptor tables that had to be copied to the GPU visible descriptor heap.
+        uint64_t NumTableCacheMisses;
+    };
+
+    Statistics GetStatistics() const;
+
 protected:
 private:
-    // Request a descriptor heap if one is available.
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> RequestDescriptorHeap();
-    // Create a new descriptor heap of no descriptor heap is available.
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap();
+    // A block of GPU visible descriptors that the staged descriptors are copied to.
+    // Without bindless descriptors, every block is a separate descriptor heap.
+    // With bindless descriptors, the blocks are allocated from the bindless descriptor heap
+    // so that the descriptor heap does not need to be changed on the command list.
+    struct DescriptorHeapBlock
+    {
+        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DescriptorHeap;
+        D3D12_CPU_DESCRIPTOR_HANDLE                  CPUDescriptorHandle;
+        D3D12_GPU_DESCRIPTOR_HANDLE                  GPUDescriptorHandle;
+        // The index of the block in the bindless descriptor heap.
+        uint32_t BindlessIndex;
+    };
+
+    // Request a descriptor heap block if one is available.
+    DescriptorHeapBlock RequestDescriptorHeap();
+    // Create a new descriptor heap block if no block is available.
+    DescriptorHeapBlock CreateDescriptorHeap();
+    // Make the next available block the current block and bind it to the command list.
+    void SetCurrentDescriptorHeap( CommandList& commandList );
 
     // Compute the number of stale descriptors that need to be copied
     // to GPU visible descriptor heap.
     uint32_t ComputeStaleDescriptorCount() const;
 
+    // Compute the hash of the staged descriptors of a descriptor table.
+    static size_t HashDescriptorTable( const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptors, uint32_t numDescriptors );
+
     /**
      * Copy all of the staged descriptors to the GPU visible descriptor heap and
      * bind the descriptor heap and the descriptor tables to the command list.
@@ -160,6 +194,9 @@ private:
     // The number of descriptors to allocate in new GPU visible descriptor heaps.
     uint32_t m_NumDescriptorsPerHeap;
 
+    // If not null, the descriptor heap blocks are allocated from the bindless descriptor heap.
+    BindlessDescriptorHeap* m_BindlessDescriptorHeap;
+
     // The increment size of a descriptor.
     uint32_t m_DescriptorHandleIncrementSize;
 
@@ -187,7 +224,7 @@ private:
     uint32_t m_StaleSRVBitMask;
     uint32_t m_StaleUAVBitMask;
 
-    using DescriptorHeapPool = std::queue<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>>;
+    using DescriptorHeapPool = std::queue<DescriptorHeapBlock>;
 
     DescriptorHeapPool m_DescriptorHeapPool;
     DescriptorHeapPool m_AvailableDescriptorHeaps;
@@ -197,5 +234,47 @@ private:
     CD3DX12_CPU_DESCRIPTOR_HANDLE                m_CurrentCPUDescriptorHandle;
 
     uint32_t m_NumFreeHandles;
+
+    // A descriptor table that was copied to the GPU visible descriptor heap.
+    struct CachedDescriptorTable
+    {
+        // The hash of the staged descriptors.
+        size_t Hash;
+        // The staged (CPU visible) descriptors that were copied, in m_CachedSrcDescriptors.
+        uint32_t SrcDescriptorOffset;
+        uint32_t NumDescriptors;
+        // The descriptor heap that the descriptors were copied to. Null for an empty slot of the table.
+        ID3D12DescriptorHeap* DescriptorHeap;
+        // The GPU visible copy of the descriptors.
+        D3D12_GPU_DESCRIPTOR_HANDLE GPUDescriptorHandle;
+    };
+
+    // Find the copy of the staged descriptors in the current descriptor heap.
+    // Returns null if the descriptors were not copied to the current descriptor heap.
+    const CachedDescriptorTable* FindCachedDescriptorTable( size_t                             hash,
+                                                            const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptors,
+                                                            uint32_t                           numDescriptors ) const;
+    // Remember the copy of the staged descriptors at the current position of the descriptor heap.
+    void AddCachedDescriptorTable( size_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptors,
+                                   uint32_t numDescriptors );
+    // Forget all copied descriptor tables.
+    void ClearDescriptorTableCache();
+
+    // Descriptor tables that were copied since the last reset, in an open addressing hash table that is keyed
+    // by the hash of their staged descriptors. The size of the table is a power of two and it is at most half
+    // full. If the same descriptors are staged again, the GPU visible copy is reused. This relies on descriptors
+    // never being rewritten while they are allocated (views are always created in new allocations). A freed
+    // descriptor can be reallocated and rewritten, so the cache is cleared whenever freed descriptors were
+    // returned to the descriptor allocators since the tables were cached.
+    std::vector<CachedDescriptorTable> m_DescriptorTableCacheSlots;
+    uint32_t                           m_NumCachedDescriptorTables;
+    // The staged descriptors of all cached descriptor tables, so that a cache miss doesn't allocate memory.
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_CachedSrcDescriptors;
+    // The release generation of the descriptor allocators (see DescriptorAllocatorPage::GetReleaseGeneration)
+    // when the cached descriptor tables were validated.
+    uint64_t m_DescriptorTableCacheGeneration;
+
+    uint64_t m_NumTableCacheHits;
+    uint64_t m_NumTableCacheMisses;
 };
 }  // namespace DX12_Library
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "ProfileAggregator.h"
+#include "SyncPoint.h"
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * The GPU profiler measures the GPU time of scopes with timestamp queries. Every scope writes a timestamp
+ * when it begins and when it ends. The queries of a frame are placed in the frame's range of a query heap and
+ * resolved into a readback buffer at the end of the frame. The timestamps are read back when the range is
+ * reused, NumFrames frames later, so reading them normally doesn't wait for the GPU. The durations are
+ * aggregated per scope in a profile aggregator.
+ *
+ *   profiler.BeginFrame();
+ *   commandList->BeginProfileScope( profiler, "Scene" );
+ *   ...
+ *   commandList->EndProfileScope();
+ *   commandQueue.ExecuteCommandList( commandList );
+ *   profiler.EndFrame();
+ *
+ * Scopes can be recorded on multiple threads. BeginFrame, EndFrame and GetTimings must be called on the same
+ * thread while no scopes are recorded. Scopes are only measured on command lists of the queue of the profiler.
+ *
+ * The profiler is created with Device::CreateGpuProfiler.
+ */
+namespace DX12_Library
+{
+
+class CommandList;
+class CommandQueue;
+class Device;
+
+class GpuProfiler
+{
+public:
+    static const uint32_t InvalidScope = ProfileAggregator::InvalidScope;
+
+    struct Statistics
+    {
+        // The number of frames that were read back.
+        uint64_t NumResolvedFrames;
+        // The number of times that BeginFrame had to wait for the GPU to read back a frame.
+        uint64_t NumStalls;
+        // The number of scopes that were not measured because a frame had too many scopes.
+        uint64_t NumDroppedScopes;
+    };
+
+    /**
+     * Begin a new frame. This reads back the timestamps of the frame that used the same queries before.
+     */
+    void BeginFrame();
+
+    /**
+     * Resolve the timestamps of the frame. This executes a command list on the queue of the profiler, so it must
+     * be called after the command lists of the frame are executed.
+     *
+     * @returns The sync point of the resolve or an invalid sync point if the frame has no scopes.
+     */
+    SyncPoint EndFrame();
+
+    /**
+     * Write the begin timestamp of a scope. It is usually easier to use CommandList::BeginProfileScope.
+     *
+     * @param parent The scope that the scope is nested in.
+     * @returns The scope or InvalidScope if the command list is not a command list of the queue of the profiler
+     * or if the frame has too many scopes.
+     */
+    uint32_t BeginScope( CommandList& commandList, const std::string& name, uint32_t parent = InvalidScope );
+
+    /**
+     * Write the end timestamp of a scope. The command list must be executed on the same queue as the command list
+     * that began the scope, but it doesn't have to be the same command list.
+     */
+    void EndScope( CommandList& commandList, uint32_t scope );
+
+    /**
+     * Get the timings of the scopes with the rolling min/avg/max durations in milliseconds.
+     */
+    const std::vector<ProfileAggregator::Timing>& GetTimings() const
+    {
+        return m_Aggregator.GetTimings();
+    }
+
+    Statistics GetStatistics() const;
+
+protected:
+    friend class std::default_delete<GpuProfiler>;
+
+    /**
+     * @param numFrames The number of frames that are in flight before their timestamps are read back.
+     * @param maxScopesPerFrame The number of scopes that can be measured in a frame.
+     */
+    GpuProfiler( Device& device, D3D12_COMMAND_LIST_TYPE type, uint32_t numFrames, uint32_t maxScopesPerFrame );
+    virtual ~GpuProfiler();
+
+private:
+    struct Frame
+    {
+        // The scopes of the frame. Only the first NumScopes are used.
+        std::vector<ProfileAggregator::Scope> Scopes;
+        uint32_t                              NumScopes;
+        // The submission that resolves the timestamps of the frame.
+        SyncPoint Completion;
+    };
+
+    // Get the index of the query that stores a timestamp of a scope in a frame.
+    uint32_t GetQueryIndex( uint32_t frame, uint32_t scope, bool end ) const
+    {
+        return ( frame * m_MaxScopesPerFrame + scope ) * 2 + ( end ? 1 : 0 );
+    }
+
+    // Read the timestamps of a frame and add them to the aggregator.
+    void ReadBack( Frame& frame, uint32_t frameIndex );
+
+    Device&                 m_Device;
+    CommandQueue&           m_CommandQueue;
+    D3D12_COMMAND_LIST_TYPE m_CommandListType;
+
+    uint32_t m_NumFrames;
+    uint32_t m_MaxScopesPerFrame;
+    uint64_t m_Frequency;
+
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_d3d12QueryHeap;
+    Microsoft::WRL::ComPtr<ID3D12Resource>  m_d3d12ReadbackBuffer;
+
+    std::vector<Frame> m_Frames;
+    // The frame whose queries are written.
+    uint32_t m_CurrentFrame;
+    // The number of scopes that were begun in the current frame (including the dropped scopes).
+    std::atomic_uint32_t m_NumScopes;
+
+    ProfileAggregator m_Aggregator;
+
+    uint64_t             m_NumResolvedFrames;
+    uint64_t             m_NumStalls;
+    std::atomic_uint64_t m_NumDroppedScopes;
+};
+}  // namespace DX12_Library
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Buffer.h"
+#include "StaticBufferAllocator.h"
 
 namespace DX12_Library
 {
@@ -29,17 +30,41 @@ public:
         return m_IndexFormat;
     }
 
+    /**
+     * The offset of the index data in the D3D12 resource.
+     * This is only non-zero if the index buffer is sub-allocated from the static buffer allocator.
+     */
+    size_t GetOffset() const
+    {
+        return m_Offset;
+    }
+
+    /**
+     * True if the index data is sub-allocated from a block of the static buffer allocator.
+     * The blocks are never transitioned explicitly (see StaticBufferAllocator).
+     */
+    bool IsStatic() const
+    {
+        return m_StaticAllocationID != 0;
+    }
+
 protected:
     IndexBuffer( Device& device, size_t numIndicies, DXGI_FORMAT indexFormat );
     IndexBuffer( Device& device, Microsoft::WRL::ComPtr<ID3D12Resource> resource, size_t numIndicies,
                  DXGI_FORMAT indexFormat );
-    virtual ~IndexBuffer() = default;
+    IndexBuffer( Device& device, const StaticBufferAllocator::Allocation& allocation, size_t numIndicies,
+                 DXGI_FORMAT indexFormat );
+    virtual ~IndexBuffer();
 
     void CreateIndexBufferView();
 
 private:
     size_t      m_NumIndicies;
     DXGI_FORMAT m_IndexFormat;
+    size_t      m_Offset;
     D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
+
+    // The static buffer allocation (or 0 if the index buffer has its own resource).
+    uint64_t m_StaticAllocationID;
 };
 }  // namespace DX12_Library
\ No newline at end of file
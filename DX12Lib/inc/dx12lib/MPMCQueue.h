@@ -0,0 +1,351 @@
+#pragma once
+
+#include <atomic>              // For std::atomic
+#include <cassert>             // For assert
+#include <chrono>              // For std::chrono::duration
+#include <condition_variable>  // For std::condition_variable
+#include <cstddef>             // For size_t
+#include <memory>              // For std::unique_ptr
+#include <mutex>               // For std::mutex
+#include <utility>             // For std::move
+
+/*
+ * A bounded multi-producer multi-consumer queue. The values are stored in a ring of cells that each
+ * have a sequence number, so producers and consumers only contend on an atomic position and never
+ * lock a mutex while the queue is neither full nor empty (see Dmitry Vyukov's bounded MPMC queue).
+ *
+ * Push and Pop block while the queue is full or empty. Threads that block park on a condition variable,
+ * which is only notified if there are parked threads, so the non-blocking paths stay lock-free.
+ *
+ * Values are moved in and out of the queue. T must be default constructible and move assignable.
+ */
+namespace DX12_Library
+{
+
+template<typename T>
+class MPMCQueue
+{
+public:
+    /**
+     * @param capacity The maximum number of values in the queue. It is rounded up to a power of two.
+     */
+    explicit MPMCQueue( size_t capacity );
+
+    MPMCQueue( const MPMCQueue& ) = delete;
+    MPMCQueue& operator=( const MPMCQueue& ) = delete;
+
+    /**
+     * Try to push a value into the back of the queue.
+     * @returns false if the queue is full. The value is only moved from if it was pushed.
+     */
+    bool TryPush( T& value );
+    bool TryPush( T&& value )
+    {
+        return TryPush( value );
+    }
+
+    /**
+     * Push a value into the back of the queue. Blocks while the queue is full.
+     */
+    void Push( T value );
+
+    /**
+     * Try to pop a value from the front of the queue.
+     * @returns false if the queue is empty.
+     */
+    bool TryPop( T& value );
+
+    /**
+     * Pop a value from the front of the queue. Blocks while the queue is empty.
+     */
+    void Pop( T& value );
+
+    /**
+     * Pop a value from the front of the queue. Blocks while the queue is empty, but not longer than the timeout.
+     * @returns false if the queue is still empty after the timeout.
+     */
+    template<typename Rep, typename Period>
+    bool TryPopFor( T& value, const std::chrono::duration<Rep, Period>& timeout );
+
+    /**
+     * Check to see if there are any values in the queue.
+     * Other threads may push or pop values at the same time, so this is only a snapshot.
+     */
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    /**
+     * Retrieve the number of values in the queue.
+     * Other threads may push or pop values at the same time, so this is only a snapshot.
+     */
+    size_t Size() const;
+
+    size_t Capacity() const
+    {
+        return m_Mask + 1;
+    }
+
+private:
+    struct Cell
+    {
+        // The position of the push that may write the cell, or that position + 1 if the cell holds a value
+        // for the pop at that position.
+        std::atomic_size_t Sequence;
+        T                  Value;
+    };
+
+    // Push or pop a value without waking up parked threads.
+    bool Enqueue( T& value );
+    bool Dequeue( T& value );
+
+    // Wait until a value was popped or pushed by another thread. The lock must hold the wait mutex.
+    // @returns The status of the wait (always no_timeout if there is no deadline).
+    std::cv_status Park( std::unique_lock<std::mutex>& lock, std::atomic_size_t& numWaiting,
+                         std::condition_variable& cv, const std::chrono::steady_clock::time_point* deadline );
+
+    // Wake up the threads that are parked on the condition variable, if there are any.
+    // The wait mutex must not be held by the caller.
+    void Notify( std::atomic_size_t& numWaiting, std::condition_variable& cv );
+
+    // The cells are padded, so that the producers and consumers don't share cache lines.
+    static const size_t CacheLineSize = 64;
+
+    std::unique_ptr<Cell[]> m_Cells;
+    size_t                  m_Mask;
+
+    alignas( CacheLineSize ) std::atomic_size_t m_PushPosition;
+    alignas( CacheLineSize ) std::atomic_size_t m_PopPosition;
+
+    // Threads that wait for the queue to be not full or not empty.
+    alignas( CacheLineSize ) std::atomic_size_t m_NumWaitingPushes;
+    std::atomic_size_t      m_NumWaitingPops;
+    std::mutex              m_WaitMutex;
+    std::condition_variable m_NotFullCV;
+    std::condition_variable m_NotEmptyCV;
+};
+
+template<typename T>
+MPMCQueue<T>::MPMCQueue( size_t capacity )
+: m_PushPosition( 0 )
+, m_PopPosition( 0 )
+, m_NumWaitingPushes( 0 )
+, m_NumWaitingPops( 0 )
+{
+    size_t size = 2;
+    while ( size < capacity )
+    {
+        size <<= 1;
+    }
+
+    m_Cells = std::make_unique<Cell[]>( size );
+    m_Mask  = size - 1;
+
+    for ( size_t i = 0; i < size; ++i )
+    {
+        m_Cells[i].Sequence.store( i, std::memory_order_relaxed );
+    }
+}
+
+template<typename T>
+bool MPMCQueue<T>::TryPush( T& value )
+{
+    if ( !Enqueue( value ) )
+    {
+        return false;
+    }
+
+    Notify( m_NumWaitingPops, m_NotEmptyCV );
+
+    return true;
+}
+
+template<typename T>
+bool MPMCQueue<T>::Enqueue( T& value )
+{
+    Cell*  cell;
+    size_t position = m_PushPosition.load( std::memory_order_relaxed );
+    while ( true )
+    {
+        cell = &m_Cells[position & m_Mask];
+
+        size_t sequence = cell->Sequence.load( std::memory_order_acquire );
+        auto   diff     = static_cast<std::ptrdiff_t>( sequence ) - static_cast<std::ptrdiff_t>( position );
+        if ( diff == 0 )
+        {
+            // The cell is free. Claim it, unless another producer was faster.
+            if ( m_PushPosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+            {
+                break;
+            }
+        }
+        else if ( diff < 0 )
+        {
+            // The cell still holds the value of the previous lap, so the queue is full.
+            return false;
+        }
+        else
+        {
+            position = m_PushPosition.load( std::memory_order_relaxed );
+        }
+    }
+
+    cell->Value = std::move( value );
+    cell->Sequence.store( position + 1, std::memory_order_release );
+
+    return true;
+}
+
+template<typename T>
+void MPMCQueue<T>::Push( T value )
+{
+    while ( !Enqueue( value ) )
+    {
+        std::unique_lock<std::mutex> lock( m_WaitMutex );
+        Park( lock, m_NumWaitingPushes, m_NotFullCV, nullptr );
+    }
+
+    Notify( m_NumWaitingPops, m_NotEmptyCV );
+}
+
+template<typename T>
+bool MPMCQueue<T>::TryPop( T& value )
+{
+    if ( !Dequeue( value ) )
+    {
+        return false;
+    }
+
+    Notify( m_NumWaitingPushes, m_NotFullCV );
+
+    return true;
+}
+
+template<typename T>
+bool MPMCQueue<T>::Dequeue( T& value )
+{
+    Cell*  cell;
+    size_t position = m_PopPosition.load( std::memory_order_relaxed );
+    while ( true )
+    {
+        cell = &m_Cells[position & m_Mask];
+
+        size_t sequence = cell->Sequence.load( std::memory_order_acquire );
+        auto   diff     = static_cast<std::ptrdiff_t>( sequence ) - static_cast<std::ptrdiff_t>( position + 1 );
+        if ( diff == 0 )
+        {
+            // The cell holds a value. Claim it, unless another consumer was faster.
+            if ( m_PopPosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+            {
+                break;
+            }
+        }
+        else if ( diff < 0 )
+        {
+            // The cell wasn't written yet, so the queue is empty.
+            return false;
+        }
+        else
+        {
+            position = m_PopPosition.load( std::memory_order_relaxed );
+        }
+    }
+
+    value = std::move( cell->Value );
+    // Don't keep the resources of the moved-from value alive until the cell is reused.
+    cell->Value = T();
+    cell->Sequence.store( position + m_Mask + 1, std::memory_order_release );
+
+    return true;
+}
+
+template<typename T>
+void MPMCQueue<T>::Pop( T& value )
+{
+    while ( !Dequeue( value ) )
+    {
+        std::unique_lock<std::mutex> lock( m_WaitMutex );
+        Park( lock, m_NumWaitingPops, m_NotEmptyCV, nullptr );
+    }
+
+    Notify( m_NumWaitingPushes, m_NotFullCV );
+}
+
+template<typename T>
+template<typename Rep, typename Period>
+bool MPMCQueue<T>::TryPopFor( T& value, const std::chrono::duration<Rep, Period>& timeout )
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while ( !Dequeue( value ) )
+    {
+        std::unique_lock<std::mutex> lock( m_WaitMutex );
+        if ( Park( lock, m_NumWaitingPops, m_NotEmptyCV, &deadline ) == std::cv_status::timeout )
+        {
+            lock.unlock();
+            return TryPop( value );
+        }
+    }
+
+    Notify( m_NumWaitingPushes, m_NotFullCV );
+
+    return true;
+}
+
+template<typename T>
+size_t MPMCQueue<T>::Size() const
+{
+    size_t popPosition  = m_PopPosition.load( std::memory_order_relaxed );
+    size_t pushPosition = m_PushPosition.load( std::memory_order_relaxed );
+
+    // The positions are read one after the other, so a pop may have passed the push position that was read.
+    return pushPosition > popPosition ? pushPosition - popPosition : 0;
+}
+
+template<typename T>
+std::cv_status MPMCQueue<T>::Park( std::unique_lock<std::mutex>& lock, std::atomic_size_t& numWaiting,
+                                   std::condition_variable&                   cv,
+                                   const std::chrono::steady_clock::time_point* deadline )
+{
+    std::cv_status status = std::cv_status::no_timeout;
+
+    // A thread that changes the queue without seeing this thread waiting made the change before the
+    // increment, so check the queue again after announcing. The caller retries in that case.
+    numWaiting.fetch_add( 1 );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+
+    bool changed = &cv == &m_NotEmptyCV ? !Empty() : Size() < Capacity();
+    if ( !changed )
+    {
+        if ( deadline )
+        {
+            status = cv.wait_until( lock, *deadline );
+        }
+        else
+        {
+            cv.wait( lock );
+        }
+    }
+
+    numWaiting.fetch_sub( 1 );
+
+    return status;
+}
+
+template<typename T>
+void MPMCQueue<T>::Notify( std::atomic_size_t& numWaiting, std::condition_variable& cv )
+{
+    // Pairs with the increment of the waiting threads: either the waiting thread sees the change
+    // to the queue when it checks again, or this thread sees that it is waiting.
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( numWaiting.load( std::memory_order_relaxed ) > 0 )
+    {
+        // The waiting thread holds the mutex until it waits, so it can't miss the notification.
+        {
+            std::lock_guard<std::mutex> lock( m_WaitMutex );
+        }
+        cv.notify_all();
+    }
+}
+}  // namespace DX12_Library
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "SyncPoint.h"
+#include "UploadManager.h"
+
+#include <d3d12.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * The mip generator batches the mip generation of loaded textures on the compute queue. The textures of
+ * all loads are recorded on a single compute command list that is submitted when the batch gets large,
+ * when a command list that uses one of its textures is executed or when the generator is flushed. The
+ * batch runs on the compute queue at the same time as the rendering on the direct queue.
+ *
+ * Every texture gets a ticket. A command list that uses a texture with pending mips only waits (on the GPU)
+ * for the sync point of the batch of that texture. Command lists find the tickets of the textures they use
+ * with GetTicket, so textures with pending mips can be used like any other texture.
+ */
+namespace DX12_Library
+{
+
+class CommandList;
+class CommandQueue;
+class Device;
+class Texture;
+
+class MipGenerator
+{
+public:
+    /**
+     * Identifies the batch that generates the mips of a texture.
+     */
+    struct Ticket
+    {
+        // A batch ID of 0 means there is nothing to wait for.
+        uint64_t BatchID = 0;
+    };
+
+    // The batch is submitted once it has this many textures.
+    static const size_t MaxBatchSize = 32;
+
+    /**
+     * Generate the mips of a texture on the compute queue.
+     *
+     * @param uploadTicket The upload of the first mip of the texture. The batch waits for it.
+     */
+    Ticket GenerateMips( const std::shared_ptr<Texture>& texture, const UploadManager::Ticket& uploadTicket = {} );
+
+    /**
+     * Get the ticket of a texture whose mips are still being generated.
+     * This also forgets the textures of the batches that are finished.
+     *
+     * @returns An empty ticket if the mips of the texture are not pending.
+     */
+    Ticket GetTicket( ID3D12Resource* d3d12Resource );
+
+    /**
+     * Check if there are any textures whose mips are still being generated. This doesn't lock a mutex,
+     * so it can be used to skip GetTicket for every texture that a command list uses. It stays true
+     * until GetTicket (or another function) finds that the last batch is finished.
+     */
+    bool HasPendingTextures() const
+    {
+        return m_NumPendingTextures > 0;
+    }
+
+    /**
+     * Submit the pending batch to the compute queue.
+     *
+     * @returns The sync point of the batch or an invalid sync point if there was nothing to submit.
+     */
+    SyncPoint Flush();
+
+    /**
+     * Get the sync point that signals that the mips are generated.
+     * The batch of the ticket is submitted if it is still pending.
+     *
+     * @returns An invalid sync point if the mips are already generated.
+     */
+    SyncPoint GetSyncPoint( const Ticket& ticket );
+
+    /**
+     * Make a command queue wait (on the GPU) until the mips are generated.
+     */
+    void Wait( CommandQueue& commandQueue, const Ticket& ticket );
+
+protected:
+    friend class std::default_delete<MipGenerator>;
+
+    explicit MipGenerator( Device& device );
+    virtual ~MipGenerator() = default;
+
+private:
+    struct Batch
+    {
+        uint64_t                     BatchID;
+        SyncPoint                    Completion;
+        std::vector<ID3D12Resource*> Textures;
+    };
+
+    // Execute the pending batch on the compute queue.
+    // The lock of the mutex must be held by the caller. It is released while the batch is executed,
+    // since executing a command list may wait for the uploads and mips of other command lists.
+    SyncPoint SubmitBatch( std::unique_lock<std::mutex>& lock );
+
+    // Forget the batches (and their textures) that are finished.
+    // The pending textures mutex must be held by the caller.
+    void ReleaseCompletedBatches();
+
+    Device&       m_Device;
+    CommandQueue& m_ComputeQueue;
+
+    // The command list and textures of the pending batch.
+    std::shared_ptr<CommandList> m_CommandList;
+    Batch                        m_PendingBatch;
+
+    // The ID of the last batch that was executed. The batches are executed in order, so a batch
+    // waits until the batch before it was executed.
+    uint64_t                m_LastSubmittedBatchID;
+    std::condition_variable m_BatchSubmittedCV;
+
+    // Protects the pending batch and the last submitted batch ID.
+    std::mutex m_Mutex;
+
+    // The submitted batches that may still be in flight.
+    std::deque<Batch> m_SubmittedBatches;
+
+    // The batch IDs of the textures whose mips are pending. It has its own mutex since command lists
+    // look up the textures they use while the mutex of the batches is held to record the batch.
+    // The mutex also protects the submitted batches, so that looking up a texture can release them.
+    std::unordered_map<ID3D12Resource*, uint64_t> m_PendingTextures;
+    std::atomic_size_t                             m_NumPendingTextures;
+    std::mutex                                     m_PendingTexturesMutex;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "CommandStream.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * The null command backend executes the commands of a command stream without a GPU. It keeps track of the
+ * bound state, validates that every command has the state it needs (e.g. a draw needs a pipeline state, a
+ * graphics root signature, a primitive topology, a render target, viewports and scissor rectangles) and counts
+ * the work of the commands. This is used to measure the cost of recording commands independent of the GPU.
+ * The null backend doesn't depend on Direct3D 12, so it can be used on any platform.
+ *
+ *   NullCommandBackend backend;
+ *   commandStream.Replay( backend );
+ *   auto statistics = backend.GetStatistics();
+ */
+namespace DX12_Library
+{
+
+class NullCommandBackend : public CommandBackend
+{
+public:
+    struct Statistics
+    {
+        uint64_t NumCommands;
+        uint64_t NumDraws;
+        uint64_t NumDispatches;
+        // The number of vertices and indices that were drawn (including all instances).
+        uint64_t NumVertices;
+        uint64_t NumIndices;
+        uint64_t NumThreadGroups;
+        // The number of pipeline state and root signature changes.
+        uint64_t NumPipelineStateChanges;
+        uint64_t NumRootSignatureChanges;
+        // The number of binds of a pipeline state, root signature, vertex buffer or index buffer that was
+        // already bound.
+        uint64_t NumRedundantBinds;
+        // The number of root constants, dynamic buffers and descriptors that were set.
+        uint64_t NumRootArguments;
+        uint64_t NumBarriers;
+        uint64_t NumCopies;
+        // The number of bytes of constants and dynamic buffer data.
+        uint64_t NumInlineBytes;
+        uint64_t NumValidationErrors;
+    };
+
+    NullCommandBackend();
+    virtual ~NullCommandBackend();
+
+    /**
+     * Describe the objects that the commands use. Without a description, the root parameter indices of
+     * a root signature and the index ranges of an index buffer are not validated. The descriptions are
+     * kept by Reset.
+     */
+    void DescribeRootSignature( CommandObjectHandle rootSignature, uint32_t numParameters );
+    void DescribeIndexBuffer( CommandObjectHandle indexBuffer, uint32_t numIndices );
+
+    void TransitionBarrier( CommandObjectHandle resource, uint32_t stateAfter, uint32_t subresource ) override;
+    void UAVBarrier( CommandObjectHandle resource ) override;
+    void AliasingBarrier( CommandObjectHandle beforeResource, CommandObjectHandle afterResource ) override;
+
+    void CopyResource( CommandObjectHandle dstRes, CommandObjectHandle srcRes ) override;
+    void ResolveSubresource( CommandObjectHandle dstRes, CommandObjectHandle srcRes, uint32_t dstSubresource,
+                             uint32_t srcSubresource ) override;
+
+    void SetPipelineState( CommandObjectHandle pipelineState ) override;
+    void SetGraphicsRootSignature( CommandObjectHandle rootSignature ) override;
+    void SetComputeRootSignature( CommandObjectHandle rootSignature ) override;
+    void SetPrimitiveTopology( uint32_t primitiveTopology ) override;
+    void SetVertexBuffer( uint32_t slot, CommandObjectHandle vertexBuffer ) override;
+    void SetIndexBuffer( CommandObjectHandle indexBuffer ) override;
+    void SetViewports( const CommandViewport* viewports, uint32_t numViewports ) override;
+    void SetScissorRects( const CommandRect* scissorRects, uint32_t numScissorRects ) override;
+    void SetRenderTarget( const CommandObjectHandle* textures, uint32_t numTextures ) override;
+
+    void SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                    const void* constants ) override;
+    void SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants ) override;
+    void SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes,
+                                           const void* bufferData ) override;
+    void SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
+                                             const void* bufferData ) override;
+    void SetShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset, CommandObjectHandle srv,
+                                uint32_t stateAfter, uint32_t firstSubresource, uint32_t numSubresources ) override;
+    void SetTextureShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
+                                       CommandObjectHandle texture, uint32_t stateAfter, uint32_t firstSubresource,
+                                       uint32_t numSubresources ) override;
+    void SetBindlessShaderResourceView( CommandObjectHandle srv, uint32_t stateAfter ) override;
+    void SetBindlessTextureShaderResourceView( CommandObjectHandle texture, uint32_t stateAfter ) override;
+
+    void Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance ) override;
+    void DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                      uint32_t startInstance ) override;
+    void Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ ) override;
+
+    const Statistics& GetStatistics() const
+    {
+        return m_Statistics;
+    }
+
+    /**
+     * Get the messages of the validation errors (at most MaxErrors).
+     */
+    const std::vector<std::string>& GetErrors() const
+    {
+        return m_Errors;
+    }
+
+    /**
+     * Unbind all state and reset the statistics and errors. This is the state of a new command list.
+     */
+    void Reset();
+
+private:
+    // Only the first validation errors are kept, a broken stream usually repeats the same error.
+    static const size_t MaxErrors = 64;
+
+    void Error( const char* command, const char* message );
+
+    // Check that a root argument can be set on the bound root signature.
+    void ValidateRootArgument( const char* command, CommandObjectHandle rootSignature, uint32_t rootParameterIndex );
+
+    // Check the state that all draws need.
+    void ValidateDraw( const char* command );
+
+    // D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT and D3D_PRIMITIVE_TOPOLOGY_UNDEFINED.
+    static constexpr uint32_t MaxVertexBufferSlots       = 32;
+    static constexpr uint32_t UndefinedPrimitiveTopology = 0;
+    // The value of an object that wasn't described.
+    static constexpr uint32_t Unknown = UINT32_MAX;
+
+    CommandObjectHandle m_PipelineState;
+    CommandObjectHandle m_GraphicsRootSignature;
+    CommandObjectHandle m_ComputeRootSignature;
+    CommandObjectHandle m_IndexBuffer;
+    uint32_t            m_PrimitiveTopology;
+    uint32_t            m_NumViewports;
+    uint32_t            m_NumScissorRects;
+    bool                m_HasRenderTarget;
+
+    // The vertex buffers that are bound to the slots.
+    std::vector<CommandObjectHandle> m_VertexBuffers;
+
+    // The number of root parameters of the root signatures and the number of indices of the index
+    // buffers, indexed by handle.
+    std::vector<uint32_t> m_NumRootParameters;
+    std::vector<uint32_t> m_NumIndices;
+
+    Statistics               m_Statistics;
+    std::vector<std::string> m_Errors;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * The parallel command recorder splits the recording of a pass into chunks that are recorded
+ * on multiple threads. Every chunk is recorded into its own command list, which starts with the
+ * render target, viewports, scissor rectangles, root signature and pipeline state of a parent
+ * command list (see CommandList::InheritState). The command lists are returned in chunk order and
+ * must be executed right after the parent command list with a single call to
+ * CommandQueue::ExecuteCommandLists:
+ *
+ *   auto commandLists = recorder.Record( *commandList, numChunks, [&]( CommandList& chunkCommandList,
+ *                                                                      uint32_t chunk, uint32_t numChunks ) {
+ *       scene->Accept( visitors[chunk], chunk, numChunks );
+ *   } );
+ *   commandLists.insert( commandLists.begin(), commandList );
+ *   commandQueue.ExecuteCommandLists( commandLists );
+ *
+ * The record function is called from multiple threads at the same time, so everything that it
+ * changes (for example, the effects that are applied to the command list) must be per chunk.
+ */
+namespace DX12_Library
+{
+
+class CommandList;
+class Device;
+
+class ParallelCommandRecorder
+{
+public:
+    // Records a chunk into a command list.
+    using RecordFunction = std::function<void( CommandList& commandList, uint32_t chunk, uint32_t numChunks )>;
+
+    /**
+     * Record numChunks command lists in parallel. The calling thread records chunks as well
+     * and this function returns when all chunks are recorded.
+     * If a record function throws, the exception is rethrown after all chunks are finished.
+     *
+     * @param parentCommandList The command list whose state the command lists inherit.
+     * It is not changed, but it must not be used by other threads while the chunks are recorded.
+     * @returns The command lists of the chunks, in chunk order.
+     */
+    std::vector<std::shared_ptr<CommandList>> Record( const CommandList& parentCommandList, uint32_t numChunks,
+                                                      const RecordFunction& record );
+
+    /**
+     * The number of worker threads (not including the thread that calls Record).
+     */
+    uint32_t GetNumThreads() const
+    {
+        return static_cast<uint32_t>( m_Threads.size() );
+    }
+
+protected:
+    friend class std::default_delete<ParallelCommandRecorder>;
+
+    /**
+     * @param numThreads The number of worker threads. If it is 0, one thread less than the
+     * number of hardware threads is used.
+     */
+    ParallelCommandRecorder( Device& device, uint32_t numThreads );
+    virtual ~ParallelCommandRecorder();
+
+private:
+    // Record the next chunk of the current recording. The lock must be held when this is called and it is held
+    // again when this returns, but it is released while the chunk is recorded.
+    // @returns false if there are no chunks left.
+    bool RecordNextChunk( std::unique_lock<std::mutex>& lock );
+
+    void WorkerThread();
+
+    Device& m_Device;
+
+    std::vector<std::thread> m_Threads;
+
+    // Only one recording runs at a time.
+    std::mutex m_RecordMutex;
+
+    // The current recording. The members are only changed while no chunks are being recorded.
+    const CommandList*                         m_ParentCommandList;
+    const RecordFunction*                      m_Record;
+    std::vector<std::shared_ptr<CommandList>>* m_CommandLists;
+    uint32_t                                   m_NumChunks;
+    uint32_t                                   m_NextChunk;
+    uint32_t                                   m_NumFinishedChunks;
+    // The first exception that was thrown by the record function.
+    std::exception_ptr m_Exception;
+
+    bool m_bStopThreads;
+
+    // Guards the current recording. The chunks are large, so the threads only lock it to get the next chunk.
+    std::mutex              m_Mutex;
+    std::condition_variable m_WorkCV;
+    std::condition_variable m_FinishedCV;
+};
+}  // namespace DX12_Library
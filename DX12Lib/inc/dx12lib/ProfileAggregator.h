@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * The profile aggregator collects the durations of hierarchical scopes over the recent frames and keeps the
+ * rolling minimum, average and maximum duration of every scope. Scopes are identified by their path (the names
+ * of the scope and its parents), so the same scope accumulates over frames even if it is recorded in a
+ * different order or on a different thread. Scopes with the same path in one frame are summed.
+ *
+ * The aggregator only works with timestamps and doesn't depend on the GPU, so it can be fed with synthetic
+ * timestamps. The GPU profiler feeds it with the timestamps that it reads back from the GPU.
+ */
+namespace DX12_Library
+{
+
+class ProfileAggregator
+{
+public:
+    static const uint32_t InvalidScope = UINT32_MAX;
+
+    /**
+     * A scope that was measured in a frame.
+     */
+    struct Scope
+    {
+        std::string Name;
+        // The index of the parent scope in the frame or InvalidScope for root scopes.
+        uint32_t Parent = InvalidScope;
+        // A scope whose end timestamp is before its begin timestamp is not measured.
+        uint64_t BeginTimestamp = 0;
+        uint64_t EndTimestamp   = 0;
+    };
+
+    /**
+     * The durations of a scope (in milliseconds) in the frames of the rolling window.
+     */
+    struct Timing
+    {
+        std::string Name;
+        // The number of parents of the scope.
+        uint32_t Depth;
+        // The duration in the last frame that measured the scope.
+        double LastMs;
+        double MinMs;
+        double AvgMs;
+        double MaxMs;
+        // The number of frames in the rolling window that measured the scope.
+        uint32_t NumSamples;
+    };
+
+    /**
+     * @param numHistoryFrames The number of frames in the rolling window.
+     */
+    explicit ProfileAggregator( uint32_t numHistoryFrames = 64 );
+
+    /**
+     * Add the scopes of a frame. Parents must come before their children.
+     *
+     * @param frequency The number of timestamp ticks per second.
+     */
+    void AddFrame( const Scope* scopes, uint32_t numScopes, uint64_t frequency );
+    void AddFrame( const std::vector<Scope>& scopes, uint64_t frequency )
+    {
+        AddFrame( scopes.data(), static_cast<uint32_t>( scopes.size() ), frequency );
+    }
+
+    /**
+     * Get the timings of the scopes that were measured in the rolling window. The timings are in depth-first
+     * order: the children of a scope follow it in the order in which they were first measured.
+     */
+    const std::vector<Timing>& GetTimings() const
+    {
+        return m_Timings;
+    }
+
+    /**
+     * Get the number of frames that were added since the aggregator was created or reset.
+     */
+    uint64_t GetNumFrames() const
+    {
+        return m_NumFrames;
+    }
+
+    /**
+     * Forget all scopes and frames.
+     */
+    void Reset();
+
+private:
+    struct Entry
+    {
+        std::string           Name;
+        uint32_t              Depth;
+        std::vector<uint32_t> Children;
+        // The durations (in milliseconds) in the frames of the rolling window, indexed by frame number modulo the
+        // size of the window. A negative duration means that the scope was not measured in that frame.
+        std::vector<double> History;
+        double              LastMs;
+        // The sum of the durations in the frame that is being added.
+        double FrameMs;
+        bool   IsMeasured;
+    };
+
+    // Find or add the entry of a scope.
+    uint32_t GetEntry( const std::string& name, uint32_t parentEntry );
+
+    // Rebuild the timings from the history of the entries.
+    void UpdateTimings();
+    void AddTimings( uint32_t entryIndex );
+
+    uint32_t m_NumHistoryFrames;
+    uint64_t m_NumFrames;
+
+    std::vector<Entry>                        m_Entries;
+    std::vector<uint32_t>                     m_RootEntries;
+    std::unordered_map<std::string, uint32_t> m_EntriesByPath;
+
+    std::vector<Timing> m_Timings;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "RenderGraphCompiler.h"
+#include "SyncPoint.h"
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * The render graph records a frame as a list of passes that declare which textures they read and write.
+ * The graph computes the barriers between the passes, culls passes whose results are not used, moves
+ * compute passes to the compute queue and places the transient textures in aliased memory.
+ *
+ * Build the graph every frame (or whenever it changes):
+ *
+ *   auto color = graph.CreateTexture( colorDesc, &clearValue, L"Color" );
+ *   auto backBuffer = graph.ImportTexture( swapChainTexture );
+ *   graph.AddPass( L"Scene", [&]( CommandList& commandList, const RenderGraph& graph ) { ... } )
+ *       .Write( color, D3D12_RESOURCE_STATE_RENDER_TARGET );
+ *   graph.AddPass( L"Resolve", ... )
+ *       .Read( color, D3D12_RESOURCE_STATE_RESOLVE_SOURCE )
+ *       .Write( backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST );
+ *   graph.Compile();
+ *   graph.Execute();
+ *
+ * The graph is created with Device::CreateRenderGraph.
+ *
+ * The passes record their work on the command list they get. They don't need to transition the
+ * resources that they declared, but they still can (for example for subresources).
+ */
+namespace DX12_Library
+{
+
+class CommandList;
+class Device;
+class GpuProfiler;
+class ParallelCommandRecorder;
+class Texture;
+class TransientTextureAllocator;
+
+class RenderGraph
+{
+public:
+    using ResourceID = uint32_t;
+
+    // Records the work of a pass.
+    using ExecuteFunction = std::function<void( CommandList& commandList, const RenderGraph& renderGraph )>;
+    // Records a chunk of a parallel pass.
+    using RecordChunkFunction = std::function<void( CommandList& commandList, uint32_t chunk, uint32_t numChunks,
+                                                    const RenderGraph& renderGraph )>;
+
+    /**
+     * Declares the resources that a pass uses.
+     */
+    class PassBuilder
+    {
+    public:
+        // The pass reads the contents of the resource.
+        PassBuilder& Read( ResourceID resource, D3D12_RESOURCE_STATES state );
+        // The pass overwrites the whole resource (for example, a render target that is cleared).
+        PassBuilder& Write( ResourceID resource, D3D12_RESOURCE_STATES state );
+        // The pass reads and writes the resource (for example, a depth buffer that is tested and written).
+        PassBuilder& ReadWrite( ResourceID resource, D3D12_RESOURCE_STATES state );
+
+    private:
+        friend class RenderGraph;
+
+        PassBuilder( RenderGraph& renderGraph, uint32_t passIndex )
+        : m_RenderGraph( renderGraph )
+        , m_PassIndex( passIndex )
+        {}
+
+        PassBuilder& AddAccess( ResourceID resource, D3D12_RESOURCE_STATES state,
+                                RenderGraphCompiler::AccessType type );
+
+        RenderGraph& m_RenderGraph;
+        uint32_t     m_PassIndex;
+    };
+
+    /**
+     * Add a texture that is owned outside of the graph (for example, the back buffer).
+     * Passes that write to an imported texture are never culled.
+     *
+     * @param initialState The state the texture is expected to be in before the first pass. This is only used to
+     * plan the barriers. The actual state is resolved by the resource state tracker.
+     * @param producer The submission that writes the texture, if it is written on another queue. The first pass
+     * that uses the texture waits for it.
+     */
+    ResourceID ImportTexture( const std::shared_ptr<Texture>& texture,
+                              D3D12_RESOURCE_STATES           initialState = D3D12_RESOURCE_STATE_COMMON,
+                              const SyncPoint&                producer     = {} );
+
+    /**
+     * Add a texture that only exists while the graph is executed. The texture is acquired from the transient
+     * texture allocator before its first pass and released after its last pass, so it must be a render target
+     * or a depth-stencil texture and its first pass must overwrite it.
+     */
+    ResourceID CreateTexture( const D3D12_RESOURCE_DESC& resourceDesc, const D3D12_CLEAR_VALUE* clearValue = nullptr,
+                              const std::wstring& name = L"" );
+
+    /**
+     * Add a pass. The passes are executed in the order they are added, unless they are culled.
+     *
+     * @param flags A combination of RenderGraphCompiler::PassFlags.
+     */
+    PassBuilder AddPass( const std::wstring& name, ExecuteFunction execute,
+                         uint32_t flags = RenderGraphCompiler::PassFlagNone );
+
+    /**
+     * Add a pass whose work is recorded on multiple threads. The execute function records on the command
+     * list of the graph first (for example, to clear and bind the render target). Then the chunks are recorded
+     * with the parallel command recorder into command lists that inherit the state of that command list, and
+     * the command lists are executed in order right after it.
+     */
+    PassBuilder AddParallelPass( const std::wstring& name, ExecuteFunction execute, ParallelCommandRecorder& recorder,
+                                 uint32_t numChunks, RecordChunkFunction recordChunk,
+                                 uint32_t flags = RenderGraphCompiler::PassFlagNone );
+
+    /**
+     * Measure the GPU time of every pass (including its barriers) with a profiler. The scopes that the passes
+     * begin are nested in the scope of the pass. Only the passes on the queue of the profiler are measured.
+     *
+     * @param profiler The profiler or nullptr to stop measuring the passes.
+     */
+    void SetProfiler( GpuProfiler* profiler )
+    {
+        m_Profiler = profiler;
+    }
+
+    /**
+     * Compute the execution order, the barriers and the lifetimes of the transient textures.
+     */
+    void Compile();
+
+    /**
+     * Record and execute the passes. TransientTextureAllocator::BeginFrame must be called
+     * once per frame before the graph is executed.
+     *
+     * @returns The sync point of the direct queue after the last pass.
+     */
+    SyncPoint Execute();
+
+    /**
+     * Get the texture of a resource. Transient textures are only available while their passes are executed.
+     */
+    std::shared_ptr<Texture> GetTexture( ResourceID resource ) const;
+
+    /**
+     * Remove all passes and resources so that the graph can be built again.
+     */
+    void Reset();
+
+    RenderGraphCompiler::Statistics GetStatistics() const
+    {
+        return m_Compiler.GetStatistics();
+    }
+
+protected:
+    /**
+     * @param transientTextureAllocator The allocator that places the transient textures.
+     */
+    RenderGraph( Device& device, TransientTextureAllocator& transientTextureAllocator );
+    virtual ~RenderGraph() = default;
+
+private:
+    struct TextureResource
+    {
+        // Transient textures are only set while they are used.
+        std::shared_ptr<Texture> Texture;
+        bool                     IsImported;
+        D3D12_RESOURCE_STATES    InitialState;
+        SyncPoint                Producer;
+        D3D12_RESOURCE_DESC      ResourceDesc;
+        bool                     HasClearValue;
+        D3D12_CLEAR_VALUE        ClearValue;
+        std::wstring             Name;
+    };
+
+    struct Pass
+    {
+        std::wstring                  Name;
+        ExecuteFunction               Execute;
+        RenderGraphCompiler::PassDesc PassDesc;
+        // Only set for parallel passes.
+        ParallelCommandRecorder* Recorder;
+        uint32_t                 NumChunks;
+        RecordChunkFunction      RecordChunk;
+    };
+
+    // Record the barriers that were planned for a pass.
+    void RecordBarriers( CommandList& commandList, const std::vector<RenderGraphCompiler::Barrier>& barriers );
+
+    Device&                    m_Device;
+    TransientTextureAllocator& m_TransientTextureAllocator;
+
+    RenderGraphCompiler m_Compiler;
+    bool                m_IsCompiled;
+
+    GpuProfiler* m_Profiler;
+
+    std::vector<TextureResource> m_Resources;
+    std::vector<Pass>            m_Passes;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace DX12_Library
+{
+/*
+ * The render graph compiler turns a list of passes that declare which resources they read and
+ * write into an execution plan:
+ *
+ * - The passes are sorted by their dependencies. Independent passes keep the order they were added in.
+ * - Passes whose results are never used are culled.
+ * - Passes that allow it and only use states that are supported by compute queues are moved to the
+ *   compute queue. The passes that depend on them wait for the compute queue (and the other way around).
+ * - The barriers before (and after) every pass are planned. A transition is split if there are
+ *   other passes between the last and the next use of the resource on the same command list.
+ * - The lifetimes of the transient resources are computed so their memory can be aliased.
+ *
+ * This class only deals with pass and resource indices and never calls D3D12, so it can be used
+ * without a device. The RenderGraph executes the plan.
+ */
+class RenderGraphCompiler
+{
+public:
+    static const uint32_t InvalidIndex = 0xffffffff;
+
+    enum AccessType
+    {
+        // The pass reads the contents of the resource.
+        Read,
+        // The pass overwrites the whole resource without reading it.
+        Write,
+        // The pass reads and writes the resource (for example, blending into a render target).
+        ReadWrite
+    };
+
+    enum PassFlags
+    {
+        PassFlagNone = 0,
+        // The pass has results outside of the graph and is never culled.
+        PassFlagSideEffects = 0x1,
+        // The pass only records compute work and may run on the compute queue.
+        PassFlagAllowAsyncCompute = 0x2
+    };
+
+    enum QueueType
+    {
+        GraphicsQueue = 0,
+        ComputeQueue,
+        NumQueueTypes
+    };
+
+    struct ResourceAccess
+    {
+        uint32_t              Resource;
+        D3D12_RESOURCE_STATES State;
+        AccessType            Type;
+    };
+
+    struct ResourceDesc
+    {
+        // Imported resources are owned outside of the graph. Their memory is never aliased and
+        // writes to them are results of the graph.
+        bool IsImported;
+        // The state of an imported resource before the first pass.
+        // Transient resources are initialized by their first pass and don't need a barrier.
+        D3D12_RESOURCE_STATES InitialState;
+    };
+
+    struct PassDesc
+    {
+        std::vector<ResourceAccess> Accesses;
+        uint32_t                    Flags;
+    };
+
+    struct Barrier
+    {
+        uint32_t                     Resource;
+        D3D12_RESOURCE_BARRIER_TYPE  Type;
+        D3D12_RESOURCE_STATES        StateBefore;
+        D3D12_RESOURCE_STATES        StateAfter;
+        D3D12_RESOURCE_BARRIER_FLAGS Flags;
+    };
+
+    struct CompiledPass
+    {
+        // The index of the pass in the order it was added.
+        uint32_t  PassIndex;
+        QueueType Queue;
+        // The barriers that are needed before the pass is executed (including the ends of split barriers).
+        std::vector<Barrier> BarriersBefore;
+        // The beginnings of the split barriers that can be issued after the pass.
+        std::vector<Barrier> BarriersAfter;
+        // The compiled pass on the other queue that must finish before this pass starts (or InvalidIndex).
+        uint32_t WaitForPass;
+        // Another queue waits for this pass.
+        bool Signal;
+    };
+
+    // The compiled passes that use a resource.
+    struct Lifetime
+    {
+        uint32_t FirstPass;
+        uint32_t LastPass;
+    };
+
+    struct Statistics
+    {
+        uint32_t NumPasses;
+        uint32_t NumCulledPasses;
+        uint32_t NumAsyncComputePasses;
+        uint32_t NumBarriers;
+        uint32_t NumSplitBarriers;
+        uint32_t NumQueueWaits;
+    };
+
+    RenderGraphCompiler();
+
+    /**
+     * Check if a resource state can be used on a compute queue.
+     */
+    static bool IsComputeQueueState( D3D12_RESOURCE_STATES state );
+
+    uint32_t AddResource( const ResourceDesc& resourceDesc );
+    uint32_t AddPass( const PassDesc& passDesc );
+
+    /**
+     * Compile the passes that were added. The results stay valid until the graph is reset.
+     */
+    void Compile();
+
+    /**
+     * The passes that are not culled, in the order they must be executed.
+     */
+    const std::vector<CompiledPass>& GetCompiledPasses() const
+    {
+        return m_CompiledPasses;
+    }
+
+    /**
+     * The indices of the first and last compiled pass that use a resource.
+     * Both are InvalidIndex if the resource is not used.
+     */
+    const Lifetime& GetLifetime( uint32_t resource ) const
+    {
+        return m_Lifetimes[resource];
+    }
+
+    uint32_t GetNumResources() const
+    {
+        return static_cast<uint32_t>( m_Resources.size() );
+    }
+
+    uint32_t GetNumPasses() const
+    {
+        return static_cast<uint32_t>( m_Passes.size() );
+    }
+
+    Statistics GetStatistics() const
+    {
+        return m_Statistics;
+    }
+
+    /**
+     * Remove all passes and resources.
+     */
+    void Reset();
+
+private:
+    // Build the dependencies between the passes.
+    void BuildDependencies();
+    // Mark the passes whose results are used.
+    void CullPasses();
+    // Sort the passes that are not culled.
+    void SortPasses();
+    // Decide on which queue each pass is executed.
+    void AssignQueues();
+    // Add the waits between the queues.
+    void AddQueueWaits();
+    // Plan the barriers and compute the lifetimes of the resources.
+    void PlanBarriers();
+
+    std::vector<ResourceDesc> m_Resources;
+    std::vector<PassDesc>     m_Passes;
+
+    // The passes that must be executed before a pass.
+    std::vector<std::vector<uint32_t>> m_Dependencies;
+    // The passes that produce the contents a pass reads (a subset of the dependencies).
+    std::vector<std::vector<uint32_t>> m_Producers;
+    std::vector<bool>                  m_IsPassUsed;
+    // The index of each pass in the compiled passes (or InvalidIndex if it was culled).
+    std::vector<uint32_t> m_CompiledPassIndices;
+
+    std::vector<CompiledPass> m_CompiledPasses;
+    std::vector<Lifetime>     m_Lifetimes;
+
+    Statistics m_Statistics;
+};
+}  // namespace DX12_Library
@@ -3,12 +3,14 @@
 #include <d3d12.h>
 #include <wrl.h>
 
+#include <memory>
 #include <string>
 
 namespace DX12_Library
 {
 
 class Device;
+struct TrackedResourceState;
 /*
  * A resource such as a render target is a memory buffer. The difference
  * between resources is how you operate with it and how the GPU sees it i.e.
@@ -41,6 +43,14 @@ public:
         return resDesc;
     }
 
+    /**
+     * Get the state of the underlying D3D12 resource that is used by the resource state tracker.
+     */
+    TrackedResourceState* GetTrackedResourceState() const
+    {
+        return m_TrackedResourceState.get();
+    }
+
     /**
      * Set the name of the resource. Useful for debugging purposes.
      */
@@ -67,6 +77,10 @@ protected:
 
     virtual ~Resource() = default;
 
+    // Replace the underlying D3D12 resource, e.g. when a texture is resized or a buffer is relocated.
+    // This must not be done while command lists that use the resource are recorded.
+    void SetD3D12Resource( Microsoft::WRL::ComPtr<ID3D12Resource> resource );
+
     // The device that is used to create this resource.
     Device& m_Device;
 
@@ -79,5 +93,9 @@ protected:
 private:
     // Check the format support and populate the m_FormatSupport structure.
     void CheckFeatureSupport();
+
+    // The tracked state of m_d3d12Resource. Only changed by SetD3D12Resource, so that command lists can
+    // read it from multiple threads.
+    std::shared_ptr<TrackedResourceState> m_TrackedResourceState;
 };
 }  // namespace DX12_Library
\ No newline at end of file
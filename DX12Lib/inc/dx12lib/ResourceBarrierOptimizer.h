@@ -0,0 +1,127 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace DX12_Library
+{
+/*
+ * The resource barrier optimizer removes redundant barriers from a batch of barriers that is
+ * flushed to a command list at once. There is no GPU work between the barriers of a batch,
+ * so intermediate states of a (sub)resource are never used:
+ *
+ * - Transitions of the same (sub)resource are merged (A->B, B->C becomes A->C).
+ * - Transitions that end in the state they started in are removed (A->B, B->A).
+ * - Consecutive transitions between read-only states are combined into a single
+ *   transition to all of the read states (A->SRV, SRV->COPY_SOURCE becomes A->SRV|COPY_SOURCE).
+ * - Split barriers that begin and end in the same batch are replaced by a normal barrier.
+ * - Duplicate UAV barriers are removed.
+ *
+ * This class only reads and writes the barrier structures and never calls D3D12.
+ */
+class ResourceBarrierOptimizer
+{
+public:
+    struct Statistics
+    {
+        // The barriers that were passed to Optimize.
+        uint32_t NumBarriers;
+        // The barriers that were removed.
+        uint32_t NumRemovedBarriers;
+        // The transitions that were combined into a single transition to multiple read states.
+        uint32_t NumCombinedReadStates;
+        // The split barriers that were replaced by a normal barrier.
+        uint32_t NumCollapsedSplitBarriers;
+    };
+
+    /**
+     * The final state of a (sub)resource that is different from the last state it was
+     * transitioned to, because read states were combined.
+     */
+    struct CombinedState
+    {
+        ID3D12Resource*       Resource;
+        UINT                  Subresource;
+        D3D12_RESOURCE_STATES State;
+    };
+
+    ResourceBarrierOptimizer();
+
+    /**
+     * Check if a state only contains read-only states.
+     */
+    static bool IsReadState( D3D12_RESOURCE_STATES state );
+
+    /**
+     * Check if a (sub)resource in the current state can be used as if it was in the requested state.
+     * This is the case if the states are the same or if the current state is a combination of
+     * read states that includes the requested state.
+     */
+    static bool IsStateCompatible( D3D12_RESOURCE_STATES currentState, D3D12_RESOURCE_STATES requestedState );
+
+    /**
+     * Optimize a batch of barriers in place. The order of the remaining barriers is preserved.
+     *
+     * @returns The number of barriers that were removed.
+     */
+    uint32_t Optimize( std::vector<D3D12_RESOURCE_BARRIER>& barriers );
+
+    /**
+     * The (sub)resources whose final state was changed by the last call to Optimize.
+     */
+    const std::vector<CombinedState>& GetCombinedStates() const
+    {
+        return m_CombinedStates;
+    }
+
+    /**
+     * The totals of all calls to Optimize since the statistics were reset.
+     */
+    const Statistics& GetStatistics() const
+    {
+        return m_Statistics;
+    }
+
+    void ResetStatistics();
+
+private:
+    // The last transition of a (sub)resource in the batch that later transitions can be merged with.
+    struct OpenTransition
+    {
+        ID3D12Resource* Resource;
+        UINT            Subresource;
+        // The index of the barrier in the batch.
+        uint32_t BarrierIndex;
+        // The state that was requested by the last merged transition.
+        // The barrier may transition to more read states than this.
+        D3D12_RESOURCE_STATES RequestedState;
+        // Set for the begin barrier of a split barrier.
+        bool IsSplitBegin;
+    };
+
+    // Find the open transition of a (sub)resource (or nullptr if there is none).
+    OpenTransition* FindOpenTransition( ID3D12Resource* resource, UINT subresource );
+
+    // Close the open transitions that overlap with the (sub)resource. A null resource overlaps with all resources.
+    // Open transitions that are closed can no longer be merged and their combined read states are undone.
+    void CloseOpenTransitions( std::vector<D3D12_RESOURCE_BARRIER>& barriers, ID3D12Resource* resource,
+                               UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+
+    // Add a transition to the batch or merge it with the open transition of the (sub)resource.
+    void AddTransition( std::vector<D3D12_RESOURCE_BARRIER>& barriers, const D3D12_RESOURCE_BARRIER& barrier );
+
+    // Open transitions in the order they were added.
+    // The number of barriers between two flushes is small, so they are searched linearly.
+    std::vector<OpenTransition> m_OpenTransitions;
+    // UAV barriers that were added to the batch since the last transition of the resource.
+    std::vector<ID3D12Resource*> m_UAVBarriers;
+    // Barriers that are removed from the batch are marked with this flag.
+    std::vector<bool> m_IsRemoved;
+
+    std::vector<CombinedState> m_CombinedStates;
+
+    Statistics m_Statistics;
+};
+}  // namespace DX12_Library
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "ResourceBarrierOptimizer.h"
+
 #include <d3d12.h>
 #include <wrl/client.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -12,6 +18,122 @@ namespace DX12_Library
 {
 class CommandList;
 class Resource;
+
+// Tracks the state of a particular resource and all of its subresources.
+struct ResourceState
+{
+    // The states of the first subresources (the mips of most textures) are stored inline.
+    // The states of the other subresources are stored in a map.
+    static const UINT NumInlineSubresources = 16;
+
+    // Initialize all of the subresources within a resource to the given state.
+    explicit ResourceState( D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON )
+    : State( state )
+    , InlineSubresourceState {}
+    , InlineSubresourceMask( 0 )
+    {}
+
+    // Set a subresource to a particular state.
+    void SetSubresourceState( UINT subresource, D3D12_RESOURCE_STATES state )
+    {
+        if ( subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES )
+        {
+            State                 = state;
+            InlineSubresourceMask = 0;
+            SubresourceState.clear();
+        }
+        else if ( subresource < NumInlineSubresources )
+        {
+            InlineSubresourceState[subresource] = state;
+            InlineSubresourceMask |= 1u << subresource;
+        }
+        else
+        {
+            SubresourceState[subresource] = state;
+        }
+    }
+
+    // Get the state of a (sub)resource within the resource.
+    // If the subresource does not have its own state then the state of the
+    // resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) is returned.
+    D3D12_RESOURCE_STATES GetSubresourceState( UINT subresource ) const
+    {
+        if ( subresource < NumInlineSubresources )
+        {
+            return ( InlineSubresourceMask & ( 1u << subresource ) ) != 0 ? InlineSubresourceState[subresource]
+                                                                           : State;
+        }
+
+        D3D12_RESOURCE_STATES state = State;
+        const auto            iter  = SubresourceState.find( subresource );
+        if ( iter != SubresourceState.end() )
+        {
+            state = iter->second;
+        }
+        return state;
+    }
+
+    // If no subresource has its own state, then the State variable defines
+    // the state of all of the subresources.
+    bool HasSubresourceStates() const
+    {
+        return InlineSubresourceMask != 0 || !SubresourceState.empty();
+    }
+
+    // Call func( subresource, state ) for every subresource that has its own state.
+    template<typename Func>
+    void ForEachSubresourceState( Func func ) const
+    {
+        for ( UINT subresource = 0; subresource < NumInlineSubresources; ++subresource )
+        {
+            if ( ( InlineSubresourceMask & ( 1u << subresource ) ) != 0 )
+            {
+                func( subresource, InlineSubresourceState[subresource] );
+            }
+        }
+        for ( const auto& subresourceState: SubresourceState )
+        {
+            func( subresourceState.first, subresourceState.second );
+        }
+    }
+
+    D3D12_RESOURCE_STATES State;
+
+    std::array<D3D12_RESOURCE_STATES, NumInlineSubresources> InlineSubresourceState;
+    uint32_t                                                 InlineSubresourceMask;
+
+    std::map<UINT, D3D12_RESOURCE_STATES> SubresourceState;
+};
+
+/*
+ * The state of a D3D12 resource that is shared between command lists.
+ * There is exactly one TrackedResourceState for each D3D12 resource. Resource objects
+ * keep a pointer to it so that a transition does not have to look up the resource.
+ */
+struct TrackedResourceState
+{
+    explicit TrackedResourceState( ID3D12Resource* resource )
+    : Resource( resource )
+    , IsTracked( false )
+    , FinalStateIndexHint( 0 )
+    {}
+
+    ID3D12Resource* const Resource;
+
+    // Protects the global state of the resource. Command lists that are submitted to different
+    // queues only wait for each other if they use the same resources.
+    std::mutex Mutex;
+
+    // The state of the resource between command list executions.
+    // Only accessed while the mutex is locked.
+    ResourceState GlobalState;
+    // Resources without a global state are not transitioned before a command list is executed.
+    bool IsTracked;
+
+    // The index of the final state of the resource in the command list that used it most recently.
+    // This is only a hint. Command lists that are recorded in parallel can overwrite it.
+    std::atomic<uint32_t> FinalStateIndexHint;
+};
 /*
  * This is a class simply creates a list that tracks each resource to
  * prevent memory fragmentation and ensures each resource gets transition correctly.
@@ -21,6 +143,21 @@ class Resource;
 class ResourceStateTracker
 {
 public:
+    /**
+     * Counters for the barriers of the command lists that were executed.
+     */
+    struct Statistics
+    {
+        // The barriers that were recorded before the batches were optimized.
+        uint32_t NumBarriers;
+        // The barriers that were removed by the barrier optimizer.
+        uint32_t NumRemovedBarriers;
+        // The transitions that were combined into a single transition to multiple read states.
+        uint32_t NumCombinedReadStates;
+        // The split barriers that were recorded (and not replaced by a normal barrier).
+        uint32_t NumSplitBarriers;
+    };
+
     ResourceStateTracker();
     virtual ~ResourceStateTracker();
 
@@ -43,6 +180,23 @@ public:
                              UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
     void TransitionResource( const Resource& resource, D3D12_RESOURCE_STATES stateAfter,
                              UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+    void TransitionResource( TrackedResourceState* trackedState, D3D12_RESOURCE_STATES stateAfter,
+                             UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+
+    /**
+     * Begin a split transition of a resource. The transition is ended by the next transition
+     * of the resource, which must be done before the resource is used again.
+     * If the state of the resource in the command list is not known yet, a normal
+     * transition is added instead.
+     */
+    void BeginTransitionResource( const Resource& resource, D3D12_RESOURCE_STATES stateAfter,
+                                  UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+
+    /**
+     * End all split transitions that have not been ended yet.
+     * This must be done before the command list is closed.
+     */
+    void EndSplitTransitions();
 
     /**
      * Push a UAV resource barrier for the given resource.
@@ -64,12 +218,23 @@ public:
     void AliasBarrier( const Resource* resourceBefore = nullptr, const Resource* resourceAfter = nullptr );
 
     /**
-     * Flush any pending resource barriers to the command list.
+     * Resolve the pending resource barriers against the global state of the resources and commit
+     * the final states of the resources to the global state. Every resource is locked while its
+     * state is resolved and committed. This must be called when the command list is closed,
+     * while the submissions to the command queue are serialized.
      *
      * @return The number of resource barriers that were flushed to the command list.
      */
     uint32_t FlushPendingResourceBarriers( const std::shared_ptr<CommandList>& commandList );
 
+    /**
+     * Resolve the pending resource barriers and commit the final states like FlushPendingResourceBarriers,
+     * but append the barriers to a vector instead of recording them on a command list.
+     *
+     * @return The number of resource barriers that were appended.
+     */
+    uint32_t ResolvePendingResourceBarriers( std::vector<D3D12_RESOURCE_BARRIER>& resourceBarriers );
+
     /**
      * Flush any (non-pending) resource barriers that have been pushed to the resource state
      * tracker.
@@ -77,35 +242,31 @@ public:
     void FlushResourceBarriers( const std::shared_ptr<CommandList>& commandList );
 
     /**
-     * Commit final resource states to the global resource state map.
-     * This must be called when the command list is closed.
+     * Reset state tracking. This must be done when the command list is reset.
      */
-    void CommitFinalResourceStates();
+    void Reset();
 
     /**
-     * Reset state tracking. This must be done when the command list is reset.
+     * Add a resource with a given state to the global resource state array (map).
+     * This should be done when the resource is created for the first time.
      */
-    void Reset();
+    static void AddGlobalResourceState( ID3D12Resource* resource, D3D12_RESOURCE_STATES state );
 
     /**
-     * The global state must be locked before flushing pending resource barriers
-     * and committing the final resource state to the global resource state.
-     * This ensures consistency of the global resource state between command list
-     * executions.
+     * Get the tracked state of a D3D12 resource. The tracked state is created the first time
+     * it is requested and is kept for the lifetime of the application.
      */
-    static void Lock();
+    static std::shared_ptr<TrackedResourceState> GetTrackedResourceState( ID3D12Resource* resource );
 
     /**
-     * Unlocks the global resource state after the final states have been committed
-     * to the global resource state array.
+     * Get the barrier counters of the command lists that were executed in the previous frame.
      */
-    static void Unlock();
+    static Statistics GetFrameStatistics();
 
     /**
-     * Add a resource with a given state to the global resource state array (map).
-     * This should be done when the resource is created for the first time.
+     * Start counting the barriers of a new frame. This is called when the swap chain is presented.
      */
-    static void AddGlobalResourceState( ID3D12Resource* resource, D3D12_RESOURCE_STATES state );
+    static void EndFrame();
 
     ///**
     // * Remove a resource from the global resource state array (map).
@@ -123,73 +284,79 @@ private:
     // An array (vector) of resource barriers.
     using ResourceBarriers = std::vector<D3D12_RESOURCE_BARRIER>;
 
-    // Pending resource transitions are committed before a command list
-    // is executed on the command queue. This guarantees that resources will
-    // be in the expected state at the beginning of a command list.
-    ResourceBarriers m_PendingResourceBarriers;
+    // A transition barrier for a resource that was not used on the command list before.
+    struct PendingResourceBarrier
+    {
+        D3D12_RESOURCE_BARRIER Barrier;
+        TrackedResourceState*  TrackedState;
+    };
 
-    // Resource barriers that need to be committed to the command list.
-    ResourceBarriers m_ResourceBarriers;
+    // The last known state of a resource within the command list.
+    struct FinalResourceState
+    {
+        TrackedResourceState* TrackedState;
+        ResourceState         State;
+    };
 
-    // Tracks the state of a particular resource and all of its subresources.
-    struct ResourceState
+    // A split transition that was started but not ended.
+    struct SplitTransition
     {
-        // Initialize all of the subresources within a resource to the given state.
-        explicit ResourceState( D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON )
-        : State( state )
-        {}
+        TrackedResourceState*  TrackedState;
+        D3D12_RESOURCE_BARRIER EndBarrier;
+    };
 
-        // Set a subresource to a particular state.
-        void SetSubresourceState( UINT subresource, D3D12_RESOURCE_STATES state )
-        {
-            if ( subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES )
-            {
-                State = state;
-                SubresourceState.clear();
-            }
-            else
-            {
-                SubresourceState[subresource] = state;
-            }
-        }
+    using TrackedResourceStateMap = std::unordered_map<ID3D12Resource*, std::shared_ptr<TrackedResourceState>>;
 
-        // Get the state of a (sub)resource within the resource.
-        // If the specified subresource is not found in the SubresourceState array (map)
-        // then the state of the resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) is
-        // returned.
-        D3D12_RESOURCE_STATES GetSubresourceState( UINT subresource ) const
-        {
-            D3D12_RESOURCE_STATES state = State;
-            const auto            iter  = SubresourceState.find( subresource );
-            if ( iter != SubresourceState.end() )
-            {
-                state = iter->second;
-            }
-            return state;
-        }
+    // The tracked states are split over a number of maps, so that looking up a resource
+    // only has to wait for lookups of other resources in the same shard.
+    static const size_t NumTrackedResourceStateShards = 64;
 
-        // If the SubresourceState array (map) is empty, then the State variable defines
-        // the state of all of the subresources.
-        D3D12_RESOURCE_STATES                 State;
-        std::map<UINT, D3D12_RESOURCE_STATES> SubresourceState;
+    struct TrackedResourceStateShard
+    {
+        TrackedResourceStateMap TrackedResourceStates;
+        std::mutex              Mutex;
     };
 
-    using ResourceList     = std::vector<ID3D12Resource*>;
-    using ResourceStateMap = std::unordered_map<ID3D12Resource*, ResourceState>;
+    // Add a transition barrier for a resource.
+    void TransitionResource( TrackedResourceState* trackedState, const D3D12_RESOURCE_BARRIER& barrier );
+
+    // End the split transitions of a resource.
+    void EndSplitTransitions( TrackedResourceState* trackedState );
+
+    // Get the final state of a resource in this command list (or nullptr if the resource was not used yet).
+    ResourceState* FindFinalResourceState( TrackedResourceState* trackedState );
+
+    // Look up the tracked state without taking a reference.
+    static TrackedResourceState* FindTrackedResourceState( ID3D12Resource* resource );
+
+    // Pending resource transitions are committed before a command list
+    // is executed on the command queue. This guarantees that resources will
+    // be in the expected state at the beginning of a command list.
+    std::vector<PendingResourceBarrier> m_PendingResourceBarriers;
+
+    // Resource barriers that need to be committed to the command list.
+    ResourceBarriers m_ResourceBarriers;
+
+    // Removes redundant barriers before they are committed to the command list.
+    ResourceBarrierOptimizer m_BarrierOptimizer;
+
+    std::vector<SplitTransition> m_SplitTransitions;
+    uint32_t                     m_NumSplitTransitions;
 
     // The final (last known state) of the resources within a command list.
     // The final resource state is committed to the global resource state when the
     // command list is closed but before it is executed on the command queue.
-    ResourceStateMap m_FinalResourceState;
+    std::vector<FinalResourceState> m_FinalResourceStates;
+    // The indices of the final states by D3D12 resource. Used when the index hint of a resource was overwritten
+    // by another command list, and to find the resources of raw barriers without the global lookup.
+    std::unordered_map<ID3D12Resource*, uint32_t> m_FinalResourceStateIndices;
 
-    // The global resource state array (map) stores the state of a resource
-    // between command list execution.
-    static ResourceStateMap ms_GlobalResourceState;
-    // Resources that should be cleaned up when they are no longer being used.
-    //static ResourceList ms_GarbageResources;
+    // The tracked state of every D3D12 resource.
+    static std::array<TrackedResourceStateShard, NumTrackedResourceStateShards> ms_TrackedResourceStateShards;
 
-    // The mutex protects shared access to the GlobalResourceState map.
-    static std::mutex ms_GlobalMutex;
-    static bool       ms_IsLocked;
+    // The barrier counters of the current and the previous frame.
+    static Statistics ms_FrameStatistics;
+    static Statistics ms_PreviousFrameStatistics;
+    static std::mutex ms_StatisticsMutex;
 };
 }  // namespace DX12_Library
\ No newline at end of file
@@ -31,6 +31,15 @@ public:
     uint32_t GetDescriptorTableBitMask( D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType ) const;
     uint32_t GetNumDescriptors( uint32_t rootIndex ) const;
 
+    /**
+     * Get a bit mask of the root parameter indices that are unbounded
+     * descriptor tables into the bindless descriptor heap.
+     */
+    uint32_t GetBindlessTableBitMask() const
+    {
+        return m_BindlessTableBitMask;
+    }
+
 protected:
     friend class std::default_delete<RootSignature>;
 
@@ -57,5 +66,9 @@ private:
     // A bit mask that represents the root parameter indices that are
     // CBV, UAV, and SRV descriptor tables.
     uint32_t m_DescriptorTableBitMask;
+
+    // A bit mask that represents the root parameter indices that are
+    // unbounded descriptor tables into the bindless descriptor heap.
+    uint32_t m_BindlessTableBitMask;
 };
 }  // namespace DX12_Library
\ No newline at end of file
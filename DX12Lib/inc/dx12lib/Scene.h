@@ -1,12 +1,16 @@
 #pragma once
 
+#include "SceneBVH.h"
+
 #include <DirectXCollision.h> // For DirectX::BoundingBox
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 class aiMaterial;
 class aiMesh;
@@ -32,10 +36,10 @@ public:
     Scene()  = default;
     ~Scene() = default;
 
-    void SetRootNode( std::shared_ptr<SceneNode> node )
-    {
-        m_RootNode = node;
-    }
+    /**
+     * Set the root node and build the BVH over its meshes.
+     */
+    void SetRootNode( std::shared_ptr<SceneNode> node );
 
     std::shared_ptr<SceneNode> GetRootNode() const
     {
@@ -44,16 +48,50 @@ public:
 
     /**
      * Get the AABB of the scene.
-     * This returns the AABB of the root node of the scene.
+     * This returns the world space AABB of the root node and all its children as of the last
+     * UpdateTransforms (see SceneNode::GetWorldAABB).
      */
     DirectX::BoundingBox GetAABB() const;
 
+    /**
+     * Recompute the changed world transforms of the scene nodes (see SceneNode::UpdateTransforms) and refit
+     * the BVH to the moved meshes. The BVH is rebuilt instead if scene nodes or meshes were added or removed
+     * since it was built. The depth-first list of the scene nodes that Accept splits into chunks is rebuilt
+     * at the same time.
+     */
+    void UpdateTransforms();
+
+    /**
+     * Build the BVH over the meshes of the scene. This is done by SetRootNode, when the scene is loaded and
+     * by UpdateTransforms after scene nodes or meshes were added or removed.
+     */
+    void BuildBVH();
+
+    /**
+     * Get the BVH for frustum, ray and overlap queries against the meshes of the scene, as of the last
+     * UpdateTransforms.
+     */
+    const SceneBVH& GetBVH() const
+    {
+        return m_BVH;
+    }
+
     /**
      * Accept a visitor.
      * This will first visit the scene, then it will visit the root node of the scene.
      */
     virtual void Accept( Visitor& visitor );
 
+    /**
+     * Accept a visitor for a part of the scene, so that the scene can be recorded on multiple threads
+     * (see ParallelCommandRecorder). The scene nodes are split into numChunks ranges of consecutive nodes
+     * in depth-first order and only the nodes of the given chunk are visited. The scene itself is visited
+     * by every chunk. The nodes are taken from the node list of the last UpdateTransforms, so every chunk
+     * only walks its own nodes. If scene nodes were added or removed since, every chunk has to walk the
+     * whole tree.
+     */
+    void Accept( Visitor& visitor, uint32_t chunk, uint32_t numChunks );
+
 protected:
     friend class CommandList;
 
@@ -80,6 +118,10 @@ private:
     std::shared_ptr<SceneNode> ImportSceneNode( CommandList& commandList, std::shared_ptr<SceneNode> parent,
                                                 const aiNode* aiNode );
 
+    // The node list doesn't match the scene nodes if nodes were added or removed since it was built.
+    bool IsNodeListStale() const;
+    void UpdateNodeList();
+
     using MaterialMap  = std::map<std::string, std::shared_ptr<Material>>;
     using MaterialList = std::vector<std::shared_ptr<Material>>;
     using MeshList     = std::vector<std::shared_ptr<Mesh>>;
@@ -90,6 +132,15 @@ private:
 
     std::shared_ptr<SceneNode> m_RootNode;
 
+    // The BVH only holds weak pointers to the scene nodes and meshes.
+    SceneBVH m_BVH;
+
+    // The scene nodes in depth-first order. The nodes are only accessed while the list is not stale, which
+    // is checked with the version of the transform hierarchy of the root node.
+    std::vector<SceneNode*>           m_NodeList;
+    std::weak_ptr<TransformHierarchy> m_NodeListTransforms;
+    uint64_t                          m_NodeListVersion = 0;
+
     std::wstring m_SceneFile;
 };
 }  // namespace DX12_Library
\ No newline at end of file
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "TransformHierarchy.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * The scene BVH is a bounding volume hierarchy over the mesh instances of a scene: every mesh of every scene
+ * node with the AABB of the mesh in world space. It is used for frustum culling, picking and overlap queries
+ * that only visit the parts of the scene that can intersect the query.
+ *
+ * The BVH is built top-down with the surface area heuristic (SAH), evaluated at a fixed number of bins per
+ * axis. The nodes are stored in an array, every node after its parent, and the instances are sorted so that
+ * the instances of every subtree are contiguous. After the transforms of the scene changed, Refit recomputes
+ * the AABBs of the instances whose transforms were recomputed by the last update of the transform hierarchy
+ * of the scene, and of the nodes above them, without changing the tree. If refitting degrades the tree too
+ * much (the SAH cost more than doubles since the last build), the tree is rebuilt.
+ *
+ * The instances store the handles of the transforms of their scene nodes and the AABBs of their meshes, so
+ * refitting doesn't access the scene nodes or meshes, which only are referred to by weak pointers. The BVH
+ * is stale after scene nodes or meshes were added or removed, since the instances no longer match the scene
+ * and the handles may be reused (see IsStale). Scene::UpdateTransforms rebuilds a stale BVH.
+ */
+namespace DX12_Library
+{
+
+class Mesh;
+class Scene;
+class SceneNode;
+
+class SceneBVH
+{
+public:
+    struct Instance
+    {
+        std::weak_ptr<SceneNode>          Node;
+        std::weak_ptr<DX12_Library::Mesh> Mesh;
+        // The transform of the scene node and the AABB of the mesh in local space.
+        TransformHierarchy::Handle Transform;
+        DirectX::BoundingBox       LocalAABB;
+        // The AABB of the mesh in world space.
+        DirectX::BoundingBox AABB;
+    };
+
+    struct Statistics
+    {
+        uint32_t NumInstances;
+        uint32_t NumNodes;
+        uint32_t NumLeaves;
+        uint32_t MaxDepth;
+        // The SAH cost of the tree relative to the cost of testing every instance.
+        float SAHCost;
+        // The number of rebuilds because refitting degraded the tree.
+        uint32_t NumRebuilds;
+    };
+
+    SceneBVH();
+    ~SceneBVH();
+
+    /**
+     * Build the BVH over the mesh instances of a scene.
+     */
+    void Build( Scene& scene );
+
+    /**
+     * Remove all instances.
+     */
+    void Clear();
+
+    /**
+     * Check if scene nodes or meshes were added to or removed from the scene since the BVH was built, or if
+     * the scene has another root node. A stale BVH must be rebuilt before it is refit.
+     */
+    bool IsStale( const Scene& scene ) const;
+
+    /**
+     * Recompute the AABBs of the instances whose world transforms changed and refit the nodes above them.
+     * If the transform hierarchy was updated more than once since the last refit, all instances are
+     * recomputed. A stale BVH is not refit.
+     */
+    void Refit();
+
+    bool IsEmpty() const
+    {
+        return m_Instances.empty();
+    }
+
+    size_t GetNumInstances() const
+    {
+        return m_Instances.size();
+    }
+
+    const Instance& GetInstance( uint32_t index ) const
+    {
+        return m_Instances[index];
+    }
+
+    /**
+     * Get the AABB of all instances.
+     */
+    DirectX::BoundingBox GetAABB() const;
+
+    /**
+     * Append the indices of the instances whose AABB intersects a volume in world space.
+     */
+    void Query( const DirectX::BoundingFrustum& frustum, std::vector<uint32_t>& instances ) const;
+    void Query( const DirectX::BoundingBox& box, std::vector<uint32_t>& instances ) const;
+    void Query( const DirectX::BoundingSphere& sphere, std::vector<uint32_t>& instances ) const;
+
+    /**
+     * Find the closest instance whose AABB is hit by a ray.
+     *
+     * @param direction The normalized direction of the ray.
+     * @param instance The index of the instance that was hit.
+     * @param distance The distance along the ray to the AABB of the instance.
+     * @returns false if no instance was hit.
+     */
+    bool RayCast( DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, uint32_t& instance,
+                  float& distance ) const;
+
+    const Statistics& GetStatistics() const
+    {
+        return m_Statistics;
+    }
+
+private:
+    static const uint32_t NumBins     = 16;
+    static const uint32_t MaxLeafSize = 4;
+
+    struct Node
+    {
+        DirectX::BoundingBox AABB;
+        // The instances of the subtree.
+        uint32_t FirstInstance;
+        uint32_t NumInstances;
+        // The first of the two children (the second child follows it) or 0 for a leaf.
+        uint32_t FirstChild;
+    };
+
+    // Build the tree over the current instances.
+    void BuildNodes();
+
+    // Split the instances of a node. Returns the number of instances in the first child or 0 for a leaf.
+    uint32_t Split( const Node& node );
+
+    // Recompute the AABBs of all instances and nodes.
+    void RefitAll( const TransformHierarchy& transforms );
+
+    // Recompute the AABBs of the instances of the updated transforms and of the nodes above them.
+    void RefitUpdated( const TransformHierarchy& transforms );
+
+    // The cost of a node, weighted by its area.
+    static float GetNodeCost( const Node& node );
+
+    // The SAH cost of the tree relative to the cost of testing every instance.
+    float ComputeSAHCost() const;
+
+    template<typename Volume>
+    void QueryVolume( const Volume& volume, std::vector<uint32_t>& instances ) const;
+
+    // Sorted so that the instances of every subtree are contiguous.
+    std::vector<Instance> m_Instances;
+    // The nodes, every node is stored after its parent. The root is the first node.
+    std::vector<Node>     m_Nodes;
+    std::vector<uint32_t> m_NodeParents;
+    // Marks the nodes whose AABBs are recomputed during a refit.
+    std::vector<uint8_t> m_NodeChanged;
+
+    // The leaf of every instance and the instances of every transform handle, whose instance indices for
+    // handle h are m_TransformInstances[m_TransformInstanceOffsets[h]] up to the offset of h + 1.
+    std::vector<uint32_t> m_InstanceLeaves;
+    std::vector<uint32_t> m_TransformInstanceOffsets;
+    std::vector<uint32_t> m_TransformInstances;
+
+    // The transform hierarchy of the scene, its version when the BVH was built and its update count when
+    // the BVH was last refit.
+    std::weak_ptr<TransformHierarchy> m_Transforms;
+    uint64_t                          m_Version;
+    uint64_t                          m_UpdateCount;
+
+    // The sum of the costs of all nodes (see GetNodeCost).
+    double m_NodeCosts;
+
+    // The SAH cost after the last build.
+    float      m_BuildSAHCost;
+    Statistics m_Statistics;
+};
+}  // namespace DX12_Library
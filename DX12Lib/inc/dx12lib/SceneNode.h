@@ -1,5 +1,7 @@
 #pragma once
 
+#include "TransformHierarchy.h"
+
 #include <map>
 #include <memory>
 #include <string>
@@ -58,6 +60,8 @@ public:
     /**
      * Get the scene node's world transform (concatenated with its parents
      * world transform).
+     * The world transform is cached in the transform hierarchy of the node and only recomputed after the
+     * local transform of the node or one of its parents changed.
      */
     DirectX::XMMATRIX GetWorldTransform() const;
 
@@ -67,6 +71,29 @@ public:
      */
     DirectX::XMMATRIX GetInverseWorldTransform() const;
 
+    /**
+     * Recompute the changed world transforms of the transform hierarchy of this node (which contains the
+     * whole tree of the node), so that every world transform is computed once per frame. Until then, the
+     * changed world transforms are computed from the local transforms of their parents when they are read.
+     */
+    void UpdateTransforms();
+
+    /**
+     * Get the transform hierarchy that stores the transforms of the tree of this node.
+     */
+    const std::shared_ptr<TransformHierarchy>& GetTransformHierarchy() const
+    {
+        return m_Transforms;
+    }
+
+    /**
+     * Get the handle of the transform of this node in its transform hierarchy.
+     */
+    TransformHierarchy::Handle GetTransformHandle() const
+    {
+        return m_TransformHandle;
+    }
+
     /**
      * Add a child node to this scene node.
      * NOTE: Circular references are not checked.
@@ -96,14 +123,40 @@ public:
      */
     const DirectX::BoundingBox& GetAABB() const;
 
+    /**
+     * Get the world space AABB of the meshes of this node and all its children.
+     * The AABB is maintained by the transform hierarchy and is updated by UpdateTransforms. If the subtree
+     * has no meshes, an empty AABB at the origin is returned.
+     */
+    DirectX::BoundingBox GetWorldAABB() const;
+
     /**
      * Accept a visitor.
      */
     void Accept( Visitor& visitor );
 
+    /**
+     * Accept a visitor for this node and its meshes, but not for its children.
+     */
+    void AcceptNode( Visitor& visitor );
+
+    /**
+     * Append the nodes of this subtree to a list in depth-first order, starting with this node.
+     */
+    void GetNodes( std::vector<SceneNode*>& nodes );
+
 protected:
     DirectX::XMMATRIX GetParentWorldTransform() const;
 
+    // Move the transforms of this subtree to another transform hierarchy.
+    void MoveTransforms( const std::shared_ptr<TransformHierarchy>& transforms, TransformHierarchy::Handle parent );
+
+    // Remove this node from its parent, keeping its world transform.
+    void Detach();
+
+    // Recompute the AABB of the meshes and pass it to the transform hierarchy.
+    void UpdateAABB();
+
 private:
     using NodePtr     = std::shared_ptr<SceneNode>;
     using NodeList    = std::vector<NodePtr>;
@@ -112,14 +165,9 @@ private:
 
     std::string m_Name;
 
-    // This data must be aligned to a 16-byte boundary.
-    // The only way to guarantee this, is to allocate this
-    // structure in aligned memory.
-    struct alignas( 16 ) AlignedData
-    {
-        DirectX::XMMATRIX m_LocalTransform;
-        DirectX::XMMATRIX m_InverseTransform;
-    } * m_AlignedData;
+    // The transforms of all nodes of a tree are stored in the same transform hierarchy.
+    std::shared_ptr<TransformHierarchy> m_Transforms;
+    TransformHierarchy::Handle          m_TransformHandle;
 
     std::weak_ptr<SceneNode> m_ParentNode;
     NodeList                 m_Children;
@@ -26,14 +26,24 @@ public:
         return m_Descriptor.GetDescriptorHandle();
     }
 
+    /**
+     * Get the index of the SRV in the bindless descriptor heap.
+     * Returns BindlessDescriptorHeap::InvalidIndex if bindless descriptors are not enabled.
+     */
+    uint32_t GetBindlessIndex() const
+    {
+        return m_BindlessIndex;
+    }
+
 protected:
     ShaderResourceView( Device& device, const std::shared_ptr<Resource>& resource,
                         const D3D12_SHADER_RESOURCE_VIEW_DESC* srv = nullptr );
-    virtual ~ShaderResourceView() = default;
+    virtual ~ShaderResourceView();
 
 private:
     Device&                   m_Device;
     std::shared_ptr<Resource> m_Resource;
     DescriptorAllocation      m_Descriptor;
+    uint32_t                  m_BindlessIndex;
 };
 }  // namespace DX12_Library
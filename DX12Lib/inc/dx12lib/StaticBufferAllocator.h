@@ -0,0 +1,163 @@
+#pragma once
+
+#include "BufferBlockAllocator.h"
+#include "Defines.h"
+#include "DescriptorAllocatorPage.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * The static buffer allocator places the geometry of static vertex and index buffers in large
+ * default heap buffers (blocks) instead of creating a committed resource per mesh. This avoids
+ * the 64 KB alignment of small committed resources and keeps the number of resources low.
+ *
+ * Vertex and index data use separate blocks so that a block is only read in a single resource state.
+ * Freed ranges are only reused once the command queues are done with the work that was
+ * submitted before they were freed.
+ *
+ * New geometry is uploaded to a block on the copy queue while other ranges of the same block are
+ * drawn, and copy queues only accept resources in the COMMON state. So the blocks are not tracked by
+ * the resource state tracker and are never transitioned explicitly: command lists rely on the implicit
+ * promotion of buffers to the vertex, index and copy states, and the blocks decay back to COMMON when
+ * each ExecuteCommandLists call finishes. CommandList::SetVertexBuffers and SetIndexBuffer skip the
+ * transitions of static buffers (see VertexBuffer::IsStatic and IndexBuffer::IsStatic), so the blocks
+ * must not be transitioned by other means either.
+ */
+namespace DX12_Library
+{
+
+class Device;
+
+class StaticBufferAllocator
+{
+public:
+    enum BufferType
+    {
+        VertexData = 0,
+        IndexData,
+        NumBufferTypes
+    };
+
+    // The default size of a block.
+    static const size_t DefaultBlockSize = _32MB;
+
+    // Vertex and index buffer views are aligned to this.
+    static const size_t DefaultAlignment = 16;
+
+    struct Allocation
+    {
+        // The block buffer that contains the allocation.
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        // The offset and size of the allocation in the block buffer.
+        size_t Offset;
+        size_t Size;
+        // Identifies the allocation.
+        uint64_t ID;
+    };
+
+    // Called when an allocation was moved to a different block.
+    using RelocationCallback = std::function<void( const Allocation& allocation )>;
+
+    /**
+     * Allocate a range of a block buffer.
+     */
+    Allocation Allocate( BufferType type, size_t sizeInBytes );
+
+    /**
+     * Set the function that is called when the allocation is moved by Defragment.
+     * Allocations without a relocation callback are never moved.
+     */
+    void SetRelocationCallback( uint64_t id, RelocationCallback callback );
+
+    /**
+     * Free an allocation. The range is reused once the GPU is done with it.
+     */
+    void Free( uint64_t id );
+
+    /**
+     * Return the freed ranges that are no longer in use by the GPU.
+     * This is done automatically before allocating.
+     */
+    void ReleaseStaleAllocations();
+
+    /**
+     * Move up to maxMoves allocations out of the least occupied block.
+     * The data is copied on the copy queue and the direct and compute queues wait for the copy before
+     * executing any further work. The relocation callbacks are called to update the buffer views, so
+     * this should not be called while command lists that use the buffers are being recorded.
+     *
+     * @returns The number of allocations that were moved.
+     */
+    uint32_t Defragment( BufferType type, uint32_t maxMoves = 64 );
+
+    /**
+     * Get the occupancy of all blocks of a buffer type.
+     */
+    BufferBlockAllocator::Statistics GetStatistics( BufferType type ) const;
+
+    /**
+     * Get the occupancy of each block of a buffer type.
+     */
+    std::vector<BufferBlockAllocator::BlockOccupancy> GetBlockOccupancy( BufferType type ) const;
+
+protected:
+    friend class std::default_delete<StaticBufferAllocator>;
+
+    explicit StaticBufferAllocator( Device& device, size_t blockSize = DefaultBlockSize );
+    virtual ~StaticBufferAllocator() = default;
+
+private:
+    struct AllocationInfo
+    {
+        BufferType                       Type;
+        BufferBlockAllocator::Allocation Range;
+        RelocationCallback               OnRelocated;
+    };
+
+    struct StaleAllocation
+    {
+        BufferType                                Type;
+        BufferBlockAllocator::Allocation          Range;
+        DescriptorAllocatorPage::QueueFenceValues FenceValues;
+    };
+
+    struct BlockList
+    {
+        explicit BlockList( size_t blockSize )
+        : Allocator( blockSize )
+        {}
+
+        BufferBlockAllocator                                Allocator;
+        std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> Blocks;
+    };
+
+    // Create the buffers for the blocks that were added to the block allocator.
+    // The mutex must be held by the caller.
+    void CreateBlocks( BufferType type );
+
+    // The mutex must be held by the caller.
+    void ReleaseCompletedAllocations();
+
+    Allocation MakeAllocation( uint64_t id, const AllocationInfo& info ) const;
+
+    Device& m_Device;
+
+    BlockList m_BlockLists[NumBufferTypes];
+
+    std::unordered_map<uint64_t, AllocationInfo> m_Allocations;
+    uint64_t                                     m_NextAllocationID;
+
+    std::queue<StaleAllocation> m_StaleAllocations;
+
+    mutable std::mutex m_Mutex;
+};
+}  // namespace DX12_Library
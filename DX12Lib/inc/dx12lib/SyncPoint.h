@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * A sync point identifies a submission to a command queue: the queue and the fence value that the queue
+ * signals after the submission. Work on another queue that consumes the results of the submission waits
+ * for the sync point instead of the latest fence value of the queue, so it only waits for its producers
+ * and not for work that was submitted later (possibly by other threads).
+ */
+namespace DX12_Library
+{
+
+class CommandQueue;
+
+struct SyncPoint
+{
+    // A sync point without a queue means there is nothing to wait for.
+    CommandQueue* Queue      = nullptr;
+    uint64_t      FenceValue = 0;
+
+    bool IsValid() const
+    {
+        return Queue != nullptr;
+    }
+
+    /**
+     * Check if the GPU reached the sync point. An invalid sync point is always complete.
+     */
+    bool IsComplete() const;
+
+    /**
+     * Block the calling thread until the GPU reaches the sync point.
+     */
+    void WaitForCompletion() const;
+};
+}  // namespace DX12_Library
@@ -39,6 +39,16 @@ public:
      */
     D3D12_CPU_DESCRIPTOR_HANDLE GetShaderResourceView() const;
 
+    /**
+     * Get the index of the default SRV in the bindless descriptor heap.
+     * Returns BindlessDescriptorHeap::InvalidIndex if bindless descriptors are not enabled
+     * or the texture does not have an SRV.
+     */
+    uint32_t GetBindlessIndex() const
+    {
+        return m_BindlessIndex;
+    }
+
     /**
      * Get the UAV for the texture at a specific mip level.
      * Note: Only only supported for 1D and 2D textures.
@@ -104,5 +114,8 @@ private:
     DescriptorAllocation m_DepthStencilView;
     DescriptorAllocation m_ShaderResourceView;
     DescriptorAllocation m_UnorderedAccessView;
+
+    // Index of the SRV in the bindless descriptor heap.
+    uint32_t m_BindlessIndex;
 };
 }  // namespace DX12_Library
\ No newline at end of file
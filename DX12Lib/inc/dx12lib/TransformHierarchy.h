@@ -0,0 +1,205 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/*
+ * The transform hierarchy stores the transforms of a tree of scene nodes in contiguous arrays: the local
+ * transforms, the world transforms, the inverse world transforms and the index of the parent of every
+ * transform. The arrays are sorted in depth-first order, so parents precede their children and the
+ * transforms of every subtree are a contiguous range.
+ *
+ * Transforms are identified by handles that stay valid while the arrays are reordered. The arrays are only
+ * reordered by Update, after transforms were removed or reparented, or added below a transform whose subtree
+ * is not the last range of the arrays.
+ *
+ * Changing a local transform marks the range of its subtree dirty, so reading the world transform of a clean
+ * transform returns the transform of the last update. The world transform of a dirty transform is computed
+ * from the local transforms up to its closest clean parent. Until the arrays are sorted again, the subtree
+ * ranges are unknown and reads check the parents of the transform instead. Reads don't modify the
+ * hierarchy, so the transforms can be read on multiple threads.
+ *
+ * Every transform can have bounds in local space (e.g. the AABB of the meshes of a scene node). Update also
+ * computes the world space bounds of every subtree by merging the bounds of the children into their parents.
+ * Update only recomputes the dirty subtrees and the bounds of their parents, unless the arrays were sorted.
+ */
+namespace DX12_Library
+{
+
+class TransformHierarchy
+{
+public:
+    using Handle = uint32_t;
+
+    static const Handle InvalidHandle = UINT32_MAX;
+
+    TransformHierarchy();
+    ~TransformHierarchy();
+
+    /**
+     * Add a transform.
+     *
+     * @param parent The transform that the transform is relative to or InvalidHandle for a root transform.
+     */
+    Handle Add( const DirectX::XMMATRIX& localTransform, Handle parent = InvalidHandle );
+
+    /**
+     * Remove a transform. The children of the transform become root transforms.
+     */
+    void Remove( Handle handle );
+
+    /**
+     * Set the parent of a transform. The local transform doesn't change.
+     * NOTE: Circular references are not checked.
+     */
+    void SetParent( Handle handle, Handle parent );
+
+    DirectX::XMMATRIX GetLocalTransform( Handle handle ) const;
+    void              SetLocalTransform( Handle handle, const DirectX::XMMATRIX& localTransform );
+
+    DirectX::XMMATRIX GetWorldTransform( Handle handle ) const;
+    DirectX::XMMATRIX GetInverseWorldTransform( Handle handle ) const;
+
+    /**
+     * Set the bounds of a transform in local space.
+     */
+    void SetBounds( Handle handle, const DirectX::BoundingBox& bounds );
+
+    /**
+     * Remove the bounds of a transform, e.g. if the scene node has no meshes.
+     */
+    void ClearBounds( Handle handle );
+
+    /**
+     * Get the world space bounds of a transform and all its children as of the last update.
+     *
+     * @returns false if neither the transform nor its children have bounds.
+     */
+    bool GetWorldBounds( Handle handle, DirectX::BoundingBox& bounds ) const;
+
+    /**
+     * Recompute the world transforms that changed since the last update. This is the only function that
+     * reorders the arrays. The cost is proportional to the size of the dirty subtrees, unless the arrays
+     * are sorted, which recomputes all transforms.
+     */
+    void Update();
+
+    /**
+     * The number of transforms in the hierarchy.
+     */
+    size_t GetNumTransforms() const
+    {
+        return m_NumTransforms;
+    }
+
+    /**
+     * The version is incremented when transforms are added, removed or reparented or their bounds change,
+     * so that data that is derived from the structure of the hierarchy (e.g. a BVH) can check if it is out
+     * of date.
+     */
+    uint64_t GetVersion() const
+    {
+        return m_Version;
+    }
+
+    /**
+     * The number of updates. Every update increments it, even if no world transform changed.
+     */
+    uint64_t GetUpdateCount() const
+    {
+        return m_UpdateCount;
+    }
+
+    /**
+     * Get the handles of the transforms whose world transforms were recomputed by the last update.
+     */
+    const std::vector<Handle>& GetUpdatedHandles() const
+    {
+        return m_UpdatedHandles;
+    }
+
+private:
+    static const uint32_t InvalidSlot = UINT32_MAX;
+
+    uint32_t GetSlot( Handle handle ) const
+    {
+        assert( handle < m_HandleSlots.size() && m_HandleSlots[handle] != InvalidSlot );
+        return m_HandleSlots[handle];
+    }
+
+    // The parent slot of a slot, or InvalidSlot if the parent was removed.
+    uint32_t GetParentSlot( uint32_t slot ) const
+    {
+        auto parent = m_Parents[slot];
+        return parent != InvalidSlot && m_SlotHandles[parent] != InvalidHandle ? parent : InvalidSlot;
+    }
+
+    // Compute the world transform of a slot whose cached world transform may be out of date.
+    DirectX::XMMATRIX ComputeWorldTransform( uint32_t slot ) const;
+
+    // Mark the subtree of a slot dirty.
+    void MarkDirty( uint32_t slot );
+
+    // Recompute the bounds of a slot and its parents by the next update.
+    void InvalidateBounds( uint32_t slot );
+
+    // Sort the slots in depth-first order and remove the slots of removed transforms.
+    void Sort();
+
+    // Recompute the world transforms of all dirty slots and the bounds of all slots, after a sort.
+    void UpdateAll();
+
+    // Recompute the world transforms and bounds of the dirty subtrees and the bounds of their parents.
+    void UpdateDirtySubtrees();
+
+    // Recompute the world transform of a slot from the world transform of its parent.
+    void UpdateWorldTransform( uint32_t slot );
+
+    // Recompute the world bounds of a slot from its local bounds and the world bounds of its children.
+    void UpdateBounds( uint32_t slot );
+
+    // The transforms, sorted in depth-first order.
+    std::vector<DirectX::XMMATRIX> m_LocalTransforms;
+    std::vector<DirectX::XMMATRIX> m_WorldTransforms;
+    std::vector<DirectX::XMMATRIX> m_InverseWorldTransforms;
+    // The slot of the parent of each slot.
+    std::vector<uint32_t> m_Parents;
+    // The end of the range of the subtree of each slot. Only valid if the arrays don't need to be sorted.
+    std::vector<uint32_t> m_SubtreeEnds;
+    // The world transform of the slot is out of date. If the arrays don't need to be sorted, the whole
+    // subtree of a dirty slot is dirty, otherwise only the slots whose local transform or parent changed.
+    std::vector<uint8_t> m_Dirty;
+    // The handle of each slot. InvalidHandle marks the slot of a removed transform.
+    std::vector<Handle> m_SlotHandles;
+
+    // The bounds of each slot in local space and the bounds of the subtree of each slot in world space.
+    std::vector<DirectX::BoundingBox> m_LocalBounds;
+    std::vector<DirectX::BoundingBox> m_WorldBounds;
+    std::vector<uint8_t>              m_HasLocalBounds;
+    std::vector<uint8_t>              m_HasWorldBounds;
+    // The bounds of the slot are recomputed by the current update.
+    std::vector<uint8_t> m_BoundsDirty;
+
+    // The slots whose subtrees were marked dirty and the slots whose local bounds changed since the last
+    // update.
+    std::vector<uint32_t> m_DirtySubtrees;
+    std::vector<uint32_t> m_ChangedBounds;
+
+    // The slot of each handle and the handles that can be reused.
+    std::vector<uint32_t> m_HandleSlots;
+    std::vector<Handle>   m_FreeHandles;
+
+    // The handles of the world transforms that were recomputed by the last update.
+    std::vector<Handle> m_UpdatedHandles;
+
+    size_t   m_NumTransforms;
+    uint64_t m_Version;
+    uint64_t m_UpdateCount;
+    // The subtrees are not contiguous or slots were removed.
+    bool m_NeedsSort;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "BufferBlockAllocator.h"
+#include "Defines.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * The transient texture allocator places render targets and depth buffers that are only needed
+ * during a part of a frame into shared heaps. Textures whose lifetimes do not overlap within a
+ * frame share the same memory. An aliasing barrier is recorded every time a texture is acquired.
+ *
+ * The placed textures are cached and reused in the next frames as long as the same textures
+ * are requested, so the views of the textures are only created once.
+ *
+ * The textures must only be used on the direct queue and the allocator is not thread safe.
+ */
+namespace DX12_Library
+{
+
+class CommandList;
+class Device;
+class Texture;
+
+class TransientTextureAllocator
+{
+public:
+    // The default size of a heap.
+    static const size_t DefaultHeapSize = _64MB;
+
+    // Cached textures that are not used for this many frames are released.
+    static const uint64_t MaxUnusedFrames = 8;
+
+    struct Statistics
+    {
+        uint32_t NumHeaps;
+        // The size of all heaps.
+        size_t HeapSize;
+        // The memory that is used by the active textures.
+        size_t UsedSize;
+        // The most memory that was used at the same time.
+        size_t PeakUsedSize;
+        // The memory that the textures acquired in the current frame would need without aliasing.
+        size_t RequestedSize;
+        uint32_t NumActiveTextures;
+        uint32_t NumCachedTextures;
+    };
+
+    /**
+     * Start a new frame. Textures that were not released in the previous frame are released.
+     */
+    void BeginFrame();
+
+    /**
+     * Get a texture that is placed in memory that is not used by any other active texture.
+     * The texture must be a render target or a depth-stencil texture. Its contents are undefined
+     * so it must be cleared (or fully overwritten) before it is read.
+     *
+     * @param commandList The command list that records the aliasing barrier for the texture.
+     */
+    std::shared_ptr<Texture> AcquireTexture( CommandList& commandList, const D3D12_RESOURCE_DESC& resourceDesc,
+                                             const D3D12_CLEAR_VALUE* clearValue = nullptr,
+                                             const std::wstring&      name       = L"" );
+
+    /**
+     * Release a texture when it is no longer used in the current frame.
+     * The memory of the texture can be used by textures that are acquired later in the frame.
+     */
+    void ReleaseTexture( const std::shared_ptr<Texture>& texture );
+
+    /**
+     * Release all heaps and textures. The GPU must be finished with the textures.
+     */
+    void Reset();
+
+    Statistics GetStatistics() const;
+
+protected:
+    TransientTextureAllocator( Device& device, size_t heapSize = DefaultHeapSize );
+    virtual ~TransientTextureAllocator() = default;
+
+private:
+    struct PlacedTexture
+    {
+        std::shared_ptr<Texture> Texture;
+        uint32_t                 HeapIndex;
+        size_t                   Offset;
+        D3D12_RESOURCE_DESC      ResourceDesc;
+        bool                     HasClearValue;
+        D3D12_CLEAR_VALUE        ClearValue;
+        uint64_t                 LastUsedFrame;
+    };
+
+    // Create the heaps for the blocks that were added to the heap allocator.
+    void CreateHeaps();
+
+    // Find a cached texture or create a new placed texture.
+    std::shared_ptr<Texture> GetPlacedTexture( const BufferBlockAllocator::Allocation& range,
+                                               const D3D12_RESOURCE_DESC&              resourceDesc,
+                                               const D3D12_CLEAR_VALUE*                clearValue );
+
+    Device& m_Device;
+    size_t  m_HeapSize;
+
+    // Keeps track of the ranges of the heaps that are used by the active textures.
+    std::unique_ptr<BufferBlockAllocator>         m_HeapAllocator;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> m_Heaps;
+
+    std::vector<PlacedTexture>                                  m_PlacedTextures;
+    std::unordered_map<Texture*, BufferBlockAllocator::Allocation> m_ActiveTextures;
+
+    uint64_t m_FrameCounter;
+    size_t   m_PeakUsedSize;
+    size_t   m_RequestedSize;
+};
+}  // namespace DX12_Library
@@ -1,21 +1,31 @@
 #pragma once
 
 #include "Defines.h"
+#include "UploadRingBuffer.h"
 
 #include <d3d12.h>
-#include <wrl.h>
 
-#include <deque>
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace DX12_Library
 {
 
-class Device;
 /*
  * This buffer allows you to create one buffer to accomodate different types of resource data
  * for uploading, copying and managing different resource data on the GPU. Individuals views get
  * built to bind that resource data to the graphics pipeline.
+ *
+ * Each command list has its own upload buffer that sub-allocates from blocks of the command queue's
+ * UploadRingBuffer. The blocks are retired when the command list is executed.
+ *
+ * Allocations fall into three size classes:
+ * - Small allocations (constant buffers, small dynamic buffers) are packed into the current block.
+ * - Medium allocations get a block of their own from the ring buffer.
+ * - Large allocations (larger than UploadRingBuffer::GetMaxRingAllocationSize) get a dedicated
+ *   upload buffer from the ring buffer's pool of dedicated buffers.
  */
 class UploadBuffer
 {
@@ -28,16 +38,24 @@ public:
     };
 
     /**
-     * The maximum size of an allocation is the size of a single page.
+     * The size of the blocks that are reserved from the ring buffer.
+     * Allocations that are larger than a block get a block of their own.
      */
-    size_t GetPageSize() const
+    size_t GetBlockSize() const
     {
-        return m_PageSize;
+        return m_BlockSize;
+    }
+
+    /**
+     * Allocations up to this size are packed into the current block.
+     */
+    size_t GetMaxSmallAllocationSize() const
+    {
+        return m_BlockSize / 4;
     }
 
     /**
      * Allocate memory in an Upload heap.
-     * An allocation must not exceed the size of a page.
      * Use a memcpy or similar method to copy the
      * buffer data to CPU pointer in the Allocation structure returned from
      * this function.
@@ -45,8 +63,17 @@ public:
     Allocation Allocate( size_t sizeInBytes, size_t alignment );
 
     /**
-     * Release all allocated pages. This should only be done when the command list
-     * is finished executing on the CommandQueue.
+     * Retire all of the blocks that were allocated since the last call.
+     * This is done by the CommandQueue when the command list is executed.
+     *
+     * @param fenceValue The fence value that the command queue signals after
+     * the command list has finished executing.
+     */
+    void Retire( uint64_t fenceValue );
+
+    /**
+     * Return the blocks that were never submitted to the ring buffer. This should
+     * only be done when the command list is finished executing on the CommandQueue.
      */
     void Reset();
 
@@ -54,61 +81,33 @@ protected:
     friend class std::default_delete<UploadBuffer>;
 
     /**
-     * @param pageSize The size to use to allocate new pages in GPU memory.
+     * @param ringBuffer The ring buffer of the command queue that executes the command list.
+     * @param blockSize The size of the blocks to reserve from the ring buffer.
      */
-    explicit UploadBuffer( Device& device, size_t pageSize = _2MB );
+    explicit UploadBuffer( UploadRingBuffer& ringBuffer, size_t blockSize = _64KB );
     virtual ~UploadBuffer();
 
 private:
-    // A single page for the allocator.
-    struct Page
-    {
-        Page( Device& device, size_t sizeInBytes );
-        ~Page();
-
-        // Check to see if the page has room to satisfy the requested
-        // allocation.
-        bool HasSpace( size_t sizeInBytes, size_t alignment ) const;
-
-        // Allocate memory from the page.
-        // Throws std::bad_alloc if the the allocation size is larger
-        // that the page size or the size of the allocation exceeds the
-        // remaining space in the page.
-        Allocation Allocate( size_t sizeInBytes, size_t alignment );
-
-        // Reset the page for reuse.
-        void Reset();
-
-    private:
-        Device&                                m_Device;
-        Microsoft::WRL::ComPtr<ID3D12Resource> m_d3d12Resource;
-
-        // Base pointer.
-        void*                     m_CPUPtr;
-        D3D12_GPU_VIRTUAL_ADDRESS m_GPUPtr;
-
-        // Allocated page size.
-        size_t m_PageSize;
-        // Current allocation offset in bytes.
-        size_t m_Offset;
-    };
+    static const size_t InvalidBlock = static_cast<size_t>( -1 );
 
-    // A pool of memory pages.
-    using PagePool = std::deque<std::shared_ptr<Page>>;
+    // Align an offset in a block so that the GPU address is aligned.
+    static size_t AlignOffset( const UploadRingBuffer::Block& block, size_t offset, size_t alignment );
 
-    // The device that was used to create this upload buffer.
-    Device& m_Device;
+    // Returns the allocation and the offset of the end of the allocation in the block.
+    static std::pair<Allocation, size_t> AllocateFromBlock( const UploadRingBuffer::Block& block, size_t offset,
+                                                            size_t alignedSize, size_t alignment );
 
-    // Request a page from the pool of available pages
-    // or create a new page if there are no available pages.
-    std::shared_ptr<Page> RequestPage();
+    UploadRingBuffer& m_RingBuffer;
 
-    PagePool m_PagePool;
-    PagePool m_AvailablePages;
+    // Blocks that were reserved since the last time the blocks were retired.
+    std::vector<UploadRingBuffer::Block> m_Blocks;
 
-    std::shared_ptr<Page> m_CurrentPage;
+    // The index of the block that small allocations are packed into.
+    size_t m_CurrentBlock;
+    // Current allocation offset in the current block.
+    size_t m_Offset;
 
-    // The size of each page of memory.
-    size_t m_PageSize;
+    // The size of each block.
+    size_t m_BlockSize;
 };
-}  // namespace DX12_Library
\ No newline at end of file
+}  // namespace DX12_Library
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "UploadRingBuffer.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*
+ * The upload manager batches buffer and texture uploads on the copy queue. The source data is staged in
+ * the copy queue's UploadRingBuffer and the copies are recorded on a single copy command list that is
+ * submitted when the batch gets too large or when a command queue needs the result.
+ *
+ * Every upload returns a ticket. A command queue only waits (on the GPU) for the batch of the ticket
+ * instead of the copy queue as a whole.
+ *
+ * Uploads are only valid for resources that are in the COMMON state, for example newly created buffers
+ * and textures. The copy queue implicitly promotes them to the COPY_DEST state and they decay back to
+ * the COMMON state once the batch is finished.
+ */
+namespace DX12_Library
+{
+
+class CommandList;
+class CommandQueue;
+class Device;
+
+class UploadManager
+{
+public:
+    /**
+     * Identifies the batch that contains an upload.
+     */
+    struct Ticket
+    {
+        // A batch ID of 0 means there is nothing to wait for.
+        uint64_t BatchID = 0;
+    };
+
+    /**
+     * Upload buffer data to a buffer resource.
+     *
+     * @param destinationOffset The offset in bytes in the destination buffer.
+     */
+    Ticket UploadBuffer( Microsoft::WRL::ComPtr<ID3D12Resource> destinationResource, size_t bufferSize,
+                         const void* bufferData, size_t destinationOffset = 0 );
+
+    /**
+     * Upload subresource data to a texture resource.
+     */
+    Ticket UploadTexture( Microsoft::WRL::ComPtr<ID3D12Resource> destinationResource, uint32_t firstSubresource,
+                          uint32_t numSubresources, const D3D12_SUBRESOURCE_DATA* subresourceData );
+
+    /**
+     * Submit the pending batch to the copy queue.
+     *
+     * @returns The copy queue fence value of the batch or 0 if there was nothing to submit.
+     */
+    uint64_t Flush();
+
+    /**
+     * Get the copy queue fence value that signals that the upload is finished.
+     * The batch of the ticket is submitted if it is still pending.
+     *
+     * @returns The fence value to wait for or 0 if the upload is already finished.
+     */
+    uint64_t GetFenceValue( const Ticket& ticket );
+
+    /**
+     * Check if the upload is finished. The batch of the ticket is submitted if it is still pending.
+     */
+    bool IsComplete( const Ticket& ticket );
+
+    /**
+     * Make a command queue wait (on the GPU) until the upload is finished.
+     */
+    void Wait( CommandQueue& commandQueue, const Ticket& ticket );
+
+    /**
+     * Wait (on the CPU) until the upload is finished.
+     */
+    void WaitForCompletion( const Ticket& ticket );
+
+protected:
+    friend class std::default_delete<UploadManager>;
+
+    explicit UploadManager( Device& device );
+    virtual ~UploadManager();
+
+private:
+    // Get the command list of the pending batch and reserve staging memory for an upload.
+    // The lock of the mutex must be held by the caller (see SubmitBatch).
+    std::pair<CommandList*, UploadRingBuffer::Block> BeginUpload( std::unique_lock<std::mutex>& lock,
+                                                                  size_t                        sizeInBytes );
+
+    // Finish an upload and submit the batch if it is large enough.
+    // The lock of the mutex must be held by the caller (see SubmitBatch).
+    Ticket EndUpload( std::unique_lock<std::mutex>& lock );
+
+    // Execute the pending batch on the copy queue.
+    // The lock of the mutex must be held by the caller. It is released while the batch is executed,
+    // since executing a command list may wait for the mips of other command lists.
+    uint64_t SubmitBatch( std::unique_lock<std::mutex>& lock );
+
+    Device&           m_Device;
+    CommandQueue&     m_CopyQueue;
+    UploadRingBuffer& m_RingBuffer;
+
+    // The command list and staging memory of the pending batch.
+    std::shared_ptr<CommandList>         m_CommandList;
+    std::vector<UploadRingBuffer::Block> m_Blocks;
+    size_t                               m_BatchSize;
+    // The batch is submitted once it has staged this many bytes.
+    size_t m_MaxBatchSize;
+
+    // The ID of the pending batch.
+    uint64_t m_BatchID;
+    // The batch IDs and fence values of the submitted batches that may still be in flight.
+    std::deque<std::pair<uint64_t, uint64_t>> m_SubmittedBatches;
+
+    // The ID of the last batch that was executed. The batches are executed in order, so a batch
+    // waits until the batch before it was executed.
+    uint64_t                m_LastSubmittedBatchID;
+    std::condition_variable m_BatchSubmittedCV;
+
+    std::mutex m_Mutex;
+};
+}  // namespace DX12_Library
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "Defines.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/*
+ * The upload ring buffer is a single persistently mapped upload heap that is shared by all of the
+ * command lists of a command queue. Command lists reserve blocks from the head of the ring and the
+ * blocks are retired with the fence value of the ExecuteCommandLists call that submitted them.
+ * The tail of the ring advances as soon as the GPU reaches those fence values, so upload memory is reused
+ * without waiting for the command lists to be reset and the size of the upload heap stays the same
+ * no matter how many command lists are in flight.
+ *
+ * Allocations that are larger than a quarter of the ring buffer don't go through the ring. They get
+ * a dedicated upload buffer that is rounded up to a power of two size class so that it can be reused
+ * for allocations of a similar size. Idle dedicated buffers are released once their total size goes
+ * over the high watermark, until it drops below the low watermark.
+ */
+namespace DX12_Library
+{
+
+class CommandQueue;
+class Device;
+
+class UploadRingBuffer
+{
+public:
+    // All blocks are aligned to the constant buffer placement alignment.
+    static const size_t BlockAlignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+    // Dedicated buffers are never smaller than this.
+    static const size_t MinDedicatedBufferSize = _1MB;
+
+    // A contiguous region of the ring buffer or a dedicated buffer.
+    struct Block
+    {
+        void*                     CPU;
+        D3D12_GPU_VIRTUAL_ADDRESS GPU;
+        // The upload resource that contains the block and the offset of the block in the resource.
+        ID3D12Resource* Resource;
+        size_t          Offset;
+        // The size of the block in bytes.
+        size_t Size;
+        // Identifies the block when it is retired.
+        uint64_t ID;
+        // True if the block is a dedicated buffer instead of a region of the ring buffer.
+        bool IsDedicated;
+    };
+
+    /**
+     * Current and peak upload heap usage of the command queue.
+     */
+    struct Statistics
+    {
+        // The size of the ring buffer.
+        size_t RingBufferSize;
+        // Bytes of the ring buffer that are reserved or waiting for the GPU.
+        size_t UsedRingBufferSize;
+        size_t PeakUsedRingBufferSize;
+        // Bytes of dedicated buffers, including idle buffers.
+        size_t DedicatedBufferSize;
+        size_t PeakDedicatedBufferSize;
+        // Bytes of dedicated buffers that are waiting to be reused.
+        size_t IdleDedicatedBufferSize;
+        uint32_t NumDedicatedBuffers;
+        // Allocations that fit in the ring buffer but got a dedicated buffer because the rest of
+        // the ring buffer was reserved by command lists that have not been executed yet.
+        uint64_t NumOverflowAllocations;
+        // Total upload heap memory: the ring buffer plus all dedicated buffers.
+        size_t CurrentSize;
+        size_t PeakSize;
+    };
+
+    /**
+     * Reserve a block of memory from the ring buffer.
+     * If the ring buffer is full, this waits for the GPU to finish with the
+     * oldest retired blocks without holding the lock of the ring buffer. If the request can't be satisfied because the rest
+     * of the ring buffer is reserved by command lists that have not been executed
+     * yet, the block is allocated from a dedicated buffer instead.
+     *
+     * Allocations larger than GetMaxRingAllocationSize get a dedicated buffer.
+     */
+    Block Allocate( size_t sizeInBytes );
+
+    /**
+     * Retire a block. The memory is reused as soon as the command queue
+     * reaches the fence value. Use a fence value of 0 for blocks that were
+     * never used by the GPU.
+     */
+    void Retire( const Block& block, uint64_t fenceValue );
+
+    /**
+     * The total size of the ring buffer in bytes.
+     */
+    size_t GetSize() const
+    {
+        return m_Size;
+    }
+
+    /**
+     * The largest allocation that is served from the ring buffer.
+     */
+    size_t GetMaxRingAllocationSize() const
+    {
+        return m_Size / 4;
+    }
+
+    /**
+     * Set the idle dedicated buffer watermarks. When more than highWatermark bytes of
+     * dedicated buffers are idle, the least recently used ones are released until
+     * at most lowWatermark bytes are left.
+     */
+    void SetIdleWatermarks( size_t lowWatermark, size_t highWatermark );
+
+    /**
+     * Release all idle dedicated buffers.
+     */
+    void Trim();
+
+    Statistics GetStatistics() const;
+
+protected:
+    friend class std::default_delete<UploadRingBuffer>;
+
+    UploadRingBuffer( Device& device, CommandQueue& commandQueue, size_t sizeInBytes );
+    virtual ~UploadRingBuffer();
+
+private:
+    // A block that was handed out from the ring buffer.
+    // Regions are stored in the same order they were allocated in.
+    struct Region
+    {
+        // The size of the region, including the padding that was skipped
+        // at the end of the ring buffer when the allocation wrapped around.
+        size_t Size;
+        // The fence value to wait for before the region can be reused.
+        uint64_t FenceValue;
+        // True once the command list that reserved the region was executed (or discarded).
+        bool IsRetired;
+    };
+
+    // Try to reserve memory at the head of the ring buffer.
+    // The mutex must be held by the caller.
+    bool TryAllocate( size_t sizeInBytes, size_t& offset );
+
+    // Advance the tail of the ring buffer past the regions that the GPU is done with.
+    // The mutex must be held by the caller.
+    void ReleaseCompletedRegions();
+
+    // An upload buffer for a single large allocation.
+    struct DedicatedBuffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+
+        void*                     CPU;
+        D3D12_GPU_VIRTUAL_ADDRESS GPU;
+        size_t                    Size;
+        uint64_t                  FenceValue;
+        bool                      IsRetired;
+    };
+
+    // Get an idle dedicated buffer of the right size class or create a new one.
+    // The mutex must be held by the caller.
+    Block AllocateDedicated( size_t sizeInBytes );
+
+    // Move the retired dedicated buffers the GPU is done with to the idle list and
+    // apply the watermarks. The mutex must be held by the caller.
+    void ReleaseCompletedDedicatedBuffers();
+
+    // Release the least recently used idle buffers until at most maxIdleSize bytes are idle.
+    // The mutex must be held by the caller.
+    void TrimIdleDedicatedBuffers( size_t maxIdleSize );
+
+    void UpdatePeakSizes();
+
+    Device&       m_Device;
+    CommandQueue& m_CommandQueue;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_d3d12Resource;
+
+    // Base pointers.
+    uint8_t*                  m_CPUPtr;
+    D3D12_GPU_VIRTUAL_ADDRESS m_GPUPtr;
+
+    size_t m_Size;
+    // Offset of the next allocation.
+    size_t m_Head;
+    // Offset of the oldest region that is still in use.
+    size_t m_Tail;
+    size_t m_UsedSize;
+
+    std::deque<Region> m_Regions;
+    // The ID of the region at the front of the queue.
+    uint64_t m_FrontRegionID;
+
+    // Dedicated buffers that are allocated or waiting for the GPU.
+    std::unordered_map<uint64_t, DedicatedBuffer> m_DedicatedBuffers;
+    // Dedicated buffers that can be reused, the least recently used first.
+    std::deque<DedicatedBuffer> m_IdleDedicatedBuffers;
+    uint64_t                    m_NextDedicatedBufferID;
+    size_t                      m_DedicatedBufferSize;
+    size_t                      m_IdleDedicatedBufferSize;
+
+    size_t m_IdleLowWatermark;
+    size_t m_IdleHighWatermark;
+
+    size_t m_PeakUsedSize;
+    size_t m_PeakDedicatedBufferSize;
+
+    uint64_t m_NumOverflowAllocations;
+
+    mutable std::mutex m_Mutex;
+};
+}  // namespace DX12_Library
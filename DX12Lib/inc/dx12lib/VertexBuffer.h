@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Buffer.h"
+#include "StaticBufferAllocator.h"
 
 namespace DX12_Library
 {
@@ -26,10 +27,30 @@ public:
         return m_VertexStride;
     }
 
+    /**
+     * The offset of the vertex data in the D3D12 resource.
+     * This is only non-zero if the vertex buffer is sub-allocated from the static buffer allocator.
+     */
+    size_t GetOffset() const
+    {
+        return m_Offset;
+    }
+
+    /**
+     * True if the vertex data is sub-allocated from a block of the static buffer allocator.
+     * The blocks are never transitioned explicitly (see StaticBufferAllocator).
+     */
+    bool IsStatic() const
+    {
+        return m_StaticAllocationID != 0;
+    }
+
 protected:
     VertexBuffer( Device& device, size_t numVertices, size_t vertexStride );
     VertexBuffer( Device& device, Microsoft::WRL::ComPtr<ID3D12Resource> resource, size_t numVertices,
                   size_t vertexStride );
+    VertexBuffer( Device& device, const StaticBufferAllocator::Allocation& allocation, size_t numVertices,
+                  size_t vertexStride );
     virtual ~VertexBuffer();
 
     void CreateVertexBufferView();
@@ -37,6 +58,10 @@ protected:
 private:
     size_t                   m_NumVertices;
     size_t                   m_VertexStride;
+    size_t                   m_Offset;
     D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
+
+    // The static buffer allocation (or 0 if the vertex buffer has its own resource).
+    uint64_t m_StaticAllocationID;
 };
 }  // namespace DX12_Library
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/BindlessDescriptorHeap.h>
+
+#include <dx12lib/Device.h>
+
+using namespace DX12_Library;
+
+BindlessDescriptorHeap::BindlessDescriptorHeap( Device& device, uint32_t numDescriptors )
+: m_Device( device )
+, m_NumDescriptors( numDescriptors )
+, m_FreeList( numDescriptors )
+{
+    auto d3d12Device = m_Device.GetD3D12Device();
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Type                       = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heapDesc.NumDescriptors             = m_NumDescriptors;
+    heapDesc.Flags                      = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+    ThrowIfFailed( d3d12Device->CreateDescriptorHeap( &heapDesc, IID_PPV_ARGS( &m_d3d12DescriptorHeap ) ) );
+    m_d3d12DescriptorHeap->SetName( L"Bindless Descriptor Heap" );
+
+    m_BaseCPUDescriptor             = m_d3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    m_BaseGPUDescriptor             = m_d3d12DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    m_DescriptorHandleIncrementSize = d3d12Device->GetDescriptorHandleIncrementSize( heapDesc.Type );
+}
+
+uint32_t BindlessDescriptorHeap::Allocate( uint32_t numDescriptors )
+{
+    std::lock_guard<std::mutex> lock( m_AllocationMutex );
+
+    auto index = m_FreeList.Allocate( numDescriptors );
+    if ( index == DescriptorFreeList::InvalidOffset )
+    {
+        // Try again after reclaiming the descriptors the GPU is done with.
+        ReleaseCompletedDescriptors();
+        index = m_FreeList.Allocate( numDescriptors );
+    }
+
+    // The bindless descriptor heap can't grow since the shaders index it directly.
+    if ( index == DescriptorFreeList::InvalidOffset )
+    {
+        throw std::bad_alloc();
+    }
+
+    return index;
+}
+
+void BindlessDescriptorHeap::Free( uint32_t index, uint32_t numDescriptors )
+{
+    if ( index == InvalidIndex )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( m_AllocationMutex );
+
+    m_StaleDescriptors.emplace( index, numDescriptors,
+                                DescriptorAllocatorPage::GetSignaledFenceValues( m_Device ) );
+}
+
+void BindlessDescriptorHeap::ReleaseStaleDescriptors()
+{
+    std::lock_guard<std::mutex> lock( m_AllocationMutex );
+
+    ReleaseCompletedDescriptors();
+}
+
+void BindlessDescriptorHeap::ReleaseCompletedDescriptors()
+{
+    auto completedFenceValues = DescriptorAllocatorPage::GetCompletedFenceValues( m_Device );
+
+    while ( !m_StaleDescriptors.empty() )
+    {
+        auto& staleDescriptor = m_StaleDescriptors.front();
+
+        bool isComplete = true;
+        for ( size_t i = 0; i < completedFenceValues.size(); ++i )
+        {
+            isComplete = isComplete && staleDescriptor.FenceValues[i] <= completedFenceValues[i];
+        }
+
+        if ( !isComplete )
+        {
+            break;
+        }
+
+        m_FreeList.Free( staleDescriptor.Index, staleDescriptor.Size );
+        m_StaleDescriptors.pop();
+    }
+}
+
+void BindlessDescriptorHeap::CopyDescriptor( uint32_t index, D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor )
+{
+    assert( index < m_NumDescriptors );
+
+    auto d3d12Device = m_Device.GetD3D12Device();
+    d3d12Device->CopyDescriptorsSimple( 1, GetCPUDescriptorHandle( index ), srcDescriptor,
+                                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE BindlessDescriptorHeap::GetCPUDescriptorHandle( uint32_t index ) const
+{
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE( m_BaseCPUDescriptor, index, m_DescriptorHandleIncrementSize );
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE BindlessDescriptorHeap::GetGPUDescriptorHandle( uint32_t index ) const
+{
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE( m_BaseGPUDescriptor, index, m_DescriptorHandleIncrementSize );
+}
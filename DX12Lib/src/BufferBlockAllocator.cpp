@@ -0,0 +1,267 @@
+#include <dx12lib/BufferBlockAllocator.h>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace DX12_Library;
+
+namespace
+{
+// alignment must be a power of two.
+inline size_t AlignUp( size_t value, size_t alignment )
+{
+    return ( value + alignment - 1 ) & ~( alignment - 1 );
+}
+}  // namespace
+
+BufferBlockAllocator::BufferBlockAllocator( size_t blockSize )
+: m_BlockSize( blockSize )
+{}
+
+BufferBlockAllocator::Allocation BufferBlockAllocator::Allocate( size_t size, size_t alignment )
+{
+    assert( size > 0 );
+
+    Allocation allocation;
+
+    for ( uint32_t i = 0; i < GetNumBlocks(); ++i )
+    {
+        if ( AllocateFromBlock( i, size, alignment, allocation ) )
+        {
+            return allocation;
+        }
+    }
+
+    // Add a new block. The offset of a new block is always aligned.
+    Block block;
+    block.Size     = std::max( m_BlockSize, size );
+    block.UsedSize = 0;
+    AddFreeRange( block, 0, block.Size );
+
+    m_Blocks.push_back( std::move( block ) );
+
+    AllocateFromBlock( GetNumBlocks() - 1, size, alignment, allocation );
+    assert( allocation.IsValid() );
+
+    return allocation;
+}
+
+bool BufferBlockAllocator::AllocateFromBlock( uint32_t blockIndex, size_t size, size_t alignment,
+                                              Allocation& allocation )
+{
+    auto& block = m_Blocks[blockIndex];
+
+    if ( block.Size - block.UsedSize < size )
+    {
+        return false;
+    }
+
+    // Best fit: start with the smallest free range that is large enough and
+    // skip the ranges that are too small once the offset is aligned.
+    for ( auto iter = block.FreeRangesBySize.lower_bound( size ); iter != block.FreeRangesBySize.end(); ++iter )
+    {
+        size_t rangeOffset   = iter->second;
+        size_t rangeSize     = iter->first;
+        size_t alignedOffset = AlignUp( rangeOffset, alignment );
+        size_t padding       = alignedOffset - rangeOffset;
+
+        if ( padding + size > rangeSize )
+        {
+            continue;
+        }
+
+        RemoveFreeRange( block, block.FreeRanges.find( rangeOffset ) );
+
+        // Return the padding and the rest of the range to the free list.
+        if ( padding > 0 )
+        {
+            AddFreeRange( block, rangeOffset, padding );
+        }
+        if ( padding + size < rangeSize )
+        {
+            AddFreeRange( block, alignedOffset + size, rangeSize - padding - size );
+        }
+
+        block.Allocations.emplace( alignedOffset, size );
+        block.UsedSize += size;
+
+        allocation.BlockIndex = blockIndex;
+        allocation.Offset     = alignedOffset;
+        allocation.Size       = size;
+
+        return true;
+    }
+
+    return false;
+}
+
+void BufferBlockAllocator::Free( const Allocation& allocation )
+{
+    if ( !allocation.IsValid() )
+    {
+        return;
+    }
+
+    assert( allocation.BlockIndex < GetNumBlocks() );
+
+    auto& block = m_Blocks[allocation.BlockIndex];
+
+    auto allocationIter = block.Allocations.find( allocation.Offset );
+    assert( allocationIter != block.Allocations.end() && allocationIter->second == allocation.Size );
+    block.Allocations.erase( allocationIter );
+    block.UsedSize -= allocation.Size;
+
+    size_t offset = allocation.Offset;
+    size_t size   = allocation.Size;
+
+    // Merge with the next free range.
+    auto nextIter = block.FreeRanges.lower_bound( offset );
+    if ( nextIter != block.FreeRanges.end() && nextIter->first == offset + size )
+    {
+        size += nextIter->second;
+        RemoveFreeRange( block, nextIter );
+    }
+
+    // Merge with the previous free range.
+    auto prevIter = block.FreeRanges.lower_bound( offset );
+    if ( prevIter != block.FreeRanges.begin() )
+    {
+        --prevIter;
+        if ( prevIter->first + prevIter->second == offset )
+        {
+            offset = prevIter->first;
+            size += prevIter->second;
+            RemoveFreeRange( block, prevIter );
+        }
+    }
+
+    AddFreeRange( block, offset, size );
+}
+
+void BufferBlockAllocator::AddFreeRange( Block& block, size_t offset, size_t size )
+{
+    block.FreeRanges.emplace( offset, size );
+    block.FreeRangesBySize.emplace( size, offset );
+}
+
+void BufferBlockAllocator::RemoveFreeRange( Block& block, std::map<size_t, size_t>::iterator iter )
+{
+    auto range = block.FreeRangesBySize.equal_range( iter->second );
+    for ( auto sizeIter = range.first; sizeIter != range.second; ++sizeIter )
+    {
+        if ( sizeIter->second == iter->first )
+        {
+            block.FreeRangesBySize.erase( sizeIter );
+            break;
+        }
+    }
+
+    block.FreeRanges.erase( iter );
+}
+
+BufferBlockAllocator::BlockOccupancy BufferBlockAllocator::GetBlockOccupancy( uint32_t blockIndex ) const
+{
+    auto& block = m_Blocks[blockIndex];
+
+    BlockOccupancy occupancy;
+    occupancy.Size             = block.Size;
+    occupancy.UsedSize         = block.UsedSize;
+    occupancy.LargestFreeRange = block.FreeRangesBySize.empty() ? 0 : block.FreeRangesBySize.rbegin()->first;
+    occupancy.NumAllocations   = static_cast<uint32_t>( block.Allocations.size() );
+
+    return occupancy;
+}
+
+BufferBlockAllocator::Statistics BufferBlockAllocator::GetStatistics() const
+{
+    Statistics statistics = {};
+    statistics.NumBlocks  = GetNumBlocks();
+
+    for ( uint32_t i = 0; i < GetNumBlocks(); ++i )
+    {
+        auto occupancy = GetBlockOccupancy( i );
+
+        statistics.NumAllocations += occupancy.NumAllocations;
+        statistics.TotalSize += occupancy.Size;
+        statistics.UsedSize += occupancy.UsedSize;
+        statistics.LargestFreeRange = std::max( statistics.LargestFreeRange, occupancy.LargestFreeRange );
+    }
+
+    return statistics;
+}
+
+uint32_t BufferBlockAllocator::FindDefragmentationCandidate() const
+{
+    uint32_t candidate     = InvalidBlock;
+    size_t   candidateUsed = 0;
+    size_t   totalFree     = 0;
+
+    for ( uint32_t i = 0; i < GetNumBlocks(); ++i )
+    {
+        auto& block = m_Blocks[i];
+        totalFree += block.Size - block.UsedSize;
+
+        if ( block.UsedSize > 0 && ( candidate == InvalidBlock || block.UsedSize < candidateUsed ) )
+        {
+            candidate     = i;
+            candidateUsed = block.UsedSize;
+        }
+    }
+
+    if ( candidate == InvalidBlock )
+    {
+        return InvalidBlock;
+    }
+
+    // The allocations of the candidate must fit in the free space of the other blocks.
+    auto& block = m_Blocks[candidate];
+    if ( candidateUsed > totalFree - ( block.Size - block.UsedSize ) )
+    {
+        return InvalidBlock;
+    }
+
+    return candidate;
+}
+
+std::vector<BufferBlockAllocator::Allocation> BufferBlockAllocator::GetAllocations( uint32_t blockIndex ) const
+{
+    std::vector<Allocation> allocations;
+
+    auto& block = m_Blocks[blockIndex];
+    allocations.reserve( block.Allocations.size() );
+
+    for ( auto& range: block.Allocations )
+    {
+        Allocation allocation;
+        allocation.BlockIndex = blockIndex;
+        allocation.Offset     = range.first;
+        allocation.Size       = range.second;
+
+        allocations.push_back( allocation );
+    }
+
+    return allocations;
+}
+
+BufferBlockAllocator::Allocation BufferBlockAllocator::Relocate( const Allocation& allocation, size_t alignment )
+{
+    Allocation newAllocation;
+
+    size_t usedSize = m_Blocks[allocation.BlockIndex].UsedSize;
+
+    for ( uint32_t i = 0; i < GetNumBlocks(); ++i )
+    {
+        // Only move allocations towards fuller blocks, otherwise blocks would trade allocations back and forth.
+        if ( i == allocation.BlockIndex || m_Blocks[i].UsedSize < usedSize )
+        {
+            continue;
+        }
+
+        if ( AllocateFromBlock( i, allocation.Size, alignment, newAllocation ) )
+        {
+            break;
+        }
+    }
+
+    return newAllocation;
+}
@@ -0,0 +1,107 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/CommandAllocatorPool.h>
+
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+
+using namespace DX12_Library;
+
+CommandAllocatorPool::CommandAllocatorPool( Device& device, CommandQueue& commandQueue, D3D12_COMMAND_LIST_TYPE type )
+: m_Device( device )
+, m_CommandQueue( commandQueue )
+, m_CommandListType( type )
+, m_NumAllocators( 0 )
+, m_PeakNumAllocators( 0 )
+, m_NumAcquires( 0 )
+, m_NumCreatedAllocators( 0 )
+, m_NumReleasedAllocators( 0 )
+{}
+
+Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocatorPool::Acquire()
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    ReleaseCompletedAllocators();
+
+    ++m_NumAcquires;
+
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+    if ( !m_AvailableAllocators.empty() )
+    {
+        commandAllocator = m_AvailableAllocators.back().CommandAllocator;
+        m_AvailableAllocators.pop_back();
+    }
+    else
+    {
+        ThrowIfFailed( m_Device.GetD3D12Device()->CreateCommandAllocator( m_CommandListType,
+                                                                          IID_PPV_ARGS( &commandAllocator ) ) );
+
+        ++m_NumAllocators;
+        ++m_NumCreatedAllocators;
+        m_PeakNumAllocators = std::max( m_PeakNumAllocators, m_NumAllocators );
+    }
+
+    return commandAllocator;
+}
+
+void CommandAllocatorPool::Release( Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator,
+                                    uint64_t                                       fenceValue )
+{
+    assert( commandAllocator );
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    // Command lists from different threads may be released out of order.
+    auto iter = m_InFlightAllocators.end();
+    while ( iter != m_InFlightAllocators.begin() && ( iter - 1 )->FenceValue > fenceValue )
+    {
+        --iter;
+    }
+    m_InFlightAllocators.insert( iter, { commandAllocator, fenceValue } );
+}
+
+void CommandAllocatorPool::ReleaseCompletedAllocators()
+{
+    if ( !m_InFlightAllocators.empty() )
+    {
+        auto completedFenceValue = m_CommandQueue.GetCompletedFenceValue();
+        while ( !m_InFlightAllocators.empty() && m_InFlightAllocators.front().FenceValue <= completedFenceValue )
+        {
+            auto& commandAllocator = m_InFlightAllocators.front().CommandAllocator;
+
+            // The allocator is reset once here, instead of every time a command list is reset.
+            ThrowIfFailed( commandAllocator->Reset() );
+            m_AvailableAllocators.push_back( { commandAllocator, m_NumAcquires } );
+
+            m_InFlightAllocators.pop_front();
+        }
+    }
+
+    // The least recently used allocators are at the front.
+    while ( !m_AvailableAllocators.empty() &&
+            m_AvailableAllocators.front().LastAcquire + MaxUnusedAcquires < m_NumAcquires )
+    {
+        m_AvailableAllocators.pop_front();
+
+        --m_NumAllocators;
+        ++m_NumReleasedAllocators;
+    }
+}
+
+CommandAllocatorPool::Statistics CommandAllocatorPool::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    Statistics statistics;
+    statistics.NumAllocators          = m_NumAllocators;
+    statistics.PeakNumAllocators      = m_PeakNumAllocators;
+    statistics.NumInFlightAllocators  = static_cast<uint32_t>( m_InFlightAllocators.size() );
+    statistics.NumAvailableAllocators = static_cast<uint32_t>( m_AvailableAllocators.size() );
+    statistics.NumActiveAllocators    = m_NumAllocators - statistics.NumAvailableAllocators;
+    statistics.NumCreatedAllocators   = m_NumCreatedAllocators;
+    statistics.NumReusedAllocators    = m_NumAcquires - m_NumCreatedAllocators;
+    statistics.NumReleasedAllocators  = m_NumReleasedAllocators;
+
+    return statistics;
+}
@@ -2,13 +2,18 @@
 
 #include <dx12lib/CommandList.h>
 
+#include <dx12lib/BindlessDescriptorHeap.h>
 #include <dx12lib/ByteAddressBuffer.h>
+#include <dx12lib/CommandAllocatorPool.h>
 #include <dx12lib/CommandQueue.h>
+#include <dx12lib/CommandStream.h>
+#include <dx12lib/CommandStreamObjects.h>
 #include <dx12lib/ConstantBuffer.h>
 #include <dx12lib/ConstantBufferView.h>
 #include <dx12lib/Device.h>
 #include <dx12lib/DynamicDescriptorHeap.h>
 #include <dx12lib/GenerateMipsPSO.h>
+#include <dx12lib/GpuProfiler.h>
 #include <dx12lib/IndexBuffer.h>
 #include <dx12lib/Material.h>
 #include <dx12lib/Mesh.h>
@@ -33,31 +38,35 @@ using namespace DX12_Library;
 class MakeUploadBuffer : public UploadBuffer
 {
 public:
-    MakeUploadBuffer( Device& device, size_t pageSize = _2MB )
-    : UploadBuffer( device, pageSize )
+    MakeUploadBuffer( UploadRingBuffer& ringBuffer )
+    : UploadBuffer( ringBuffer )
     {}
 
     virtual ~MakeUploadBuffer() {}
 };
 
-std::map<std::wstring, ID3D12Resource*> CommandList::ms_TextureCache;
-std::mutex                              CommandList::ms_TextureCacheMutex;
+std::map<std::wstring, CommandList::CachedTexture> CommandList::ms_TextureCache;
+std::mutex                                         CommandList::ms_TextureCacheMutex;
 
 CommandList::CommandList( Device& device, D3D12_COMMAND_LIST_TYPE type )
 : m_Device( device )
 , m_d3d12CommandListType( type )
 , m_RootSignature( nullptr )
 , m_PipelineState( nullptr )
+, m_PrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_UNDEFINED )
+, m_NumInheritedProfileScopes( 0 )
+, m_CommandStream( nullptr )
+, m_CommandStreamObjects( nullptr )
+, m_CaptureDepth( 0 )
 {
     auto d3d12Device = m_Device.GetD3D12Device();
 
-    ThrowIfFailed(
-        d3d12Device->CreateCommandAllocator( m_d3d12CommandListType, IID_PPV_ARGS( &m_d3d12CommandAllocator ) ) );
+    m_d3d12CommandAllocator = device.GetCommandQueue( type ).GetCommandAllocatorPool().Acquire();
 
     ThrowIfFailed( d3d12Device->CreateCommandList( 0, m_d3d12CommandListType, m_d3d12CommandAllocator.Get(), nullptr,
                                                    IID_PPV_ARGS( &m_d3d12CommandList ) ) );
 
-    m_UploadBuffer = std::make_unique<MakeUploadBuffer>( device );
+    m_UploadBuffer = std::make_unique<MakeUploadBuffer>( device.GetCommandQueue( type ).GetUploadRingBuffer() );
 
     m_ResourceStateTracker = std::make_unique<ResourceStateTracker>();
 
@@ -94,9 +103,30 @@ void CommandList::TransitionBarrier( Microsoft::WRL::ComPtr<ID3D12Resource> reso
 void CommandList::TransitionBarrier( const std::shared_ptr<Resource>& resource, D3D12_RESOURCE_STATES stateAfter,
                                      UINT subresource, bool flushBarriers )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->TransitionBarrier( capture.Objects().AddResource( resource ), stateAfter, subresource );
+    }
+
     if ( resource )
     {
-        TransitionBarrier( resource->GetD3D12Resource(), stateAfter, subresource, flushBarriers );
+        // The resource keeps a pointer to its tracked state, so the state doesn't have to be looked up.
+        m_ResourceStateTracker->TransitionResource( *resource, stateAfter, subresource );
+
+        if ( flushBarriers )
+        {
+            FlushResourceBarriers();
+        }
+    }
+}
+
+void CommandList::BeginTransitionBarrier( const std::shared_ptr<Resource>& resource, D3D12_RESOURCE_STATES stateAfter,
+                                          UINT subresource )
+{
+    if ( resource )
+    {
+        m_ResourceStateTracker->BeginTransitionResource( *resource, stateAfter, subresource );
     }
 }
 
@@ -115,6 +145,12 @@ void CommandList::UAVBarrier( Microsoft::WRL::ComPtr<ID3D12Resource> resource, b
 
 void CommandList::UAVBarrier( const std::shared_ptr<Resource>& resource, bool flushBarriers )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->UAVBarrier( capture.Objects().AddResource( resource ) );
+    }
+
     auto d3d12Resource = resource ? resource->GetD3D12Resource() : nullptr;
     UAVBarrier( d3d12Resource, flushBarriers );
 }
@@ -136,10 +172,19 @@ void CommandList::AliasingBarrier( Microsoft::WRL::ComPtr<ID3D12Resource> before
 void CommandList::AliasingBarrier( const std::shared_ptr<Resource>& beforeResource,
                                    const std::shared_ptr<Resource>& afterResource, bool flushBarriers )
 {
-    auto d3d12BeforeResource = beforeResource ? beforeResource->GetD3D12Resource() : nullptr;
-    auto d3d12AfterResource  = afterResource ? afterResource->GetD3D12Resource() : nullptr;
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->AliasingBarrier( capture.Objects().AddResource( beforeResource ),
+                                  capture.Objects().AddResource( afterResource ) );
+    }
+
+    m_ResourceStateTracker->AliasBarrier( beforeResource.get(), afterResource.get() );
 
-    AliasingBarrier( d3d12BeforeResource, d3d12AfterResource, flushBarriers );
+    if ( flushBarriers )
+    {
+        FlushResourceBarriers();
+    }
 }
 
 // Flush non-pending resource barriers to the command list
@@ -173,15 +218,37 @@ void CommandList::CopyResource( Microsoft::WRL::ComPtr<ID3D12Resource> dstRes,
 // The CopyResource method is used to copy one GPU resource to another
 void CommandList::CopyResource( const std::shared_ptr<Resource>& dstRes, const std::shared_ptr<Resource>& srcRes )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->CopyResource( capture.Objects().AddResource( dstRes ), capture.Objects().AddResource( srcRes ) );
+    }
+
     assert( dstRes && srcRes );
 
-    CopyResource( dstRes->GetD3D12Resource(), srcRes->GetD3D12Resource() );
+    // The resources keep pointers to their tracked states, so the states don't have to be looked up.
+    m_ResourceStateTracker->TransitionResource( *dstRes, D3D12_RESOURCE_STATE_COPY_DEST );
+    m_ResourceStateTracker->TransitionResource( *srcRes, D3D12_RESOURCE_STATE_COPY_SOURCE );
+
+    FlushResourceBarriers();
+
+    m_d3d12CommandList->CopyResource( dstRes->GetD3D12Resource().Get(), srcRes->GetD3D12Resource().Get() );
+
+    TrackResource( dstRes );
+    TrackResource( srcRes );
 }
 
 // Ensure all the subresource are in the correct state before letting them be used by the command list.
 void CommandList::ResolveSubresource( const std::shared_ptr<Resource>& dstRes, const std::shared_ptr<Resource>& srcRes,
                                       uint32_t dstSubresource, uint32_t srcSubresource )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->ResolveSubresource( capture.Objects().AddResource( dstRes ), capture.Objects().AddResource( srcRes ),
+                                     dstSubresource, srcSubresource );
+    }
+
     assert( dstRes && srcRes );
 
     // Transition all subresources to the same state
@@ -220,26 +287,9 @@ ComPtr<ID3D12Resource> CommandList::CopyBuffer( size_t bufferSize, const void* b
 
         if ( bufferData != nullptr )
         {
-            // Create an upload resource to use as an intermediate buffer to copy the buffer resource
-            ComPtr<ID3D12Resource> uploadResource;
-            ThrowIfFailed( d3d12Device->CreateCommittedResource(
-                &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), D3D12_HEAP_FLAG_NONE,
-                &CD3DX12_RESOURCE_DESC::Buffer( bufferSize ), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                IID_PPV_ARGS( &uploadResource ) ) );
-
-            D3D12_SUBRESOURCE_DATA subresourceData = {};
-            subresourceData.pData                  = bufferData;
-            subresourceData.RowPitch               = bufferSize;
-            subresourceData.SlicePitch             = subresourceData.RowPitch;
-
-            m_ResourceStateTracker->TransitionResource( d3d12Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST );
-            FlushResourceBarriers();
-
-            UpdateSubresources( m_d3d12CommandList.Get(), d3d12Resource.Get(), uploadResource.Get(), 0, 0, 1,
-                                &subresourceData );
-
-            // Add references to resources so they stay in scope until the command list is reset.
-            TrackResource( uploadResource );
+            // The buffer data is staged and copied by the upload manager on the copy queue.
+            // The new buffer is still in the COMMON state so it doesn't need a transition.
+            AddUploadDependency( m_Device.GetUploadManager().UploadBuffer( d3d12Resource, bufferSize, bufferData ) );
         }
         TrackResource( d3d12Resource );
     }
@@ -247,10 +297,33 @@ ComPtr<ID3D12Resource> CommandList::CopyBuffer( size_t bufferSize, const void* b
     return d3d12Resource;
 }
 
+StaticBufferAllocator::Allocation CommandList::CopyStaticBuffer( StaticBufferAllocator::BufferType type,
+                                                                size_t bufferSize, const void* bufferData )
+{
+    auto allocation = m_Device.GetStaticBufferAllocator().Allocate( type, bufferSize );
+
+    // The blocks are never transitioned explicitly, so they are in the COMMON state that uploads require.
+    AddUploadDependency( m_Device.GetUploadManager().UploadBuffer( allocation.Resource, bufferSize, bufferData,
+                                                                   allocation.Offset ) );
+    TrackResource( allocation.Resource );
+
+    return allocation;
+}
+
 std::shared_ptr<VertexBuffer> CommandList::CopyVertexBuffer( size_t numVertices, size_t vertexStride,
                                                              const void* vertexBufferData )
 {
-    auto                          d3d12Resource = CopyBuffer( numVertices * vertexStride, vertexBufferData );
+    size_t bufferSize = numVertices * vertexStride;
+
+    // Static vertex data is placed in a shared block buffer.
+    if ( bufferSize > 0 && vertexBufferData != nullptr )
+    {
+        auto allocation = CopyStaticBuffer( StaticBufferAllocator::VertexData, bufferSize, vertexBufferData );
+
+        return m_Device.CreateVertexBuffer( allocation, numVertices, vertexStride );
+    }
+
+    auto                          d3d12Resource = CopyBuffer( bufferSize, vertexBufferData );
     std::shared_ptr<VertexBuffer> vertexBuffer =
         m_Device.CreateVertexBuffer( d3d12Resource, numVertices, vertexStride );
 
@@ -261,8 +334,17 @@ std::shared_ptr<IndexBuffer> CommandList::CopyIndexBuffer( size_t numIndicies, D
                                                            const void* indexBufferData )
 {
     size_t elementSize = indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4;
+    size_t bufferSize  = numIndicies * elementSize;
+
+    // Static index data is placed in a shared block buffer.
+    if ( bufferSize > 0 && indexBufferData != nullptr )
+    {
+        auto allocation = CopyStaticBuffer( StaticBufferAllocator::IndexData, bufferSize, indexBufferData );
+
+        return m_Device.CreateIndexBuffer( allocation, numIndicies, indexFormat );
+    }
 
-    auto d3d12Resource = CopyBuffer( numIndicies * elementSize, indexBufferData );
+    auto d3d12Resource = CopyBuffer( bufferSize, indexBufferData );
 
     std::shared_ptr<IndexBuffer> indexBuffer = m_Device.CreateIndexBuffer( d3d12Resource, numIndicies, indexFormat );
 
@@ -301,6 +383,13 @@ std::shared_ptr<StructuredBuffer> CommandList::CopyStructuredBuffer( size_t numE
 
 void CommandList::SetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY primitiveTopology )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetPrimitiveTopology( primitiveTopology );
+    }
+
+    m_PrimitiveTopology = primitiveTopology;
     m_d3d12CommandList->IASetPrimitiveTopology( primitiveTopology );
 }
 
@@ -317,7 +406,16 @@ std::shared_ptr<Texture> CommandList::LoadTextureFromFile( const std::wstring& f
     auto                        iter = ms_TextureCache.find( fileName );
     if ( iter != ms_TextureCache.end() )
     {
-        texture = m_Device.CreateTexture( iter->second );
+        const CachedTexture& cachedTexture = iter->second;
+
+        texture = m_Device.CreateTexture( cachedTexture.Resource );
+
+        // The texture data may still be uploaded and the mips may still be generated.
+        AddUploadDependency( cachedTexture.UploadTicket );
+        if ( m_d3d12CommandListType != D3D12_COMMAND_LIST_TYPE_COPY )
+        {
+            AddMipDependency( m_Device.GetMipGenerator().GetTicket( cachedTexture.Resource ) );
+        }
     }
     else
     {
@@ -392,15 +490,25 @@ std::shared_ptr<Texture> CommandList::LoadTextureFromFile( const std::wstring& f
             subresource.pData      = pImages[i].pixels;
         }
 
-        CopyTextureSubresource( texture, 0, static_cast<uint32_t>( subresources.size() ), subresources.data() );
+        // The texture was just created so it can be uploaded on the copy queue.
+        auto uploadTicket = m_Device.GetUploadManager().UploadTexture(
+            textureResource, 0, static_cast<uint32_t>( subresources.size() ), subresources.data() );
+        AddUploadDependency( uploadTicket );
+        TrackResource( textureResource );
 
+        // The mips are generated in a batch with the mips of other loaded textures on the compute queue.
+        // Copy command lists don't use the texture, so only other command lists wait for the mips.
         if ( subresources.size() < textureResource->GetDesc().MipLevels )
         {
-            GenerateMips( texture );
+            auto mipTicket = m_Device.GetMipGenerator().GenerateMips( texture, uploadTicket );
+            if ( m_d3d12CommandListType != D3D12_COMMAND_LIST_TYPE_COPY )
+            {
+                AddMipDependency( mipTicket );
+            }
         }
 
         // Add the texture resource to the texture cache.
-        ms_TextureCache[fileName] = textureResource.Get();
+        ms_TextureCache[fileName] = { textureResource.Get(), uploadTicket };
     }
 
     return texture;
@@ -413,13 +521,11 @@ void CommandList::GenerateMips( const std::shared_ptr<Texture>& texture )
 
     auto d3d12Device = m_Device.GetD3D12Device();
 
+    // Mips can't be generated on copy queues, so they are generated by the mip generator after the
+    // uploads of this command list are finished.
     if ( m_d3d12CommandListType == D3D12_COMMAND_LIST_TYPE_COPY )
     {
-        if ( !m_ComputeCommandList )
-        {
-            m_ComputeCommandList = m_Device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE ).GetCommandList();
-        }
-        m_ComputeCommandList->GenerateMips( texture );
+        m_Device.GetMipGenerator().GenerateMips( texture, m_UploadTicket );
         return;
     }
 
@@ -1192,6 +1298,12 @@ void CommandList::CopyTextureSubresource( const std::shared_ptr<Texture>& textur
 void CommandList::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes,
                                                     const void* bufferData )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetGraphicsDynamicConstantBuffer( rootParameterIndex, sizeInBytes, bufferData );
+    }
+
     // Constant buffers must be 256-byte aligned.
     auto heapAllococation = m_UploadBuffer->Allocate( sizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT );
     memcpy( heapAllococation.CPU, bufferData, sizeInBytes );
@@ -1201,17 +1313,39 @@ void CommandList::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex,
 
 void CommandList::SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetGraphics32BitConstants( rootParameterIndex, numConstants, constants );
+    }
+
     m_d3d12CommandList->SetGraphicsRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
 }
 
 void CommandList::SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetCompute32BitConstants( rootParameterIndex, numConstants, constants );
+    }
+
     m_d3d12CommandList->SetComputeRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
 }
 
 void CommandList::SetVertexBuffers( uint32_t                                          startSlot,
                                     const std::vector<std::shared_ptr<VertexBuffer>>& vertexBuffers )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        for ( size_t i = 0; i < vertexBuffers.size(); ++i )
+        {
+            capture->SetVertexBuffer( startSlot + static_cast<uint32_t>( i ),
+                                      capture.Objects().AddVertexBuffer( vertexBuffers[i] ) );
+        }
+    }
+
     std::vector<D3D12_VERTEX_BUFFER_VIEW> views;
     views.reserve( vertexBuffers.size() );
 
@@ -1219,7 +1353,11 @@ void CommandList::SetVertexBuffers( uint32_t
     {
         if ( vertexBuffer )
         {
-            TransitionBarrier( vertexBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER );
+            // Static vertex buffers are implicitly promoted to the vertex buffer state.
+            if ( !vertexBuffer->IsStatic() )
+            {
+                TransitionBarrier( vertexBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER );
+            }
             TrackResource( vertexBuffer );
 
             views.push_back( vertexBuffer->GetVertexBufferView() );
@@ -1252,9 +1390,19 @@ void CommandList::SetDynamicVertexBuffer( uint32_t slot, size_t numVertices, siz
 
 void CommandList::SetIndexBuffer( const std::shared_ptr<IndexBuffer>& indexBuffer )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetIndexBuffer( capture.Objects().AddIndexBuffer( indexBuffer ) );
+    }
+
     if ( indexBuffer )
     {
-        TransitionBarrier( indexBuffer, D3D12_RESOURCE_STATE_INDEX_BUFFER );
+        // Static index buffers are implicitly promoted to the index buffer state.
+        if ( !indexBuffer->IsStatic() )
+        {
+            TransitionBarrier( indexBuffer, D3D12_RESOURCE_STATE_INDEX_BUFFER );
+        }
         TrackResource( indexBuffer );
         m_d3d12CommandList->IASetIndexBuffer( &( indexBuffer->GetIndexBufferView() ) );
     }
@@ -1279,6 +1427,12 @@ void CommandList::SetDynamicIndexBuffer( size_t numIndicies, DXGI_FORMAT indexFo
 void CommandList::SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
                                                       const void* bufferData )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetGraphicsDynamicStructuredBuffer( slot, numElements, elementSize, bufferData );
+    }
+
     size_t bufferSize = numElements * elementSize;
 
     auto heapAllocation = m_UploadBuffer->Allocate( bufferSize, elementSize );
@@ -1294,7 +1448,15 @@ void CommandList::SetViewport( const D3D12_VIEWPORT& viewport )
 
 void CommandList::SetViewports( const std::vector<D3D12_VIEWPORT>& viewports )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetViewports( reinterpret_cast<const CommandViewport*>( viewports.data() ),
+                               static_cast<uint32_t>( viewports.size() ) );
+    }
+
     assert( viewports.size() < D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE );
+    m_Viewports = viewports;
     m_d3d12CommandList->RSSetViewports( static_cast<UINT>( viewports.size() ), viewports.data() );
 }
 
@@ -1305,7 +1467,15 @@ void CommandList::SetScissorRect( const D3D12_RECT& scissorRect )
 
 void CommandList::SetScissorRects( const std::vector<D3D12_RECT>& scissorRects )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetScissorRects( reinterpret_cast<const CommandRect*>( scissorRects.data() ),
+                                  static_cast<uint32_t>( scissorRects.size() ) );
+    }
+
     assert( scissorRects.size() < D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE );
+    m_ScissorRects = scissorRects;
     m_d3d12CommandList->RSSetScissorRects( static_cast<UINT>( scissorRects.size() ), scissorRects.data() );
 }
 
@@ -1318,7 +1488,7 @@ void CommandList::SetShaderResourceView( uint32_t rootParameterIndex, const std:
     if ( buffer )
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
-        TransitionBarrier( d3d12Resource, stateAfter );
+        m_ResourceStateTracker->TransitionResource( *buffer, stateAfter );
 
         // The SRV matching the SRV description is retrieved from the resource and stage to the DynamicDescriptorHeap
         // using StageDescriptors.
@@ -1336,12 +1506,19 @@ void CommandList::SetShaderResourceView( uint32_t rootParameterIndex, const std:
  */
 void CommandList::SetPipelineState( const std::shared_ptr<PipelineStateObject>& pipelineState )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetPipelineState( capture.Objects().AddPipelineState( pipelineState ) );
+    }
+
     assert( pipelineState );
 
     auto d3d12PipelineStateObject = pipelineState->GetD3D12PipelineState().Get();
     if ( m_PipelineState != d3d12PipelineStateObject )
     {
-        m_PipelineState = d3d12PipelineStateObject;
+        m_PipelineState       = d3d12PipelineStateObject;
+        m_PipelineStateObject = pipelineState;
 
         m_d3d12CommandList->SetPipelineState( d3d12PipelineStateObject );
 
@@ -1351,12 +1528,19 @@ void CommandList::SetPipelineState( const std::shared_ptr<PipelineStateObject>&
 
 void CommandList::SetGraphicsRootSignature( const std::shared_ptr<RootSignature>& rootSignature )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetGraphicsRootSignature( capture.Objects().AddRootSignature( rootSignature ) );
+    }
+
     assert( rootSignature );
 
     auto d3d12RootSignature = rootSignature->GetD3D12RootSignature().Get();
     if ( m_RootSignature != d3d12RootSignature )
     {
-        m_RootSignature = d3d12RootSignature;
+        m_RootSignature         = d3d12RootSignature;
+        m_GraphicsRootSignature = rootSignature;
 
         for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
         {
@@ -1365,18 +1549,27 @@ void CommandList::SetGraphicsRootSignature( const std::shared_ptr<RootSignature>
 
         m_d3d12CommandList->SetGraphicsRootSignature( m_RootSignature );
 
+        BindBindlessDescriptorTables( rootSignature, &ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable );
+
         TrackResource( m_RootSignature );
     }
 }
 
 void CommandList::SetComputeRootSignature( const std::shared_ptr<RootSignature>& rootSignature )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetComputeRootSignature( capture.Objects().AddRootSignature( rootSignature ) );
+    }
+
     assert( rootSignature );
 
     auto d3d12RootSignature = rootSignature->GetD3D12RootSignature().Get();
     if ( m_RootSignature != d3d12RootSignature )
     {
-        m_RootSignature = d3d12RootSignature;
+        m_RootSignature        = d3d12RootSignature;
+        m_ComputeRootSignature = rootSignature;
 
         for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
         {
@@ -1385,6 +1578,8 @@ void CommandList::SetComputeRootSignature( const std::shared_ptr<RootSignature>&
 
         m_d3d12CommandList->SetComputeRootSignature( m_RootSignature );
 
+        BindBindlessDescriptorTables( rootSignature, &ID3D12GraphicsCommandList::SetComputeRootDescriptorTable );
+
         TrackResource( m_RootSignature );
     }
 }
@@ -1395,7 +1590,7 @@ void CommandList::SetConstantBufferView( uint32_t rootParameterIndex, const std:
     if ( buffer )
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
-        TransitionBarrier( d3d12Resource, stateAfter );
+        m_ResourceStateTracker->TransitionResource( *buffer, stateAfter );
 
         m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineCBV(
             rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset );
@@ -1412,7 +1607,7 @@ void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, const std
     if ( buffer )
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
-        TransitionBarrier( d3d12Resource, stateAfter );
+        m_ResourceStateTracker->TransitionResource( *buffer, stateAfter );
 
         m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineUAV(
             rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset );
@@ -1425,6 +1620,14 @@ void CommandList::SetShaderResourceView( uint32_t rootParameterIndex, uint32_t d
                                          const std::shared_ptr<ShaderResourceView>& srv,
                                          D3D12_RESOURCE_STATES stateAfter, UINT firstSubresource, UINT numSubresources )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetShaderResourceView( rootParameterIndex, descriptorOffset,
+                                        capture.Objects().AddShaderResourceView( srv ), stateAfter, firstSubresource,
+                                        numSubresources );
+    }
+
     assert( srv );
 
     auto resource = srv->GetResource();
@@ -1453,6 +1656,14 @@ void CommandList::SetShaderResourceView( int32_t rootParameterIndex, uint32_t de
                                          const std::shared_ptr<Texture>& texture, D3D12_RESOURCE_STATES stateAfter,
                                          UINT firstSubresource, UINT numSubresources )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetTextureShaderResourceView( rootParameterIndex, descriptorOffset,
+                                               capture.Objects().AddTexture( texture ), stateAfter, firstSubresource,
+                                               numSubresources );
+    }
+
     if ( texture )
     {
         if ( numSubresources < D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES )
@@ -1474,6 +1685,44 @@ void CommandList::SetShaderResourceView( int32_t rootParameterIndex, uint32_t de
     }
 }
 
+uint32_t CommandList::SetBindlessShaderResourceView( const std::shared_ptr<Texture>& texture,
+                                                     D3D12_RESOURCE_STATES           stateAfter )
+{
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetBindlessTextureShaderResourceView( capture.Objects().AddTexture( texture ), stateAfter );
+    }
+
+    assert( texture );
+
+    TransitionBarrier( texture, stateAfter );
+    TrackResource( texture );
+
+    return texture->GetBindlessIndex();
+}
+
+uint32_t CommandList::SetBindlessShaderResourceView( const std::shared_ptr<ShaderResourceView>& srv,
+                                                     D3D12_RESOURCE_STATES                      stateAfter )
+{
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->SetBindlessShaderResourceView( capture.Objects().AddShaderResourceView( srv ), stateAfter );
+    }
+
+    assert( srv );
+
+    auto resource = srv->GetResource();
+    if ( resource )
+    {
+        TransitionBarrier( resource, stateAfter );
+        TrackResource( resource );
+    }
+
+    return srv->GetBindlessIndex();
+}
+
 void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
                                           const std::shared_ptr<UnorderedAccessView>& uav,
                                           D3D12_RESOURCE_STATES stateAfter, UINT firstSubresource,
@@ -1548,10 +1797,23 @@ void CommandList::SetConstantBufferView( uint32_t rootParameterIndex, uint32_t d
 
 void CommandList::SetRenderTarget( const RenderTarget& renderTarget )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        const auto&         renderTargetTextures = renderTarget.GetTextures();
+        CommandObjectHandle textures[AttachmentPoint::NumAttachmentPoints];
+        for ( int i = 0; i < AttachmentPoint::NumAttachmentPoints; ++i )
+        {
+            textures[i] = capture.Objects().AddTexture( renderTargetTextures[i] );
+        }
+        capture->SetRenderTarget( textures, AttachmentPoint::NumAttachmentPoints );
+    }
+
     std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> renderTargetDescriptors;
     renderTargetDescriptors.reserve( AttachmentPoint::NumAttachmentPoints );
 
     const auto& textures = renderTarget.GetTextures();
+    m_RenderTargetTextures = textures;
 
     // Bind color targets (max of 8 render targets can be bound to the rendering pipeline.
     for ( int i = 0; i < 8; ++i )
@@ -1584,12 +1846,113 @@ void CommandList::SetRenderTarget( const RenderTarget& renderTarget )
                                             renderTargetDescriptors.data(), FALSE, pDSV );
 }
 
+void CommandList::InheritState( const CommandList& commandList )
+{
+    assert( commandList.m_d3d12CommandListType == m_d3d12CommandListType );
+
+    if ( !commandList.m_RenderTargetTextures.empty() )
+    {
+        RenderTarget renderTarget;
+        for ( size_t i = 0; i < commandList.m_RenderTargetTextures.size(); ++i )
+        {
+            renderTarget.AttachTexture( static_cast<AttachmentPoint>( i ), commandList.m_RenderTargetTextures[i] );
+        }
+        SetRenderTarget( renderTarget );
+    }
+
+    if ( !commandList.m_Viewports.empty() )
+    {
+        SetViewports( commandList.m_Viewports );
+    }
+
+    if ( !commandList.m_ScissorRects.empty() )
+    {
+        SetScissorRects( commandList.m_ScissorRects );
+    }
+
+    if ( commandList.m_ComputeRootSignature )
+    {
+        SetComputeRootSignature( commandList.m_ComputeRootSignature );
+    }
+
+    // The graphics root signature is bound last, since both root signatures share the descriptor heaps.
+    if ( commandList.m_GraphicsRootSignature )
+    {
+        SetGraphicsRootSignature( commandList.m_GraphicsRootSignature );
+    }
+
+    if ( commandList.m_PipelineStateObject )
+    {
+        SetPipelineState( commandList.m_PipelineStateObject );
+    }
+
+    if ( commandList.m_PrimitiveTopology != D3D_PRIMITIVE_TOPOLOGY_UNDEFINED )
+    {
+        SetPrimitiveTopology( commandList.m_PrimitiveTopology );
+    }
+
+    // The scopes of this command list are nested in the open scopes of the other command list.
+    m_ProfileScopes             = commandList.m_ProfileScopes;
+    m_NumInheritedProfileScopes = m_ProfileScopes.size();
+}
+
+void CommandList::BeginProfileScope( GpuProfiler& profiler, const std::string& name )
+{
+    uint32_t parent = GpuProfiler::InvalidScope;
+    if ( !m_ProfileScopes.empty() && m_ProfileScopes.back().Profiler == &profiler )
+    {
+        parent = m_ProfileScopes.back().Scope;
+    }
+
+    m_ProfileScopes.push_back( { &profiler, profiler.BeginScope( *this, name, parent ) } );
+}
+
+void CommandList::EndProfileScope()
+{
+    assert( m_ProfileScopes.size() > m_NumInheritedProfileScopes && "No open profile scope to end." );
+
+    auto profileScope = m_ProfileScopes.back();
+    m_ProfileScopes.pop_back();
+
+    profileScope.Profiler->EndScope( *this, profileScope.Scope );
+}
+
+void CommandList::ContinueProfileScopes( CommandList& commandList )
+{
+    assert( commandList.m_d3d12CommandListType == m_d3d12CommandListType );
+
+    m_ProfileScopes.insert( m_ProfileScopes.end(),
+                            commandList.m_ProfileScopes.begin() + commandList.m_NumInheritedProfileScopes,
+                            commandList.m_ProfileScopes.end() );
+    commandList.m_ProfileScopes.resize( commandList.m_NumInheritedProfileScopes );
+}
+
+void CommandList::BeginCapture( CommandStream& commandStream, CommandStreamObjects& objects )
+{
+    assert( !m_CommandStream && "The command list is already capturing commands." );
+
+    m_CommandStream        = &commandStream;
+    m_CommandStreamObjects = &objects;
+}
+
+void CommandList::EndCapture()
+{
+    m_CommandStream        = nullptr;
+    m_CommandStreamObjects = nullptr;
+}
+
 
 // The Draw method is used to render geometry to the currently bound render target. Before executing a Draw command on
 // the command list, all barriers must be flushed to the command list and any resource descriptors that were staged to
 // the DDH need to be committed.
 void CommandList::Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->Draw( vertexCount, instanceCount, startVertex, startInstance );
+    }
+
     FlushResourceBarriers();
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_DSV; ++i)  // This was the wrong flag I used to index through
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )// The fix 
@@ -1603,6 +1966,12 @@ void CommandList::Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t s
 void CommandList::DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
                                uint32_t startInstance )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->DrawIndexed( indexCount, instanceCount, startIndex, baseVertex, startInstance );
+    }
+
     FlushResourceBarriers();
 
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
@@ -1615,6 +1984,12 @@ void CommandList::DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint
 
 void CommandList::Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ )
 {
+    CaptureScope capture( *this );
+    if ( capture )
+    {
+        capture->Dispatch( numGroupsX, numGroupsY, numGroupsZ );
+    }
+
     FlushResourceBarriers();
 
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
@@ -1625,30 +2000,39 @@ void CommandList::Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t n
     m_d3d12CommandList->Dispatch( numGroupsX, numGroupsY, numGroupsZ );
 }
 
+DynamicDescriptorHeap::Statistics
+    CommandList::GetDynamicDescriptorHeapStatistics( D3D12_DESCRIPTOR_HEAP_TYPE heapType ) const
+{
+    return m_DynamicDescriptorHeap[heapType]->GetStatistics();
+}
+
 bool CommandList::Close( const std::shared_ptr<CommandList>& pendingCommandList )
 {
     // Flush any remaining barriers.
+    m_ResourceStateTracker->EndSplitTransitions();
     FlushResourceBarriers();
 
     m_d3d12CommandList->Close();
 
-    // Flush pending resource barriers.
+    // Flush pending resource barriers and commit the final resource state to the global state.
     uint32_t numPendingBarriers = m_ResourceStateTracker->FlushPendingResourceBarriers( pendingCommandList );
-    // Commit the final resource state to the global state.
-    m_ResourceStateTracker->CommitFinalResourceStates();
 
     return numPendingBarriers > 0;
 }
 
 void CommandList::Close()
 {
+    m_ResourceStateTracker->EndSplitTransitions();
     FlushResourceBarriers();
     m_d3d12CommandList->Close();
 }
 
 void CommandList::Reset()
 {
-    ThrowIfFailed( m_d3d12CommandAllocator->Reset() );
+    // The allocator of the last recording was returned to the pool when the command list was executed.
+    assert( !m_d3d12CommandAllocator );
+
+    m_d3d12CommandAllocator = m_Device.GetCommandQueue( m_d3d12CommandListType ).GetCommandAllocatorPool().Acquire();
     ThrowIfFailed( m_d3d12CommandList->Reset( m_d3d12CommandAllocator.Get(), nullptr ) );
 
     m_ResourceStateTracker->Reset();
@@ -1665,6 +2049,47 @@ void CommandList::Reset()
     m_RootSignature      = nullptr;
     m_PipelineState      = nullptr;
     m_ComputeCommandList = nullptr;
+    m_UploadTicket       = {};
+    m_MipTicket          = {};
+    m_Dependencies.clear();
+
+    m_ProfileScopes.clear();
+    m_NumInheritedProfileScopes = 0;
+
+    m_CommandStream        = nullptr;
+    m_CommandStreamObjects = nullptr;
+}
+
+void CommandList::AddDependency( const SyncPoint& syncPoint )
+{
+    if ( !syncPoint.IsValid() )
+    {
+        return;
+    }
+
+    // The fence values of a queue only increase, so waiting for the latest one is enough.
+    for ( auto& dependency: m_Dependencies )
+    {
+        if ( dependency.Queue == syncPoint.Queue )
+        {
+            dependency.FenceValue = std::max( dependency.FenceValue, syncPoint.FenceValue );
+            return;
+        }
+    }
+
+    m_Dependencies.push_back( syncPoint );
+}
+
+void CommandList::AddMipDependency( const MipGenerator::Ticket& ticket )
+{
+    // Batches are executed in order, so waiting for the latest batch is enough.
+    m_MipTicket.BatchID = std::max( m_MipTicket.BatchID, ticket.BatchID );
+}
+
+void CommandList::AddUploadDependency( const UploadManager::Ticket& ticket )
+{
+    // Batches are executed in order, so waiting for the latest batch is enough.
+    m_UploadTicket.BatchID = std::max( m_UploadTicket.BatchID, ticket.BatchID );
 }
 
 void CommandList::TrackResource( Microsoft::WRL::ComPtr<ID3D12Object> object )
@@ -1676,12 +2101,28 @@ void CommandList::TrackResource( const std::shared_ptr<Resource>& res )
 {
     assert( res );
 
+    // This is the first use of a texture whose mips may still be generated.
+    auto& mipGenerator = m_Device.GetMipGenerator();
+    if ( mipGenerator.HasPendingTextures() )
+    {
+        AddMipDependency( mipGenerator.GetTicket( res->GetD3D12Resource().Get() ) );
+    }
+
     TrackResource( res->GetD3D12Resource() );
 }
 
 void CommandList::ReleaseTrackedObjects()
 {
     m_TrackedObjects.clear();
+
+    // The state that other command lists can inherit also holds on to resources.
+    m_RenderTargetTextures.clear();
+    m_Viewports.clear();
+    m_ScissorRects.clear();
+    m_GraphicsRootSignature.reset();
+    m_ComputeRootSignature.reset();
+    m_PipelineStateObject.reset();
+    m_PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
 }
 
 void CommandList::SetDescriptorHeap( D3D12_DESCRIPTOR_HEAP_TYPE heapType, ID3D12DescriptorHeap* heap )
@@ -1693,6 +2134,30 @@ void CommandList::SetDescriptorHeap( D3D12_DESCRIPTOR_HEAP_TYPE heapType, ID3D12
     }
 }
 
+void CommandList::BindBindlessDescriptorTables(
+    const std::shared_ptr<RootSignature>&                                                rootSignature,
+    std::function<void( ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE )> setFunc )
+{
+    DWORD bindlessTableBitMask = rootSignature->GetBindlessTableBitMask();
+    if ( bindlessTableBitMask != 0 )
+    {
+        auto bindlessDescriptorHeap = m_Device.GetBindlessDescriptorHeap();
+        assert( bindlessDescriptorHeap &&
+                "Root signatures with unbounded descriptor tables require bindless descriptors to be enabled." );
+
+        // The dynamic descriptor heap allocates from the same heap so this does not need to be changed again.
+        SetDescriptorHeap( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+                           bindlessDescriptorHeap->GetD3D12DescriptorHeap().Get() );
+
+        DWORD rootIndex;
+        while ( _BitScanForward( &rootIndex, bindlessTableBitMask ) )
+        {
+            setFunc( m_d3d12CommandList.Get(), rootIndex, bindlessDescriptorHeap->GetGPUDescriptorHandle() );
+            bindlessTableBitMask ^= ( 1 << rootIndex );
+        }
+    }
+}
+
 void CommandList::BindDescriptorHeaps()
 {
     UINT                  numDescriptorHeaps                                    = 0;
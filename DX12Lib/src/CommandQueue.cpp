@@ -2,12 +2,54 @@
 
 #include <dx12lib/CommandQueue.h>
 
+#include <dx12lib/CommandAllocatorPool.h>
 #include <dx12lib/CommandList.h>
 #include <dx12lib/Device.h>
-#include <dx12lib/ResourceStateTracker.h>
+#include <dx12lib/MipGenerator.h>
+#include <dx12lib/UploadBuffer.h>
+#include <dx12lib/UploadRingBuffer.h>
 
 using namespace DX12_Library;
 
+namespace
+{
+// An event that a thread reuses for all of its fence waits, instead of creating an event for every wait.
+class FenceEvent
+{
+public:
+    FenceEvent()
+    : m_Event( ::CreateEvent( NULL, FALSE, FALSE, NULL ) )
+    {
+        if ( !m_Event )
+        {
+            ThrowIfFailed( HRESULT_FROM_WIN32( ::GetLastError() ) );
+        }
+    }
+
+    ~FenceEvent()
+    {
+        ::CloseHandle( m_Event );
+    }
+
+    HANDLE Get() const
+    {
+        return m_Event;
+    }
+
+private:
+    HANDLE m_Event;
+};
+
+thread_local FenceEvent t_FenceEvent;
+
+uint64_t GetElapsedNanoseconds( std::chrono::high_resolution_clock::time_point start )
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::high_resolution_clock::now() - start )
+            .count() );
+}
+}  // namespace
+
 // Adapter for std::make_shared
 class MakeCommandList : public CommandList
 {
@@ -19,11 +61,38 @@ public:
     virtual ~MakeCommandList() {}
 };
 
+// Adapter for std::make_unique
+class MakeCommandAllocatorPool : public CommandAllocatorPool
+{
+public:
+    MakeCommandAllocatorPool( Device& device, CommandQueue& commandQueue, D3D12_COMMAND_LIST_TYPE type )
+    : CommandAllocatorPool( device, commandQueue, type )
+    {}
+
+    virtual ~MakeCommandAllocatorPool() {}
+};
+
+// Adapter for std::make_unique
+class MakeUploadRingBuffer : public UploadRingBuffer
+{
+public:
+    MakeUploadRingBuffer( Device& device, CommandQueue& commandQueue, size_t sizeInBytes )
+    : UploadRingBuffer( device, commandQueue, sizeInBytes )
+    {}
+
+    virtual ~MakeUploadRingBuffer() {}
+};
+
 CommandQueue::CommandQueue( Device& device, D3D12_COMMAND_LIST_TYPE type )
 : m_Device( device )
 , m_CommandListType( type )
 , m_FenceValue( 0 )
-, m_bProcessInFlightCommandLists( true )
+, m_InFlightCommandLists( MaxInFlightCommandLists )
+, m_AvailableCommandLists( MaxAvailableCommandLists )
+, m_NumInFlightCommandLists( 0 )
+, m_IdleTime( 0 )
+, m_FenceWaitTime( 0 )
+, m_NumFenceWaits( 0 )
 {
     auto d3d12Device = m_Device.GetD3D12Device();
 
@@ -42,6 +111,12 @@ CommandQueue::CommandQueue( Device& device, D3D12_COMMAND_LIST_TYPE type )
     ThrowIfFailed( d3d12Device->CreateCommandQueue( &desc, IID_PPV_ARGS( &m_d3d12CommandQueue ) ) );
     ThrowIfFailed( d3d12Device->CreateFence( m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS( &m_d3d12Fence ) ) );
 
+    // Dynamic buffers are recorded on the direct queue and the UploadManager stages its uploads on the copy queue.
+    size_t uploadRingBufferSize = type == D3D12_COMMAND_LIST_TYPE_COMPUTE ? _4MB : _16MB;
+    m_UploadRingBuffer          = std::make_unique<MakeUploadRingBuffer>( device, *this, uploadRingBufferSize );
+
+    m_CommandAllocatorPool = std::make_unique<MakeCommandAllocatorPool>( device, *this, type );
+
     // Set List name according to the type
     switch ( type )
     {
@@ -80,7 +155,9 @@ CommandQueue::CommandQueue( Device& device, D3D12_COMMAND_LIST_TYPE type )
 
 CommandQueue::~CommandQueue()
 {
-    m_bProcessInFlightCommandLists = false;
+    // Stop the thread after the command lists that are still in flight.
+    m_InFlightCommandLists.Push( { 0, nullptr } );
+
     m_ProcessInFlightCommandListsThread.join();
 }
 
@@ -100,24 +177,33 @@ bool CommandQueue::IsFenceComplete( uint64_t fenceValue )
     return m_d3d12Fence->GetCompletedValue() >= fenceValue;
 }
 
+uint64_t CommandQueue::GetFenceValue() const
+{
+    return m_FenceValue;
+}
+
+uint64_t CommandQueue::GetCompletedFenceValue() const
+{
+    return m_d3d12Fence->GetCompletedValue();
+}
+
 
 // Wait for Fence Value
 // CPU thread will need to stall to wait for the GPU queue to finish executing commands that write to resources before
 // being reused. This is needed to prevent resources such as RTV being modified from multiple queues at the same time
 // This function is used to stall the CPU thread if the fence value has not yet reached a specific value
+// Every thread waits on its own event, so multiple threads can wait at the same time.
 void CommandQueue::WaitForFenceValue( uint64_t fenceValue )
 {
     if ( !IsFenceComplete( fenceValue ) )
     {
-        auto event = ::CreateEvent( NULL, FALSE, FALSE, NULL );
-        if ( event )
-        {
-            // Is this function thread safe?
-            m_d3d12Fence->SetEventOnCompletion( fenceValue, event );
-            ::WaitForSingleObject( event, DWORD_MAX );
+        auto start = std::chrono::high_resolution_clock::now();
 
-            ::CloseHandle( event );
-        }
+        ThrowIfFailed( m_d3d12Fence->SetEventOnCompletion( fenceValue, t_FenceEvent.Get() ) );
+        ::WaitForSingleObject( t_FenceEvent.Get(), INFINITE );
+
+        m_FenceWaitTime += GetElapsedNanoseconds( start );
+        ++m_NumFenceWaits;
     }
 }
 
@@ -125,7 +211,7 @@ void CommandQueue::WaitForFenceValue( uint64_t fenceValue )
 void CommandQueue::Flush()
 {
     std::unique_lock<std::mutex> lock( m_ProcessInFlightCommandListsThreadMutex );
-    m_ProcessInFlightCommandListsThreadCV.wait( lock, [this] { return m_InFlightCommandLists.Empty(); } );
+    m_ProcessInFlightCommandListsThreadCV.wait( lock, [this] { return m_NumInFlightCommandLists == 0; } );
 
     // In case the command queue was signaled directly
     // using the CommandQueue::Signal method then the
@@ -134,6 +220,17 @@ void CommandQueue::Flush()
     WaitForFenceValue( m_FenceValue );
 }
 
+void CommandQueue::ReleaseCommandLists()
+{
+    Flush();
+
+    std::shared_ptr<CommandList> commandList;
+    while ( m_AvailableCommandLists.TryPop( commandList ) )
+    {
+        commandList.reset();
+    }
+}
+
 
 // GetCommandList method returns a command list that can directly be used to issues GPU drawing commands.
 // The command list will be in a recording state so there is no need to reset the command list.
@@ -145,9 +242,10 @@ std::shared_ptr<CommandList> CommandQueue::GetCommandList()
     std::shared_ptr<CommandList> commandList;
 
     // If there is a command list on the queue.
-    if ( !m_AvailableCommandLists.Empty() )
+    if ( m_AvailableCommandLists.TryPop( commandList ) )
     {
-        m_AvailableCommandLists.TryPop( commandList );
+        // The command list gets a command allocator from the pool when it is reset.
+        commandList->Reset();
     }
     else
     {
@@ -159,23 +257,43 @@ std::shared_ptr<CommandList> CommandQueue::GetCommandList()
 }
 
 // Execute a command list.
-// Returns the fence value to wait for for this command list.
-uint64_t CommandQueue::ExecuteCommandList( std::shared_ptr<CommandList> commandList )
+// Returns the sync point to wait for for this command list.
+SyncPoint CommandQueue::ExecuteCommandList( std::shared_ptr<CommandList> commandList )
 {
     return ExecuteCommandLists( std::vector<std::shared_ptr<CommandList>>( { commandList } ) );
 }
 
-uint64_t CommandQueue::ExecuteCommandLists( const std::vector<std::shared_ptr<CommandList>>& commandLists )
+SyncPoint CommandQueue::ExecuteCommandLists( const std::vector<std::shared_ptr<CommandList>>& commandLists )
 {
-    ResourceStateTracker::Lock();
+    // Wait for the uploads on the copy queue that the command lists depend on. This has to be done
+    // before the resource state tracker is locked since the pending upload batch may be executed.
+    UploadManager::Ticket uploadTicket;
+    for ( auto commandList: commandLists )
+    {
+        uploadTicket.BatchID = std::max( uploadTicket.BatchID, commandList->m_UploadTicket.BatchID );
+    }
+    m_Device.GetUploadManager().Wait( *this, uploadTicket );
+
+    // Wait for the mips of the textures that the command lists use. This submits the pending
+    // mip generation batch to the compute queue, so it has to be done before the lock as well.
+    MipGenerator::Ticket mipTicket;
+    for ( auto commandList: commandLists )
+    {
+        mipTicket.BatchID = std::max( mipTicket.BatchID, commandList->m_MipTicket.BatchID );
+    }
+    m_Device.GetMipGenerator().Wait( *this, mipTicket );
+
+    // The global resource states are resolved in the order the command lists are submitted, so the submissions
+    // to this queue must execute in the same order. Other queues can submit at the same time.
+    std::unique_lock<std::mutex> submitLock( m_SubmitMutex );
 
     // Command lists that need to put back on the command list queue.
     std::vector<std::shared_ptr<CommandList>> toBeQueued;
     toBeQueued.reserve( commandLists.size() * 2 );  // 2x since each command list will have a pending command list.
 
-    // Generate mips command lists.
-    std::vector<std::shared_ptr<CommandList>> generateMipsCommandLists;
-    generateMipsCommandLists.reserve( commandLists.size() );
+    // Compute command lists that were deferred by copy command lists.
+    std::vector<std::shared_ptr<CommandList>> computeCommandLists;
+    computeCommandLists.reserve( commandLists.size() );
 
     // Command lists that need to be executed.
     std::vector<ID3D12CommandList*> d3d12CommandLists;
@@ -198,35 +316,65 @@ uint64_t CommandQueue::ExecuteCommandLists( const std::vector<std::shared_ptr<Co
         toBeQueued.push_back( pendingCommandList );
         toBeQueued.push_back( commandList );
 
-        auto generateMipsCommandList = commandList->GetGenerateMipsCommandList();
-        if ( generateMipsCommandList )
+        auto computeCommandList = commandList->GetComputeCommandList();
+        if ( computeCommandList )
         {
-            generateMipsCommandLists.push_back( generateMipsCommandList );
+            computeCommandLists.push_back( computeCommandList );
+        }
+    }
+
+    // Wait for the producers of the command lists on other queues.
+    for ( auto commandList: commandLists )
+    {
+        for ( const auto& dependency: commandList->m_Dependencies )
+        {
+            Wait( dependency );
         }
     }
 
     UINT numCommandLists = static_cast<UINT>( d3d12CommandLists.size() );
     m_d3d12CommandQueue->ExecuteCommandLists( numCommandLists, d3d12CommandLists.data() );
-    uint64_t fenceValue = Signal();
+    uint64_t  fenceValue = Signal();
+    SyncPoint syncPoint  = { this, fenceValue };
 
-    ResourceStateTracker::Unlock();
+    submitLock.unlock();
+
+    // The upload memory can be reused as soon as the GPU reaches the fence value.
+    for ( auto commandList: commandLists )
+    {
+        commandList->m_UploadBuffer->Retire( fenceValue );
+    }
 
-    // Queue command lists for reuse.
+    // The command allocators can be reused as soon as the GPU reaches the fence value,
+    // even before the command lists are reused.
     for ( auto commandList: toBeQueued )
     {
-        m_InFlightCommandLists.Push( { fenceValue, commandList } );
+        m_CommandAllocatorPool->Release( commandList->m_d3d12CommandAllocator, fenceValue );
+        commandList->m_d3d12CommandAllocator.Reset();
+    }
+
+    // Queue command lists for reuse. This wakes up the thread if it is waiting for command lists.
+    m_NumInFlightCommandLists += toBeQueued.size();
+    for ( auto& commandList: toBeQueued )
+    {
+        m_InFlightCommandLists.Push( { fenceValue, std::move( commandList ) } );
     }
 
-    // If there are any command lists that generate mips then execute those
-    // after the initial resource command lists have finished.
-    if ( generateMipsCommandLists.size() > 0 )
+    // If there are any deferred compute command lists then execute those
+    // after the initial resource command lists have finished. They only wait for this
+    // submission, not for the work that other threads submitted to this queue since then.
+    if ( computeCommandLists.size() > 0 )
     {
+        for ( auto computeCommandList: computeCommandLists )
+        {
+            computeCommandList->AddDependency( syncPoint );
+        }
+
         auto& computeQueue = m_Device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE );
-        computeQueue.Wait( *this );
-        computeQueue.ExecuteCommandLists( generateMipsCommandLists );
+        computeQueue.ExecuteCommandLists( computeCommandLists );
     }
 
-    return fenceValue;
+    return syncPoint;
 }
 
 // Wait for another command queue to execute.
@@ -236,6 +384,19 @@ void CommandQueue::Wait( const CommandQueue& other )
     m_d3d12CommandQueue->Wait( other.m_d3d12Fence.Get(), other.m_FenceValue );
 }
 
+void CommandQueue::Wait( const CommandQueue& other, uint64_t fenceValue )
+{
+    m_d3d12CommandQueue->Wait( other.m_d3d12Fence.Get(), fenceValue );
+}
+
+void CommandQueue::Wait( const SyncPoint& syncPoint )
+{
+    if ( syncPoint.Queue && syncPoint.Queue != this && !syncPoint.IsComplete() )
+    {
+        Wait( *syncPoint.Queue, syncPoint.FenceValue );
+    }
+}
+
 Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue() const
 {
     return m_d3d12CommandQueue;
@@ -246,28 +407,52 @@ Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue()
 //for a frame that is currently being rendered and about to appear on screen.
 void CommandQueue::ProccessInFlightCommandLists()
 {
-    std::unique_lock<std::mutex> lock( m_ProcessInFlightCommandListsThreadMutex, std::defer_lock );
-
-    while ( m_bProcessInFlightCommandLists )
+    while ( true )
     {
         CommandListEntry commandListEntry;
 
-        lock.lock();
-        while ( m_InFlightCommandLists.TryPop( commandListEntry ) )
+        // Sleep until command lists are executed.
         {
-            auto fenceValue  = std::get<0>( commandListEntry );
-            auto commandList = std::get<1>( commandListEntry );
+            auto start = std::chrono::high_resolution_clock::now();
+
+            m_InFlightCommandLists.Pop( commandListEntry );
 
-            WaitForFenceValue( fenceValue );
+            m_IdleTime += GetElapsedNanoseconds( start );
+        }
 
-            commandList->Reset();
+        auto fenceValue  = std::get<0>( commandListEntry );
+        auto commandList = std::move( std::get<1>( commandListEntry ) );
 
-            m_AvailableCommandLists.Push( commandList );
+        if ( !commandList )
+        {
+            break;
         }
-        lock.unlock();
-        m_ProcessInFlightCommandListsThreadCV.notify_one();
 
-        // std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
-        std::this_thread::yield();
+        WaitForFenceValue( fenceValue );
+
+        // The command list is reset when it is reused. The objects it used can be released now.
+        commandList->ReleaseTrackedObjects();
+
+        // If enough command lists are available for reuse, this one is released.
+        m_AvailableCommandLists.TryPush( std::move( commandList ) );
+
+        // The mutex makes sure that Flush is either waiting or about to check the count again.
+        if ( --m_NumInFlightCommandLists == 0 )
+        {
+            {
+                std::lock_guard<std::mutex> lock( m_ProcessInFlightCommandListsThreadMutex );
+            }
+            m_ProcessInFlightCommandListsThreadCV.notify_all();
+        }
     }
-}
\ No newline at end of file
+}
+
+CommandQueue::Statistics CommandQueue::GetStatistics() const
+{
+    Statistics statistics;
+    statistics.IdleTime      = m_IdleTime * 1e-9;
+    statistics.FenceWaitTime = m_FenceWaitTime * 1e-9;
+    statistics.NumFenceWaits = m_NumFenceWaits;
+
+    return statistics;
+}
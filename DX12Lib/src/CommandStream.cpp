@@ -0,0 +1,532 @@
+#include <dx12lib/CommandStream.h>
+
+#include <cassert>
+#include <cstring>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+enum CommandType : uint8_t
+{
+    TransitionBarrierCommand,
+    UAVBarrierCommand,
+    AliasingBarrierCommand,
+    CopyResourceCommand,
+    ResolveSubresourceCommand,
+    SetPipelineStateCommand,
+    SetGraphicsRootSignatureCommand,
+    SetComputeRootSignatureCommand,
+    SetPrimitiveTopologyCommand,
+    SetVertexBufferCommand,
+    SetIndexBufferCommand,
+    SetViewportsCommand,
+    SetScissorRectsCommand,
+    SetRenderTargetCommand,
+    SetGraphics32BitConstantsCommand,
+    SetCompute32BitConstantsCommand,
+    SetGraphicsDynamicConstantBufferCommand,
+    SetGraphicsDynamicStructuredBufferCommand,
+    SetShaderResourceViewCommand,
+    SetTextureShaderResourceViewCommand,
+    SetBindlessShaderResourceViewCommand,
+    SetBindlessTextureShaderResourceViewCommand,
+    DrawCommand,
+    DrawIndexedCommand,
+    DispatchCommand,
+};
+
+// Commands (and the data that follows their arguments) are aligned to 4 bytes.
+const size_t CommandAlignment = 4;
+
+struct CommandHeader
+{
+    uint8_t Type;
+    uint8_t Padding[3];
+    // The size of the command in bytes (including the header, the arguments and the data).
+    uint32_t Size;
+};
+
+// The arguments of the commands. Objects are stored as handles.
+struct ResourceArgs
+{
+    uint32_t Resource;
+};
+
+struct TransitionBarrierArgs
+{
+    uint32_t Resource;
+    uint32_t StateAfter;
+    uint32_t Subresource;
+};
+
+struct ResourcePairArgs
+{
+    uint32_t First;
+    uint32_t Second;
+};
+
+struct ResolveSubresourceArgs
+{
+    uint32_t DstResource;
+    uint32_t SrcResource;
+    uint32_t DstSubresource;
+    uint32_t SrcSubresource;
+};
+
+struct ObjectArgs
+{
+    uint32_t Object;
+};
+
+struct SetPrimitiveTopologyArgs
+{
+    uint32_t PrimitiveTopology;
+};
+
+struct SetVertexBufferArgs
+{
+    uint32_t Slot;
+    uint32_t VertexBuffer;
+};
+
+// The elements (viewports, scissor rectangles or texture handles) follow the arguments.
+struct ArrayArgs
+{
+    uint32_t NumElements;
+};
+
+// The constants follow the arguments.
+struct SetRootConstantsArgs
+{
+    uint32_t RootParameterIndex;
+    uint32_t NumConstants;
+};
+
+// The buffer data follows the arguments.
+struct SetDynamicConstantBufferArgs
+{
+    uint32_t RootParameterIndex;
+    uint32_t SizeInBytes;
+};
+
+// The buffer data follows the arguments.
+struct SetDynamicStructuredBufferArgs
+{
+    uint32_t Slot;
+    uint32_t NumElements;
+    uint32_t ElementSize;
+};
+
+struct SetShaderResourceViewArgs
+{
+    uint32_t RootParameterIndex;
+    uint32_t DescriptorOffset;
+    uint32_t Object;
+    uint32_t StateAfter;
+    uint32_t FirstSubresource;
+    uint32_t NumSubresources;
+};
+
+struct SetBindlessShaderResourceViewArgs
+{
+    uint32_t Object;
+    uint32_t StateAfter;
+};
+
+struct DrawArgs
+{
+    uint32_t VertexCount;
+    uint32_t InstanceCount;
+    uint32_t StartVertex;
+    uint32_t StartInstance;
+};
+
+struct DrawIndexedArgs
+{
+    uint32_t IndexCount;
+    uint32_t InstanceCount;
+    uint32_t StartIndex;
+    int32_t  BaseVertex;
+    uint32_t StartInstance;
+};
+
+struct DispatchArgs
+{
+    uint32_t NumGroupsX;
+    uint32_t NumGroupsY;
+    uint32_t NumGroupsZ;
+};
+
+// The stream is a byte array, so the arguments are copied out instead of cast.
+template<typename Args>
+Args ReadArgs( const uint8_t* data )
+{
+    Args args;
+    memcpy( &args, data, sizeof( Args ) );
+    return args;
+}
+
+}  // namespace
+
+CommandStream::CommandStream()
+: m_NumCommands( 0 )
+{}
+
+CommandStream::~CommandStream() {}
+
+template<typename Args>
+void CommandStream::Write( uint8_t type, const Args& args, const void* data, size_t dataSize )
+{
+    size_t size = ( sizeof( CommandHeader ) + sizeof( Args ) + dataSize + CommandAlignment - 1 ) &
+                  ~( CommandAlignment - 1 );
+    assert( size <= UINT32_MAX );
+
+    CommandHeader header = {};
+    header.Type          = type;
+    header.Size          = static_cast<uint32_t>( size );
+
+    size_t offset = m_Data.size();
+    m_Data.resize( offset + size );
+
+    uint8_t* command = m_Data.data() + offset;
+    memcpy( command, &header, sizeof( CommandHeader ) );
+    memcpy( command + sizeof( CommandHeader ), &args, sizeof( Args ) );
+    if ( dataSize > 0 )
+    {
+        memcpy( command + sizeof( CommandHeader ) + sizeof( Args ), data, dataSize );
+    }
+
+    ++m_NumCommands;
+}
+
+void CommandStream::TransitionBarrier( CommandObjectHandle resource, uint32_t stateAfter, uint32_t subresource )
+{
+    Write( TransitionBarrierCommand, TransitionBarrierArgs { resource, stateAfter, subresource } );
+}
+
+void CommandStream::UAVBarrier( CommandObjectHandle resource )
+{
+    Write( UAVBarrierCommand, ResourceArgs { resource } );
+}
+
+void CommandStream::AliasingBarrier( CommandObjectHandle beforeResource, CommandObjectHandle afterResource )
+{
+    Write( AliasingBarrierCommand, ResourcePairArgs { beforeResource, afterResource } );
+}
+
+void CommandStream::CopyResource( CommandObjectHandle dstRes, CommandObjectHandle srcRes )
+{
+    Write( CopyResourceCommand, ResourcePairArgs { dstRes, srcRes } );
+}
+
+void CommandStream::ResolveSubresource( CommandObjectHandle dstRes, CommandObjectHandle srcRes,
+                                        uint32_t dstSubresource, uint32_t srcSubresource )
+{
+    Write( ResolveSubresourceCommand, ResolveSubresourceArgs { dstRes, srcRes, dstSubresource, srcSubresource } );
+}
+
+void CommandStream::SetPipelineState( CommandObjectHandle pipelineState )
+{
+    Write( SetPipelineStateCommand, ObjectArgs { pipelineState } );
+}
+
+void CommandStream::SetGraphicsRootSignature( CommandObjectHandle rootSignature )
+{
+    Write( SetGraphicsRootSignatureCommand, ObjectArgs { rootSignature } );
+}
+
+void CommandStream::SetComputeRootSignature( CommandObjectHandle rootSignature )
+{
+    Write( SetComputeRootSignatureCommand, ObjectArgs { rootSignature } );
+}
+
+void CommandStream::SetPrimitiveTopology( uint32_t primitiveTopology )
+{
+    Write( SetPrimitiveTopologyCommand, SetPrimitiveTopologyArgs { primitiveTopology } );
+}
+
+void CommandStream::SetVertexBuffer( uint32_t slot, CommandObjectHandle vertexBuffer )
+{
+    Write( SetVertexBufferCommand, SetVertexBufferArgs { slot, vertexBuffer } );
+}
+
+void CommandStream::SetIndexBuffer( CommandObjectHandle indexBuffer )
+{
+    Write( SetIndexBufferCommand, ObjectArgs { indexBuffer } );
+}
+
+void CommandStream::SetViewports( const CommandViewport* viewports, uint32_t numViewports )
+{
+    Write( SetViewportsCommand, ArrayArgs { numViewports }, viewports, numViewports * sizeof( CommandViewport ) );
+}
+
+void CommandStream::SetScissorRects( const CommandRect* scissorRects, uint32_t numScissorRects )
+{
+    Write( SetScissorRectsCommand, ArrayArgs { numScissorRects }, scissorRects,
+           numScissorRects * sizeof( CommandRect ) );
+}
+
+void CommandStream::SetRenderTarget( const CommandObjectHandle* textures, uint32_t numTextures )
+{
+    Write( SetRenderTargetCommand, ArrayArgs { numTextures }, textures, numTextures * sizeof( CommandObjectHandle ) );
+}
+
+void CommandStream::SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                               const void* constants )
+{
+    Write( SetGraphics32BitConstantsCommand, SetRootConstantsArgs { rootParameterIndex, numConstants }, constants,
+           numConstants * sizeof( uint32_t ) );
+}
+
+void CommandStream::SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                              const void* constants )
+{
+    Write( SetCompute32BitConstantsCommand, SetRootConstantsArgs { rootParameterIndex, numConstants }, constants,
+           numConstants * sizeof( uint32_t ) );
+}
+
+void CommandStream::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes,
+                                                      const void* bufferData )
+{
+    Write( SetGraphicsDynamicConstantBufferCommand,
+           SetDynamicConstantBufferArgs { rootParameterIndex, static_cast<uint32_t>( sizeInBytes ) }, bufferData,
+           sizeInBytes );
+}
+
+void CommandStream::SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
+                                                        const void* bufferData )
+{
+    Write( SetGraphicsDynamicStructuredBufferCommand,
+           SetDynamicStructuredBufferArgs { slot, static_cast<uint32_t>( numElements ),
+                                            static_cast<uint32_t>( elementSize ) },
+           bufferData, numElements * elementSize );
+}
+
+void CommandStream::SetShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
+                                           CommandObjectHandle srv, uint32_t stateAfter, uint32_t firstSubresource,
+                                           uint32_t numSubresources )
+{
+    Write( SetShaderResourceViewCommand, SetShaderResourceViewArgs { rootParameterIndex, descriptorOffset, srv,
+                                                                     stateAfter, firstSubresource, numSubresources } );
+}
+
+void CommandStream::SetTextureShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
+                                                  CommandObjectHandle texture, uint32_t stateAfter,
+                                                  uint32_t firstSubresource, uint32_t numSubresources )
+{
+    Write( SetTextureShaderResourceViewCommand,
+           SetShaderResourceViewArgs { rootParameterIndex, descriptorOffset, texture, stateAfter, firstSubresource,
+                                       numSubresources } );
+}
+
+void CommandStream::SetBindlessShaderResourceView( CommandObjectHandle srv, uint32_t stateAfter )
+{
+    Write( SetBindlessShaderResourceViewCommand, SetBindlessShaderResourceViewArgs { srv, stateAfter } );
+}
+
+void CommandStream::SetBindlessTextureShaderResourceView( CommandObjectHandle texture, uint32_t stateAfter )
+{
+    Write( SetBindlessTextureShaderResourceViewCommand, SetBindlessShaderResourceViewArgs { texture, stateAfter } );
+}
+
+void CommandStream::Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance )
+{
+    Write( DrawCommand, DrawArgs { vertexCount, instanceCount, startVertex, startInstance } );
+}
+
+void CommandStream::DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                                 uint32_t startInstance )
+{
+    Write( DrawIndexedCommand, DrawIndexedArgs { indexCount, instanceCount, startIndex, baseVertex, startInstance } );
+}
+
+void CommandStream::Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ )
+{
+    Write( DispatchCommand, DispatchArgs { numGroupsX, numGroupsY, numGroupsZ } );
+}
+
+void CommandStream::Replay( CommandBackend& backend ) const
+{
+    size_t offset = 0;
+    while ( offset < m_Data.size() )
+    {
+        auto header = ReadArgs<CommandHeader>( m_Data.data() + offset );
+        auto args   = m_Data.data() + offset + sizeof( CommandHeader );
+
+        switch ( header.Type )
+        {
+        case TransitionBarrierCommand:
+        {
+            auto a = ReadArgs<TransitionBarrierArgs>( args );
+            backend.TransitionBarrier( a.Resource, a.StateAfter, a.Subresource );
+        }
+        break;
+        case UAVBarrierCommand:
+        {
+            auto a = ReadArgs<ResourceArgs>( args );
+            backend.UAVBarrier( a.Resource );
+        }
+        break;
+        case AliasingBarrierCommand:
+        {
+            auto a = ReadArgs<ResourcePairArgs>( args );
+            backend.AliasingBarrier( a.First, a.Second );
+        }
+        break;
+        case CopyResourceCommand:
+        {
+            auto a = ReadArgs<ResourcePairArgs>( args );
+            backend.CopyResource( a.First, a.Second );
+        }
+        break;
+        case ResolveSubresourceCommand:
+        {
+            auto a = ReadArgs<ResolveSubresourceArgs>( args );
+            backend.ResolveSubresource( a.DstResource, a.SrcResource, a.DstSubresource, a.SrcSubresource );
+        }
+        break;
+        case SetPipelineStateCommand:
+        {
+            auto a = ReadArgs<ObjectArgs>( args );
+            backend.SetPipelineState( a.Object );
+        }
+        break;
+        case SetGraphicsRootSignatureCommand:
+        {
+            auto a = ReadArgs<ObjectArgs>( args );
+            backend.SetGraphicsRootSignature( a.Object );
+        }
+        break;
+        case SetComputeRootSignatureCommand:
+        {
+            auto a = ReadArgs<ObjectArgs>( args );
+            backend.SetComputeRootSignature( a.Object );
+        }
+        break;
+        case SetPrimitiveTopologyCommand:
+        {
+            auto a = ReadArgs<SetPrimitiveTopologyArgs>( args );
+            backend.SetPrimitiveTopology( a.PrimitiveTopology );
+        }
+        break;
+        case SetVertexBufferCommand:
+        {
+            auto a = ReadArgs<SetVertexBufferArgs>( args );
+            backend.SetVertexBuffer( a.Slot, a.VertexBuffer );
+        }
+        break;
+        case SetIndexBufferCommand:
+        {
+            auto a = ReadArgs<ObjectArgs>( args );
+            backend.SetIndexBuffer( a.Object );
+        }
+        break;
+        case SetViewportsCommand:
+        {
+            auto a = ReadArgs<ArrayArgs>( args );
+            backend.SetViewports( reinterpret_cast<const CommandViewport*>( args + sizeof( ArrayArgs ) ),
+                                  a.NumElements );
+        }
+        break;
+        case SetScissorRectsCommand:
+        {
+            auto a = ReadArgs<ArrayArgs>( args );
+            backend.SetScissorRects( reinterpret_cast<const CommandRect*>( args + sizeof( ArrayArgs ) ),
+                                     a.NumElements );
+        }
+        break;
+        case SetRenderTargetCommand:
+        {
+            auto a = ReadArgs<ArrayArgs>( args );
+            backend.SetRenderTarget( reinterpret_cast<const CommandObjectHandle*>( args + sizeof( ArrayArgs ) ),
+                                     a.NumElements );
+        }
+        break;
+        case SetGraphics32BitConstantsCommand:
+        {
+            auto a = ReadArgs<SetRootConstantsArgs>( args );
+            backend.SetGraphics32BitConstants( a.RootParameterIndex, a.NumConstants,
+                                               args + sizeof( SetRootConstantsArgs ) );
+        }
+        break;
+        case SetCompute32BitConstantsCommand:
+        {
+            auto a = ReadArgs<SetRootConstantsArgs>( args );
+            backend.SetCompute32BitConstants( a.RootParameterIndex, a.NumConstants,
+                                              args + sizeof( SetRootConstantsArgs ) );
+        }
+        break;
+        case SetGraphicsDynamicConstantBufferCommand:
+        {
+            auto a = ReadArgs<SetDynamicConstantBufferArgs>( args );
+            backend.SetGraphicsDynamicConstantBuffer( a.RootParameterIndex, a.SizeInBytes,
+                                                      args + sizeof( SetDynamicConstantBufferArgs ) );
+        }
+        break;
+        case SetGraphicsDynamicStructuredBufferCommand:
+        {
+            auto a = ReadArgs<SetDynamicStructuredBufferArgs>( args );
+            backend.SetGraphicsDynamicStructuredBuffer( a.Slot, a.NumElements, a.ElementSize,
+                                                        args + sizeof( SetDynamicStructuredBufferArgs ) );
+        }
+        break;
+        case SetShaderResourceViewCommand:
+        {
+            auto a = ReadArgs<SetShaderResourceViewArgs>( args );
+            backend.SetShaderResourceView( a.RootParameterIndex, a.DescriptorOffset, a.Object, a.StateAfter,
+                                           a.FirstSubresource, a.NumSubresources );
+        }
+        break;
+        case SetTextureShaderResourceViewCommand:
+        {
+            auto a = ReadArgs<SetShaderResourceViewArgs>( args );
+            backend.SetTextureShaderResourceView( a.RootParameterIndex, a.DescriptorOffset, a.Object, a.StateAfter,
+                                                  a.FirstSubresource, a.NumSubresources );
+        }
+        break;
+        case SetBindlessShaderResourceViewCommand:
+        {
+            auto a = ReadArgs<SetBindlessShaderResourceViewArgs>( args );
+            backend.SetBindlessShaderResourceView( a.Object, a.StateAfter );
+        }
+        break;
+        case SetBindlessTextureShaderResourceViewCommand:
+        {
+            auto a = ReadArgs<SetBindlessShaderResourceViewArgs>( args );
+            backend.SetBindlessTextureShaderResourceView( a.Object, a.StateAfter );
+        }
+        break;
+        case DrawCommand:
+        {
+            auto a = ReadArgs<DrawArgs>( args );
+            backend.Draw( a.VertexCount, a.InstanceCount, a.StartVertex, a.StartInstance );
+        }
+        break;
+        case DrawIndexedCommand:
+        {
+            auto a = ReadArgs<DrawIndexedArgs>( args );
+            backend.DrawIndexed( a.IndexCount, a.InstanceCount, a.StartIndex, a.BaseVertex, a.StartInstance );
+        }
+        break;
+        case DispatchCommand:
+        {
+            auto a = ReadArgs<DispatchArgs>( args );
+            backend.Dispatch( a.NumGroupsX, a.NumGroupsY, a.NumGroupsZ );
+        }
+        break;
+        default:
+            assert( false && "Invalid command in command stream." );
+            break;
+        }
+
+        offset += header.Size;
+    }
+}
+
+void CommandStream::Clear()
+{
+    m_Data.clear();
+    m_NumCommands = 0;
+}
@@ -0,0 +1,353 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/CommandStreamObjects.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/IndexBuffer.h>
+#include <dx12lib/NullCommandBackend.h>
+#include <dx12lib/PipelineStateObject.h>
+#include <dx12lib/RenderTarget.h>
+#include <dx12lib/Resource.h>
+#include <dx12lib/RootSignature.h>
+#include <dx12lib/ShaderResourceView.h>
+#include <dx12lib/Texture.h>
+#include <dx12lib/VertexBuffer.h>
+
+using namespace DX12_Library;
+
+// The command stream stores the Direct3D 12 values and structures as plain types.
+static_assert( sizeof( CommandViewport ) == sizeof( D3D12_VIEWPORT ), "CommandViewport must match D3D12_VIEWPORT." );
+static_assert( offsetof( CommandViewport, MaxDepth ) == offsetof( D3D12_VIEWPORT, MaxDepth ),
+               "CommandViewport must match D3D12_VIEWPORT." );
+static_assert( sizeof( CommandRect ) == sizeof( D3D12_RECT ), "CommandRect must match D3D12_RECT." );
+static_assert( AllSubresources == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+               "AllSubresources must match D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES." );
+
+namespace
+{
+
+// Replays a command stream into a command list.
+class CommandListBackend : public CommandBackend
+{
+public:
+    CommandListBackend( const CommandStreamObjects& objects, CommandList& commandList )
+    : m_Objects( objects )
+    , m_CommandList( commandList )
+    {}
+
+    void TransitionBarrier( CommandObjectHandle resource, uint32_t stateAfter, uint32_t subresource ) override
+    {
+        m_CommandList.TransitionBarrier( m_Objects.GetResource( resource ),
+                                         static_cast<D3D12_RESOURCE_STATES>( stateAfter ), subresource );
+    }
+
+    void UAVBarrier( CommandObjectHandle resource ) override
+    {
+        m_CommandList.UAVBarrier( m_Objects.GetResource( resource ) );
+    }
+
+    void AliasingBarrier( CommandObjectHandle beforeResource, CommandObjectHandle afterResource ) override
+    {
+        m_CommandList.AliasingBarrier( m_Objects.GetResource( beforeResource ),
+                                       m_Objects.GetResource( afterResource ) );
+    }
+
+    void CopyResource( CommandObjectHandle dstRes, CommandObjectHandle srcRes ) override
+    {
+        m_CommandList.CopyResource( m_Objects.GetResource( dstRes ), m_Objects.GetResource( srcRes ) );
+    }
+
+    void ResolveSubresource( CommandObjectHandle dstRes, CommandObjectHandle srcRes, uint32_t dstSubresource,
+                             uint32_t srcSubresource ) override
+    {
+        m_CommandList.ResolveSubresource( m_Objects.GetResource( dstRes ), m_Objects.GetResource( srcRes ),
+                                          dstSubresource, srcSubresource );
+    }
+
+    void SetPipelineState( CommandObjectHandle pipelineState ) override
+    {
+        m_CommandList.SetPipelineState( m_Objects.GetPipelineState( pipelineState ) );
+    }
+
+    void SetGraphicsRootSignature( CommandObjectHandle rootSignature ) override
+    {
+        m_CommandList.SetGraphicsRootSignature( m_Objects.GetRootSignature( rootSignature ) );
+    }
+
+    void SetComputeRootSignature( CommandObjectHandle rootSignature ) override
+    {
+        m_CommandList.SetComputeRootSignature( m_Objects.GetRootSignature( rootSignature ) );
+    }
+
+    void SetPrimitiveTopology( uint32_t primitiveTopology ) override
+    {
+        m_CommandList.SetPrimitiveTopology( static_cast<D3D_PRIMITIVE_TOPOLOGY>( primitiveTopology ) );
+    }
+
+    void SetVertexBuffer( uint32_t slot, CommandObjectHandle vertexBuffer ) override
+    {
+        m_CommandList.SetVertexBuffer( slot, m_Objects.GetVertexBuffer( vertexBuffer ) );
+    }
+
+    void SetIndexBuffer( CommandObjectHandle indexBuffer ) override
+    {
+        m_CommandList.SetIndexBuffer( m_Objects.GetIndexBuffer( indexBuffer ) );
+    }
+
+    void SetViewports( const CommandViewport* viewports, uint32_t numViewports ) override
+    {
+        auto d3d12Viewports = reinterpret_cast<const D3D12_VIEWPORT*>( viewports );
+        m_CommandList.SetViewports( std::vector<D3D12_VIEWPORT>( d3d12Viewports, d3d12Viewports + numViewports ) );
+    }
+
+    void SetScissorRects( const CommandRect* scissorRects, uint32_t numScissorRects ) override
+    {
+        auto d3d12ScissorRects = reinterpret_cast<const D3D12_RECT*>( scissorRects );
+        m_CommandList.SetScissorRects(
+            std::vector<D3D12_RECT>( d3d12ScissorRects, d3d12ScissorRects + numScissorRects ) );
+    }
+
+    void SetRenderTarget( const CommandObjectHandle* textures, uint32_t numTextures ) override
+    {
+        RenderTarget renderTarget;
+        for ( uint32_t i = 0; i < numTextures && i < AttachmentPoint::NumAttachmentPoints; ++i )
+        {
+            if ( textures[i] != InvalidCommandObject )
+            {
+                renderTarget.AttachTexture( static_cast<AttachmentPoint>( i ), m_Objects.GetTexture( textures[i] ) );
+            }
+        }
+        m_CommandList.SetRenderTarget( renderTarget );
+    }
+
+    void SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                    const void* constants ) override
+    {
+        m_CommandList.SetGraphics32BitConstants( rootParameterIndex, numConstants, constants );
+    }
+
+    void SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants ) override
+    {
+        m_CommandList.SetCompute32BitConstants( rootParameterIndex, numConstants, constants );
+    }
+
+    void SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes,
+                                           const void* bufferData ) override
+    {
+        m_CommandList.SetGraphicsDynamicConstantBuffer( rootParameterIndex, sizeInBytes, bufferData );
+    }
+
+    void SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
+                                             const void* bufferData ) override
+    {
+        m_CommandList.SetGraphicsDynamicStructuredBuffer( slot, numElements, elementSize, bufferData );
+    }
+
+    void SetShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset, CommandObjectHandle srv,
+                                uint32_t stateAfter, uint32_t firstSubresource, uint32_t numSubresources ) override
+    {
+        m_CommandList.SetShaderResourceView( rootParameterIndex, descriptorOffset,
+                                             m_Objects.GetShaderResourceView( srv ),
+                                             static_cast<D3D12_RESOURCE_STATES>( stateAfter ), firstSubresource,
+                                             numSubresources );
+    }
+
+    void SetTextureShaderResourceView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
+                                       CommandObjectHandle texture, uint32_t stateAfter, uint32_t firstSubresource,
+                                       uint32_t numSubresources ) override
+    {
+        m_CommandList.SetShaderResourceView( static_cast<int32_t>( rootParameterIndex ), descriptorOffset,
+                                             m_Objects.GetTexture( texture ),
+                                             static_cast<D3D12_RESOURCE_STATES>( stateAfter ), firstSubresource,
+                                             numSubresources );
+    }
+
+    void SetBindlessShaderResourceView( CommandObjectHandle srv, uint32_t stateAfter ) override
+    {
+        m_CommandList.SetBindlessShaderResourceView( m_Objects.GetShaderResourceView( srv ),
+                                                     static_cast<D3D12_RESOURCE_STATES>( stateAfter ) );
+    }
+
+    void SetBindlessTextureShaderResourceView( CommandObjectHandle texture, uint32_t stateAfter ) override
+    {
+        m_CommandList.SetBindlessShaderResourceView( m_Objects.GetTexture( texture ),
+                                                     static_cast<D3D12_RESOURCE_STATES>( stateAfter ) );
+    }
+
+    void Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance ) override
+    {
+        m_CommandList.Draw( vertexCount, instanceCount, startVertex, startInstance );
+    }
+
+    void DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+                      uint32_t startInstance ) override
+    {
+        m_CommandList.DrawIndexed( indexCount, instanceCount, startIndex, baseVertex, startInstance );
+    }
+
+    void Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ ) override
+    {
+        m_CommandList.Dispatch( numGroupsX, numGroupsY, numGroupsZ );
+    }
+
+private:
+    const CommandStreamObjects& m_Objects;
+    CommandList&                m_CommandList;
+};
+
+}  // namespace
+
+template<typename T>
+CommandObjectHandle CommandStreamObjects::ObjectTable<T>::Add( const std::shared_ptr<T>& object )
+{
+    if ( !object )
+    {
+        return InvalidCommandObject;
+    }
+
+    if ( LastIndex != InvalidCommandObject && Objects[LastIndex] == object )
+    {
+        return LastIndex;
+    }
+
+    auto iter = Indices.find( object.get() );
+    if ( iter != Indices.end() )
+    {
+        LastIndex = iter->second;
+    }
+    else
+    {
+        LastIndex = static_cast<uint32_t>( Objects.size() );
+        Objects.push_back( object );
+        Indices.emplace( object.get(), LastIndex );
+    }
+
+    return LastIndex;
+}
+
+template<typename T>
+const std::shared_ptr<T>& CommandStreamObjects::ObjectTable<T>::Get( CommandObjectHandle handle ) const
+{
+    static const std::shared_ptr<T> nullObject;
+
+    if ( handle == InvalidCommandObject )
+    {
+        return nullObject;
+    }
+
+    assert( handle < Objects.size() );
+    return Objects[handle];
+}
+
+template<typename T>
+void CommandStreamObjects::ObjectTable<T>::Clear()
+{
+    Objects.clear();
+    Indices.clear();
+    LastIndex = InvalidCommandObject;
+}
+
+CommandStreamObjects::CommandStreamObjects() {}
+
+CommandStreamObjects::~CommandStreamObjects() {}
+
+CommandObjectHandle CommandStreamObjects::AddResource( const std::shared_ptr<Resource>& resource )
+{
+    return m_Resources.Add( resource );
+}
+
+CommandObjectHandle CommandStreamObjects::AddTexture( const std::shared_ptr<Texture>& texture )
+{
+    return m_Textures.Add( texture );
+}
+
+CommandObjectHandle CommandStreamObjects::AddPipelineState( const std::shared_ptr<PipelineStateObject>& pipelineState )
+{
+    return m_PipelineStates.Add( pipelineState );
+}
+
+CommandObjectHandle CommandStreamObjects::AddRootSignature( const std::shared_ptr<RootSignature>& rootSignature )
+{
+    return m_RootSignatures.Add( rootSignature );
+}
+
+CommandObjectHandle CommandStreamObjects::AddVertexBuffer( const std::shared_ptr<VertexBuffer>& vertexBuffer )
+{
+    return m_VertexBuffers.Add( vertexBuffer );
+}
+
+CommandObjectHandle CommandStreamObjects::AddIndexBuffer( const std::shared_ptr<IndexBuffer>& indexBuffer )
+{
+    return m_IndexBuffers.Add( indexBuffer );
+}
+
+CommandObjectHandle CommandStreamObjects::AddShaderResourceView( const std::shared_ptr<ShaderResourceView>& srv )
+{
+    return m_ShaderResourceViews.Add( srv );
+}
+
+const std::shared_ptr<Resource>& CommandStreamObjects::GetResource( CommandObjectHandle handle ) const
+{
+    return m_Resources.Get( handle );
+}
+
+const std::shared_ptr<Texture>& CommandStreamObjects::GetTexture( CommandObjectHandle handle ) const
+{
+    return m_Textures.Get( handle );
+}
+
+const std::shared_ptr<PipelineStateObject>& CommandStreamObjects::GetPipelineState( CommandObjectHandle handle ) const
+{
+    return m_PipelineStates.Get( handle );
+}
+
+const std::shared_ptr<RootSignature>& CommandStreamObjects::GetRootSignature( CommandObjectHandle handle ) const
+{
+    return m_RootSignatures.Get( handle );
+}
+
+const std::shared_ptr<VertexBuffer>& CommandStreamObjects::GetVertexBuffer( CommandObjectHandle handle ) const
+{
+    return m_VertexBuffers.Get( handle );
+}
+
+const std::shared_ptr<IndexBuffer>& CommandStreamObjects::GetIndexBuffer( CommandObjectHandle handle ) const
+{
+    return m_IndexBuffers.Get( handle );
+}
+
+const std::shared_ptr<ShaderResourceView>&
+    CommandStreamObjects::GetShaderResourceView( CommandObjectHandle handle ) const
+{
+    return m_ShaderResourceViews.Get( handle );
+}
+
+void CommandStreamObjects::Replay( const CommandStream& commandStream, CommandList& commandList ) const
+{
+    CommandListBackend backend( *this, commandList );
+    commandStream.Replay( backend );
+}
+
+void CommandStreamObjects::Describe( NullCommandBackend& backend ) const
+{
+    for ( uint32_t i = 0; i < m_RootSignatures.Objects.size(); ++i )
+    {
+        backend.DescribeRootSignature( i, m_RootSignatures.Objects[i]->GetRootSignatureDesc().NumParameters );
+    }
+
+    for ( uint32_t i = 0; i < m_IndexBuffers.Objects.size(); ++i )
+    {
+        backend.DescribeIndexBuffer( i, static_cast<uint32_t>( m_IndexBuffers.Objects[i]->GetNumIndicies() ) );
+    }
+}
+
+void CommandStreamObjects::Clear()
+{
+    m_Resources.Clear();
+    m_Textures.Clear();
+    m_PipelineStates.Clear();
+    m_RootSignatures.Clear();
+    m_VertexBuffers.Clear();
+    m_IndexBuffers.Clear();
+    m_ShaderResourceViews.Clear();
+}
@@ -17,14 +17,38 @@ public:
     virtual ~MakeAllocatorPage() {}
 };
 
+// Used to identify the thread's magazine for an allocator.
+// Allocator addresses may be reused, so a unique ID is used instead.
+static std::atomic_uint64_t s_NextAllocatorID( 1 );
+
 DescriptorAllocator::DescriptorAllocator( Device& device, D3D12_DESCRIPTOR_HEAP_TYPE type,
                                           uint32_t numDescriptorsPerHeap )
 : m_Device( device )
 , m_HeapType( type )
 , m_NumDescriptorsPerHeap( numDescriptorsPerHeap )
+, m_AllocatorID( s_NextAllocatorID++ )
+, m_NumRetiredAllocations( 0 )
+, m_NumRetiredMagazineHits( 0 )
+, m_NumRangeAllocations( 0 )
+, m_NumMagazineRefills( 0 )
+, m_NumLocks( 0 )
+, m_NumContendedLocks( 0 )
+, m_NumReleasedDescriptors( 0 )
 {}
 
-DescriptorAllocator::~DescriptorAllocator() {}
+DescriptorAllocator::~DescriptorAllocator()
+{
+    // Return the descriptors that are still cached by other threads.
+    // The magazine mutex makes sure that a thread that is exiting is not draining it at the same time.
+    // Setting the flag after the drain publishes the emptied magazine to the thread, which removes it
+    // the next time it looks up a magazine.
+    for ( auto& magazine: m_Magazines )
+    {
+        std::lock_guard<std::mutex> lock( magazine->Mutex );
+        magazine->Drain();
+        magazine->IsOrphaned.store( true, std::memory_order_release );
+    }
+}
 
 std::shared_ptr<DescriptorAllocatorPage> DescriptorAllocator::CreateAllocatorPage()
 {
@@ -37,16 +61,139 @@ std::shared_ptr<DescriptorAllocatorPage> DescriptorAllocator::CreateAllocatorPag
 }
 
 
+std::unique_lock<std::mutex> DescriptorAllocator::LockAllocationMutex()
+{
+    std::unique_lock<std::mutex> lock( m_AllocationMutex, std::try_to_lock );
+    if ( !lock.owns_lock() )
+    {
+        lock.lock();
+        ++m_NumContendedLocks;
+    }
+    ++m_NumLocks;
+
+    return lock;
+}
+
+DescriptorAllocator::Magazine& DescriptorAllocator::GetThreadMagazine()
+{
+    struct ThreadMagazine
+    {
+        ThreadMagazine( uint64_t allocatorID, std::shared_ptr<Magazine> magazine )
+        : AllocatorID( allocatorID )
+        , Cache( std::move( magazine ) )
+        {}
+
+        ThreadMagazine( ThreadMagazine&& ) = default;
+        ThreadMagazine& operator=( ThreadMagazine&& ) = default;
+
+        // Return the cached descriptors when the thread exits.
+        ~ThreadMagazine()
+        {
+            if ( Cache )
+            {
+                std::lock_guard<std::mutex> lock( Cache->Mutex );
+                Cache->Drain();
+                Cache->IsThreadExited = true;
+            }
+        }
+
+        uint64_t                  AllocatorID;
+        std::shared_ptr<Magazine> Cache;
+    };
+
+    // Each thread has one magazine for every allocator it has allocated from.
+    // There are only a few allocators per device so a linear search is fine.
+    static thread_local std::vector<ThreadMagazine> t_Magazines;
+
+    for ( auto& threadMagazine: t_Magazines )
+    {
+        if ( threadMagazine.AllocatorID == m_AllocatorID )
+        {
+            return *threadMagazine.Cache;
+        }
+    }
+
+    // Remove the magazines of allocators that have been destroyed.
+    t_Magazines.erase( std::remove_if( t_Magazines.begin(), t_Magazines.end(),
+                                       []( const ThreadMagazine& m ) {
+                                           return m.Cache->IsOrphaned.load( std::memory_order_acquire );
+                                       } ),
+                       t_Magazines.end() );
+
+    auto magazine = std::make_shared<Magazine>();
+    {
+        auto lock = LockAllocationMutex();
+        // Forget the magazines of threads that have exited, but keep their counters.
+        m_Magazines.erase( std::remove_if( m_Magazines.begin(), m_Magazines.end(),
+                                           [this]( const std::shared_ptr<Magazine>& m ) {
+                                               if ( !m->IsThreadExited )
+                                               {
+                                                   return false;
+                                               }
+                                               m_NumRetiredAllocations += m->NumAllocations;
+                                               m_NumRetiredMagazineHits += m->NumHits;
+                                               return true;
+                                           } ),
+                           m_Magazines.end() );
+        m_Magazines.push_back( magazine );
+    }
+    t_Magazines.emplace_back( m_AllocatorID, magazine );
+
+    return *magazine;
+}
+
 /*
  * The Allocate method allocates a contiguous block of descriptors from a descriptor heap.
- * It iterates through the available pages and tries to allocate the requested number of
- * descriptors until a page is able to satisfy the requested allocation.
- * If there is no page to satisfy the request, a new page is created.
+ * Single descriptors are taken from the calling thread's magazine without taking a lock. If the
+ * magazine is empty, it is refilled with MagazineSize descriptors from the shared pages.
  */
 DescriptorAllocation DescriptorAllocator::Allocate( uint32_t numDescriptors )
 {
-    std::lock_guard<std::mutex> lock( m_AllocationMutex );//Ensure current thread has exclusive access to allocator
+    if ( numDescriptors == 1 )
+    {
+        Magazine& magazine = GetThreadMagazine();
+
+        // The counters only have one writer, so they are incremented without a read-modify-write.
+        magazine.NumAllocations.store( magazine.NumAllocations.load( std::memory_order_relaxed ) + 1,
+                                       std::memory_order_relaxed );
+
+        // Only the owning thread takes descriptors from its magazine. The allocator only drains it in
+        // its destructor, when no thread may allocate from it anymore, so a filled magazine needs no lock.
+        if ( magazine.Count > 0 )
+        {
+            magazine.NumHits.store( magazine.NumHits.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+            return std::move( magazine.Descriptors[--magazine.Count] );
+        }
+
+        std::lock_guard<std::mutex> magazineLock( magazine.Mutex );
+        auto                        lock = LockAllocationMutex();
+
+        AllocateSinglesFromPages( magazine.Descriptors, MagazineSize );
+        // The descriptors are taken from the back, reverse them so that they are handed out in
+        // the order they were allocated.
+        std::reverse( magazine.Descriptors, magazine.Descriptors + MagazineSize );
+        magazine.Count = MagazineSize;
+
+        ++m_NumMagazineRefills;
+
+        return std::move( magazine.Descriptors[--magazine.Count] );
+    }
+
+    auto lock = LockAllocationMutex();
 
+    ++m_NumRangeAllocations;
+
+    return AllocateFromPages( numDescriptors );
+}
+
+/*
+ * Iterates through the available pages and tries to allocate the requested number of
+ * descriptors until a page is able to satisfy the requested allocation.
+ * If there is no page to satisfy the request, a new page is created.
+ */
+DescriptorAllocation DescriptorAllocator::AllocateFromPages( uint32_t numDescriptors )
+{
     DescriptorAllocation allocation;
     // Iterate until available page is found to store the allocation
     auto iter = m_AvailableHeaps.begin();
@@ -72,6 +219,24 @@ DescriptorAllocation DescriptorAllocator::Allocate( uint32_t numDescriptors )
         }
     }
 
+    // Before growing the pool, reclaim the stale descriptors that the GPU is done with
+    // and try again.
+    if ( allocation.IsNull() && ReleaseCompletedDescriptors() > 0 )
+    {
+        for ( auto iter = m_AvailableHeaps.begin(); iter != m_AvailableHeaps.end(); ++iter )
+        {
+            allocation = m_HeapPool[*iter]->Allocate( numDescriptors );
+            if ( !allocation.IsNull() )
+            {
+                if ( m_HeapPool[*iter]->NumFreeHandles() == 0 )
+                {
+                    m_AvailableHeaps.erase( iter );
+                }
+                break;
+            }
+        }
+    }
+
     // If there is no available pages to satisfy the request, create a new page.
     if ( allocation.IsNull() )
     {
@@ -85,24 +250,101 @@ DescriptorAllocation DescriptorAllocator::Allocate( uint32_t numDescriptors )
 }
 
 
+void DescriptorAllocator::AllocateSinglesFromPages( DescriptorAllocation* descriptors, uint32_t numDescriptors )
+{
+    uint32_t numAllocated = 0;
+
+    auto allocateFromAvailablePages = [&]() {
+        auto iter = m_AvailableHeaps.begin();
+        while ( numAllocated < numDescriptors && iter != m_AvailableHeaps.end() )
+        {
+            auto& allocatorPage = m_HeapPool[*iter];
+
+            numAllocated +=
+                allocatorPage->AllocateSingles( descriptors + numAllocated, numDescriptors - numAllocated );
+
+            if ( allocatorPage->NumFreeHandles() == 0 )
+            {
+                iter = m_AvailableHeaps.erase( iter );
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    };
+
+    allocateFromAvailablePages();
+
+    // Before growing the pool, reclaim the stale descriptors that the GPU is done with
+    // and try again.
+    if ( numAllocated < numDescriptors && ReleaseCompletedDescriptors() > 0 )
+    {
+        allocateFromAvailablePages();
+    }
+
+    while ( numAllocated < numDescriptors )
+    {
+        CreateAllocatorPage();
+        allocateFromAvailablePages();
+    }
+}
+
 /*
  * This method iterates over all of the descriptor heap pages and calls
- * the page's ReleaseStaleDescriptors method. If after releasing the page
- * has free handles it is added to the list of available pages.
+ * the page's ReleaseStaleDescriptors method. Only the descriptors whose fences
+ * have been reached are released so it is safe to call this method at any time.
  */
 void DescriptorAllocator::ReleaseStaleDescriptors()
 {
-    std::lock_guard<std::mutex> lock( m_AllocationMutex );
+    auto lock = LockAllocationMutex();
 
+    ReleaseCompletedDescriptors();
+}
+
+uint32_t DescriptorAllocator::ReleaseCompletedDescriptors()
+{
+    // Query the fences once for all pages.
+    auto completedFenceValues = DescriptorAllocatorPage::GetCompletedFenceValues( m_Device );
+
+    uint32_t numReleased = 0;
     for ( size_t i = 0; i < m_HeapPool.size(); ++i )
     {
-        auto page = m_HeapPool[i];
+        auto& page = m_HeapPool[i];
 
-        page->ReleaseStaleDescriptors();
+        numReleased += page->ReleaseStaleDescriptors( completedFenceValues );
 
+        // If after releasing the page has free handles it is added to the list of available pages.
         if ( page->NumFreeHandles() > 0 )
         {
             m_AvailableHeaps.insert( i );
         }
     }
+
+    m_NumReleasedDescriptors += numReleased;
+
+    return numReleased;
+}
+
+DescriptorAllocator::Statistics DescriptorAllocator::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock( m_AllocationMutex );
+
+    Statistics statistics;
+
+    statistics.NumAllocations         = m_NumRetiredAllocations + m_NumRangeAllocations;
+    statistics.NumMagazineHits        = m_NumRetiredMagazineHits;
+    statistics.NumMagazineRefills     = m_NumMagazineRefills;
+    statistics.NumLocks               = m_NumLocks;
+    statistics.NumContendedLocks      = m_NumContendedLocks;
+    statistics.NumReleasedDescriptors = m_NumReleasedDescriptors;
+
+    // Sum the counters of the magazines. They are only written by their threads.
+    for ( auto& magazine: m_Magazines )
+    {
+        statistics.NumAllocations += magazine->NumAllocations.load( std::memory_order_relaxed );
+        statistics.NumMagazineHits += magazine->NumHits.load( std::memory_order_relaxed );
+    }
+
+    return statistics;
 }
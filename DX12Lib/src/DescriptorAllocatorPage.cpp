@@ -6,9 +6,12 @@
 
 using namespace DX12_Library;
 
+std::atomic_uint64_t DescriptorAllocatorPage::ms_ReleaseGeneration( 0 );
+
 DescriptorAllocatorPage::DescriptorAllocatorPage( Device& device, D3D12_DESCRIPTOR_HEAP_TYPE type,
                                                   uint32_t numDescriptors )
 : m_Device( device )
+, m_FreeList( numDescriptors )
 , m_HeapType( type )
 , m_NumDescriptorsInHeap( numDescriptors )
 {
@@ -22,10 +25,25 @@ DescriptorAllocatorPage::DescriptorAllocatorPage( Device& device, D3D12_DESCRIPT
 
     m_BaseDescriptor                = m_d3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
     m_DescriptorHandleIncrementSize = d3d12Device->GetDescriptorHandleIncrementSize( m_HeapType );
-    m_NumFreeHandles                = m_NumDescriptorsInHeap;
+}
 
-    // Initialize the free lists
-    AddNewBlock( 0, m_NumFreeHandles );
+DescriptorAllocatorPage::QueueFenceValues DescriptorAllocatorPage::GetSignaledFenceValues( Device& device )
+{
+    return { device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT ).GetFenceValue(),
+             device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE ).GetFenceValue(),
+             device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COPY ).GetFenceValue() };
+}
+
+DescriptorAllocatorPage::QueueFenceValues DescriptorAllocatorPage::GetCompletedFenceValues( Device& device )
+{
+    return { device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT ).GetCompletedFenceValue(),
+             device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE ).GetCompletedFenceValue(),
+             device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COPY ).GetCompletedFenceValue() };
+}
+
+uint64_t DescriptorAllocatorPage::GetReleaseGeneration()
+{
+    return ms_ReleaseGeneration.load();
 }
 
 D3D12_DESCRIPTOR_HEAP_TYPE DescriptorAllocatorPage::GetHeapType() const
@@ -35,70 +53,69 @@ D3D12_DESCRIPTOR_HEAP_TYPE DescriptorAllocatorPage::GetHeapType() const
 
 uint32_t DescriptorAllocatorPage::NumFreeHandles() const
 {
-    return m_NumFreeHandles;
+    return m_FreeList.NumFreeHandles();
 }
 
 bool DescriptorAllocatorPage::HasSpace( uint32_t numDescriptors ) const
 {
-    return m_FreeListBySize.lower_bound( numDescriptors ) != m_FreeListBySize.end();
-}
-
-void DescriptorAllocatorPage::AddNewBlock( uint32_t offset, uint32_t numDescriptors )
-{
-    auto offsetIt                           = m_FreeListByOffset.emplace( offset, numDescriptors );
-    auto sizeIt                             = m_FreeListBySize.emplace( numDescriptors, offsetIt.first );
-    offsetIt.first->second.FreeListBySizeIt = sizeIt;
+    return m_FreeList.HasSpace( numDescriptors );
 }
 
 DX12_Library::DescriptorAllocation DescriptorAllocatorPage::Allocate( uint32_t numDescriptors )
 {
     std::lock_guard<std::mutex> lock( m_AllocationMutex );
 
-    // There are less than the requested number of descriptors left in the heap.
-    // Return a NULL descriptor and try another heap.
-    if ( numDescriptors > m_NumFreeHandles )
-    {
-        return DX12_Library::DescriptorAllocation();
-    }
-
     // Get the first block that is large enough to satisfy the request.
-    auto smallestBlockIt = m_FreeListBySize.lower_bound( numDescriptors );
-    if ( smallestBlockIt == m_FreeListBySize.end() )
+    // The free list splits the block and returns the left-over to the free list.
+    auto offset = m_FreeList.Allocate( numDescriptors );
+    if ( offset == DescriptorFreeList::InvalidOffset )
     {
         // There was no free block that could satisfy the request.
+        // Return a NULL descriptor and try another heap.
         return DX12_Library::DescriptorAllocation();
     }
 
-    // The size of the smallest block that satisfies the request.
-    auto blockSize = smallestBlockIt->first;
-
-    // The pointer to the same entry in the FreeListByOffset map.
-    auto offsetIt = smallestBlockIt->second;
-
-    // The offset in the descriptor heap.
-    auto offset = offsetIt->first;
+    return DescriptorAllocation(
+        CD3DX12_CPU_DESCRIPTOR_HANDLE( m_BaseDescriptor, offset, m_DescriptorHandleIncrementSize ), numDescriptors,
+        m_DescriptorHandleIncrementSize, shared_from_this() );
+}
 
-    // Remove the existing free block from the free list.
-    m_FreeListBySize.erase( smallestBlockIt );
-    m_FreeListByOffset.erase( offsetIt );
+uint32_t DescriptorAllocatorPage::AllocateSingles( DescriptorAllocation* descriptors, uint32_t numDescriptors )
+{
+    std::lock_guard<std::mutex> lock( m_AllocationMutex );
 
-    // Compute the new free block that results from splitting this block.
-    auto newOffset = offset + numDescriptors;
-    auto newSize   = blockSize - numDescriptors;
+    auto self = shared_from_this();
 
-    if ( newSize > 0 )
+    // Prefer one contiguous block, it is split into single descriptors that are freed individually.
+    auto offset = m_FreeList.Allocate( numDescriptors );
+    if ( offset != DescriptorFreeList::InvalidOffset )
     {
-        // If the allocation didn't exactly match the requested size,
-        // return the left-over to the free list.
-        AddNewBlock( newOffset, newSize );
+        for ( uint32_t i = 0; i < numDescriptors; ++i )
+        {
+            descriptors[i] = DescriptorAllocation(
+                CD3DX12_CPU_DESCRIPTOR_HANDLE( m_BaseDescriptor, offset + i, m_DescriptorHandleIncrementSize ), 1,
+                m_DescriptorHandleIncrementSize, self );
+        }
+
+        return numDescriptors;
     }
 
-    // Decrement free handles.
-    m_NumFreeHandles -= numDescriptors;
+    // The heap is fragmented, take the descriptors one at a time.
+    uint32_t numAllocated = 0;
+    while ( numAllocated < numDescriptors )
+    {
+        offset = m_FreeList.Allocate( 1 );
+        if ( offset == DescriptorFreeList::InvalidOffset )
+        {
+            break;
+        }
+
+        descriptors[numAllocated++] = DescriptorAllocation(
+            CD3DX12_CPU_DESCRIPTOR_HANDLE( m_BaseDescriptor, offset, m_DescriptorHandleIncrementSize ), 1,
+            m_DescriptorHandleIncrementSize, self );
+    }
 
-    return DescriptorAllocation(
-        CD3DX12_CPU_DESCRIPTOR_HANDLE( m_BaseDescriptor, offset, m_DescriptorHandleIncrementSize ), numDescriptors,
-        m_DescriptorHandleIncrementSize, shared_from_this() );
+    return numAllocated;
 }
 
 uint32_t DescriptorAllocatorPage::ComputeOffset( D3D12_CPU_DESCRIPTOR_HANDLE handle )
@@ -112,89 +129,61 @@ void DescriptorAllocatorPage::Free( DescriptorAllocation&& descriptor )
     auto offset = ComputeOffset( descriptor.GetDescriptorHandle() );
 
     std::lock_guard<std::mutex> lock( m_AllocationMutex );
-    // Don't add the block directly to the free list until the frame has completed.
-    m_StaleDescriptors.emplace( offset, descriptor.GetNumHandles() );
+    // Don't add the block directly to the free list until the GPU is done with it.
+    // The fence values are read while holding the lock so that the stale queue stays sorted.
+    m_StaleDescriptors.emplace( offset, descriptor.GetNumHandles(), GetSignaledFenceValues( m_Device ) );
 }
 
 void DescriptorAllocatorPage::FreeBlock( uint32_t offset, uint32_t numDescriptors )
 {
-    // Find the first element whose offset is greater than the specified offset.
-    // This is the block that should appear after the block that is being freed.
-    auto nextBlockIt = m_FreeListByOffset.upper_bound( offset );
-
-    // Find the block that appears before the block being freed.
-    auto prevBlockIt = nextBlockIt;
-    // If it's not the first block in the list.
-    if ( prevBlockIt != m_FreeListByOffset.begin() )
-    {
-        // Go to the previous block in the list.
-        --prevBlockIt;
-    }
-    else
-    {
-        // Otherwise, just set it to the end of the list to indicate that no
-        // block comes before the one being freed.
-        prevBlockIt = m_FreeListByOffset.end();
-    }
-
-    // Add the number of free handles back to the heap.
-    // This needs to be done before merging any blocks since merging
-    // blocks modifies the numDescriptors variable.
-    m_NumFreeHandles += numDescriptors;
-
-    if ( prevBlockIt != m_FreeListByOffset.end() && offset == prevBlockIt->first + prevBlockIt->second.Size )
-    {
-        // The previous block is exactly behind the block that is to be freed.
-        //
-        // PrevBlock.Offset           Offset
-        // |                          |
-        // |<-----PrevBlock.Size----->|<------Size-------->|
-        //
-
-        // Increase the block size by the size of merging with the previous block.
-        offset = prevBlockIt->first;
-        numDescriptors += prevBlockIt->second.Size;
-
-        // Remove the previous block from the free list.
-        m_FreeListBySize.erase( prevBlockIt->second.FreeListBySizeIt );
-        m_FreeListByOffset.erase( prevBlockIt );
-    }
-
-    if ( nextBlockIt != m_FreeListByOffset.end() && offset + numDescriptors == nextBlockIt->first )
-    {
-        // The next block is exactly in front of the block that is to be freed.
-        //
-        // Offset               NextBlock.Offset
-        // |                    |
-        // |<------Size-------->|<-----NextBlock.Size----->|
-
-        // Increase the block size by the size of merging with the next block.
-        numDescriptors += nextBlockIt->second.Size;
-
-        // Remove the next block from the free list.
-        m_FreeListBySize.erase( nextBlockIt->second.FreeListBySizeIt );
-        m_FreeListByOffset.erase( nextBlockIt );
-    }
-
-    // Add the freed block to the free list.
-    AddNewBlock( offset, numDescriptors );
+    // The free list merges the block with the adjacent free blocks (if any).
+    m_FreeList.Free( offset, numDescriptors );
 }
 
-void DescriptorAllocatorPage::ReleaseStaleDescriptors()
+uint32_t DescriptorAllocatorPage::ReleaseStaleDescriptors( const QueueFenceValues& completedFenceValues )
 {
     std::lock_guard<std::mutex> lock( m_AllocationMutex );
 
+    // Stop at the first stale descriptor that may still be in use.
+    // All descriptors after it were freed later so they can't be released either.
     while ( !m_StaleDescriptors.empty() )
     {
         auto& staleDescriptor = m_StaleDescriptors.front();
 
-        // The offset of the descriptor in the heap.
-        auto offset = staleDescriptor.Offset;
-        // The number of descriptors that were allocated.
-        auto numDescriptors = staleDescriptor.Size;
+        bool isComplete = true;
+        for ( size_t i = 0; i < completedFenceValues.size(); ++i )
+        {
+            isComplete = isComplete && staleDescriptor.FenceValues[i] <= completedFenceValues[i];
+        }
 
-        FreeBlock( offset, numDescriptors );
+        if ( !isComplete )
+        {
+            break;
+        }
 
+        m_ReleaseBatch.push_back( staleDescriptor );
         m_StaleDescriptors.pop();
     }
-}
\ No newline at end of file
+
+    // Free the blocks in order of their offset so that neighbouring blocks
+    // are merged while walking through the heap once.
+    std::sort( m_ReleaseBatch.begin(), m_ReleaseBatch.end(),
+               []( const StaleDescriptorInfo& a, const StaleDescriptorInfo& b ) { return a.Offset < b.Offset; } );
+
+    uint32_t numReleased = 0;
+    for ( auto& staleDescriptor: m_ReleaseBatch )
+    {
+        FreeBlock( staleDescriptor.Offset, staleDescriptor.Size );
+        numReleased += staleDescriptor.Size;
+    }
+
+    if ( !m_ReleaseBatch.empty() )
+    {
+        // The released descriptors can be reallocated and rewritten from now on.
+        ++ms_ReleaseGeneration;
+    }
+
+    m_ReleaseBatch.clear();
+
+    return numReleased;
+}
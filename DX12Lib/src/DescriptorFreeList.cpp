@@ -0,0 +1,287 @@
+#include <dx12lib/DescriptorFreeList.h>
+
+#include <algorithm>
+#include <cassert>
+
+#if defined( _MSC_VER )
+    #include <intrin.h>
+#endif
+
+using namespace DX12_Library;
+
+namespace
+{
+// Index of the least significant set bit. mask must be non-zero.
+inline uint32_t FindFirstSet( uint32_t mask )
+{
+#if defined( _MSC_VER )
+    unsigned long index;
+    _BitScanForward( &index, mask );
+    return static_cast<uint32_t>( index );
+#else
+    return static_cast<uint32_t>( __builtin_ctz( mask ) );
+#endif
+}
+
+// Index of the most significant set bit. mask must be non-zero.
+inline uint32_t FindLastSet( uint32_t mask )
+{
+#if defined( _MSC_VER )
+    unsigned long index;
+    _BitScanReverse( &index, mask );
+    return static_cast<uint32_t>( index );
+#else
+    return static_cast<uint32_t>( 31 - __builtin_clz( mask ) );
+#endif
+}
+}  // namespace
+
+// The constant is passed by reference to the std::vector constructors, so it needs a definition.
+const uint32_t DescriptorFreeList::InvalidOffset;
+
+DescriptorFreeList::DescriptorFreeList( uint32_t capacity )
+: m_Capacity( capacity )
+, m_NumFreeHandles( 0 )
+, m_FLBitmap( 0 )
+, m_SLBitmap {}
+, m_Blocks( capacity, Block { 0, InvalidOffset, InvalidOffset, false } )
+, m_BlockStart( capacity, InvalidOffset )
+{
+    for ( auto& flHeads: m_BinHeads )
+    {
+        for ( auto& head: flHeads )
+        {
+            head = InvalidOffset;
+        }
+    }
+
+    if ( m_Capacity > 0 )
+    {
+        InsertFreeBlock( 0, m_Capacity );
+        m_NumFreeHandles = m_Capacity;
+    }
+}
+
+void DescriptorFreeList::MappingInsert( uint32_t size, uint32_t& fl, uint32_t& sl )
+{
+    if ( size < SLCount )
+    {
+        fl = 0;
+        sl = size;
+    }
+    else
+    {
+        uint32_t log2 = FindLastSet( size );
+        sl            = ( size >> ( log2 - SLIndexLog2 ) ) ^ SLCount;
+        fl            = log2 - SLIndexLog2 + 1;
+    }
+}
+
+void DescriptorFreeList::MappingSearch( uint32_t size, uint32_t& fl, uint32_t& sl )
+{
+    if ( size >= SLCount )
+    {
+        // Round up to the next bin so that every block in the bin is large enough.
+        uint64_t rounded = static_cast<uint64_t>( size ) + ( 1ull << ( FindLastSet( size ) - SLIndexLog2 ) ) - 1;
+        size             = static_cast<uint32_t>( std::min<uint64_t>( rounded, 0xffffffffull ) );
+    }
+
+    MappingInsert( size, fl, sl );
+}
+
+bool DescriptorFreeList::FindSuitableBin( uint32_t& fl, uint32_t& sl ) const
+{
+    if ( fl >= FLCount )
+    {
+        return false;
+    }
+
+    // Look for a non-empty bin in the same first level bin.
+    uint32_t slMap = sl < SLCount ? m_SLBitmap[fl] & ( ~0u << sl ) : 0;
+    if ( !slMap )
+    {
+        // Otherwise, look in the next larger first level bin.
+        uint32_t flMap = fl + 1 < 32 ? m_FLBitmap & ( ~0u << ( fl + 1 ) ) : 0;
+        if ( !flMap )
+        {
+            return false;
+        }
+
+        fl    = FindFirstSet( flMap );
+        slMap = m_SLBitmap[fl];
+    }
+
+    sl = FindFirstSet( slMap );
+
+    return true;
+}
+
+uint32_t DescriptorFreeList::FindInExactBin( uint32_t size ) const
+{
+    uint32_t fl, sl;
+    MappingInsert( size, fl, sl );
+
+    for ( uint32_t offset = m_BinHeads[fl][sl]; offset != InvalidOffset; offset = m_Blocks[offset].NextFree )
+    {
+        if ( m_Blocks[offset].Size >= size )
+        {
+            return offset;
+        }
+    }
+
+    return InvalidOffset;
+}
+
+bool DescriptorFreeList::HasSpace( uint32_t numDescriptors ) const
+{
+    if ( numDescriptors == 0 || numDescriptors > m_NumFreeHandles )
+    {
+        return false;
+    }
+
+    uint32_t fl, sl;
+    MappingSearch( numDescriptors, fl, sl );
+
+    return FindSuitableBin( fl, sl ) || FindInExactBin( numDescriptors ) != InvalidOffset;
+}
+
+uint32_t DescriptorFreeList::Allocate( uint32_t numDescriptors )
+{
+    if ( numDescriptors == 0 || numDescriptors > m_NumFreeHandles )
+    {
+        return InvalidOffset;
+    }
+
+    uint32_t offset;
+
+    uint32_t fl, sl;
+    MappingSearch( numDescriptors, fl, sl );
+
+    if ( FindSuitableBin( fl, sl ) )
+    {
+        offset = m_BinHeads[fl][sl];
+    }
+    else
+    {
+        // Rounding up the search may skip a block that is exactly large enough
+        // (for example, when the whole page is requested).
+        offset = FindInExactBin( numDescriptors );
+        if ( offset == InvalidOffset )
+        {
+            return InvalidOffset;
+        }
+    }
+
+    uint32_t blockSize = m_Blocks[offset].Size;
+
+    assert( blockSize >= numDescriptors );
+
+    RemoveFreeBlock( offset );
+
+    // Return the left-over to the free list.
+    if ( blockSize > numDescriptors )
+    {
+        InsertFreeBlock( offset + numDescriptors, blockSize - numDescriptors );
+    }
+
+    m_NumFreeHandles -= numDescriptors;
+
+    return offset;
+}
+
+void DescriptorFreeList::Free( uint32_t offset, uint32_t numDescriptors )
+{
+    assert( numDescriptors > 0 && offset + numDescriptors <= m_Capacity );
+
+    // This needs to be done before merging any blocks since merging
+    // blocks modifies the numDescriptors variable.
+    m_NumFreeHandles += numDescriptors;
+
+    // Merge with the previous block if it is free and ends exactly where this block begins.
+    if ( offset > 0 )
+    {
+        uint32_t prevOffset = m_BlockStart[offset - 1];
+        if ( prevOffset != InvalidOffset && m_Blocks[prevOffset].IsFree &&
+             prevOffset + m_Blocks[prevOffset].Size == offset )
+        {
+            numDescriptors += m_Blocks[prevOffset].Size;
+            offset = prevOffset;
+
+            RemoveFreeBlock( prevOffset );
+        }
+    }
+
+    // Merge with the next block if it is free.
+    uint32_t nextOffset = offset + numDescriptors;
+    if ( nextOffset < m_Capacity && m_Blocks[nextOffset].IsFree )
+    {
+        numDescriptors += m_Blocks[nextOffset].Size;
+
+        RemoveFreeBlock( nextOffset );
+    }
+
+    InsertFreeBlock( offset, numDescriptors );
+}
+
+void DescriptorFreeList::InsertFreeBlock( uint32_t offset, uint32_t size )
+{
+    uint32_t fl, sl;
+    MappingInsert( size, fl, sl );
+
+    uint32_t head = m_BinHeads[fl][sl];
+
+    auto& block    = m_Blocks[offset];
+    block.Size     = size;
+    block.PrevFree = InvalidOffset;
+    block.NextFree = head;
+    block.IsFree   = true;
+
+    if ( head != InvalidOffset )
+    {
+        m_Blocks[head].PrevFree = offset;
+    }
+
+    m_BinHeads[fl][sl] = offset;
+    m_BlockStart[offset + size - 1] = offset;
+
+    m_FLBitmap |= 1u << fl;
+    m_SLBitmap[fl] |= 1u << sl;
+}
+
+void DescriptorFreeList::RemoveFreeBlock( uint32_t offset )
+{
+    auto& block = m_Blocks[offset];
+    assert( block.IsFree );
+
+    uint32_t fl, sl;
+    MappingInsert( block.Size, fl, sl );
+
+    if ( block.PrevFree != InvalidOffset )
+    {
+        m_Blocks[block.PrevFree].NextFree = block.NextFree;
+    }
+    else
+    {
+        m_BinHeads[fl][sl] = block.NextFree;
+    }
+
+    if ( block.NextFree != InvalidOffset )
+    {
+        m_Blocks[block.NextFree].PrevFree = block.PrevFree;
+    }
+
+    if ( m_BinHeads[fl][sl] == InvalidOffset )
+    {
+        m_SLBitmap[fl] &= ~( 1u << sl );
+        if ( !m_SLBitmap[fl] )
+        {
+            m_FLBitmap &= ~( 1u << fl );
+        }
+    }
+
+    m_BlockStart[offset + block.Size - 1] = InvalidOffset;
+
+    block.IsFree   = false;
+    block.PrevFree = InvalidOffset;
+    block.NextFree = InvalidOffset;
+}
@@ -9,16 +9,23 @@
 #include <dx12lib/DescriptorAllocator.h>
 #include <dx12lib/Device.h>
 #include <dx12lib/GUI.h>
+#include <dx12lib/GpuProfiler.h>
 #include <dx12lib/IndexBuffer.h>
+#include <dx12lib/MipGenerator.h>
+#include <dx12lib/ParallelCommandRecorder.h>
 #include <dx12lib/PipelineStateObject.h>
+#include <dx12lib/RenderGraph.h>
 #include <dx12lib/ResourceStateTracker.h>
 #include <dx12lib/RootSignature.h>
 #include <dx12lib/Scene.h>
 #include <dx12lib/ShaderResourceView.h>
+#include <dx12lib/StaticBufferAllocator.h>
 #include <dx12lib/StructuredBuffer.h>
 #include <dx12lib/SwapChain.h>
 #include <dx12lib/Texture.h>
+#include <dx12lib/TransientTextureAllocator.h>
 #include <dx12lib/UnorderedAccessView.h>
+#include <dx12lib/UploadManager.h>
 #include <dx12lib/VertexBuffer.h>
 
 using namespace DX12_Library;
@@ -101,6 +108,46 @@ public:
     virtual ~MakeTexture() {}
 };
 
+class MakeTransientTextureAllocator : public TransientTextureAllocator
+{
+public:
+    MakeTransientTextureAllocator( Device& device, size_t heapSize )
+    : TransientTextureAllocator( device, heapSize )
+    {}
+
+    virtual ~MakeTransientTextureAllocator() {}
+};
+
+class MakeParallelCommandRecorder : public ParallelCommandRecorder
+{
+public:
+    MakeParallelCommandRecorder( Device& device, uint32_t numThreads )
+    : ParallelCommandRecorder( device, numThreads )
+    {}
+
+    virtual ~MakeParallelCommandRecorder() {}
+};
+
+class MakeGpuProfiler : public GpuProfiler
+{
+public:
+    MakeGpuProfiler( Device& device, D3D12_COMMAND_LIST_TYPE type, uint32_t numFrames, uint32_t maxScopesPerFrame )
+    : GpuProfiler( device, type, numFrames, maxScopesPerFrame )
+    {}
+
+    virtual ~MakeGpuProfiler() {}
+};
+
+class MakeRenderGraph : public RenderGraph
+{
+public:
+    MakeRenderGraph( Device& device, TransientTextureAllocator& transientTextureAllocator )
+    : RenderGraph( device, transientTextureAllocator )
+    {}
+
+    virtual ~MakeRenderGraph() {}
+};
+
 class MakeStructuredBuffer : public StructuredBuffer
 {
 public:
@@ -126,6 +173,11 @@ public:
     : VertexBuffer( device, resource, numVertices, vertexStride )
     {}
 
+    MakeVertexBuffer( Device& device, const StaticBufferAllocator::Allocation& allocation, size_t numVertices,
+                      size_t vertexStride )
+    : VertexBuffer( device, allocation, numVertices, vertexStride )
+    {}
+
     virtual ~MakeVertexBuffer() {}
 };
 
@@ -141,6 +193,11 @@ public:
     : IndexBuffer( device, resource, numIndicies, indexFormat )
     {}
 
+    MakeIndexBuffer( Device& device, const StaticBufferAllocator::Allocation& allocation, size_t numIndicies,
+                     DXGI_FORMAT indexFormat )
+    : IndexBuffer( device, allocation, numIndicies, indexFormat )
+    {}
+
     virtual ~MakeIndexBuffer() {}
 };
 
@@ -178,6 +235,16 @@ public:
     virtual ~MakeDescriptorAllocator() {}
 };
 
+class MakeBindlessDescriptorHeap : public BindlessDescriptorHeap
+{
+public:
+    MakeBindlessDescriptorHeap( Device& device, uint32_t numDescriptors = DefaultNumDescriptors )
+    : BindlessDescriptorHeap( device, numDescriptors )
+    {}
+
+    virtual ~MakeBindlessDescriptorHeap() {}
+};
+
 class MakeSwapChain : public SwapChain
 {
 public:
@@ -188,6 +255,36 @@ public:
     virtual ~MakeSwapChain() {}
 };
 
+class MakeUploadManager : public UploadManager
+{
+public:
+    MakeUploadManager( Device& device )
+    : UploadManager( device )
+    {}
+
+    virtual ~MakeUploadManager() {}
+};
+
+class MakeMipGenerator : public MipGenerator
+{
+public:
+    MakeMipGenerator( Device& device )
+    : MipGenerator( device )
+    {}
+
+    virtual ~MakeMipGenerator() {}
+};
+
+class MakeStaticBufferAllocator : public StaticBufferAllocator
+{
+public:
+    MakeStaticBufferAllocator( Device& device )
+    : StaticBufferAllocator( device )
+    {}
+
+    virtual ~MakeStaticBufferAllocator() {}
+};
+
 class MakeCommandQueue : public CommandQueue
 {
 public:
@@ -201,8 +298,8 @@ public:
 class MakeDevice : public Device
 {
 public:
-    MakeDevice( std::shared_ptr<Adapter> adapter )
-    : Device( adapter )
+    MakeDevice( std::shared_ptr<Adapter> adapter, bool enableBindless )
+    : Device( adapter, enableBindless )
     {}
 
     virtual ~MakeDevice() {}
@@ -226,9 +323,9 @@ void Device::ReportLiveObjects()
     dxgiDebug->Release();
 }
 
-std::shared_ptr<Device> Device::Create( std::shared_ptr<Adapter> adapter )
+std::shared_ptr<Device> Device::Create( std::shared_ptr<Adapter> adapter, bool enableBindless )
 {
-    return std::make_shared<MakeDevice>( adapter );
+    return std::make_shared<MakeDevice>( adapter, enableBindless );
 }
 
 std::wstring Device::GetDescription() const
@@ -236,7 +333,7 @@ std::wstring Device::GetDescription() const
     return m_Adapter->GetDescription();
 }
 
-Device::Device( std::shared_ptr<Adapter> adapter )
+Device::Device( std::shared_ptr<Adapter> adapter, bool enableBindless )
 : m_Adapter( adapter )
 {
     if ( !m_Adapter )
@@ -290,6 +387,10 @@ Device::Device( std::shared_ptr<Adapter> adapter )
     m_ComputeCommandQueue = std::make_unique<MakeCommandQueue>( *this, D3D12_COMMAND_LIST_TYPE_COMPUTE );
     m_CopyCommandQueue    = std::make_unique<MakeCommandQueue>( *this, D3D12_COMMAND_LIST_TYPE_COPY );
 
+    m_UploadManager         = std::make_unique<MakeUploadManager>( *this );
+    m_MipGenerator          = std::make_unique<MakeMipGenerator>( *this );
+    m_StaticBufferAllocator = std::make_unique<MakeStaticBufferAllocator>( *this );
+
     // Create descriptor allocators
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
     {
@@ -308,9 +409,34 @@ Device::Device( std::shared_ptr<Adapter> adapter )
         }
         m_HighestRootSignatureVersion = featureData.HighestVersion;
     }
+
+    // Bindless descriptors use unbounded descriptor tables which require resource binding tier 2.
+    if ( enableBindless )
+    {
+        D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+        if ( SUCCEEDED( m_d3d12Device->CheckFeatureSupport( D3D12_FEATURE_D3D12_OPTIONS, &options,
+                                                            sizeof( D3D12_FEATURE_DATA_D3D12_OPTIONS ) ) ) &&
+             options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2 )
+        {
+            m_BindlessDescriptorHeap = std::make_unique<MakeBindlessDescriptorHeap>( *this );
+        }
+    }
 }
 
-Device::~Device() {}
+Device::~Device()
+{
+    // The members are destroyed in reverse order, so these are destroyed before the command queues anyway.
+    m_StaticBufferAllocator.reset();
+    m_MipGenerator.reset();
+    m_UploadManager.reset();
+
+    // Command lists return their blocks of the bindless descriptor heap when they are destroyed, which reads
+    // the fence values of all command queues. So the command lists of all queues are destroyed before any
+    // of the queues is.
+    m_DirectCommandQueue->ReleaseCommandLists();
+    m_ComputeCommandQueue->ReleaseCommandLists();
+    m_CopyCommandQueue->ReleaseCommandLists();
+}
 
 CommandQueue& Device::GetCommandQueue( D3D12_COMMAND_LIST_TYPE type )
 {
@@ -335,6 +461,9 @@ CommandQueue& Device::GetCommandQueue( D3D12_COMMAND_LIST_TYPE type )
 
 void Device::Flush()
 {
+    // The mip generation batch waits for the uploads, so it is submitted first.
+    m_MipGenerator->Flush();
+    m_UploadManager->Flush();
     m_DirectCommandQueue->Flush();
     m_ComputeCommandQueue->Flush();
     m_CopyCommandQueue->Flush();
@@ -345,10 +474,30 @@ DescriptorAllocation Device::AllocateDescriptors( D3D12_DESCRIPTOR_HEAP_TYPE typ
     return m_DescriptorAllocators[type]->Allocate( numDescriptors );
 }
 
+DescriptorAllocator::Statistics Device::GetDescriptorAllocatorStatistics( D3D12_DESCRIPTOR_HEAP_TYPE type ) const
+{
+    return m_DescriptorAllocators[type]->GetStatistics();
+}
+
+UploadRingBuffer::Statistics Device::GetUploadStatistics( D3D12_COMMAND_LIST_TYPE type )
+{
+    return GetCommandQueue( type ).GetUploadRingBuffer().GetStatistics();
+}
+
+ResourceStateTracker::Statistics Device::GetResourceBarrierStatistics() const
+{
+    return ResourceStateTracker::GetFrameStatistics();
+}
+
 void Device::ReleaseStaleDescriptors()
 {
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
     { m_DescriptorAllocators[i]->ReleaseStaleDescriptors(); }
+
+    if ( m_BindlessDescriptorHeap )
+    {
+        m_BindlessDescriptorHeap->ReleaseStaleDescriptors();
+    }
 }
 
 std::shared_ptr<SwapChain> Device::CreateSwapChain( HWND hWnd, DXGI_FORMAT backBufferFormat )
@@ -425,6 +574,15 @@ std::shared_ptr<DX12_Library::IndexBuffer>
     return indexBuffer;
 }
 
+std::shared_ptr<IndexBuffer> Device::CreateIndexBuffer( const StaticBufferAllocator::Allocation& allocation,
+                                                        size_t numIndices, DXGI_FORMAT indexFormat )
+{
+    std::shared_ptr<IndexBuffer> indexBuffer =
+        std::make_shared<MakeIndexBuffer>( *this, allocation, numIndices, indexFormat );
+
+    return indexBuffer;
+}
+
 std::shared_ptr<VertexBuffer> Device::CreateVertexBuffer( size_t numVertices, size_t vertexStride )
 {
     std::shared_ptr<VertexBuffer> vertexBuffer = std::make_shared<MakeVertexBuffer>( *this, numVertices, vertexStride );
@@ -442,6 +600,15 @@ std::shared_ptr<DX12_Library::VertexBuffer>
     return vertexBuffer;
 }
 
+std::shared_ptr<VertexBuffer> Device::CreateVertexBuffer( const StaticBufferAllocator::Allocation& allocation,
+                                                          size_t numVertices, size_t vertexStride )
+{
+    std::shared_ptr<VertexBuffer> vertexBuffer =
+        std::make_shared<MakeVertexBuffer>( *this, allocation, numVertices, vertexStride );
+
+    return vertexBuffer;
+}
+
 std::shared_ptr<Texture> Device::CreateTexture( const D3D12_RESOURCE_DESC& resourceDesc, const D3D12_CLEAR_VALUE* clearValue )
 {
     std::shared_ptr<Texture> texture = std::make_shared<MakeTexture>( *this, resourceDesc, clearValue );
@@ -502,6 +669,38 @@ std::shared_ptr<UnorderedAccessView>
     return unorderedAccessView;
 }
 
+std::shared_ptr<TransientTextureAllocator> Device::CreateTransientTextureAllocator( size_t heapSize )
+{
+    std::shared_ptr<TransientTextureAllocator> transientTextureAllocator =
+        std::make_shared<MakeTransientTextureAllocator>( *this, heapSize );
+
+    return transientTextureAllocator;
+}
+
+std::shared_ptr<ParallelCommandRecorder> Device::CreateParallelCommandRecorder( uint32_t numThreads )
+{
+    std::shared_ptr<ParallelCommandRecorder> parallelCommandRecorder =
+        std::make_shared<MakeParallelCommandRecorder>( *this, numThreads );
+
+    return parallelCommandRecorder;
+}
+
+std::shared_ptr<GpuProfiler> Device::CreateGpuProfiler( D3D12_COMMAND_LIST_TYPE type, uint32_t numFrames,
+                                                        uint32_t maxScopesPerFrame )
+{
+    std::shared_ptr<GpuProfiler> gpuProfiler =
+        std::make_shared<MakeGpuProfiler>( *this, type, numFrames, maxScopesPerFrame );
+
+    return gpuProfiler;
+}
+
+std::shared_ptr<RenderGraph> Device::CreateRenderGraph( TransientTextureAllocator& transientTextureAllocator )
+{
+    std::shared_ptr<RenderGraph> renderGraph = std::make_shared<MakeRenderGraph>( *this, transientTextureAllocator );
+
+    return renderGraph;
+}
+
 DXGI_SAMPLE_DESC Device::GetMultisampleQualityLevels( DXGI_FORMAT format, UINT numSamples,
                                                       D3D12_MULTISAMPLE_QUALITY_LEVEL_FLAGS flags ) const
 {
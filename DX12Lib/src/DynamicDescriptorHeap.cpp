@@ -2,7 +2,9 @@
 
 #include <dx12lib/DynamicDescriptorHeap.h>
 
+#include <dx12lib/BindlessDescriptorHeap.h>
 #include <dx12lib/CommandList.h>
+#include <dx12lib/DescriptorAllocatorPage.h>
 #include <dx12lib/Device.h>
 #include <dx12lib/RootSignature.h>
 
@@ -14,6 +16,7 @@ DynamicDescriptorHeap::DynamicDescriptorHeap( Device& device, D3D12_DESCRIPTOR_H
 : m_Device( device )
 , m_DescriptorHeapType( heapType )
 , m_NumDescriptorsPerHeap( numDescriptorsPerHeap )
+, m_BindlessDescriptorHeap( nullptr )
 , m_DescriptorTableBitMask( 0 )
 , m_StaleDescriptorTableBitMask( 0 )
 , m_StaleCBVBitMask( 0 )
@@ -22,15 +25,43 @@ DynamicDescriptorHeap::DynamicDescriptorHeap( Device& device, D3D12_DESCRIPTOR_H
 , m_CurrentCPUDescriptorHandle( D3D12_DEFAULT )
 , m_CurrentGPUDescriptorHandle( D3D12_DEFAULT )
 , m_NumFreeHandles( 0 )
+, m_NumCachedDescriptorTables( 0 )
+, m_DescriptorTableCacheGeneration( DescriptorAllocatorPage::GetReleaseGeneration() )
+, m_NumTableCacheHits( 0 )
+, m_NumTableCacheMisses( 0 )
 {
     // Query the increment size of the descriptor
     m_DescriptorHandleIncrementSize = m_Device.GetDescriptorHandleIncrementSize( heapType );
 
     // Allocate space for staging CPU visible descriptors.
     m_DescriptorHandleCache = std::make_unique<D3D12_CPU_DESCRIPTOR_HANDLE[]>( m_NumDescriptorsPerHeap );
+
+    // Reserve the descriptor table cache up front, so that it rarely grows while commands are recorded.
+    m_DescriptorTableCacheSlots.resize( 256, CachedDescriptorTable {} );
+    m_CachedSrcDescriptors.reserve( m_NumDescriptorsPerHeap );
+
+    // Only one CBV_SRV_UAV descriptor heap can be bound to the command list so if bindless
+    // descriptors are enabled, the staged descriptors are copied to the bindless descriptor heap.
+    if ( heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV )
+    {
+        m_BindlessDescriptorHeap = m_Device.GetBindlessDescriptorHeap();
+    }
 }
 
-DynamicDescriptorHeap::~DynamicDescriptorHeap() {}
+// Command queues destroy command lists that they don't keep for reuse, so the blocks of the bindless
+// descriptor heap must be returned. The bindless descriptor heap only reuses them once the work that was
+// submitted so far (including the last execution of the command list) is finished.
+DynamicDescriptorHeap::~DynamicDescriptorHeap()
+{
+    if ( m_BindlessDescriptorHeap )
+    {
+        while ( !m_DescriptorHeapPool.empty() )
+        {
+            m_BindlessDescriptorHeap->Free( m_DescriptorHeapPool.front().BindlessIndex, m_NumDescriptorsPerHeap );
+            m_DescriptorHeapPool.pop();
+        }
+    }
+}
 
 // This method is used to configure the layout of the descriptor cache whenever the root
 // signature gets changed.
@@ -139,9 +170,97 @@ uint32_t DynamicDescriptorHeap::ComputeStaleDescriptorCount() const
     return numStaleDescriptors;
 }
 
-Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::RequestDescriptorHeap()
+size_t DynamicDescriptorHeap::HashDescriptorTable( const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptors,
+                                                  uint32_t                           numDescriptors )
 {
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+    size_t seed = numDescriptors;
+    for ( uint32_t i = 0; i < numDescriptors; ++i )
+    {
+        seed ^= std::hash<SIZE_T>()( srcDescriptors[i].ptr ) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
+    }
+
+    return seed;
+}
+
+const DynamicDescriptorHeap::CachedDescriptorTable*
+    DynamicDescriptorHeap::FindCachedDescriptorTable( size_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptors,
+                                                      uint32_t numDescriptors ) const
+{
+    auto mask = static_cast<uint32_t>( m_DescriptorTableCacheSlots.size() - 1 );
+    for ( auto slot = static_cast<uint32_t>( hash ) & mask; m_DescriptorTableCacheSlots[slot].DescriptorHeap;
+          slot = ( slot + 1 ) & mask )
+    {
+        const CachedDescriptorTable& cachedTable = m_DescriptorTableCacheSlots[slot];
+        if ( cachedTable.Hash == hash && cachedTable.DescriptorHeap == m_CurrentDescriptorHeap.Get() &&
+             cachedTable.NumDescriptors == numDescriptors &&
+             std::equal( srcDescriptors, srcDescriptors + numDescriptors,
+                         m_CachedSrcDescriptors.begin() + cachedTable.SrcDescriptorOffset,
+                         []( const D3D12_CPU_DESCRIPTOR_HANDLE& a, const D3D12_CPU_DESCRIPTOR_HANDLE& b ) {
+                             return a.ptr == b.ptr;
+                         } ) )
+        {
+            return &cachedTable;
+        }
+    }
+
+    return nullptr;
+}
+
+void DynamicDescriptorHeap::AddCachedDescriptorTable( size_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptors,
+                                                      uint32_t numDescriptors )
+{
+    // Keep the table at most half full, so that the probe sequences stay short.
+    if ( 2 * ( m_NumCachedDescriptorTables + 1 ) > m_DescriptorTableCacheSlots.size() )
+    {
+        std::vector<CachedDescriptorTable> slots( 2 * m_DescriptorTableCacheSlots.size(), CachedDescriptorTable {} );
+        std::swap( slots, m_DescriptorTableCacheSlots );
+
+        auto mask = static_cast<uint32_t>( m_DescriptorTableCacheSlots.size() - 1 );
+        for ( const auto& cachedTable: slots )
+        {
+            if ( cachedTable.DescriptorHeap )
+            {
+                auto slot = static_cast<uint32_t>( cachedTable.Hash ) & mask;
+                while ( m_DescriptorTableCacheSlots[slot].DescriptorHeap )
+                {
+                    slot = ( slot + 1 ) & mask;
+                }
+                m_DescriptorTableCacheSlots[slot] = cachedTable;
+            }
+        }
+    }
+
+    auto mask = static_cast<uint32_t>( m_DescriptorTableCacheSlots.size() - 1 );
+    auto slot = static_cast<uint32_t>( hash ) & mask;
+    while ( m_DescriptorTableCacheSlots[slot].DescriptorHeap )
+    {
+        slot = ( slot + 1 ) & mask;
+    }
+
+    CachedDescriptorTable& cachedTable = m_DescriptorTableCacheSlots[slot];
+    cachedTable.Hash                   = hash;
+    cachedTable.SrcDescriptorOffset    = static_cast<uint32_t>( m_CachedSrcDescriptors.size() );
+    cachedTable.NumDescriptors         = numDescriptors;
+    cachedTable.DescriptorHeap         = m_CurrentDescriptorHeap.Get();
+    cachedTable.GPUDescriptorHandle    = m_CurrentGPUDescriptorHandle;
+    ++m_NumCachedDescriptorTables;
+
+    m_CachedSrcDescriptors.insert( m_CachedSrcDescriptors.end(), srcDescriptors, srcDescriptors + numDescriptors );
+}
+
+void DynamicDescriptorHeap::ClearDescriptorTableCache()
+{
+    if ( m_NumCachedDescriptorTables > 0 )
+    {
+        std::fill( m_DescriptorTableCacheSlots.begin(), m_DescriptorTableCacheSlots.end(), CachedDescriptorTable {} );
+        m_NumCachedDescriptorTables = 0;
+    }
+    m_CachedSrcDescriptors.clear();
+}
+
+DynamicDescriptorHeap::DescriptorHeapBlock DynamicDescriptorHeap::RequestDescriptorHeap()
+{
+    DescriptorHeapBlock descriptorHeap;
     if ( !m_AvailableDescriptorHeaps.empty() )
     {
         descriptorHeap = m_AvailableDescriptorHeaps.front();
@@ -156,21 +275,56 @@ Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::RequestDescr
     return descriptorHeap;
 }
 
-Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::CreateDescriptorHeap()
+DynamicDescriptorHeap::DescriptorHeapBlock DynamicDescriptorHeap::CreateDescriptorHeap()
 {
-    auto d3d12Device = m_Device.GetD3D12Device();
+    DescriptorHeapBlock descriptorHeap;
+
+    if ( m_BindlessDescriptorHeap )
+    {
+        uint32_t index = m_BindlessDescriptorHeap->Allocate( m_NumDescriptorsPerHeap );
 
-    D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
-    descriptorHeapDesc.Type                       = m_DescriptorHeapType;
-    descriptorHeapDesc.NumDescriptors             = m_NumDescriptorsPerHeap;
-    descriptorHeapDesc.Flags                      = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+        descriptorHeap.DescriptorHeap      = m_BindlessDescriptorHeap->GetD3D12DescriptorHeap();
+        descriptorHeap.CPUDescriptorHandle = m_BindlessDescriptorHeap->GetCPUDescriptorHandle( index );
+        descriptorHeap.GPUDescriptorHandle = m_BindlessDescriptorHeap->GetGPUDescriptorHandle( index );
+        descriptorHeap.BindlessIndex       = index;
+    }
+    else
+    {
+        auto d3d12Device = m_Device.GetD3D12Device();
 
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap;
-    ThrowIfFailed( d3d12Device->CreateDescriptorHeap( &descriptorHeapDesc, IID_PPV_ARGS( &descriptorHeap ) ) );
+        D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
+        descriptorHeapDesc.Type                       = m_DescriptorHeapType;
+        descriptorHeapDesc.NumDescriptors             = m_NumDescriptorsPerHeap;
+        descriptorHeapDesc.Flags                      = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+        ThrowIfFailed(
+            d3d12Device->CreateDescriptorHeap( &descriptorHeapDesc, IID_PPV_ARGS( &descriptorHeap.DescriptorHeap ) ) );
+
+        descriptorHeap.CPUDescriptorHandle = descriptorHeap.DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+        descriptorHeap.GPUDescriptorHandle = descriptorHeap.DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+        descriptorHeap.BindlessIndex       = BindlessDescriptorHeap::InvalidIndex;
+    }
 
     return descriptorHeap;
 }
 
+void DynamicDescriptorHeap::SetCurrentDescriptorHeap( CommandList& commandList )
+{
+    auto descriptorHeap = RequestDescriptorHeap();
+
+    m_CurrentDescriptorHeap      = descriptorHeap.DescriptorHeap;
+    m_CurrentCPUDescriptorHandle = descriptorHeap.CPUDescriptorHandle;
+    m_CurrentGPUDescriptorHandle = descriptorHeap.GPUDescriptorHandle;
+    m_NumFreeHandles             = m_NumDescriptorsPerHeap;
+
+    commandList.SetDescriptorHeap( m_DescriptorHeapType, m_CurrentDescriptorHeap.Get() );
+
+    // When updating the descriptor heap on the command list, all descriptor
+    // tables must be (re)recopied to the new descriptor heap (not just
+    // the stale descriptor tables).
+    m_StaleDescriptorTableBitMask = m_DescriptorTableBitMask;
+}
+
 void DynamicDescriptorHeap::CommitDescriptorTables(
     CommandList&                                                                         commandList,
     std::function<void( ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE )> setFunc )
@@ -186,17 +340,16 @@ void DynamicDescriptorHeap::CommitDescriptorTables(
 
         if ( !m_CurrentDescriptorHeap || m_NumFreeHandles < numDescriptorsToCommit )
         {
-            m_CurrentDescriptorHeap      = RequestDescriptorHeap();
-            m_CurrentCPUDescriptorHandle = m_CurrentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-            m_CurrentGPUDescriptorHandle = m_CurrentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-            m_NumFreeHandles             = m_NumDescriptorsPerHeap;
-
-            commandList.SetDescriptorHeap( m_DescriptorHeapType, m_CurrentDescriptorHeap.Get() );
+            SetCurrentDescriptorHeap( commandList );
+        }
 
-            // When updating the descriptor heap on the command list, all descriptor
-            // tables must be (re)recopied to the new descriptor heap (not just
-            // the stale descriptor tables).
-            m_StaleDescriptorTableBitMask = m_DescriptorTableBitMask;
+        // The staged descriptors may have been freed, reallocated and rewritten since the descriptor
+        // tables were cached.
+        auto releaseGeneration = DescriptorAllocatorPage::GetReleaseGeneration();
+        if ( releaseGeneration != m_DescriptorTableCacheGeneration )
+        {
+            ClearDescriptorTableCache();
+            m_DescriptorTableCacheGeneration = releaseGeneration;
         }
 
         DWORD rootIndex;
@@ -206,6 +359,20 @@ void DynamicDescriptorHeap::CommitDescriptorTables(
             UINT                         numSrcDescriptors     = m_DescriptorTableCache[rootIndex].NumDescriptors;
             D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorHandles = m_DescriptorTableCache[rootIndex].BaseDescriptor;
 
+            // Check if the same descriptors have already been copied to the bound descriptor heap.
+            size_t hash        = HashDescriptorTable( pSrcDescriptorHandles, numSrcDescriptors );
+            auto   cachedTable = FindCachedDescriptorTable( hash, pSrcDescriptorHandles, numSrcDescriptors );
+
+            if ( cachedTable )
+            {
+                // Reuse the previous copy of the descriptor table.
+                setFunc( d3d12GraphicsCommandList, rootIndex, cachedTable->GPUDescriptorHandle );
+                ++m_NumTableCacheHits;
+
+                m_StaleDescriptorTableBitMask ^= ( 1 << rootIndex );
+                continue;
+            }
+
             D3D12_CPU_DESCRIPTOR_HANDLE pDestDescriptorRangeStarts[] = { m_CurrentCPUDescriptorHandle };
             UINT                        pDestDescriptorRangeSizes[]  = { numSrcDescriptors };
 
@@ -216,6 +383,10 @@ void DynamicDescriptorHeap::CommitDescriptorTables(
             // Set the descriptors on the command list using the passed-in setter function.
             setFunc( d3d12GraphicsCommandList, rootIndex, m_CurrentGPUDescriptorHandle );
 
+            // Remember the copy so that it can be reused if the same descriptors are staged again.
+            AddCachedDescriptorTable( hash, pSrcDescriptorHandles, numSrcDescriptors );
+            ++m_NumTableCacheMisses;
+
             // Offset current CPU and GPU descriptor handles.
             m_CurrentCPUDescriptorHandle.Offset( numSrcDescriptors, m_DescriptorHandleIncrementSize );
             m_CurrentGPUDescriptorHandle.Offset( numSrcDescriptors, m_DescriptorHandleIncrementSize );
@@ -273,17 +444,7 @@ D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::CopyDescriptor( CommandList&
 {
     if ( !m_CurrentDescriptorHeap || m_NumFreeHandles < 1 )
     {
-        m_CurrentDescriptorHeap      = RequestDescriptorHeap();
-        m_CurrentCPUDescriptorHandle = m_CurrentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-        m_CurrentGPUDescriptorHandle = m_CurrentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-        m_NumFreeHandles             = m_NumDescriptorsPerHeap;
-
-        comandList.SetDescriptorHeap( m_DescriptorHeapType, m_CurrentDescriptorHeap.Get() );
-
-        // When updating the descriptor heap on the command list, all descriptor
-        // tables must be (re)recopied to the new descriptor heap (not just
-        // the stale descriptor tables).
-        m_StaleDescriptorTableBitMask = m_DescriptorTableBitMask;
+        SetCurrentDescriptorHeap( comandList );
     }
 
     auto d3d12Device = m_Device.GetD3D12Device();
@@ -311,6 +472,9 @@ void DynamicDescriptorHeap::Reset()
     m_StaleSRVBitMask             = 0;
     m_StaleUAVBitMask             = 0;
 
+    // The copied descriptor tables can be overwritten after the reset.
+    ClearDescriptorTableCache();
+
     // Reset the descriptor cache
     for ( int i = 0; i < MaxDescriptorTables; ++i )
     {
@@ -320,3 +484,13 @@ void DynamicDescriptorHeap::Reset()
         m_InlineUAV[i] = 0ull;
     }
 }
+
+DynamicDescriptorHeap::Statistics DynamicDescriptorHeap::GetStatistics() const
+{
+    Statistics statistics;
+
+    statistics.NumTableCacheHits   = m_NumTableCacheHits;
+    statistics.NumTableCacheMisses = m_NumTableCacheMisses;
+
+    return statistics;
+}
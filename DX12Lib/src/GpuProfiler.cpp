@@ -0,0 +1,181 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/GpuProfiler.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+
+using namespace DX12_Library;
+
+GpuProfiler::GpuProfiler( Device& device, D3D12_COMMAND_LIST_TYPE type, uint32_t numFrames,
+                          uint32_t maxScopesPerFrame )
+: m_Device( device )
+, m_CommandQueue( device.GetCommandQueue( type ) )
+, m_CommandListType( type )
+, m_NumFrames( std::max( numFrames, 1u ) )
+, m_MaxScopesPerFrame( std::max( maxScopesPerFrame, 1u ) )
+, m_Frequency( 0 )
+, m_CurrentFrame( 0 )
+, m_NumScopes( 0 )
+, m_NumResolvedFrames( 0 )
+, m_NumStalls( 0 )
+, m_NumDroppedScopes( 0 )
+{
+    // Timestamps on copy queues are an optional feature.
+    assert( type != D3D12_COMMAND_LIST_TYPE_COPY );
+
+    auto d3d12Device = m_Device.GetD3D12Device();
+
+    ThrowIfFailed( m_CommandQueue.GetD3D12CommandQueue()->GetTimestampFrequency( &m_Frequency ) );
+
+    uint32_t numQueries = m_NumFrames * m_MaxScopesPerFrame * 2;
+
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+    queryHeapDesc.Type                  = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryHeapDesc.Count                 = numQueries;
+    queryHeapDesc.NodeMask              = 0;
+    ThrowIfFailed( d3d12Device->CreateQueryHeap( &queryHeapDesc, IID_PPV_ARGS( &m_d3d12QueryHeap ) ) );
+    m_d3d12QueryHeap->SetName( L"GPU Profiler Query Heap" );
+
+    ThrowIfFailed( d3d12Device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_READBACK ), D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer( numQueries * sizeof( uint64_t ) ), D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+        IID_PPV_ARGS( &m_d3d12ReadbackBuffer ) ) );
+    m_d3d12ReadbackBuffer->SetName( L"GPU Profiler Readback Buffer" );
+
+    m_Frames.resize( m_NumFrames );
+    for ( auto& frame: m_Frames )
+    {
+        frame.Scopes.resize( m_MaxScopesPerFrame );
+        frame.NumScopes = 0;
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    // The queries and the readback buffer may still be used by the resolves of the last frames.
+    for ( const auto& frame: m_Frames )
+    {
+        frame.Completion.WaitForCompletion();
+    }
+}
+
+void GpuProfiler::BeginFrame()
+{
+    auto& frame = m_Frames[m_CurrentFrame];
+
+    // The timestamps of the frame that used the queries before are read back before they are overwritten.
+    if ( frame.Completion.IsValid() )
+    {
+        if ( !frame.Completion.IsComplete() )
+        {
+            ++m_NumStalls;
+            frame.Completion.WaitForCompletion();
+        }
+
+        ReadBack( frame, m_CurrentFrame );
+    }
+
+    frame.NumScopes  = 0;
+    frame.Completion = {};
+    m_NumScopes      = 0;
+}
+
+SyncPoint GpuProfiler::EndFrame()
+{
+    auto& frame     = m_Frames[m_CurrentFrame];
+    frame.NumScopes = std::min( m_NumScopes.load(), m_MaxScopesPerFrame );
+
+    if ( frame.NumScopes > 0 )
+    {
+        auto commandList      = m_CommandQueue.GetCommandList();
+        auto firstQuery       = GetQueryIndex( m_CurrentFrame, 0, false );
+        auto numQueries       = frame.NumScopes * 2;
+        auto destinationBytes = static_cast<UINT64>( firstQuery ) * sizeof( uint64_t );
+
+        commandList->GetD3D12CommandList()->ResolveQueryData( m_d3d12QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+                                                              firstQuery, numQueries, m_d3d12ReadbackBuffer.Get(),
+                                                              destinationBytes );
+
+        frame.Completion = m_CommandQueue.ExecuteCommandList( commandList );
+    }
+
+    m_CurrentFrame = ( m_CurrentFrame + 1 ) % m_NumFrames;
+
+    return frame.Completion;
+}
+
+uint32_t GpuProfiler::BeginScope( CommandList& commandList, const std::string& name, uint32_t parent )
+{
+    if ( commandList.GetCommandListType() != m_CommandListType )
+    {
+        return InvalidScope;
+    }
+
+    uint32_t scope = m_NumScopes++;
+    if ( scope >= m_MaxScopesPerFrame )
+    {
+        ++m_NumDroppedScopes;
+        return InvalidScope;
+    }
+
+    // Every scope has its own entry, so the scopes of a frame can be begun on multiple threads.
+    auto& frameScope  = m_Frames[m_CurrentFrame].Scopes[scope];
+    frameScope.Name   = name;
+    frameScope.Parent = parent;
+
+    commandList.GetD3D12CommandList()->EndQuery( m_d3d12QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+                                                 GetQueryIndex( m_CurrentFrame, scope, false ) );
+
+    return scope;
+}
+
+void GpuProfiler::EndScope( CommandList& commandList, uint32_t scope )
+{
+    if ( scope == InvalidScope )
+    {
+        return;
+    }
+
+    assert( scope < m_MaxScopesPerFrame );
+    assert( commandList.GetCommandListType() == m_CommandListType );
+
+    commandList.GetD3D12CommandList()->EndQuery( m_d3d12QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+                                                 GetQueryIndex( m_CurrentFrame, scope, true ) );
+}
+
+void GpuProfiler::ReadBack( Frame& frame, uint32_t frameIndex )
+{
+    auto firstQuery = GetQueryIndex( frameIndex, 0, false );
+    auto numQueries = frame.NumScopes * 2;
+
+    D3D12_RANGE readRange = { firstQuery * sizeof( uint64_t ), ( firstQuery + numQueries ) * sizeof( uint64_t ) };
+    uint8_t*    data      = nullptr;
+    ThrowIfFailed( m_d3d12ReadbackBuffer->Map( 0, &readRange, reinterpret_cast<void**>( &data ) ) );
+
+    auto timestamps = reinterpret_cast<const uint64_t*>( data + readRange.Begin );
+    for ( uint32_t i = 0; i < frame.NumScopes; ++i )
+    {
+        frame.Scopes[i].BeginTimestamp = timestamps[i * 2];
+        frame.Scopes[i].EndTimestamp   = timestamps[i * 2 + 1];
+    }
+
+    // Nothing was written by the CPU.
+    D3D12_RANGE writeRange = { 0, 0 };
+    m_d3d12ReadbackBuffer->Unmap( 0, &writeRange );
+
+    m_Aggregator.AddFrame( frame.Scopes.data(), frame.NumScopes, m_Frequency );
+
+    ++m_NumResolvedFrames;
+}
+
+GpuProfiler::Statistics GpuProfiler::GetStatistics() const
+{
+    Statistics statistics;
+    statistics.NumResolvedFrames = m_NumResolvedFrames;
+    statistics.NumStalls         = m_NumStalls;
+    statistics.NumDroppedScopes  = m_NumDroppedScopes;
+
+    return statistics;
+}
@@ -2,6 +2,8 @@
 
 #include <dx12lib/IndexBuffer.h>
 
+#include <dx12lib/Device.h>
+
 #include <cassert>
 
 using namespace DX12_Library;
@@ -10,7 +12,9 @@ IndexBuffer::IndexBuffer( Device& device, size_t numIndicies, DXGI_FORMAT indexF
 : Buffer( device, CD3DX12_RESOURCE_DESC::Buffer( numIndicies * ( indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4 ) ) )
 , m_NumIndicies( numIndicies )
 , m_IndexFormat( indexFormat )
+, m_Offset( 0 )
 , m_IndexBufferView {}
+, m_StaticAllocationID( 0 )
 {
     assert( indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT );
     CreateIndexBufferView();
@@ -21,17 +25,48 @@ IndexBuffer::IndexBuffer( Device& device, Microsoft::WRL::ComPtr<ID3D12Resource>
 : Buffer( device, resource )
 , m_NumIndicies( numIndicies )
 , m_IndexFormat( indexFormat )
+, m_Offset( 0 )
 , m_IndexBufferView {}
+, m_StaticAllocationID( 0 )
 {
     assert( indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT );
     CreateIndexBufferView();
 }
 
+IndexBuffer::IndexBuffer( Device& device, const StaticBufferAllocator::Allocation& allocation, size_t numIndicies,
+                          DXGI_FORMAT indexFormat )
+: Buffer( device, allocation.Resource )
+, m_NumIndicies( numIndicies )
+, m_IndexFormat( indexFormat )
+, m_Offset( allocation.Offset )
+, m_IndexBufferView {}
+, m_StaticAllocationID( allocation.ID )
+{
+    assert( indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT );
+    CreateIndexBufferView();
+
+    // Update the view if the index data is moved to a different block.
+    m_Device.GetStaticBufferAllocator().SetRelocationCallback(
+        m_StaticAllocationID, [this]( const StaticBufferAllocator::Allocation& newAllocation ) {
+            SetD3D12Resource( newAllocation.Resource );
+            m_Offset = newAllocation.Offset;
+            CreateIndexBufferView();
+        } );
+}
+
+IndexBuffer::~IndexBuffer()
+{
+    if ( m_StaticAllocationID != 0 )
+    {
+        m_Device.GetStaticBufferAllocator().Free( m_StaticAllocationID );
+    }
+}
+
 void IndexBuffer::CreateIndexBufferView()
 {
     UINT bufferSize = m_NumIndicies * ( m_IndexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4 );
 
-    m_IndexBufferView.BufferLocation = m_d3d12Resource->GetGPUVirtualAddress();
+    m_IndexBufferView.BufferLocation = m_d3d12Resource->GetGPUVirtualAddress() + m_Offset;
     m_IndexBufferView.SizeInBytes    = bufferSize;
     m_IndexBufferView.Format         = m_IndexFormat;
 }
@@ -0,0 +1,180 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/MipGenerator.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+#include <dx12lib/Texture.h>
+
+using namespace DX12_Library;
+
+MipGenerator::MipGenerator( Device& device )
+: m_Device( device )
+, m_ComputeQueue( device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE ) )
+, m_LastSubmittedBatchID( 0 )
+, m_NumPendingTextures( 0 )
+{
+    m_PendingBatch.BatchID = 1;
+}
+
+MipGenerator::Ticket MipGenerator::GenerateMips( const std::shared_ptr<Texture>& texture,
+                                                 const UploadManager::Ticket& uploadTicket )
+{
+    assert( texture );
+
+    auto d3d12Resource = texture->GetD3D12Resource();
+    if ( !d3d12Resource || d3d12Resource->GetDesc().MipLevels == 1 )
+    {
+        return {};
+    }
+
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    if ( !m_CommandList )
+    {
+        m_CommandList = m_ComputeQueue.GetCommandList();
+    }
+
+    // The mips are generated from the first mip, so the batch must wait for its upload.
+    m_CommandList->AddUploadDependency( uploadTicket );
+    m_CommandList->GenerateMips( texture );
+
+    m_PendingBatch.Textures.push_back( d3d12Resource.Get() );
+    {
+        std::lock_guard<std::mutex> pendingTexturesLock( m_PendingTexturesMutex );
+        ReleaseCompletedBatches();
+        m_PendingTextures[d3d12Resource.Get()] = m_PendingBatch.BatchID;
+        m_NumPendingTextures                   = m_PendingTextures.size();
+    }
+
+    Ticket ticket = { m_PendingBatch.BatchID };
+
+    if ( m_PendingBatch.Textures.size() >= MaxBatchSize )
+    {
+        SubmitBatch( lock );
+    }
+
+    return ticket;
+}
+
+MipGenerator::Ticket MipGenerator::GetTicket( ID3D12Resource* d3d12Resource )
+{
+    std::lock_guard<std::mutex> lock( m_PendingTexturesMutex );
+
+    // Otherwise the textures of the last batches would stay pending until the next batch.
+    ReleaseCompletedBatches();
+
+    auto iter = m_PendingTextures.find( d3d12Resource );
+    if ( iter == m_PendingTextures.end() )
+    {
+        return {};
+    }
+
+    return { iter->second };
+}
+
+SyncPoint MipGenerator::SubmitBatch( std::unique_lock<std::mutex>& lock )
+{
+    if ( !m_CommandList )
+    {
+        return {};
+    }
+
+    auto  commandList = std::move( m_CommandList );
+    Batch batch       = std::move( m_PendingBatch );
+
+    m_CommandList          = nullptr;
+    m_PendingBatch         = {};
+    m_PendingBatch.BatchID = batch.BatchID + 1;
+
+    // Another thread may still be executing the batch before this one.
+    m_BatchSubmittedCV.wait( lock, [&]() { return m_LastSubmittedBatchID + 1 == batch.BatchID; } );
+
+    // The command list uses the textures of its own batch, but it must not wait for itself.
+    commandList->m_MipTicket = {};
+
+    lock.unlock();
+    auto syncPoint = m_ComputeQueue.ExecuteCommandList( commandList );
+    lock.lock();
+
+    m_LastSubmittedBatchID = batch.BatchID;
+    batch.Completion       = syncPoint;
+    {
+        std::lock_guard<std::mutex> pendingTexturesLock( m_PendingTexturesMutex );
+        m_SubmittedBatches.push_back( std::move( batch ) );
+    }
+
+    m_BatchSubmittedCV.notify_all();
+
+    return syncPoint;
+}
+
+void MipGenerator::ReleaseCompletedBatches()
+{
+    while ( !m_SubmittedBatches.empty() && m_SubmittedBatches.front().Completion.IsComplete() )
+    {
+        const auto& batch = m_SubmittedBatches.front();
+        for ( auto d3d12Resource: batch.Textures )
+        {
+            // The texture may have been added to a later batch again.
+            auto iter = m_PendingTextures.find( d3d12Resource );
+            if ( iter != m_PendingTextures.end() && iter->second == batch.BatchID )
+            {
+                m_PendingTextures.erase( iter );
+            }
+        }
+        m_NumPendingTextures = m_PendingTextures.size();
+
+        m_SubmittedBatches.pop_front();
+    }
+}
+
+SyncPoint MipGenerator::Flush()
+{
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    return SubmitBatch( lock );
+}
+
+SyncPoint MipGenerator::GetSyncPoint( const Ticket& ticket )
+{
+    if ( ticket.BatchID == 0 )
+    {
+        return {};
+    }
+
+    {
+        std::unique_lock<std::mutex> lock( m_Mutex );
+        assert( ticket.BatchID <= m_PendingBatch.BatchID );
+
+        if ( ticket.BatchID == m_PendingBatch.BatchID )
+        {
+            SubmitBatch( lock );
+        }
+
+        // The batch may still be executed by another thread.
+        m_BatchSubmittedCV.wait( lock, [&]() { return m_LastSubmittedBatchID >= ticket.BatchID; } );
+    }
+
+    std::lock_guard<std::mutex> pendingTexturesLock( m_PendingTexturesMutex );
+
+    ReleaseCompletedBatches();
+
+    if ( m_SubmittedBatches.empty() || ticket.BatchID < m_SubmittedBatches.front().BatchID )
+    {
+        return {};
+    }
+
+    // Batch IDs are consecutive.
+    auto index = static_cast<size_t>( ticket.BatchID - m_SubmittedBatches.front().BatchID );
+    assert( index < m_SubmittedBatches.size() );
+
+    return m_SubmittedBatches[index].Completion;
+}
+
+void MipGenerator::Wait( CommandQueue& commandQueue, const Ticket& ticket )
+{
+    // Work on the compute queue is already executed in order.
+    commandQueue.Wait( GetSyncPoint( ticket ) );
+}
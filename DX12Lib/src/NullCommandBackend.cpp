@@ -0,0 +1,483 @@
+#include <dx12lib/NullCommandBackend.h>
+
+using namespace DX12_Library;
+
+NullCommandBackend::NullCommandBackend()
+{
+    Reset();
+}
+
+NullCommandBackend::~NullCommandBackend() {}
+
+void NullCommandBackend::Reset()
+{
+    m_PipelineState         = InvalidCommandObject;
+    m_GraphicsRootSignature = InvalidCommandObject;
+    m_ComputeRootSignature  = InvalidCommandObject;
+    m_IndexBuffer           = InvalidCommandObject;
+    m_PrimitiveTopology     = UndefinedPrimitiveTopology;
+    m_NumViewports          = 0;
+    m_NumScissorRects       = 0;
+    m_HasRenderTarget       = false;
+    m_VertexBuffers.clear();
+
+    m_Statistics = {};
+    m_Errors.clear();
+}
+
+void NullCommandBackend::DescribeRootSignature( CommandObjectHandle rootSignature, uint32_t numParameters )
+{
+    if ( rootSignature >= m_NumRootParameters.size() )
+    {
+        m_NumRootParameters.resize( rootSignature + 1, Unknown );
+    }
+    m_NumRootParameters[rootSignature] = numParameters;
+}
+
+void NullCommandBackend::DescribeIndexBuffer( CommandObjectHandle indexBuffer, uint32_t numIndices )
+{
+    if ( indexBuffer >= m_NumIndices.size() )
+    {
+        m_NumIndices.resize( indexBuffer + 1, Unknown );
+    }
+    m_NumIndices[indexBuffer] = numIndices;
+}
+
+void NullCommandBackend::Error( const char* command, const char* message )
+{
+    ++m_Statistics.NumValidationErrors;
+
+    if ( m_Errors.size() < MaxErrors )
+    {
+        m_Errors.push_back( std::string( command ) + " (command " + std::to_string( m_Statistics.NumCommands ) +
+                            "): " + message );
+    }
+}
+
+void NullCommandBackend::ValidateRootArgument( const char* command, CommandObjectHandle rootSignature,
+                                               uint32_t rootParameterIndex )
+{
+    ++m_Statistics.NumRootArguments;
+
+    if ( rootSignature == InvalidCommandObject )
+    {
+        Error( command, "No root signature is bound." );
+    }
+    else if ( rootSignature < m_NumRootParameters.size() && m_NumRootParameters[rootSignature] != Unknown &&
+              rootParameterIndex >= m_NumRootParameters[rootSignature] )
+    {
+        Error( command, "The root parameter index is out of range of the bound root signature." );
+    }
+}
+
+void NullCommandBackend::ValidateDraw( const char* command )
+{
+    if ( m_PipelineState == InvalidCommandObject )
+    {
+        Error( command, "No pipeline state is bound." );
+    }
+    if ( m_GraphicsRootSignature == InvalidCommandObject )
+    {
+        Error( command, "No graphics root signature is bound." );
+    }
+    if ( m_PrimitiveTopology == UndefinedPrimitiveTopology )
+    {
+        Error( command, "No primitive topology is set." );
+    }
+    if ( !m_HasRenderTarget )
+    {
+        Error( command, "No render target is bound." );
+    }
+    if ( m_NumViewports == 0 )
+    {
+        Error( command, "No viewport is set." );
+    }
+    if ( m_NumScissorRects == 0 )
+    {
+        Error( command, "No scissor rectangle is set." );
+    }
+}
+
+void NullCommandBackend::TransitionBarrier( CommandObjectHandle resource, uint32_t /*stateAfter*/,
+                                            uint32_t /*subresource*/ )
+{
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumBarriers;
+
+    if ( resource == InvalidCommandObject )
+    {
+        Error( "TransitionBarrier", "The resource is null." );
+    }
+}
+
+void NullCommandBackend::UAVBarrier( CommandObjectHandle /*resource*/ )
+{
+    // A UAV barrier without a resource applies to all UAV accesses.
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumBarriers;
+}
+
+void NullCommandBackend::AliasingBarrier( CommandObjectHandle /*beforeResource*/,
+                                          CommandObjectHandle /*afterResource*/ )
+{
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumBarriers;
+}
+
+void NullCommandBackend::CopyResource( CommandObjectHandle dstRes, CommandObjectHandle srcRes )
+{
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumCopies;
+
+    if ( dstRes == InvalidCommandObject || srcRes == InvalidCommandObject )
+    {
+        Error( "CopyResource", "The source or destination resource is null." );
+    }
+    else if ( dstRes == srcRes )
+    {
+        Error( "CopyResource", "The source and destination resource are the same." );
+    }
+}
+
+void NullCommandBackend::ResolveSubresource( CommandObjectHandle dstRes, CommandObjectHandle srcRes,
+                                             uint32_t /*dstSubresource*/, uint32_t /*srcSubresource*/ )
+{
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumCopies;
+
+    if ( dstRes == InvalidCommandObject || srcRes == InvalidCommandObject )
+    {
+        Error( "ResolveSubresource", "The source or destination resource is null." );
+    }
+    else if ( dstRes == srcRes )
+    {
+        Error( "ResolveSubresource", "The source and destination resource are the same." );
+    }
+}
+
+void NullCommandBackend::SetPipelineState( CommandObjectHandle pipelineState )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( pipelineState == InvalidCommandObject )
+    {
+        Error( "SetPipelineState", "The pipeline state is null." );
+    }
+    else if ( pipelineState == m_PipelineState )
+    {
+        ++m_Statistics.NumRedundantBinds;
+    }
+    else
+    {
+        ++m_Statistics.NumPipelineStateChanges;
+    }
+
+    m_PipelineState = pipelineState;
+}
+
+void NullCommandBackend::SetGraphicsRootSignature( CommandObjectHandle rootSignature )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( rootSignature == InvalidCommandObject )
+    {
+        Error( "SetGraphicsRootSignature", "The root signature is null." );
+    }
+    else if ( rootSignature == m_GraphicsRootSignature )
+    {
+        ++m_Statistics.NumRedundantBinds;
+    }
+    else
+    {
+        ++m_Statistics.NumRootSignatureChanges;
+    }
+
+    m_GraphicsRootSignature = rootSignature;
+}
+
+void NullCommandBackend::SetComputeRootSignature( CommandObjectHandle rootSignature )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( rootSignature == InvalidCommandObject )
+    {
+        Error( "SetComputeRootSignature", "The root signature is null." );
+    }
+    else if ( rootSignature == m_ComputeRootSignature )
+    {
+        ++m_Statistics.NumRedundantBinds;
+    }
+    else
+    {
+        ++m_Statistics.NumRootSignatureChanges;
+    }
+
+    m_ComputeRootSignature = rootSignature;
+}
+
+void NullCommandBackend::SetPrimitiveTopology( uint32_t primitiveTopology )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( primitiveTopology == UndefinedPrimitiveTopology )
+    {
+        Error( "SetPrimitiveTopology", "The primitive topology is undefined." );
+    }
+
+    m_PrimitiveTopology = primitiveTopology;
+}
+
+void NullCommandBackend::SetVertexBuffer( uint32_t slot, CommandObjectHandle vertexBuffer )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( slot >= MaxVertexBufferSlots )
+    {
+        Error( "SetVertexBuffer", "The slot is out of range." );
+        return;
+    }
+
+    if ( slot >= m_VertexBuffers.size() )
+    {
+        m_VertexBuffers.resize( slot + 1, InvalidCommandObject );
+    }
+
+    if ( vertexBuffer != InvalidCommandObject && vertexBuffer == m_VertexBuffers[slot] )
+    {
+        ++m_Statistics.NumRedundantBinds;
+    }
+
+    m_VertexBuffers[slot] = vertexBuffer;
+}
+
+void NullCommandBackend::SetIndexBuffer( CommandObjectHandle indexBuffer )
+{
+    ++m_Statistics.NumCommands;
+
+    // Like the command list, a null index buffer doesn't change the bound index buffer.
+    if ( indexBuffer != InvalidCommandObject )
+    {
+        if ( indexBuffer == m_IndexBuffer )
+        {
+            ++m_Statistics.NumRedundantBinds;
+        }
+
+        m_IndexBuffer = indexBuffer;
+    }
+}
+
+void NullCommandBackend::SetViewports( const CommandViewport* viewports, uint32_t numViewports )
+{
+    ++m_Statistics.NumCommands;
+
+    for ( uint32_t i = 0; i < numViewports; ++i )
+    {
+        if ( viewports[i].Width <= 0.0f || viewports[i].Height <= 0.0f )
+        {
+            Error( "SetViewports", "The viewport is empty." );
+        }
+    }
+
+    m_NumViewports = numViewports;
+}
+
+void NullCommandBackend::SetScissorRects( const CommandRect* scissorRects, uint32_t numScissorRects )
+{
+    ++m_Statistics.NumCommands;
+
+    for ( uint32_t i = 0; i < numScissorRects; ++i )
+    {
+        if ( scissorRects[i].Right < scissorRects[i].Left || scissorRects[i].Bottom < scissorRects[i].Top )
+        {
+            Error( "SetScissorRects", "The scissor rectangle is inverted." );
+        }
+    }
+
+    m_NumScissorRects = numScissorRects;
+}
+
+void NullCommandBackend::SetRenderTarget( const CommandObjectHandle* textures, uint32_t numTextures )
+{
+    ++m_Statistics.NumCommands;
+
+    m_HasRenderTarget = false;
+    for ( uint32_t i = 0; i < numTextures; ++i )
+    {
+        if ( textures[i] != InvalidCommandObject )
+        {
+            m_HasRenderTarget = true;
+            // Every attached texture is transitioned to a render target or depth state.
+            ++m_Statistics.NumBarriers;
+        }
+    }
+}
+
+void NullCommandBackend::SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                                    const void* constants )
+{
+    ++m_Statistics.NumCommands;
+    m_Statistics.NumInlineBytes += numConstants * sizeof( uint32_t );
+
+    if ( numConstants > 0 && constants == nullptr )
+    {
+        Error( "SetGraphics32BitConstants", "The constant data pointer is null." );
+    }
+
+    ValidateRootArgument( "SetGraphics32BitConstants", m_GraphicsRootSignature, rootParameterIndex );
+}
+
+void NullCommandBackend::SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants,
+                                                   const void* constants )
+{
+    ++m_Statistics.NumCommands;
+    m_Statistics.NumInlineBytes += numConstants * sizeof( uint32_t );
+
+    if ( numConstants > 0 && constants == nullptr )
+    {
+        Error( "SetCompute32BitConstants", "The constant data pointer is null." );
+    }
+
+    ValidateRootArgument( "SetCompute32BitConstants", m_ComputeRootSignature, rootParameterIndex );
+}
+
+void NullCommandBackend::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes,
+                                                           const void* bufferData )
+{
+    ++m_Statistics.NumCommands;
+    m_Statistics.NumInlineBytes += sizeInBytes;
+
+    if ( sizeInBytes > 0 && bufferData == nullptr )
+    {
+        Error( "SetGraphicsDynamicConstantBuffer", "The buffer data pointer is null." );
+    }
+
+    ValidateRootArgument( "SetGraphicsDynamicConstantBuffer", m_GraphicsRootSignature, rootParameterIndex );
+}
+
+void NullCommandBackend::SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
+                                                             const void* bufferData )
+{
+    ++m_Statistics.NumCommands;
+    m_Statistics.NumInlineBytes += numElements * elementSize;
+
+    if ( numElements > 0 && bufferData == nullptr )
+    {
+        Error( "SetGraphicsDynamicStructuredBuffer", "The buffer data pointer is null." );
+    }
+
+    ValidateRootArgument( "SetGraphicsDynamicStructuredBuffer", m_GraphicsRootSignature, slot );
+}
+
+void NullCommandBackend::SetShaderResourceView( uint32_t rootParameterIndex, uint32_t /*descriptorOffset*/,
+                                                CommandObjectHandle srv, uint32_t /*stateAfter*/,
+                                                uint32_t /*firstSubresource*/, uint32_t /*numSubresources*/ )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( srv == InvalidCommandObject )
+    {
+        Error( "SetShaderResourceView", "The shader resource view is null." );
+    }
+    else
+    {
+        ++m_Statistics.NumBarriers;
+    }
+
+    // The descriptors are staged for the bound root signature, graphics or compute.
+    ValidateRootArgument( "SetShaderResourceView",
+                          m_GraphicsRootSignature != InvalidCommandObject ? m_GraphicsRootSignature
+                                                                          : m_ComputeRootSignature,
+                          rootParameterIndex );
+}
+
+void NullCommandBackend::SetTextureShaderResourceView( uint32_t rootParameterIndex, uint32_t /*descriptorOffset*/,
+                                                       CommandObjectHandle texture, uint32_t /*stateAfter*/,
+                                                       uint32_t /*firstSubresource*/, uint32_t /*numSubresources*/ )
+{
+    ++m_Statistics.NumCommands;
+
+    // The command list ignores null textures.
+    if ( texture != InvalidCommandObject )
+    {
+        ++m_Statistics.NumBarriers;
+
+        ValidateRootArgument( "SetShaderResourceView",
+                              m_GraphicsRootSignature != InvalidCommandObject ? m_GraphicsRootSignature
+                                                                              : m_ComputeRootSignature,
+                              rootParameterIndex );
+    }
+}
+
+void NullCommandBackend::SetBindlessShaderResourceView( CommandObjectHandle srv, uint32_t /*stateAfter*/ )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( srv == InvalidCommandObject )
+    {
+        Error( "SetBindlessShaderResourceView", "The shader resource view is null." );
+    }
+    else
+    {
+        ++m_Statistics.NumBarriers;
+    }
+}
+
+void NullCommandBackend::SetBindlessTextureShaderResourceView( CommandObjectHandle texture, uint32_t /*stateAfter*/ )
+{
+    ++m_Statistics.NumCommands;
+
+    if ( texture == InvalidCommandObject )
+    {
+        Error( "SetBindlessShaderResourceView", "The texture is null." );
+    }
+    else
+    {
+        ++m_Statistics.NumBarriers;
+    }
+}
+
+void NullCommandBackend::Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t /*startVertex*/,
+                               uint32_t /*startInstance*/ )
+{
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumDraws;
+    m_Statistics.NumVertices += static_cast<uint64_t>( vertexCount ) * instanceCount;
+
+    ValidateDraw( "Draw" );
+}
+
+void NullCommandBackend::DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex,
+                                      int32_t /*baseVertex*/, uint32_t /*startInstance*/ )
+{
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumDraws;
+    m_Statistics.NumIndices += static_cast<uint64_t>( indexCount ) * instanceCount;
+
+    ValidateDraw( "DrawIndexed" );
+
+    if ( m_IndexBuffer == InvalidCommandObject )
+    {
+        Error( "DrawIndexed", "No index buffer is bound." );
+    }
+    else if ( m_IndexBuffer < m_NumIndices.size() && m_NumIndices[m_IndexBuffer] != Unknown &&
+              static_cast<uint64_t>( startIndex ) + indexCount > m_NumIndices[m_IndexBuffer] )
+    {
+        Error( "DrawIndexed", "The indices are out of range of the bound index buffer." );
+    }
+}
+
+void NullCommandBackend::Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ )
+{
+    ++m_Statistics.NumCommands;
+    ++m_Statistics.NumDispatches;
+    m_Statistics.NumThreadGroups += static_cast<uint64_t>( numGroupsX ) * numGroupsY * numGroupsZ;
+
+    if ( m_PipelineState == InvalidCommandObject )
+    {
+        Error( "Dispatch", "No pipeline state is bound." );
+    }
+    if ( m_ComputeRootSignature == InvalidCommandObject )
+    {
+        Error( "Dispatch", "No compute root signature is bound." );
+    }
+}
@@ -0,0 +1,156 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/ParallelCommandRecorder.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+
+using namespace DX12_Library;
+
+ParallelCommandRecorder::ParallelCommandRecorder( Device& device, uint32_t numThreads )
+: m_Device( device )
+, m_ParentCommandList( nullptr )
+, m_Record( nullptr )
+, m_CommandLists( nullptr )
+, m_NumChunks( 0 )
+, m_NextChunk( 0 )
+, m_NumFinishedChunks( 0 )
+, m_bStopThreads( false )
+{
+    if ( numThreads == 0 )
+    {
+        // The thread that calls Record records chunks as well.
+        numThreads = std::max( std::thread::hardware_concurrency(), 1u ) - 1;
+    }
+
+    m_Threads.reserve( numThreads );
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        m_Threads.emplace_back( &ParallelCommandRecorder::WorkerThread, this );
+        SetThreadName( m_Threads.back(), "ParallelCommandRecorder" );
+    }
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_bStopThreads = true;
+    }
+    m_WorkCV.notify_all();
+
+    for ( auto& thread: m_Threads )
+    {
+        thread.join();
+    }
+}
+
+std::vector<std::shared_ptr<CommandList>> ParallelCommandRecorder::Record( const CommandList& parentCommandList,
+                                                                           uint32_t           numChunks,
+                                                                           const RecordFunction& record )
+{
+    std::lock_guard<std::mutex> recordLock( m_RecordMutex );
+
+    // The command lists are taken from the queue on this thread, so the chunks only record.
+    auto& commandQueue = m_Device.GetCommandQueue( parentCommandList.GetCommandListType() );
+
+    std::vector<std::shared_ptr<CommandList>> commandLists( numChunks );
+    for ( auto& commandList: commandLists )
+    {
+        commandList = commandQueue.GetCommandList();
+    }
+
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    m_ParentCommandList = &parentCommandList;
+    m_Record            = &record;
+    m_CommandLists      = &commandLists;
+    m_NumChunks         = numChunks;
+    m_NextChunk         = 0;
+    m_NumFinishedChunks = 0;
+    m_Exception         = nullptr;
+
+    m_WorkCV.notify_all();
+
+    while ( RecordNextChunk( lock ) )
+    {}
+
+    m_FinishedCV.wait( lock, [this] { return m_NumFinishedChunks == m_NumChunks; } );
+
+    auto exception = m_Exception;
+
+    m_ParentCommandList = nullptr;
+    m_Record            = nullptr;
+    m_CommandLists      = nullptr;
+    m_NumChunks         = 0;
+    m_NextChunk         = 0;
+    m_Exception         = nullptr;
+
+    lock.unlock();
+
+    if ( exception )
+    {
+        std::rethrow_exception( exception );
+    }
+
+    return commandLists;
+}
+
+bool ParallelCommandRecorder::RecordNextChunk( std::unique_lock<std::mutex>& lock )
+{
+    if ( m_NextChunk >= m_NumChunks )
+    {
+        return false;
+    }
+
+    auto        chunk             = m_NextChunk++;
+    auto        numChunks         = m_NumChunks;
+    auto&       commandList       = *( *m_CommandLists )[chunk];
+    const auto& parentCommandList = *m_ParentCommandList;
+    const auto& record            = *m_Record;
+
+    lock.unlock();
+
+    std::exception_ptr exception;
+    try
+    {
+        commandList.InheritState( parentCommandList );
+        record( commandList, chunk, numChunks );
+    }
+    catch ( ... )
+    {
+        exception = std::current_exception();
+    }
+
+    lock.lock();
+
+    if ( exception && !m_Exception )
+    {
+        m_Exception = exception;
+    }
+
+    if ( ++m_NumFinishedChunks == m_NumChunks )
+    {
+        m_FinishedCV.notify_one();
+    }
+
+    return true;
+}
+
+void ParallelCommandRecorder::WorkerThread()
+{
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    while ( true )
+    {
+        m_WorkCV.wait( lock, [this] { return m_bStopThreads || m_NextChunk < m_NumChunks; } );
+
+        if ( m_bStopThreads )
+        {
+            break;
+        }
+
+        RecordNextChunk( lock );
+    }
+}
@@ -0,0 +1,148 @@
+#include <dx12lib/ProfileAggregator.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace DX12_Library;
+
+ProfileAggregator::ProfileAggregator( uint32_t numHistoryFrames )
+: m_NumHistoryFrames( std::max( numHistoryFrames, 1u ) )
+, m_NumFrames( 0 )
+{}
+
+void ProfileAggregator::AddFrame( const Scope* scopes, uint32_t numScopes, uint64_t frequency )
+{
+    assert( frequency > 0 );
+
+    // The entries of the scopes of this frame.
+    std::vector<uint32_t> scopeEntries( numScopes );
+    for ( uint32_t i = 0; i < numScopes; ++i )
+    {
+        const auto& scope = scopes[i];
+        assert( scope.Parent == InvalidScope || scope.Parent < i );
+
+        uint32_t parentEntry = scope.Parent != InvalidScope ? scopeEntries[scope.Parent] : InvalidScope;
+        scopeEntries[i]      = GetEntry( scope.Name, parentEntry );
+
+        if ( scope.EndTimestamp >= scope.BeginTimestamp )
+        {
+            auto& entry = m_Entries[scopeEntries[i]];
+            entry.FrameMs += static_cast<double>( scope.EndTimestamp - scope.BeginTimestamp ) * 1000.0 /
+                             static_cast<double>( frequency );
+            entry.IsMeasured = true;
+        }
+    }
+
+    auto historyIndex = static_cast<size_t>( m_NumFrames % m_NumHistoryFrames );
+    for ( auto& entry: m_Entries )
+    {
+        if ( entry.IsMeasured )
+        {
+            entry.History[historyIndex] = entry.FrameMs;
+            entry.LastMs                = entry.FrameMs;
+        }
+        else
+        {
+            entry.History[historyIndex] = -1.0;
+        }
+
+        entry.FrameMs    = 0.0;
+        entry.IsMeasured = false;
+    }
+
+    ++m_NumFrames;
+
+    UpdateTimings();
+}
+
+uint32_t ProfileAggregator::GetEntry( const std::string& name, uint32_t parentEntry )
+{
+    // Entries are never removed, so the index of the parent entry identifies the path of the parent.
+    std::string path = std::to_string( parentEntry ) + '/' + name;
+
+    auto iter = m_EntriesByPath.find( path );
+    if ( iter != m_EntriesByPath.end() )
+    {
+        return iter->second;
+    }
+
+    auto entryIndex = static_cast<uint32_t>( m_Entries.size() );
+
+    Entry entry;
+    entry.Name       = name;
+    entry.Depth      = parentEntry != InvalidScope ? m_Entries[parentEntry].Depth + 1 : 0;
+    entry.History    = std::vector<double>( m_NumHistoryFrames, -1.0 );
+    entry.LastMs     = 0.0;
+    entry.FrameMs    = 0.0;
+    entry.IsMeasured = false;
+    m_Entries.push_back( std::move( entry ) );
+
+    if ( parentEntry != InvalidScope )
+    {
+        m_Entries[parentEntry].Children.push_back( entryIndex );
+    }
+    else
+    {
+        m_RootEntries.push_back( entryIndex );
+    }
+
+    m_EntriesByPath.emplace( std::move( path ), entryIndex );
+
+    return entryIndex;
+}
+
+void ProfileAggregator::UpdateTimings()
+{
+    m_Timings.clear();
+    for ( auto entryIndex: m_RootEntries )
+    {
+        AddTimings( entryIndex );
+    }
+}
+
+void ProfileAggregator::AddTimings( uint32_t entryIndex )
+{
+    const auto& entry = m_Entries[entryIndex];
+
+    Timing timing     = {};
+    timing.Name       = entry.Name;
+    timing.Depth      = entry.Depth;
+    timing.LastMs     = entry.LastMs;
+    timing.MinMs      = std::numeric_limits<double>::max();
+    timing.MaxMs      = 0.0;
+    timing.NumSamples = 0;
+
+    double totalMs = 0.0;
+    for ( auto durationMs: entry.History )
+    {
+        if ( durationMs >= 0.0 )
+        {
+            timing.MinMs = std::min( timing.MinMs, durationMs );
+            timing.MaxMs = std::max( timing.MaxMs, durationMs );
+            totalMs += durationMs;
+            ++timing.NumSamples;
+        }
+    }
+
+    // Scopes that were not measured in the rolling window are hidden, but their children may still be measured.
+    if ( timing.NumSamples > 0 )
+    {
+        timing.AvgMs = totalMs / timing.NumSamples;
+        m_Timings.push_back( std::move( timing ) );
+    }
+
+    for ( auto childIndex: entry.Children )
+    {
+        AddTimings( childIndex );
+    }
+}
+
+void ProfileAggregator::Reset()
+{
+    m_Entries.clear();
+    m_RootEntries.clear();
+    m_EntriesByPath.clear();
+    m_Timings.clear();
+    m_NumFrames = 0;
+}
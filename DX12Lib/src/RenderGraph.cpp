@@ -0,0 +1,336 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/RenderGraph.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+#include <dx12lib/GpuProfiler.h>
+#include <dx12lib/ParallelCommandRecorder.h>
+#include <dx12lib/Texture.h>
+#include <dx12lib/TransientTextureAllocator.h>
+
+using namespace DX12_Library;
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read( ResourceID resource, D3D12_RESOURCE_STATES state )
+{
+    return AddAccess( resource, state, RenderGraphCompiler::Read );
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write( ResourceID resource, D3D12_RESOURCE_STATES state )
+{
+    return AddAccess( resource, state, RenderGraphCompiler::Write );
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ReadWrite( ResourceID resource, D3D12_RESOURCE_STATES state )
+{
+    return AddAccess( resource, state, RenderGraphCompiler::ReadWrite );
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::AddAccess( ResourceID resource, D3D12_RESOURCE_STATES state,
+                                                               RenderGraphCompiler::AccessType type )
+{
+    assert( resource < m_RenderGraph.m_Resources.size() );
+
+    m_RenderGraph.m_Passes[m_PassIndex].PassDesc.Accesses.push_back( { resource, state, type } );
+    m_RenderGraph.m_IsCompiled = false;
+
+    return *this;
+}
+
+RenderGraph::RenderGraph( Device& device, TransientTextureAllocator& transientTextureAllocator )
+: m_Device( device )
+, m_TransientTextureAllocator( transientTextureAllocator )
+, m_IsCompiled( false )
+, m_Profiler( nullptr )
+{}
+
+RenderGraph::ResourceID RenderGraph::ImportTexture( const std::shared_ptr<Texture>& texture,
+                                                    D3D12_RESOURCE_STATES initialState, const SyncPoint& producer )
+{
+    assert( texture );
+
+    TextureResource resource = {};
+    resource.Texture         = texture;
+    resource.IsImported      = true;
+    resource.InitialState    = initialState;
+    resource.Producer        = producer;
+    resource.ResourceDesc    = texture->GetD3D12ResourceDesc();
+    resource.Name            = texture->GetName();
+
+    m_Resources.push_back( resource );
+    m_IsCompiled = false;
+
+    return static_cast<ResourceID>( m_Resources.size() - 1 );
+}
+
+RenderGraph::ResourceID RenderGraph::CreateTexture( const D3D12_RESOURCE_DESC& resourceDesc,
+                                                    const D3D12_CLEAR_VALUE* clearValue, const std::wstring& name )
+{
+    TextureResource resource = {};
+    resource.IsImported      = false;
+    resource.InitialState    = D3D12_RESOURCE_STATE_COMMON;
+    resource.ResourceDesc    = resourceDesc;
+    resource.HasClearValue   = clearValue != nullptr;
+    resource.Name            = name;
+    if ( clearValue )
+    {
+        resource.ClearValue = *clearValue;
+    }
+
+    m_Resources.push_back( resource );
+    m_IsCompiled = false;
+
+    return static_cast<ResourceID>( m_Resources.size() - 1 );
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass( const std::wstring& name, ExecuteFunction execute, uint32_t flags )
+{
+    Pass pass;
+    pass.Name           = name;
+    pass.Execute        = std::move( execute );
+    pass.PassDesc.Flags = flags;
+    pass.Recorder       = nullptr;
+    pass.NumChunks      = 0;
+
+    m_Passes.push_back( std::move( pass ) );
+    m_IsCompiled = false;
+
+    return PassBuilder( *this, static_cast<uint32_t>( m_Passes.size() - 1 ) );
+}
+
+RenderGraph::PassBuilder RenderGraph::AddParallelPass( const std::wstring& name, ExecuteFunction execute,
+                                                       ParallelCommandRecorder& recorder, uint32_t numChunks,
+                                                       RecordChunkFunction recordChunk, uint32_t flags )
+{
+    assert( recordChunk );
+
+    auto passBuilder = AddPass( name, std::move( execute ), flags );
+
+    auto& pass       = m_Passes.back();
+    pass.Recorder    = &recorder;
+    pass.NumChunks   = numChunks;
+    pass.RecordChunk = std::move( recordChunk );
+
+    return passBuilder;
+}
+
+void RenderGraph::Compile()
+{
+    m_Compiler.Reset();
+
+    for ( const auto& resource: m_Resources )
+    {
+        RenderGraphCompiler::ResourceDesc resourceDesc;
+        resourceDesc.IsImported   = resource.IsImported;
+        resourceDesc.InitialState = resource.InitialState;
+
+        m_Compiler.AddResource( resourceDesc );
+    }
+
+    for ( const auto& pass: m_Passes )
+    {
+        m_Compiler.AddPass( pass.PassDesc );
+    }
+
+    m_Compiler.Compile();
+
+    m_IsCompiled = true;
+}
+
+SyncPoint RenderGraph::Execute()
+{
+    if ( !m_IsCompiled )
+    {
+        Compile();
+    }
+
+    const auto& compiledPasses    = m_Compiler.GetCompiledPasses();
+    auto        numCompiledPasses = static_cast<uint32_t>( compiledPasses.size() );
+
+    // The transient textures that are acquired before and released after each pass.
+    std::vector<std::vector<ResourceID>> acquiredTextures( numCompiledPasses );
+    std::vector<std::vector<ResourceID>> releasedTextures( numCompiledPasses );
+    // The producers of the imported textures that each pass waits for.
+    std::vector<std::vector<SyncPoint>> producers( numCompiledPasses );
+    for ( ResourceID resource = 0; resource < m_Compiler.GetNumResources(); ++resource )
+    {
+        const auto& lifetime = m_Compiler.GetLifetime( resource );
+        if ( lifetime.FirstPass == RenderGraphCompiler::InvalidIndex )
+        {
+            continue;
+        }
+
+        if ( !m_Resources[resource].IsImported )
+        {
+            acquiredTextures[lifetime.FirstPass].push_back( resource );
+            releasedTextures[lifetime.LastPass].push_back( resource );
+        }
+        else if ( m_Resources[resource].Producer.IsValid() )
+        {
+            producers[lifetime.FirstPass].push_back( m_Resources[resource].Producer );
+        }
+    }
+
+    CommandQueue* commandQueues[RenderGraphCompiler::NumQueueTypes] = {
+        &m_Device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT ),
+        &m_Device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE )
+    };
+    // The command lists that are recorded for each queue but not executed yet. The last command list
+    // is the one that is being recorded. Parallel passes add the command lists of their chunks.
+    std::vector<std::shared_ptr<CommandList>> commandLists[RenderGraphCompiler::NumQueueTypes];
+
+    // The sync points of the passes that other queues wait for.
+    std::vector<SyncPoint> syncPoints( numCompiledPasses );
+
+    for ( uint32_t i = 0; i < numCompiledPasses; ++i )
+    {
+        const auto& compiledPass      = compiledPasses[i];
+        auto&       pass              = m_Passes[compiledPass.PassIndex];
+        auto&       commandQueue      = *commandQueues[compiledPass.Queue];
+        auto&       queueCommandLists = commandLists[compiledPass.Queue];
+
+        if ( compiledPass.WaitForPass != RenderGraphCompiler::InvalidIndex )
+        {
+            // The work that was recorded before the wait doesn't depend on the other queue.
+            if ( !queueCommandLists.empty() )
+            {
+                commandQueue.ExecuteCommandLists( queueCommandLists );
+                queueCommandLists.clear();
+            }
+
+            commandQueue.Wait( syncPoints[compiledPass.WaitForPass] );
+        }
+
+        if ( queueCommandLists.empty() )
+        {
+            queueCommandLists.push_back( commandQueue.GetCommandList() );
+        }
+
+        auto commandList = queueCommandLists.back();
+
+        for ( const auto& producer: producers[i] )
+        {
+            commandList->AddDependency( producer );
+        }
+
+        if ( m_Profiler )
+        {
+            commandList->BeginProfileScope( *m_Profiler, ConvertString( pass.Name ) );
+        }
+
+        for ( auto resource: acquiredTextures[i] )
+        {
+            auto& textureResource   = m_Resources[resource];
+            textureResource.Texture = m_TransientTextureAllocator.AcquireTexture(
+                *commandList, textureResource.ResourceDesc,
+                textureResource.HasClearValue ? &textureResource.ClearValue : nullptr, textureResource.Name );
+
+            // The compiler doesn't plan a barrier for the first use of a transient texture, but a cached
+            // texture is still in the state it was left in by the previous frame.
+            D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+            for ( const auto& access: pass.PassDesc.Accesses )
+            {
+                if ( access.Resource == resource )
+                {
+                    state |= access.State;
+                }
+            }
+            commandList->TransitionBarrier( textureResource.Texture, state );
+        }
+
+        RecordBarriers( *commandList, compiledPass.BarriersBefore );
+
+        if ( pass.Execute )
+        {
+            pass.Execute( *commandList, *this );
+        }
+
+        if ( pass.Recorder )
+        {
+            auto chunkCommandLists = pass.Recorder->Record(
+                *commandList, pass.NumChunks,
+                [this, &pass]( CommandList& chunkCommandList, uint32_t chunk, uint32_t numChunks ) {
+                    pass.RecordChunk( chunkCommandList, chunk, numChunks, *this );
+                } );
+            queueCommandLists.insert( queueCommandLists.end(), chunkCommandLists.begin(), chunkCommandLists.end() );
+
+            // The barriers after the pass must be executed after the chunks, and so must the end of its scope.
+            auto passCommandList = commandList;
+            commandList          = commandQueue.GetCommandList();
+            commandList->ContinueProfileScopes( *passCommandList );
+            queueCommandLists.push_back( commandList );
+        }
+
+        RecordBarriers( *commandList, compiledPass.BarriersAfter );
+
+        if ( m_Profiler )
+        {
+            commandList->EndProfileScope();
+        }
+
+        for ( auto resource: releasedTextures[i] )
+        {
+            auto& textureResource = m_Resources[resource];
+            m_TransientTextureAllocator.ReleaseTexture( textureResource.Texture );
+            textureResource.Texture.reset();
+        }
+
+        if ( compiledPass.Signal )
+        {
+            syncPoints[i] = commandQueue.ExecuteCommandLists( queueCommandLists );
+            queueCommandLists.clear();
+        }
+    }
+
+    if ( !commandLists[RenderGraphCompiler::ComputeQueue].empty() )
+    {
+        commandQueues[RenderGraphCompiler::ComputeQueue]->ExecuteCommandLists(
+            commandLists[RenderGraphCompiler::ComputeQueue] );
+    }
+
+    auto& directQueue = *commandQueues[RenderGraphCompiler::GraphicsQueue];
+    if ( !commandLists[RenderGraphCompiler::GraphicsQueue].empty() )
+    {
+        return directQueue.ExecuteCommandLists( commandLists[RenderGraphCompiler::GraphicsQueue] );
+    }
+
+    return { &directQueue, directQueue.Signal() };
+}
+
+void RenderGraph::RecordBarriers( CommandList& commandList, const std::vector<RenderGraphCompiler::Barrier>& barriers )
+{
+    for ( const auto& barrier: barriers )
+    {
+        const auto& texture = m_Resources[barrier.Resource].Texture;
+
+        if ( barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV )
+        {
+            commandList.UAVBarrier( texture );
+        }
+        else if ( ( barrier.Flags & D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY ) != 0 )
+        {
+            commandList.BeginTransitionBarrier( texture, barrier.StateAfter );
+        }
+        else
+        {
+            // The end of a split transition is recorded as a normal transition.
+            commandList.TransitionBarrier( texture, barrier.StateAfter );
+        }
+    }
+}
+
+std::shared_ptr<Texture> RenderGraph::GetTexture( ResourceID resource ) const
+{
+    assert( resource < m_Resources.size() );
+    return m_Resources[resource].Texture;
+}
+
+void RenderGraph::Reset()
+{
+    m_Resources.clear();
+    m_Passes.clear();
+    m_Compiler.Reset();
+
+    m_IsCompiled = false;
+}
@@ -0,0 +1,456 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/RenderGraphCompiler.h>
+
+#include <dx12lib/ResourceBarrierOptimizer.h>
+
+#include <queue>
+
+using namespace DX12_Library;
+
+namespace
+{
+// States that can be used on a compute queue.
+const D3D12_RESOURCE_STATES ComputeQueueStates =
+    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT |
+    D3D12_RESOURCE_STATE_COPY_DEST | D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+void AddUnique( std::vector<uint32_t>& passes, uint32_t pass )
+{
+    if ( std::find( passes.begin(), passes.end(), pass ) == passes.end() )
+    {
+        passes.push_back( pass );
+    }
+}
+}  // namespace
+
+RenderGraphCompiler::RenderGraphCompiler()
+: m_Statistics {}
+{}
+
+bool RenderGraphCompiler::IsComputeQueueState( D3D12_RESOURCE_STATES state )
+{
+    return ( state & ~ComputeQueueStates ) == 0;
+}
+
+uint32_t RenderGraphCompiler::AddResource( const ResourceDesc& resourceDesc )
+{
+    m_Resources.push_back( resourceDesc );
+    return static_cast<uint32_t>( m_Resources.size() - 1 );
+}
+
+uint32_t RenderGraphCompiler::AddPass( const PassDesc& passDesc )
+{
+#if defined( _DEBUG )
+    for ( const auto& access: passDesc.Accesses )
+    {
+        assert( access.Resource < m_Resources.size() );
+    }
+#endif
+
+    m_Passes.push_back( passDesc );
+    return static_cast<uint32_t>( m_Passes.size() - 1 );
+}
+
+void RenderGraphCompiler::Compile()
+{
+    m_Statistics           = {};
+    m_Statistics.NumPasses = GetNumPasses();
+
+    BuildDependencies();
+    CullPasses();
+    SortPasses();
+    AssignQueues();
+    AddQueueWaits();
+    PlanBarriers();
+
+    m_Statistics.NumCulledPasses = m_Statistics.NumPasses - static_cast<uint32_t>( m_CompiledPasses.size() );
+}
+
+void RenderGraphCompiler::BuildDependencies()
+{
+    struct ResourceUsage
+    {
+        uint32_t              LastWriter = InvalidIndex;
+        std::vector<uint32_t> Readers;
+        D3D12_RESOURCE_STATES ReadState = D3D12_RESOURCE_STATE_COMMON;
+    };
+
+    std::vector<ResourceUsage> usages( m_Resources.size() );
+
+    m_Dependencies.assign( m_Passes.size(), {} );
+    m_Producers.assign( m_Passes.size(), {} );
+
+    for ( uint32_t pass = 0; pass < GetNumPasses(); ++pass )
+    {
+        auto& dependencies = m_Dependencies[pass];
+
+        for ( const auto& access: m_Passes[pass].Accesses )
+        {
+            auto& usage = usages[access.Resource];
+
+            if ( access.Type != Write && usage.LastWriter != InvalidIndex && usage.LastWriter != pass )
+            {
+                // Read after write.
+                AddUnique( dependencies, usage.LastWriter );
+                AddUnique( m_Producers[pass], usage.LastWriter );
+            }
+
+            if ( access.Type == Read )
+            {
+                // The resource is transitioned to a different read state, which can't happen while it is read.
+                if ( !usage.Readers.empty() && access.State != usage.ReadState )
+                {
+                    for ( auto reader: usage.Readers )
+                    {
+                        if ( reader != pass )
+                        {
+                            AddUnique( dependencies, reader );
+                        }
+                    }
+                }
+
+                AddUnique( usage.Readers, pass );
+                usage.ReadState = access.State;
+            }
+            else
+            {
+                // Write after read and write after write.
+                for ( auto reader: usage.Readers )
+                {
+                    if ( reader != pass )
+                    {
+                        AddUnique( dependencies, reader );
+                    }
+                }
+                if ( usage.LastWriter != InvalidIndex && usage.LastWriter != pass )
+                {
+                    AddUnique( dependencies, usage.LastWriter );
+                }
+
+                usage.LastWriter = pass;
+                usage.Readers.clear();
+            }
+        }
+    }
+}
+
+void RenderGraphCompiler::CullPasses()
+{
+    m_IsPassUsed.assign( m_Passes.size(), false );
+
+    for ( uint32_t pass = 0; pass < GetNumPasses(); ++pass )
+    {
+        const auto& passDesc = m_Passes[pass];
+        if ( ( passDesc.Flags & PassFlagSideEffects ) != 0 )
+        {
+            m_IsPassUsed[pass] = true;
+            continue;
+        }
+
+        for ( const auto& access: passDesc.Accesses )
+        {
+            if ( access.Type != Read && m_Resources[access.Resource].IsImported )
+            {
+                m_IsPassUsed[pass] = true;
+                break;
+            }
+        }
+    }
+
+    // Producers are always added before the passes that read their results,
+    // so a single pass from the back marks all passes that are needed.
+    for ( uint32_t pass = GetNumPasses(); pass-- > 0; )
+    {
+        if ( m_IsPassUsed[pass] )
+        {
+            for ( auto producer: m_Producers[pass] )
+            {
+                m_IsPassUsed[producer] = true;
+            }
+        }
+    }
+}
+
+void RenderGraphCompiler::SortPasses()
+{
+    auto numPasses = GetNumPasses();
+
+    std::vector<uint32_t>              numDependencies( numPasses, 0 );
+    std::vector<std::vector<uint32_t>> dependents( numPasses );
+
+    for ( uint32_t pass = 0; pass < numPasses; ++pass )
+    {
+        if ( !m_IsPassUsed[pass] )
+        {
+            continue;
+        }
+
+        for ( auto dependency: m_Dependencies[pass] )
+        {
+            if ( m_IsPassUsed[dependency] )
+            {
+                ++numDependencies[pass];
+                dependents[dependency].push_back( pass );
+            }
+        }
+    }
+
+    // Of all passes that are ready, the pass that was added first is executed first.
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> readyPasses;
+    for ( uint32_t pass = 0; pass < numPasses; ++pass )
+    {
+        if ( m_IsPassUsed[pass] && numDependencies[pass] == 0 )
+        {
+            readyPasses.push( pass );
+        }
+    }
+
+    m_CompiledPasses.clear();
+    m_CompiledPassIndices.assign( numPasses, InvalidIndex );
+
+    while ( !readyPasses.empty() )
+    {
+        auto pass = readyPasses.top();
+        readyPasses.pop();
+
+        m_CompiledPassIndices[pass] = static_cast<uint32_t>( m_CompiledPasses.size() );
+
+        CompiledPass compiledPass;
+        compiledPass.PassIndex   = pass;
+        compiledPass.Queue       = GraphicsQueue;
+        compiledPass.WaitForPass = InvalidIndex;
+        compiledPass.Signal      = false;
+        m_CompiledPasses.push_back( compiledPass );
+
+        for ( auto dependent: dependents[pass] )
+        {
+            if ( --numDependencies[dependent] == 0 )
+            {
+                readyPasses.push( dependent );
+            }
+        }
+    }
+}
+
+void RenderGraphCompiler::AssignQueues()
+{
+    // The state of every resource before the current pass.
+    std::vector<D3D12_RESOURCE_STATES> states( m_Resources.size() );
+    for ( size_t i = 0; i < m_Resources.size(); ++i )
+    {
+        states[i] = m_Resources[i].InitialState;
+    }
+
+    for ( auto& compiledPass: m_CompiledPasses )
+    {
+        const auto& passDesc = m_Passes[compiledPass.PassIndex];
+
+        // Transient resources are aliased on the graphics queue, so the passes that use them stay there.
+        // The resources must be in states that the compute queue supports before and during the pass.
+        bool isAsyncCompute = ( passDesc.Flags & PassFlagAllowAsyncCompute ) != 0;
+        for ( const auto& access: passDesc.Accesses )
+        {
+            isAsyncCompute = isAsyncCompute && m_Resources[access.Resource].IsImported &&
+                             IsComputeQueueState( access.State ) && IsComputeQueueState( states[access.Resource] );
+        }
+
+        // Resources that are already in a combination of read states are not transitioned (see PlanBarriers).
+        for ( const auto& access: passDesc.Accesses )
+        {
+            if ( !ResourceBarrierOptimizer::IsStateCompatible( states[access.Resource], access.State ) )
+            {
+                states[access.Resource] = access.State;
+            }
+        }
+
+        if ( isAsyncCompute )
+        {
+            compiledPass.Queue = ComputeQueue;
+            ++m_Statistics.NumAsyncComputePasses;
+        }
+    }
+}
+
+void RenderGraphCompiler::AddQueueWaits()
+{
+    // The last pass of the other queue that each queue waited for.
+    // Waiting for a pass also waits for the passes before it on the same queue.
+    uint32_t waitedForPass[NumQueueTypes] = { InvalidIndex, InvalidIndex };
+
+    for ( auto& compiledPass: m_CompiledPasses )
+    {
+        uint32_t waitForPass = InvalidIndex;
+        for ( auto dependency: m_Dependencies[compiledPass.PassIndex] )
+        {
+            auto compiledDependency = m_CompiledPassIndices[dependency];
+            if ( compiledDependency != InvalidIndex &&
+                 m_CompiledPasses[compiledDependency].Queue != compiledPass.Queue &&
+                 ( waitForPass == InvalidIndex || compiledDependency > waitForPass ) )
+            {
+                waitForPass = compiledDependency;
+            }
+        }
+
+        auto& waitedFor = waitedForPass[compiledPass.Queue];
+        if ( waitForPass != InvalidIndex && ( waitedFor == InvalidIndex || waitForPass > waitedFor ) )
+        {
+            compiledPass.WaitForPass               = waitForPass;
+            m_CompiledPasses[waitForPass].Signal = true;
+            waitedFor                              = waitForPass;
+
+            ++m_Statistics.NumQueueWaits;
+        }
+    }
+}
+
+void RenderGraphCompiler::PlanBarriers()
+{
+    auto numCompiledPasses = static_cast<uint32_t>( m_CompiledPasses.size() );
+
+    // Split barriers must begin and end in the same command list. The command list of a queue is
+    // executed after a pass that another queue waits for and before a pass that waits for another queue.
+    // The position of a pass in the passes of its queue tells if there are passes between two passes.
+    std::vector<uint32_t> commandListIndices( numCompiledPasses );
+    std::vector<uint32_t> queuePositions( numCompiledPasses );
+    {
+        uint32_t commandListIndex[NumQueueTypes] = {};
+        uint32_t queuePosition[NumQueueTypes]    = {};
+        bool     isSignaled[NumQueueTypes]       = {};
+
+        for ( uint32_t i = 0; i < numCompiledPasses; ++i )
+        {
+            const auto& compiledPass = m_CompiledPasses[i];
+            auto        queue        = compiledPass.Queue;
+
+            if ( compiledPass.WaitForPass != InvalidIndex || isSignaled[queue] )
+            {
+                ++commandListIndex[queue];
+            }
+            isSignaled[queue] = compiledPass.Signal;
+
+            commandListIndices[i] = commandListIndex[queue];
+            queuePositions[i]     = queuePosition[queue]++;
+        }
+    }
+
+    struct ResourceUsage
+    {
+        D3D12_RESOURCE_STATES State;
+        // The last compiled pass that used the resource.
+        uint32_t LastPass = InvalidIndex;
+        bool     LastPassWrites = false;
+    };
+
+    std::vector<ResourceUsage> usages( m_Resources.size() );
+    for ( size_t i = 0; i < m_Resources.size(); ++i )
+    {
+        usages[i].State = m_Resources[i].InitialState;
+    }
+
+    m_Lifetimes.assign( m_Resources.size(), { InvalidIndex, InvalidIndex } );
+
+    // The accesses of a pass, combined per resource.
+    std::vector<ResourceAccess> passAccesses;
+
+    for ( uint32_t i = 0; i < numCompiledPasses; ++i )
+    {
+        auto& compiledPass = m_CompiledPasses[i];
+
+        passAccesses.clear();
+        for ( const auto& access: m_Passes[compiledPass.PassIndex].Accesses )
+        {
+            auto iter = std::find_if( passAccesses.begin(), passAccesses.end(),
+                                      [&]( const ResourceAccess& a ) { return a.Resource == access.Resource; } );
+            if ( iter == passAccesses.end() )
+            {
+                passAccesses.push_back( access );
+            }
+            else
+            {
+                // A pass can read a resource in multiple read states, but it can't be written in one state
+                // and used in another one.
+                assert( iter->State == access.State || ( ResourceBarrierOptimizer::IsReadState( iter->State ) &&
+                                                         ResourceBarrierOptimizer::IsReadState( access.State ) ) );
+                iter->State |= access.State;
+                if ( access.Type != Read )
+                {
+                    iter->Type = ReadWrite;
+                }
+            }
+        }
+
+        for ( const auto& access: passAccesses )
+        {
+            auto& usage    = usages[access.Resource];
+            auto& lifetime = m_Lifetimes[access.Resource];
+
+            if ( lifetime.FirstPass == InvalidIndex )
+            {
+                lifetime.FirstPass = i;
+            }
+            lifetime.LastPass = i;
+
+            bool writes = access.Type != Read;
+
+            if ( usage.LastPass == InvalidIndex && !m_Resources[access.Resource].IsImported )
+            {
+                // Transient resources are initialized by their first pass.
+                usage.State = access.State;
+            }
+            else if ( ResourceBarrierOptimizer::IsStateCompatible( usage.State, access.State ) )
+            {
+                // Unordered access after unordered access needs a UAV barrier if either of them writes.
+                if ( access.State == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && usage.LastPass != InvalidIndex &&
+                     ( writes || usage.LastPassWrites ) )
+                {
+                    compiledPass.BarriersBefore.push_back( { access.Resource, D3D12_RESOURCE_BARRIER_TYPE_UAV,
+                                                             usage.State, usage.State,
+                                                             D3D12_RESOURCE_BARRIER_FLAG_NONE } );
+                    ++m_Statistics.NumBarriers;
+                }
+            }
+            else
+            {
+                Barrier barrier = { access.Resource, D3D12_RESOURCE_BARRIER_TYPE_TRANSITION, usage.State, access.State,
+                                    D3D12_RESOURCE_BARRIER_FLAG_NONE };
+
+                auto lastPass = usage.LastPass;
+                if ( lastPass != InvalidIndex && m_CompiledPasses[lastPass].Queue == compiledPass.Queue &&
+                     commandListIndices[lastPass] == commandListIndices[i] &&
+                     queuePositions[i] - queuePositions[lastPass] > 1 )
+                {
+                    // There are other passes between the last and the next use of the resource.
+                    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+                    m_CompiledPasses[lastPass].BarriersAfter.push_back( barrier );
+
+                    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+                    ++m_Statistics.NumSplitBarriers;
+                }
+
+                compiledPass.BarriersBefore.push_back( barrier );
+                ++m_Statistics.NumBarriers;
+
+                usage.State = access.State;
+            }
+
+            usage.LastPass       = i;
+            usage.LastPassWrites = writes;
+        }
+    }
+}
+
+void RenderGraphCompiler::Reset()
+{
+    m_Resources.clear();
+    m_Passes.clear();
+    m_Dependencies.clear();
+    m_Producers.clear();
+    m_IsPassUsed.clear();
+    m_CompiledPassIndices.clear();
+    m_CompiledPasses.clear();
+    m_Lifetimes.clear();
+
+    m_Statistics = {};
+}
@@ -22,6 +22,7 @@ Resource::Resource( Device& device, const D3D12_RESOURCE_DESC& resourceDesc, con
         D3D12_RESOURCE_STATE_COMMON, m_d3d12ClearValue.get(), IID_PPV_ARGS( &m_d3d12Resource ) ) );
 
     ResourceStateTracker::AddGlobalResourceState( m_d3d12Resource.Get(), D3D12_RESOURCE_STATE_COMMON );
+    m_TrackedResourceState = ResourceStateTracker::GetTrackedResourceState( m_d3d12Resource.Get() );
 
     CheckFeatureSupport();
 }
@@ -35,9 +36,17 @@ Resource::Resource( Device& device, Microsoft::WRL::ComPtr<ID3D12Resource> resou
     {
         m_d3d12ClearValue = std::make_unique<D3D12_CLEAR_VALUE>( *clearValue );
     }
+    m_TrackedResourceState = ResourceStateTracker::GetTrackedResourceState( m_d3d12Resource.Get() );
+
     CheckFeatureSupport();
 }
 
+void Resource::SetD3D12Resource( Microsoft::WRL::ComPtr<ID3D12Resource> resource )
+{
+    m_d3d12Resource        = resource;
+    m_TrackedResourceState = ResourceStateTracker::GetTrackedResourceState( m_d3d12Resource.Get() );
+}
+
 void Resource::SetName( const std::wstring& name )
 {
     m_ResourceName = name;
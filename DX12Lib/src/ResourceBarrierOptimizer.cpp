@@ -0,0 +1,267 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/ResourceBarrierOptimizer.h>
+
+using namespace DX12_Library;
+
+namespace
+{
+// States that only read from a resource and can be combined with each other.
+const D3D12_RESOURCE_STATES ReadStates =
+    D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+
+bool IsOverlapping( UINT subresourceA, UINT subresourceB )
+{
+    return subresourceA == subresourceB || subresourceA == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ||
+           subresourceB == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+}
+}  // namespace
+
+ResourceBarrierOptimizer::ResourceBarrierOptimizer()
+: m_Statistics {}
+{}
+
+bool ResourceBarrierOptimizer::IsReadState( D3D12_RESOURCE_STATES state )
+{
+    return state != D3D12_RESOURCE_STATE_COMMON && ( state & ~ReadStates ) == 0;
+}
+
+bool ResourceBarrierOptimizer::IsStateCompatible( D3D12_RESOURCE_STATES currentState,
+                                                  D3D12_RESOURCE_STATES requestedState )
+{
+    if ( currentState == requestedState )
+    {
+        return true;
+    }
+
+    return IsReadState( currentState ) && requestedState != D3D12_RESOURCE_STATE_COMMON &&
+           ( currentState & requestedState ) == requestedState;
+}
+
+uint32_t ResourceBarrierOptimizer::Optimize( std::vector<D3D12_RESOURCE_BARRIER>& barriers )
+{
+    auto numBarriers = static_cast<uint32_t>( barriers.size() );
+
+    m_CombinedStates.clear();
+
+    // A single barrier can't be optimized.
+    if ( numBarriers < 2 )
+    {
+        m_Statistics.NumBarriers += numBarriers;
+        return 0;
+    }
+
+    std::vector<D3D12_RESOURCE_BARRIER> batch;
+    batch.reserve( numBarriers );
+    m_OpenTransitions.clear();
+    m_UAVBarriers.clear();
+    m_IsRemoved.clear();
+
+    for ( const auto& barrier: barriers )
+    {
+        switch ( barrier.Type )
+        {
+        case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+        {
+            const auto& transition = barrier.Transition;
+
+            if ( ( barrier.Flags & D3D12_RESOURCE_BARRIER_FLAG_END_ONLY ) != 0 )
+            {
+                // If the split barrier began in this batch, the begin barrier becomes a normal barrier.
+                auto openTransition = FindOpenTransition( transition.pResource, transition.Subresource );
+                if ( openTransition && openTransition->IsSplitBegin )
+                {
+                    auto& beginBarrier = batch[openTransition->BarrierIndex];
+                    if ( beginBarrier.Transition.StateBefore == transition.StateBefore &&
+                         beginBarrier.Transition.StateAfter == transition.StateAfter )
+                    {
+                        beginBarrier.Flags &= ~D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+                        openTransition->IsSplitBegin = false;
+                        ++m_Statistics.NumCollapsedSplitBarriers;
+                        break;
+                    }
+                }
+
+                CloseOpenTransitions( batch, transition.pResource, transition.Subresource );
+                batch.push_back( barrier );
+                m_IsRemoved.push_back( false );
+            }
+            else if ( ( barrier.Flags & D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY ) != 0 )
+            {
+                CloseOpenTransitions( batch, transition.pResource, transition.Subresource );
+
+                m_OpenTransitions.push_back( { transition.pResource, transition.Subresource,
+                                               static_cast<uint32_t>( batch.size() ), transition.StateAfter,
+                                               true } );
+                batch.push_back( barrier );
+                m_IsRemoved.push_back( false );
+            }
+            else
+            {
+                AddTransition( batch, barrier );
+            }
+        }
+        break;
+        case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+        {
+            // There is no work between the barriers of a batch, so a second UAV barrier
+            // for the same resource (or after a UAV barrier for all resources) has no effect.
+            auto resource = barrier.UAV.pResource;
+            if ( std::find( m_UAVBarriers.begin(), m_UAVBarriers.end(), resource ) != m_UAVBarriers.end() ||
+                 std::find( m_UAVBarriers.begin(), m_UAVBarriers.end(), nullptr ) != m_UAVBarriers.end() )
+            {
+                break;
+            }
+
+            CloseOpenTransitions( batch, resource );
+            m_UAVBarriers.push_back( resource );
+
+            batch.push_back( barrier );
+            m_IsRemoved.push_back( false );
+        }
+        break;
+        default:
+        {
+            // Transitions are never merged across aliasing barriers.
+            CloseOpenTransitions( batch, barrier.Aliasing.pResourceBefore );
+            CloseOpenTransitions( batch, barrier.Aliasing.pResourceAfter );
+
+            batch.push_back( barrier );
+            m_IsRemoved.push_back( false );
+        }
+        break;
+        }
+    }
+
+    // The remaining open transitions are the final transitions of the (sub)resources in the batch.
+    for ( const auto& openTransition: m_OpenTransitions )
+    {
+        const auto& barrier = batch[openTransition.BarrierIndex];
+        if ( !m_IsRemoved[openTransition.BarrierIndex] && !openTransition.IsSplitBegin &&
+             barrier.Transition.StateAfter != openTransition.RequestedState )
+        {
+            m_CombinedStates.push_back(
+                { openTransition.Resource, openTransition.Subresource, barrier.Transition.StateAfter } );
+        }
+    }
+
+    barriers.clear();
+    for ( size_t i = 0; i < batch.size(); ++i )
+    {
+        if ( !m_IsRemoved[i] )
+        {
+            barriers.push_back( batch[i] );
+        }
+    }
+
+    auto numRemovedBarriers = numBarriers - static_cast<uint32_t>( barriers.size() );
+
+    m_Statistics.NumBarriers += numBarriers;
+    m_Statistics.NumRemovedBarriers += numRemovedBarriers;
+    m_Statistics.NumCombinedReadStates += static_cast<uint32_t>( m_CombinedStates.size() );
+
+    return numRemovedBarriers;
+}
+
+void ResourceBarrierOptimizer::AddTransition( std::vector<D3D12_RESOURCE_BARRIER>& batch,
+                                              const D3D12_RESOURCE_BARRIER&        barrier )
+{
+    const auto& transition = barrier.Transition;
+
+    // Transitions of other subresources that overlap with this transition can't be merged anymore.
+    for ( size_t i = 0; i < m_OpenTransitions.size(); )
+    {
+        const auto& openTransition = m_OpenTransitions[i];
+        if ( openTransition.Resource == transition.pResource &&
+             ( openTransition.Subresource != transition.Subresource || openTransition.IsSplitBegin ) &&
+             IsOverlapping( openTransition.Subresource, transition.Subresource ) )
+        {
+            CloseOpenTransitions( batch, transition.pResource, openTransition.Subresource );
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    m_UAVBarriers.erase( std::remove( m_UAVBarriers.begin(), m_UAVBarriers.end(), transition.pResource ),
+                         m_UAVBarriers.end() );
+
+    auto openTransition = FindOpenTransition( transition.pResource, transition.Subresource );
+    if ( !openTransition )
+    {
+        m_OpenTransitions.push_back( { transition.pResource, transition.Subresource,
+                                       static_cast<uint32_t>( batch.size() ), transition.StateAfter, false } );
+        batch.push_back( barrier );
+        m_IsRemoved.push_back( false );
+        return;
+    }
+
+    // Merge the transition with the previous transition of the (sub)resource.
+    auto& mergedTransition = batch[openTransition->BarrierIndex].Transition;
+
+    auto stateAfter = transition.StateAfter;
+    if ( IsReadState( mergedTransition.StateAfter ) && IsReadState( stateAfter ) )
+    {
+        stateAfter |= mergedTransition.StateAfter;
+    }
+
+    if ( stateAfter == mergedTransition.StateBefore )
+    {
+        // The (sub)resource ends up in the state it started in.
+        m_IsRemoved[openTransition->BarrierIndex] = true;
+        m_OpenTransitions.erase( m_OpenTransitions.begin() + ( openTransition - m_OpenTransitions.data() ) );
+    }
+    else
+    {
+        mergedTransition.StateAfter    = stateAfter;
+        openTransition->RequestedState = transition.StateAfter;
+    }
+}
+
+ResourceBarrierOptimizer::OpenTransition* ResourceBarrierOptimizer::FindOpenTransition( ID3D12Resource* resource,
+                                                                                        UINT subresource )
+{
+    for ( auto& openTransition: m_OpenTransitions )
+    {
+        if ( openTransition.Resource == resource && openTransition.Subresource == subresource )
+        {
+            return &openTransition;
+        }
+    }
+
+    return nullptr;
+}
+
+void ResourceBarrierOptimizer::CloseOpenTransitions( std::vector<D3D12_RESOURCE_BARRIER>& batch,
+                                                     ID3D12Resource* resource, UINT subresource )
+{
+    auto iter = m_OpenTransitions.begin();
+    while ( iter != m_OpenTransitions.end() )
+    {
+        if ( resource != nullptr &&
+             ( iter->Resource != resource || !IsOverlapping( iter->Subresource, subresource ) ) )
+        {
+            ++iter;
+            continue;
+        }
+
+        // The state that the (sub)resource is expected to be in by the following barriers is the requested state.
+        auto& transition = batch[iter->BarrierIndex].Transition;
+        if ( !iter->IsSplitBegin && transition.StateAfter != iter->RequestedState )
+        {
+            transition.StateAfter = iter->RequestedState;
+            if ( transition.StateAfter == transition.StateBefore )
+            {
+                m_IsRemoved[iter->BarrierIndex] = true;
+            }
+        }
+
+        iter = m_OpenTransitions.erase( iter );
+    }
+}
+
+void ResourceBarrierOptimizer::ResetStatistics()
+{
+    m_Statistics = {};
+}
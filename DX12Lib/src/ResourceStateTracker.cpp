@@ -8,12 +8,16 @@
 using namespace DX12_Library;
 
 // Static definitions.
-std::mutex                             ResourceStateTracker::ms_GlobalMutex;
-bool                                   ResourceStateTracker::ms_IsLocked = false;
-ResourceStateTracker::ResourceStateMap ResourceStateTracker::ms_GlobalResourceState;
+std::array<ResourceStateTracker::TrackedResourceStateShard, ResourceStateTracker::NumTrackedResourceStateShards>
+                                 ResourceStateTracker::ms_TrackedResourceStateShards;
+ResourceStateTracker::Statistics ResourceStateTracker::ms_FrameStatistics         = {};
+ResourceStateTracker::Statistics ResourceStateTracker::ms_PreviousFrameStatistics = {};
+std::mutex                       ResourceStateTracker::ms_StatisticsMutex;
 //ResourceStateTracker::ResourceList     ResourceStateTracker::ms_GarbageResources;
 
-ResourceStateTracker::ResourceStateTracker() {}
+ResourceStateTracker::ResourceStateTracker()
+: m_NumSplitTransitions( 0 )
+{}
 
 ResourceStateTracker::~ResourceStateTracker() {}
 
@@ -21,66 +25,120 @@ void ResourceStateTracker::ResourceBarrier( const D3D12_RESOURCE_BARRIER& barrie
 {
     if ( barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION )
     {
-        const D3D12_RESOURCE_TRANSITION_BARRIER& transitionBarrier = barrier.Transition;
+        // Resources that were already used on the command list are found without the global lookup.
+        auto                  iter = m_FinalResourceStateIndices.find( barrier.Transition.pResource );
+        TrackedResourceState* trackedState;
+        if ( iter != m_FinalResourceStateIndices.end() )
+        {
+            trackedState = m_FinalResourceStates[iter->second].TrackedState;
+        }
+        else
+        {
+            trackedState = FindTrackedResourceState( barrier.Transition.pResource );
+        }
+        if ( trackedState )
+        {
+            TransitionResource( trackedState, barrier );
+        }
+    }
+    else
+    {
+        // Just push non-transition barriers to the resource barriers array.
+        m_ResourceBarriers.push_back( barrier );
+    }
+}
+
+ResourceState* ResourceStateTracker::FindFinalResourceState( TrackedResourceState* trackedState )
+{
+    // Most of the time the hint points to the final state of the resource in this command list.
+    uint32_t index = trackedState->FinalStateIndexHint.load( std::memory_order_relaxed );
+    if ( index < m_FinalResourceStates.size() && m_FinalResourceStates[index].TrackedState == trackedState )
+    {
+        return &m_FinalResourceStates[index].State;
+    }
+
+    // The hint was overwritten by another command list that used the same resource.
+    const auto iter = m_FinalResourceStateIndices.find( trackedState->Resource );
+    if ( iter != m_FinalResourceStateIndices.end() )
+    {
+        trackedState->FinalStateIndexHint.store( iter->second, std::memory_order_relaxed );
+        return &m_FinalResourceStates[iter->second].State;
+    }
+
+    return nullptr;
+}
+
+void ResourceStateTracker::TransitionResource( TrackedResourceState* trackedState, const D3D12_RESOURCE_BARRIER& barrier )
+{
+    const D3D12_RESOURCE_TRANSITION_BARRIER& transitionBarrier = barrier.Transition;
 
-        // Check if there is already known final state for the resource.
-        // If there is a final state it means the resource has already been used on the command list before,
-        // and already has a known state on the command list execution.
-        const auto iter = m_FinalResourceState.find( transitionBarrier.pResource );
-        if ( iter != m_FinalResourceState.end() )
+    // A resource that is in the middle of a split transition must finish it first.
+    if ( !m_SplitTransitions.empty() )
+    {
+        EndSplitTransitions( trackedState );
+    }
+
+    // Check if there is already known final state for the resource.
+    // If there is a final state it means the resource has already been used on the command list before,
+    // and already has a known state on the command list execution.
+    ResourceState* finalState = FindFinalResourceState( trackedState );
+    if ( finalState )
+    {
+        // If the known final state of the resource is different...
+        if ( transitionBarrier.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
+             finalState->HasSubresourceStates() )
         {
-            auto& resourceState = iter->second;
-            // If the known final state of the resource is different...
-            if ( transitionBarrier.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
-                 !resourceState.SubresourceState.empty() )
-            {
-                // First transition all of the subresources if they are different than the StateAfter.
-                for ( auto subresourceState: resourceState.SubresourceState )
+            // First transition all of the subresources if they are different than the StateAfter.
+            // If there are resources that are in a different state then a transition barrier for each
+            // subresource that is not in the correct state is added to the ResourceBarriers vector.
+            finalState->ForEachSubresourceState( [&]( UINT subresource, D3D12_RESOURCE_STATES state ) {
+                if ( transitionBarrier.StateAfter != state )
                 {
-                    // If there are resources that are in a different state then a transition barrier for each
-                    // subresource that is not in the correct state is added to the ResourceBarriers vector.
-                    if ( transitionBarrier.StateAfter != subresourceState.second )
-                    {
-                        D3D12_RESOURCE_BARRIER newBarrier = barrier;
-                        newBarrier.Transition.Subresource = subresourceState.first;
-                        newBarrier.Transition.StateBefore = subresourceState.second;
-                        m_ResourceBarriers.push_back( newBarrier );
-                    }
-                }
-            }
-            else
-            {
-                // If the transition barrier is transitioning only a single subresouce or
-                // all the subresources are in the same state and the current state of the (sub)resource
-                // is different than the requested state then a single transition barrier is added to the
-                // ResourceBarriers vector.
-                auto finalState = resourceState.GetSubresourceState( transitionBarrier.Subresource );
-                if ( transitionBarrier.StateAfter != finalState )
-                {
-                    // Push a new transition barrier with the correct before state.
                     D3D12_RESOURCE_BARRIER newBarrier = barrier;
-                    newBarrier.Transition.StateBefore = finalState;
+                    newBarrier.Transition.Subresource = subresource;
+                    newBarrier.Transition.StateBefore = state;
                     m_ResourceBarriers.push_back( newBarrier );
                 }
-            }
+            } );
         }
-        else  // In this case, the resource is being used on the command list for the first time.
+        else
         {
-            // Add a pending barrier. The pending barriers will be resolved
-            // before the command list is executed on the command queue.
-            m_PendingResourceBarriers.push_back( barrier );
-        }
+            // If the transition barrier is transitioning only a single subresouce or
+            // all the subresources are in the same state and the current state of the (sub)resource
+            // is different than the requested state then a single transition barrier is added to the
+            // ResourceBarriers vector.
+            auto state = finalState->GetSubresourceState( transitionBarrier.Subresource );
+            if ( ResourceBarrierOptimizer::IsStateCompatible( state, transitionBarrier.StateAfter ) )
+            {
+                // The (sub)resource is already in the requested state or in a combination
+                // of read states that includes the requested state.
+                return;
+            }
 
-        // Push the final known state (possibly replacing the previously known state for the subresource).
-        m_FinalResourceState[transitionBarrier.pResource].SetSubresourceState( transitionBarrier.Subresource,
-                                                                               transitionBarrier.StateAfter );
+            // Push a new transition barrier with the correct before state.
+            D3D12_RESOURCE_BARRIER newBarrier = barrier;
+            newBarrier.Transition.StateBefore = state;
+            m_ResourceBarriers.push_back( newBarrier );
+        }
     }
-    else
+    else  // In this case, the resource is being used on the command list for the first time.
     {
-        // Just push non-transition barriers to the resource barriers array.
-        m_ResourceBarriers.push_back( barrier );
+        // Add a pending barrier. The pending barriers will be resolved
+        // before the command list is executed on the command queue.
+        m_PendingResourceBarriers.push_back( { barrier, trackedState } );
+
+        auto index = static_cast<uint32_t>( m_FinalResourceStates.size() );
+        m_FinalResourceStates.push_back( { trackedState, ResourceState() } );
+        m_FinalResourceStateIndices.emplace( trackedState->Resource, index );
+        trackedState->FinalStateIndexHint.store( index, std::memory_order_relaxed );
+
+        finalState = &m_FinalResourceStates.back().State;
     }
+
+    // Push the final known state (possibly replacing the previously known state for the subresource).
+    finalState->SetSubresourceState( transitionBarrier.Subresource, transitionBarrier.StateAfter );
 }
+
 // Helper methods to forward a transition barrier to the ResourceBarriers
 void ResourceStateTracker::TransitionResource( ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter,
                                                UINT subResource )
@@ -95,8 +153,81 @@ void ResourceStateTracker::TransitionResource( ID3D12Resource* resource, D3D12_R
 void ResourceStateTracker::TransitionResource( const Resource& resource, D3D12_RESOURCE_STATES stateAfter,
                                                UINT subResource )
 {
-    TransitionResource( resource.GetD3D12Resource().Get(), stateAfter, subResource );
+    TransitionResource( resource.GetTrackedResourceState(), stateAfter, subResource );
+}
+
+void ResourceStateTracker::TransitionResource( TrackedResourceState* trackedState, D3D12_RESOURCE_STATES stateAfter,
+                                               UINT subResource )
+{
+    if ( trackedState )
+    {
+        TransitionResource( trackedState, CD3DX12_RESOURCE_BARRIER::Transition( trackedState->Resource,
+                                                                                D3D12_RESOURCE_STATE_COMMON,
+                                                                                stateAfter, subResource ) );
+    }
+}
+void ResourceStateTracker::BeginTransitionResource( const Resource& resource, D3D12_RESOURCE_STATES stateAfter,
+                                                    UINT subResource )
+{
+    auto trackedState = resource.GetTrackedResourceState();
+    if ( !trackedState )
+    {
+        return;
+    }
+
+    if ( !m_SplitTransitions.empty() )
+    {
+        EndSplitTransitions( trackedState );
+    }
+
+    // The before state of a split barrier must be known when the barrier begins.
+    ResourceState* finalState = FindFinalResourceState( trackedState );
+    if ( !finalState ||
+         ( subResource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && finalState->HasSubresourceStates() ) )
+    {
+        TransitionResource( trackedState, stateAfter, subResource );
+        return;
+    }
+
+    auto stateBefore = finalState->GetSubresourceState( subResource );
+    if ( ResourceBarrierOptimizer::IsStateCompatible( stateBefore, stateAfter ) )
+    {
+        return;
+    }
+
+    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition( trackedState->Resource, stateBefore, stateAfter, subResource,
+                                                         D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY );
+    m_ResourceBarriers.push_back( barrier );
+
+    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+    m_SplitTransitions.push_back( { trackedState, barrier } );
+    ++m_NumSplitTransitions;
+
+    finalState->SetSubresourceState( subResource, stateAfter );
+}
+
+void ResourceStateTracker::EndSplitTransitions()
+{
+    EndSplitTransitions( nullptr );
+}
+
+void ResourceStateTracker::EndSplitTransitions( TrackedResourceState* trackedState )
+{
+    auto iter = m_SplitTransitions.begin();
+    while ( iter != m_SplitTransitions.end() )
+    {
+        if ( trackedState == nullptr || iter->TrackedState == trackedState )
+        {
+            m_ResourceBarriers.push_back( iter->EndBarrier );
+            iter = m_SplitTransitions.erase( iter );
+        }
+        else
+        {
+            ++iter;
+        }
+    }
 }
+
 // The UAVBarrier method is used to add UAV Barrier to the command list.
 // UAV barriers should only be used to synchronize read/write operations on the same UAV resource.
 void ResourceStateTracker::UAVBarrier( const Resource* resource )
@@ -122,6 +253,21 @@ void ResourceStateTracker::FlushResourceBarriers( const std::shared_ptr<CommandL
 {
     assert( commandList );
 
+    // Remove the redundant barriers of the batch.
+    m_BarrierOptimizer.Optimize( m_ResourceBarriers );
+
+    // Keep track of the read states that were added to the final states of the (sub)resources.
+    // The combined transitions were recorded on this command list, so the resources have final states.
+    for ( const auto& combinedState: m_BarrierOptimizer.GetCombinedStates() )
+    {
+        const auto iter = m_FinalResourceStateIndices.find( combinedState.Resource );
+        if ( iter != m_FinalResourceStateIndices.end() )
+        {
+            m_FinalResourceStates[iter->second].State.SetSubresourceState( combinedState.Subresource,
+                                                                           combinedState.State );
+        }
+    }
+
     UINT numBarriers = static_cast<UINT>( m_ResourceBarriers.size() );
     if ( numBarriers > 0 )
     {
@@ -133,85 +279,103 @@ void ResourceStateTracker::FlushResourceBarriers( const std::shared_ptr<CommandL
 
 // This method adds only the resource barriers that are required to transition the resource
 // into the correct state required by the command list. So the method adds the transition barriers to the intermediate
-// command list.
+// command list. The final state of each resource is committed to its global state at the same time.
 uint32_t ResourceStateTracker::FlushPendingResourceBarriers( const std::shared_ptr<CommandList>& commandList )
 {
-    assert( ms_IsLocked );
     assert( commandList );
 
+    ResourceBarriers resourceBarriers;
+
+    UINT numBarriers = ResolvePendingResourceBarriers( resourceBarriers );
+    if ( numBarriers > 0 )
+    {
+        auto d3d12CommandList = commandList->GetD3D12CommandList();
+        d3d12CommandList->ResourceBarrier( numBarriers, resourceBarriers.data() );
+    }
+
+    return numBarriers;
+}
+
+uint32_t ResourceStateTracker::ResolvePendingResourceBarriers( ResourceBarriers& resourceBarriers )
+{
+    // A pending barrier is added together with the final state when a resource is used for the first time.
+    assert( m_PendingResourceBarriers.size() == m_FinalResourceStates.size() );
+
     // Resolve the pending resource barriers by checking the global state of the
     // (sub)resources. Add barriers if the pending state and the global state do
     //  not match.
-    ResourceBarriers resourceBarriers;
+    size_t firstBarrier = resourceBarriers.size();
     // Reserve enough space (worst-case, all pending barriers).
-    resourceBarriers.reserve( m_PendingResourceBarriers.size() );
+    resourceBarriers.reserve( firstBarrier + m_PendingResourceBarriers.size() );
 
-    for ( auto pendingBarrier: m_PendingResourceBarriers )
+    for ( size_t i = 0; i < m_PendingResourceBarriers.size(); ++i )
     {
-        if ( pendingBarrier.Type ==
-             D3D12_RESOURCE_BARRIER_TYPE_TRANSITION )  // Only transition barriers should be pending...
-        {
-            auto pendingTransition = pendingBarrier.Transition;
+        const auto& pending      = m_PendingResourceBarriers[i];
+        auto        trackedState = pending.TrackedState;
+        assert( m_FinalResourceStates[i].TrackedState == trackedState );
 
-            const auto& iter = ms_GlobalResourceState.find( pendingTransition.pResource );
-            if ( iter != ms_GlobalResourceState.end() )
+        auto  pendingBarrier    = pending.Barrier;
+        auto& pendingTransition = pendingBarrier.Transition;
+
+        // Command lists of other queues that use the same resource can be submitted at the same time.
+        std::lock_guard<std::mutex> lock( trackedState->Mutex );
+
+        // Only transition barriers are pending. Resources without a global state are not transitioned.
+        if ( trackedState->IsTracked )
+        {
+            // If all subresources are being transitioned, and there are multiple
+            // subresources of the resource that are in a different state...
+            const auto& resourceState = trackedState->GlobalState;
+            if ( pendingTransition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
+                 resourceState.HasSubresourceStates() )
             {
-                // If all subresources are being transitioned, and there are multiple
-                // subresources of the resource that are in a different state...
-                auto& resourceState = iter->second;
-                if ( pendingTransition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
-                     !resourceState.SubresourceState.empty() )
-                {
-                    // Transition all subresources
-                    for ( auto subresourceState: resourceState.SubresourceState )
+                // Transition all subresources
+                resourceState.ForEachSubresourceState( [&]( UINT subresource, D3D12_RESOURCE_STATES state ) {
+                    if ( pendingTransition.StateAfter != state )
                     {
-                        if ( pendingTransition.StateAfter != subresourceState.second )
-                        {
-                            D3D12_RESOURCE_BARRIER newBarrier = pendingBarrier;
-                            newBarrier.Transition.Subresource = subresourceState.first;
-                            newBarrier.Transition.StateBefore = subresourceState.second;
-                            resourceBarriers.push_back( newBarrier );
-                        }
+                        D3D12_RESOURCE_BARRIER newBarrier = pendingBarrier;
+                        newBarrier.Transition.Subresource = subresource;
+                        newBarrier.Transition.StateBefore = state;
+                        resourceBarriers.push_back( newBarrier );
                     }
-                }
-                else
+                } );
+            }
+            else
+            {
+                // No (sub)resources need to be transitioned. Just add a single transition barrier (if needed).
+                auto globalState = resourceState.GetSubresourceState( pendingTransition.Subresource );
+                if ( pendingTransition.StateAfter != globalState )
                 {
-                    // No (sub)resources need to be transitioned. Just add a single transition barrier (if needed).
-                    auto globalState = ( iter->second ).GetSubresourceState( pendingTransition.Subresource );
-                    if ( pendingTransition.StateAfter != globalState )
-                    {
-                        // Fix-up the before state based on current global state of the resource.
-                        pendingBarrier.Transition.StateBefore = globalState;
-                        resourceBarriers.push_back( pendingBarrier );
-                    }
+                    // Fix-up the before state based on current global state of the resource.
+                    pendingTransition.StateBefore = globalState;
+                    resourceBarriers.push_back( pendingBarrier );
                 }
             }
         }
-    }
 
-    UINT numBarriers = static_cast<UINT>( resourceBarriers.size() );
-    if ( numBarriers > 0 )
-    {
-        auto d3d12CommandList = commandList->GetD3D12CommandList();
-        d3d12CommandList->ResourceBarrier( numBarriers, resourceBarriers.data() );
+        // Commit the final state of the resource to the global state of the resource.
+        trackedState->GlobalState = m_FinalResourceStates[i].State;
+        trackedState->IsTracked   = true;
     }
 
     m_PendingResourceBarriers.clear();
+    m_FinalResourceStates.clear();
+    m_FinalResourceStateIndices.clear();
 
-    return numBarriers;
-}
-
+    const auto& optimizerStatistics = m_BarrierOptimizer.GetStatistics();
+    {
+        std::lock_guard<std::mutex> lock( ms_StatisticsMutex );
 
-// This method ensures that the final state of the resource is commited to the static global state map.
-void ResourceStateTracker::CommitFinalResourceStates()
-{
-    assert( ms_IsLocked );
+        ms_FrameStatistics.NumBarriers += optimizerStatistics.NumBarriers;
+        ms_FrameStatistics.NumRemovedBarriers += optimizerStatistics.NumRemovedBarriers;
+        ms_FrameStatistics.NumCombinedReadStates += optimizerStatistics.NumCombinedReadStates;
+        ms_FrameStatistics.NumSplitBarriers += m_NumSplitTransitions - optimizerStatistics.NumCollapsedSplitBarriers;
+    }
 
-    // Commit final resource states to the global resource state array (map).
-    for ( const auto& resourceState: m_FinalResourceState )
-    { ms_GlobalResourceState[resourceState.first] = resourceState.second; }
+    m_BarrierOptimizer.ResetStatistics();
+    m_NumSplitTransitions = 0;
 
-    m_FinalResourceState.clear();
+    return static_cast<uint32_t>( resourceBarriers.size() - firstBarrier );
 }
 
 void ResourceStateTracker::Reset()
@@ -219,29 +383,67 @@ void ResourceStateTracker::Reset()
     // Reset the pending, current, and final resource states.
     m_PendingResourceBarriers.clear();
     m_ResourceBarriers.clear();
-    m_FinalResourceState.clear();
+    m_FinalResourceStates.clear();
+    m_FinalResourceStateIndices.clear();
+    m_SplitTransitions.clear();
+
+    m_BarrierOptimizer.ResetStatistics();
+    m_NumSplitTransitions = 0;
 
     //RemoveGarbageResources();
 }
 
-void ResourceStateTracker::Lock()
+void ResourceStateTracker::AddGlobalResourceState( ID3D12Resource* resource, D3D12_RESOURCE_STATES state )
 {
-    ms_GlobalMutex.lock();
-    ms_IsLocked = true;
-}
+    if ( resource != nullptr )
+    {
+        auto trackedState = FindTrackedResourceState( resource );
 
-void ResourceStateTracker::Unlock()
-{
-    ms_GlobalMutex.unlock();
-    ms_IsLocked = false;
+        std::lock_guard<std::mutex> lock( trackedState->Mutex );
+        trackedState->GlobalState.SetSubresourceState( D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state );
+        trackedState->IsTracked = true;
+    }
 }
 
-void ResourceStateTracker::AddGlobalResourceState( ID3D12Resource* resource, D3D12_RESOURCE_STATES state )
+std::shared_ptr<TrackedResourceState> ResourceStateTracker::GetTrackedResourceState( ID3D12Resource* resource )
 {
-    if ( resource != nullptr )
+    if ( resource == nullptr )
     {
-        std::lock_guard<std::mutex> lock( ms_GlobalMutex );
-        ms_GlobalResourceState[resource].SetSubresourceState( D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state );
+        return nullptr;
     }
+
+    // Resources are at least 16 byte aligned, so the lowest bits of the address are skipped.
+    auto& shard = ms_TrackedResourceStateShards[( reinterpret_cast<uintptr_t>( resource ) >> 4 ) %
+                                                 NumTrackedResourceStateShards];
+
+    std::lock_guard<std::mutex> lock( shard.Mutex );
+
+    auto& trackedState = shard.TrackedResourceStates[resource];
+    if ( !trackedState )
+    {
+        trackedState = std::make_shared<TrackedResourceState>( resource );
+    }
+
+    return trackedState;
+}
+
+TrackedResourceState* ResourceStateTracker::FindTrackedResourceState( ID3D12Resource* resource )
+{
+    // The tracked states are never removed so the pointer stays valid.
+    return GetTrackedResourceState( resource ).get();
 }
 
+ResourceStateTracker::Statistics ResourceStateTracker::GetFrameStatistics()
+{
+    std::lock_guard<std::mutex> lock( ms_StatisticsMutex );
+
+    return ms_PreviousFrameStatistics;
+}
+
+void ResourceStateTracker::EndFrame()
+{
+    std::lock_guard<std::mutex> lock( ms_StatisticsMutex );
+
+    ms_PreviousFrameStatistics = ms_FrameStatistics;
+    ms_FrameStatistics         = {};
+}
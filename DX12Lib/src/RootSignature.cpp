@@ -12,6 +12,7 @@ RootSignature::RootSignature( Device& device, const D3D12_ROOT_SIGNATURE_DESC1&
 , m_NumDescriptorsPerTable { 0 }
 , m_SamplerTableBitMask( 0 )
 , m_DescriptorTableBitMask( 0 )
+, m_BindlessTableBitMask( 0 )
 {
     SetRootSignatureDesc( rootSignatureDesc );
 }
@@ -42,6 +43,7 @@ void RootSignature::Destroy()
 
     m_DescriptorTableBitMask = 0;
     m_SamplerTableBitMask    = 0;
+    m_BindlessTableBitMask   = 0;
 
     memset( m_NumDescriptorsPerTable, 0, sizeof( m_NumDescriptorsPerTable ) );
 }
@@ -72,8 +74,21 @@ void RootSignature::SetRootSignatureDesc( const D3D12_ROOT_SIGNATURE_DESC1& root
             pParameters[i].DescriptorTable.NumDescriptorRanges = numDescriptorRanges;
             pParameters[i].DescriptorTable.pDescriptorRanges   = pDescriptorRanges;
 
+            // Tables with an unbounded range are used to index into the bindless descriptor heap.
+            // They are bound directly to the start of the bindless heap and are not staged by the
+            // DynamicDescriptorHeap.
+            bool isBindless = false;
+            for ( UINT j = 0; j < numDescriptorRanges; ++j )
+            {
+                isBindless = isBindless || pDescriptorRanges[j].NumDescriptors == UINT_MAX;
+            }
+
             // Set the bit mask depending on the type of descriptor table.
-            if ( numDescriptorRanges > 0 )
+            if ( isBindless )
+            {
+                m_BindlessTableBitMask |= ( 1 << i );
+            }
+            else if ( numDescriptorRanges > 0 )
             {
                 switch ( pDescriptorRanges[0].RangeType )
                 {
@@ -89,7 +104,7 @@ void RootSignature::SetRootSignatureDesc( const D3D12_ROOT_SIGNATURE_DESC1& root
             }
 
             // Count the number of descriptors in the descriptor table.
-            for ( UINT j = 0; j < numDescriptorRanges; ++j )
+            for ( UINT j = 0; j < numDescriptorRanges && !isBindless; ++j )
             { m_NumDescriptorsPerTable[i] += pDescriptorRanges[j].NumDescriptors; }
         }
     }
@@ -130,6 +130,7 @@ bool Scene::LoadSceneFromString( CommandList& commandList, const std::string& sc
 
 void Scene::ImportScene( CommandList& commandList, const aiScene& scene, std::filesystem::path parentPath )
 {
+    m_BVH.Clear();
 
     if ( m_RootNode )
     {
@@ -153,6 +154,9 @@ void Scene::ImportScene( CommandList& commandList, const aiScene& scene, std::fi
 
     // Import the root node.
     m_RootNode = ImportSceneNode( commandList, nullptr, scene.mRootNode );
+
+    // Compute the world transforms and bounds of the imported nodes and build the BVH over them.
+    UpdateTransforms();
 }
 
 void Scene::ImportMaterial( CommandList& commandList, const aiMaterial& material, std::filesystem::path parentPath )
@@ -410,6 +414,70 @@ std::shared_ptr<SceneNode> Scene::ImportSceneNode( CommandList& commandList, std
     return node;
 }
 
+void Scene::SetRootNode( std::shared_ptr<SceneNode> node )
+{
+    m_BVH.Clear();
+    m_RootNode = node;
+
+    // The cleared BVH is stale, so it is built by UpdateTransforms.
+    UpdateTransforms();
+}
+
+void Scene::UpdateTransforms()
+{
+    if ( m_RootNode )
+    {
+        m_RootNode->UpdateTransforms();
+    }
+
+    // The instances of a stale BVH no longer match the scene nodes and meshes.
+    if ( m_BVH.IsStale( *this ) )
+    {
+        BuildBVH();
+    }
+    else
+    {
+        m_BVH.Refit();
+    }
+
+    if ( IsNodeListStale() )
+    {
+        UpdateNodeList();
+    }
+}
+
+bool Scene::IsNodeListStale() const
+{
+    auto transforms = m_NodeListTransforms.lock();
+    if ( !m_RootNode )
+    {
+        return !m_NodeList.empty();
+    }
+
+    return transforms != m_RootNode->GetTransformHierarchy() || transforms->GetVersion() != m_NodeListVersion;
+}
+
+void Scene::UpdateNodeList()
+{
+    m_NodeList.clear();
+    m_NodeListTransforms.reset();
+    m_NodeListVersion = 0;
+
+    if ( m_RootNode )
+    {
+        m_RootNode->GetNodes( m_NodeList );
+
+        auto transforms      = m_RootNode->GetTransformHierarchy();
+        m_NodeListTransforms = transforms;
+        m_NodeListVersion    = transforms->GetVersion();
+    }
+}
+
+void Scene::BuildBVH()
+{
+    m_BVH.Build( *this );
+}
+
 void Scene::Accept( Visitor& visitor )
 {
     visitor.Visit( *this );
@@ -419,13 +487,42 @@ void Scene::Accept( Visitor& visitor )
     }
 }
 
+void Scene::Accept( Visitor& visitor, uint32_t chunk, uint32_t numChunks )
+{
+    assert( chunk < numChunks );
+
+    visitor.Visit( *this );
+    if ( !m_RootNode )
+    {
+        return;
+    }
+
+    // The chunks are visited in parallel, so a stale node list is not rebuilt here.
+    std::vector<SceneNode*>        nodes;
+    const std::vector<SceneNode*>* nodeList = &m_NodeList;
+    if ( IsNodeListStale() )
+    {
+        m_RootNode->GetNodes( nodes );
+        nodeList = &nodes;
+    }
+
+    size_t numNodes  = nodeList->size();
+    size_t firstNode = numNodes * chunk / numChunks;
+    size_t endNode   = numNodes * ( chunk + 1 ) / numChunks;
+
+    for ( size_t i = firstNode; i < endNode; ++i )
+    {
+        ( *nodeList )[i]->AcceptNode( visitor );
+    }
+}
+
 DirectX::BoundingBox Scene::GetAABB() const
 {
     DirectX::BoundingBox aabb { { 0, 0, 0 }, { 0, 0, 0 } };
 
     if ( m_RootNode )
     {
-        aabb = m_RootNode->GetAABB();
+        aabb = m_RootNode->GetWorldAABB();
     }
 
     return aabb;
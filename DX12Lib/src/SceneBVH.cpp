@@ -0,0 +1,732 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/SceneBVH.h>
+
+#include <dx12lib/Mesh.h>
+#include <dx12lib/Scene.h>
+#include <dx12lib/SceneNode.h>
+#include <dx12lib/Visitor.h>
+
+using namespace DX12_Library;
+using namespace DirectX;
+
+namespace
+{
+
+// The cost of visiting a node relative to the cost of testing an instance.
+const float TraversalCost = 1.0f;
+// Rebuild the tree if refitting more than doubled its SAH cost.
+const float RebuildThreshold = 2.0f;
+// The parent of the root node.
+const uint32_t InvalidNode = UINT32_MAX;
+
+// Collect the meshes of the scene nodes.
+class InstanceCollector : public Visitor
+{
+public:
+    explicit InstanceCollector( std::vector<SceneBVH::Instance>& instances )
+    : m_Instances( instances )
+    {}
+
+    void Visit( Scene& ) override {}
+
+    void Visit( SceneNode& sceneNode ) override
+    {
+        // The meshes are taken from the scene node instead of being visited, since the instances need the
+        // shared pointers of the meshes to refer to them.
+        auto node = sceneNode.shared_from_this();
+
+        std::shared_ptr<Mesh> mesh;
+        for ( size_t i = 0; ( mesh = sceneNode.GetMesh( i ) ) != nullptr; ++i )
+        {
+            SceneBVH::Instance instance;
+            instance.Node      = node;
+            instance.Mesh      = mesh;
+            instance.Transform = sceneNode.GetTransformHandle();
+            instance.LocalAABB = mesh->GetAABB();
+
+            m_Instances.push_back( instance );
+        }
+    }
+
+    void Visit( Mesh& ) override {}
+
+private:
+    std::vector<SceneBVH::Instance>& m_Instances;
+};
+
+BoundingBox ComputeWorldAABB( const SceneBVH::Instance& instance, const TransformHierarchy& transforms )
+{
+    BoundingBox aabb;
+    instance.LocalAABB.Transform( aabb, transforms.GetWorldTransform( instance.Transform ) );
+
+    return aabb;
+}
+
+bool IsEqual( const BoundingBox& a, const BoundingBox& b )
+{
+    return a.Center.x == b.Center.x && a.Center.y == b.Center.y && a.Center.z == b.Center.z &&
+           a.Extents.x == b.Extents.x && a.Extents.y == b.Extents.y && a.Extents.z == b.Extents.z;
+}
+
+XMVECTOR GetMin( const BoundingBox& aabb )
+{
+    return XMVectorSubtract( XMLoadFloat3( &aabb.Center ), XMLoadFloat3( &aabb.Extents ) );
+}
+
+XMVECTOR GetMax( const BoundingBox& aabb )
+{
+    return XMVectorAdd( XMLoadFloat3( &aabb.Center ), XMLoadFloat3( &aabb.Extents ) );
+}
+
+// Half the surface area of a box, which is proportional to the probability that a ray hits the box.
+float GetHalfArea( FXMVECTOR min, FXMVECTOR max )
+{
+    XMFLOAT3 size;
+    XMStoreFloat3( &size, XMVectorMax( XMVectorSubtract( max, min ), XMVectorZero() ) );
+
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+float GetHalfArea( const BoundingBox& aabb )
+{
+    return GetHalfArea( GetMin( aabb ), GetMax( aabb ) );
+}
+
+// The AABB of a range of instances.
+BoundingBox ComputeAABB( const SceneBVH::Instance* instances, uint32_t numInstances )
+{
+    XMVECTOR min = g_XMFltMax;
+    XMVECTOR max = XMVectorNegate( g_XMFltMax );
+    for ( uint32_t i = 0; i < numInstances; ++i )
+    {
+        min = XMVectorMin( min, GetMin( instances[i].AABB ) );
+        max = XMVectorMax( max, GetMax( instances[i].AABB ) );
+    }
+
+    BoundingBox aabb;
+    BoundingBox::CreateFromPoints( aabb, min, max );
+
+    return aabb;
+}
+
+}  // namespace
+
+SceneBVH::SceneBVH()
+: m_Version( 0 )
+, m_UpdateCount( 0 )
+, m_NodeCosts( 0.0 )
+, m_BuildSAHCost( 0.0f )
+{
+    m_Statistics = {};
+}
+
+SceneBVH::~SceneBVH() {}
+
+void SceneBVH::Build( Scene& scene )
+{
+    m_Instances.clear();
+    m_Transforms.reset();
+
+    // The transforms of all scene nodes of the scene are stored in the transform hierarchy of the root node.
+    auto rootNode = scene.GetRootNode();
+    if ( rootNode )
+    {
+        const auto& transforms = rootNode->GetTransformHierarchy();
+
+        InstanceCollector collector( m_Instances );
+        scene.Accept( collector );
+
+        for ( auto& instance: m_Instances )
+        {
+            instance.AABB = ComputeWorldAABB( instance, *transforms );
+        }
+
+        m_Transforms  = transforms;
+        m_Version     = transforms->GetVersion();
+        m_UpdateCount = transforms->GetUpdateCount();
+    }
+
+    BuildNodes();
+}
+
+void SceneBVH::Clear()
+{
+    m_Instances.clear();
+    m_Nodes.clear();
+    m_NodeParents.clear();
+    m_NodeChanged.clear();
+    m_InstanceLeaves.clear();
+    m_TransformInstanceOffsets.clear();
+    m_TransformInstances.clear();
+    m_Transforms.reset();
+
+    m_Version      = 0;
+    m_UpdateCount  = 0;
+    m_NodeCosts    = 0.0;
+    m_BuildSAHCost = 0.0f;
+    m_Statistics   = {};
+}
+
+bool SceneBVH::IsStale( const Scene& scene ) const
+{
+    auto rootNode   = scene.GetRootNode();
+    auto transforms = m_Transforms.lock();
+    if ( !rootNode )
+    {
+        return transforms || !m_Instances.empty();
+    }
+
+    return transforms != rootNode->GetTransformHierarchy() || transforms->GetVersion() != m_Version;
+}
+
+void SceneBVH::BuildNodes()
+{
+    auto numInstances = static_cast<uint32_t>( m_Instances.size() );
+
+    m_Nodes.clear();
+    m_NodeParents.clear();
+    m_InstanceLeaves.assign( numInstances, 0 );
+    m_TransformInstanceOffsets.clear();
+    m_TransformInstances.clear();
+    m_NodeCosts               = 0.0;
+    m_Statistics.NumInstances = numInstances;
+    m_Statistics.NumNodes     = 0;
+    m_Statistics.NumLeaves    = 0;
+    m_Statistics.MaxDepth     = 0;
+    m_Statistics.SAHCost      = 0.0f;
+    m_BuildSAHCost            = 0.0f;
+
+    if ( numInstances == 0 )
+    {
+        return;
+    }
+
+    // A binary tree with one instance per leaf has 2n - 1 nodes.
+    m_Nodes.reserve( 2 * numInstances - 1 );
+    m_Nodes.push_back( { ComputeAABB( m_Instances.data(), numInstances ), 0, numInstances, 0 } );
+    m_NodeParents.push_back( InvalidNode );
+
+    // The nodes that are not split yet and their depth.
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.emplace_back( 0, 0 );
+
+    while ( !stack.empty() )
+    {
+        auto [index, depth] = stack.back();
+        stack.pop_back();
+
+        m_Statistics.MaxDepth = std::max( m_Statistics.MaxDepth, depth );
+
+        // Split may reorder the instances of the node, but not its range.
+        Node     node          = m_Nodes[index];
+        uint32_t numFirstChild = Split( node );
+        if ( numFirstChild == 0 )
+        {
+            for ( uint32_t i = node.FirstInstance; i < node.FirstInstance + node.NumInstances; ++i )
+            {
+                m_InstanceLeaves[i] = index;
+            }
+            ++m_Statistics.NumLeaves;
+            continue;
+        }
+
+        auto     firstChild     = static_cast<uint32_t>( m_Nodes.size() );
+        uint32_t firstInstance  = node.FirstInstance + numFirstChild;
+        uint32_t numSecondChild = node.NumInstances - numFirstChild;
+
+        m_Nodes[index].FirstChild = firstChild;
+        m_Nodes.push_back(
+            { ComputeAABB( &m_Instances[node.FirstInstance], numFirstChild ), node.FirstInstance, numFirstChild, 0 } );
+        m_Nodes.push_back(
+            { ComputeAABB( &m_Instances[firstInstance], numSecondChild ), firstInstance, numSecondChild, 0 } );
+        m_NodeParents.push_back( index );
+        m_NodeParents.push_back( index );
+
+        stack.emplace_back( firstChild, depth + 1 );
+        stack.emplace_back( firstChild + 1, depth + 1 );
+    }
+
+    m_NodeChanged.assign( m_Nodes.size(), 0 );
+
+    // Map the transforms to their instances, so that refitting only recomputes the instances of the
+    // transforms that were updated.
+    uint32_t numHandles = 0;
+    for ( const auto& instance: m_Instances )
+    {
+        numHandles = std::max( numHandles, instance.Transform + 1 );
+    }
+
+    m_TransformInstanceOffsets.assign( numHandles + 1, 0 );
+    for ( const auto& instance: m_Instances )
+    {
+        ++m_TransformInstanceOffsets[instance.Transform + 1];
+    }
+    for ( uint32_t handle = 0; handle < numHandles; ++handle )
+    {
+        m_TransformInstanceOffsets[handle + 1] += m_TransformInstanceOffsets[handle];
+    }
+
+    std::vector<uint32_t> numTransformInstances( numHandles, 0 );
+    m_TransformInstances.resize( numInstances );
+    for ( uint32_t i = 0; i < numInstances; ++i )
+    {
+        auto handle = m_Instances[i].Transform;
+        m_TransformInstances[m_TransformInstanceOffsets[handle] + numTransformInstances[handle]++] = i;
+    }
+
+    for ( const auto& node: m_Nodes )
+    {
+        m_NodeCosts += GetNodeCost( node );
+    }
+
+    m_BuildSAHCost        = ComputeSAHCost();
+    m_Statistics.NumNodes = static_cast<uint32_t>( m_Nodes.size() );
+    m_Statistics.SAHCost  = m_BuildSAHCost;
+}
+
+uint32_t SceneBVH::Split( const Node& node )
+{
+    if ( node.NumInstances <= 1 )
+    {
+        return 0;
+    }
+
+    auto first = m_Instances.begin() + node.FirstInstance;
+    auto last  = first + node.NumInstances;
+
+    // The instances are binned by the centers of their AABBs.
+    XMVECTOR centerMin = g_XMFltMax;
+    XMVECTOR centerMax = XMVectorNegate( g_XMFltMax );
+    for ( auto iter = first; iter != last; ++iter )
+    {
+        XMVECTOR center = XMLoadFloat3( &iter->AABB.Center );
+        centerMin       = XMVectorMin( centerMin, center );
+        centerMax       = XMVectorMax( centerMax, center );
+    }
+
+    struct Bin
+    {
+        XMVECTOR Min;
+        XMVECTOR Max;
+        uint32_t NumInstances;
+    };
+
+    auto getBin = [&]( const Instance& instance, uint32_t axis, float scale ) {
+        float offset = XMVectorGetByIndex( XMLoadFloat3( &instance.AABB.Center ), axis ) -
+                       XMVectorGetByIndex( centerMin, axis );
+        return std::min( static_cast<uint32_t>( offset * scale ), NumBins - 1 );
+    };
+
+    // Find the split with the lowest SAH cost: the areas of the children weighted by their number of
+    // instances.
+    float    bestCost  = FLT_MAX;
+    uint32_t bestAxis  = 3;
+    uint32_t bestSplit = 0;
+    float    bestScale = 0.0f;
+
+    for ( uint32_t axis = 0; axis < 3; ++axis )
+    {
+        float extent = XMVectorGetByIndex( centerMax, axis ) - XMVectorGetByIndex( centerMin, axis );
+        if ( extent <= 0.0f )
+        {
+            continue;
+        }
+
+        float scale = NumBins / extent;
+
+        Bin bins[NumBins];
+        for ( auto& bin: bins )
+        {
+            bin = { g_XMFltMax, XMVectorNegate( g_XMFltMax ), 0 };
+        }
+
+        for ( auto iter = first; iter != last; ++iter )
+        {
+            auto& bin = bins[getBin( *iter, axis, scale )];
+            bin.Min   = XMVectorMin( bin.Min, GetMin( iter->AABB ) );
+            bin.Max   = XMVectorMax( bin.Max, GetMax( iter->AABB ) );
+            ++bin.NumInstances;
+        }
+
+        // The cost of the bins right of every split, accumulated from the right.
+        float    rightCosts[NumBins];
+        XMVECTOR rightMin          = g_XMFltMax;
+        XMVECTOR rightMax          = XMVectorNegate( g_XMFltMax );
+        uint32_t numRightInstances = 0;
+        for ( uint32_t i = NumBins - 1; i > 0; --i )
+        {
+            rightMin = XMVectorMin( rightMin, bins[i].Min );
+            rightMax = XMVectorMax( rightMax, bins[i].Max );
+            numRightInstances += bins[i].NumInstances;
+
+            rightCosts[i] = numRightInstances > 0 ? GetHalfArea( rightMin, rightMax ) * numRightInstances : 0.0f;
+        }
+
+        XMVECTOR leftMin          = g_XMFltMax;
+        XMVECTOR leftMax          = XMVectorNegate( g_XMFltMax );
+        uint32_t numLeftInstances = 0;
+        for ( uint32_t i = 0; i < NumBins - 1; ++i )
+        {
+            leftMin = XMVectorMin( leftMin, bins[i].Min );
+            leftMax = XMVectorMax( leftMax, bins[i].Max );
+            numLeftInstances += bins[i].NumInstances;
+
+            if ( numLeftInstances == 0 || numLeftInstances == node.NumInstances )
+            {
+                continue;
+            }
+
+            float cost = GetHalfArea( leftMin, leftMax ) * numLeftInstances + rightCosts[i + 1];
+            if ( cost < bestCost )
+            {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = i + 1;
+                bestScale = scale;
+            }
+        }
+    }
+
+    if ( bestAxis == 3 )
+    {
+        // All instances have the same center. Large leaves are split in the middle to bound their size.
+        return node.NumInstances > MaxLeafSize ? node.NumInstances / 2 : 0;
+    }
+
+    // Compare the cost of the split with the cost of testing all instances of a leaf.
+    float area      = GetHalfArea( node.AABB );
+    float splitCost = TraversalCost + ( area > 0.0f ? bestCost / area : 0.0f );
+    if ( node.NumInstances <= MaxLeafSize && splitCost >= static_cast<float>( node.NumInstances ) )
+    {
+        return 0;
+    }
+
+    auto middle = std::partition( first, last, [&]( const Instance& instance ) {
+        return getBin( instance, bestAxis, bestScale ) < bestSplit;
+    } );
+
+    return static_cast<uint32_t>( middle - first );
+}
+
+float SceneBVH::GetNodeCost( const Node& node )
+{
+    float area = GetHalfArea( node.AABB );
+
+    return node.FirstChild != 0 ? area * TraversalCost : area * node.NumInstances;
+}
+
+float SceneBVH::ComputeSAHCost() const
+{
+    float rootArea = GetHalfArea( m_Nodes[0].AABB );
+    if ( rootArea <= 0.0f )
+    {
+        return 1.0f;
+    }
+
+    // The cost of a node is weighted by the probability that a query of the root reaches it.
+    return static_cast<float>( m_NodeCosts / ( rootArea * m_Nodes[0].NumInstances ) );
+}
+
+void SceneBVH::Refit()
+{
+    // The handles of a stale BVH may refer to other transforms.
+    auto transforms = m_Transforms.lock();
+    if ( m_Nodes.empty() || !transforms || transforms->GetVersion() != m_Version )
+    {
+        return;
+    }
+
+    auto updateCount = transforms->GetUpdateCount();
+    if ( updateCount == m_UpdateCount )
+    {
+        return;
+    }
+
+    // The updated transforms of the last update are only known if no update was missed. Refitting the
+    // updated instances sorts the changed nodes, so the reverse sweep over all nodes is faster if many
+    // transforms were updated.
+    const auto& updatedHandles = transforms->GetUpdatedHandles();
+    if ( updateCount == m_UpdateCount + 1 && updatedHandles.size() < m_Instances.size() / 4 )
+    {
+        RefitUpdated( *transforms );
+    }
+    else
+    {
+        RefitAll( *transforms );
+    }
+    m_UpdateCount = updateCount;
+
+    m_Statistics.SAHCost = ComputeSAHCost();
+    if ( m_Statistics.SAHCost > RebuildThreshold * m_BuildSAHCost )
+    {
+        BuildNodes();
+        ++m_Statistics.NumRebuilds;
+    }
+}
+
+void SceneBVH::RefitAll( const TransformHierarchy& transforms )
+{
+    // Children are stored after their parents, so a reverse sweep refits the children first. Only the nodes
+    // above instances that moved are merged again.
+    for ( size_t i = m_Nodes.size(); i-- > 0; )
+    {
+        auto& node    = m_Nodes[i];
+        bool  changed = false;
+
+        if ( node.FirstChild == 0 )
+        {
+            for ( uint32_t j = 0; j < node.NumInstances; ++j )
+            {
+                auto&       instance = m_Instances[node.FirstInstance + j];
+                BoundingBox aabb     = ComputeWorldAABB( instance, transforms );
+                if ( !IsEqual( aabb, instance.AABB ) )
+                {
+                    instance.AABB = aabb;
+                    changed       = true;
+                }
+            }
+
+            if ( changed )
+            {
+                node.AABB = ComputeAABB( &m_Instances[node.FirstInstance], node.NumInstances );
+            }
+        }
+        else
+        {
+            changed = m_NodeChanged[node.FirstChild] || m_NodeChanged[node.FirstChild + 1];
+            if ( changed )
+            {
+                BoundingBox::CreateMerged( node.AABB, m_Nodes[node.FirstChild].AABB,
+                                           m_Nodes[node.FirstChild + 1].AABB );
+            }
+        }
+
+        m_NodeChanged[i] = changed;
+    }
+
+    m_NodeCosts = 0.0;
+    for ( const auto& node: m_Nodes )
+    {
+        m_NodeCosts += GetNodeCost( node );
+    }
+
+    std::fill( m_NodeChanged.begin(), m_NodeChanged.end(), 0 );
+}
+
+void SceneBVH::RefitUpdated( const TransformHierarchy& transforms )
+{
+    auto numHandles = static_cast<uint32_t>( m_TransformInstanceOffsets.size() - 1 );
+
+    // Recompute the instances of the updated transforms and collect the leaves of the instances that moved.
+    // Transforms of scene nodes without meshes have no instances.
+    std::vector<uint32_t> changedNodes;
+    for ( auto handle: transforms.GetUpdatedHandles() )
+    {
+        if ( handle >= numHandles )
+        {
+            continue;
+        }
+
+        for ( auto i = m_TransformInstanceOffsets[handle]; i < m_TransformInstanceOffsets[handle + 1]; ++i )
+        {
+            auto        index    = m_TransformInstances[i];
+            auto&       instance = m_Instances[index];
+            BoundingBox aabb     = ComputeWorldAABB( instance, transforms );
+            if ( IsEqual( aabb, instance.AABB ) )
+            {
+                continue;
+            }
+
+            instance.AABB = aabb;
+
+            auto leaf = m_InstanceLeaves[index];
+            if ( !m_NodeChanged[leaf] )
+            {
+                m_NodeChanged[leaf] = 1;
+                changedNodes.push_back( leaf );
+            }
+        }
+    }
+
+    // Add the parents of the changed leaves.
+    auto numChangedLeaves = changedNodes.size();
+    for ( size_t i = 0; i < numChangedLeaves; ++i )
+    {
+        auto node = m_NodeParents[changedNodes[i]];
+        while ( node != InvalidNode && !m_NodeChanged[node] )
+        {
+            m_NodeChanged[node] = 1;
+            changedNodes.push_back( node );
+            node = m_NodeParents[node];
+        }
+    }
+
+    // Children are stored after their parents, so they are refit first.
+    std::sort( changedNodes.begin(), changedNodes.end(), std::greater<uint32_t>() );
+    for ( auto index: changedNodes )
+    {
+        auto& node = m_Nodes[index];
+
+        m_NodeCosts -= GetNodeCost( node );
+        if ( node.FirstChild == 0 )
+        {
+            node.AABB = ComputeAABB( &m_Instances[node.FirstInstance], node.NumInstances );
+        }
+        else
+        {
+            BoundingBox::CreateMerged( node.AABB, m_Nodes[node.FirstChild].AABB, m_Nodes[node.FirstChild + 1].AABB );
+        }
+        m_NodeCosts += GetNodeCost( node );
+
+        m_NodeChanged[index] = 0;
+    }
+}
+
+DirectX::BoundingBox SceneBVH::GetAABB() const
+{
+    return m_Nodes.empty() ? BoundingBox( { 0, 0, 0 }, { 0, 0, 0 } ) : m_Nodes[0].AABB;
+}
+
+template<typename Volume>
+void SceneBVH::QueryVolume( const Volume& volume, std::vector<uint32_t>& instances ) const
+{
+    if ( m_Nodes.empty() )
+    {
+        return;
+    }
+
+    std::vector<uint32_t> stack;
+    stack.reserve( 64 );
+    stack.push_back( 0 );
+
+    while ( !stack.empty() )
+    {
+        const auto& node = m_Nodes[stack.back()];
+        stack.pop_back();
+
+        auto containment = volume.Contains( node.AABB );
+        if ( containment == DISJOINT )
+        {
+            continue;
+        }
+
+        // All instances of a node that is inside the volume intersect it.
+        if ( containment == CONTAINS )
+        {
+            for ( uint32_t i = 0; i < node.NumInstances; ++i )
+            {
+                instances.push_back( node.FirstInstance + i );
+            }
+        }
+        else if ( node.FirstChild == 0 )
+        {
+            for ( uint32_t i = node.FirstInstance; i < node.FirstInstance + node.NumInstances; ++i )
+            {
+                if ( volume.Intersects( m_Instances[i].AABB ) )
+                {
+                    instances.push_back( i );
+                }
+            }
+        }
+        else
+        {
+            stack.push_back( node.FirstChild );
+            stack.push_back( node.FirstChild + 1 );
+        }
+    }
+}
+
+void SceneBVH::Query( const DirectX::BoundingFrustum& frustum, std::vector<uint32_t>& instances ) const
+{
+    QueryVolume( frustum, instances );
+}
+
+void SceneBVH::Query( const DirectX::BoundingBox& box, std::vector<uint32_t>& instances ) const
+{
+    QueryVolume( box, instances );
+}
+
+void SceneBVH::Query( const DirectX::BoundingSphere& sphere, std::vector<uint32_t>& instances ) const
+{
+    QueryVolume( sphere, instances );
+}
+
+bool SceneBVH::RayCast( DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, uint32_t& instance,
+                        float& distance ) const
+{
+    float rootDistance;
+    if ( m_Nodes.empty() || !m_Nodes[0].AABB.Intersects( origin, direction, rootDistance ) )
+    {
+        return false;
+    }
+
+    // The nodes that are hit and the distance to their AABB. The nearer child is visited first, so that the
+    // nodes behind the closest hit are skipped.
+    std::vector<std::pair<uint32_t, float>> stack;
+    stack.reserve( 64 );
+    stack.emplace_back( 0, rootDistance );
+
+    float closestDistance = FLT_MAX;
+    bool  isHit           = false;
+
+    while ( !stack.empty() )
+    {
+        auto [index, nodeDistance] = stack.back();
+        stack.pop_back();
+
+        if ( nodeDistance >= closestDistance )
+        {
+            continue;
+        }
+
+        const auto& node = m_Nodes[index];
+        if ( node.FirstChild == 0 )
+        {
+            for ( uint32_t i = node.FirstInstance; i < node.FirstInstance + node.NumInstances; ++i )
+            {
+                float d;
+                if ( m_Instances[i].AABB.Intersects( origin, direction, d ) && d < closestDistance )
+                {
+                    closestDistance = d;
+                    instance        = i;
+                    isHit           = true;
+                }
+            }
+            continue;
+        }
+
+        float d0, d1;
+        bool  isHit0 = m_Nodes[node.FirstChild].AABB.Intersects( origin, direction, d0 ) && d0 < closestDistance;
+        bool  isHit1 = m_Nodes[node.FirstChild + 1].AABB.Intersects( origin, direction, d1 ) && d1 < closestDistance;
+
+        if ( isHit0 && isHit1 )
+        {
+            if ( d0 <= d1 )
+            {
+                stack.emplace_back( node.FirstChild + 1, d1 );
+                stack.emplace_back( node.FirstChild, d0 );
+            }
+            else
+            {
+                stack.emplace_back( node.FirstChild, d0 );
+                stack.emplace_back( node.FirstChild + 1, d1 );
+            }
+        }
+        else if ( isHit0 )
+        {
+            stack.emplace_back( node.FirstChild, d0 );
+        }
+        else if ( isHit1 )
+        {
+            stack.emplace_back( node.FirstChild + 1, d1 );
+        }
+    }
+
+    if ( isHit )
+    {
+        distance = closestDistance;
+    }
+
+    return isHit;
+}
@@ -11,18 +11,18 @@ using namespace DirectX;
 
 SceneNode::SceneNode( const DirectX::XMMATRIX& localTransform )
 : m_Name( "SceneNode" )
+, m_Transforms( std::make_shared<TransformHierarchy>() )
 , m_AABB( { 0, 0, 0 }, {0, 0, 0} )
 , m_Selected(false)
 {
-    m_AlignedData                     = (AlignedData*)_aligned_malloc( sizeof( AlignedData ), 16 );
-    m_AlignedData->m_LocalTransform   = localTransform;
-    m_AlignedData->m_InverseTransform = XMMatrixInverse( nullptr, localTransform );
-    m_DefaultTransform                = m_AlignedData->m_LocalTransform;
+    m_TransformHandle  = m_Transforms->Add( localTransform );
+    m_DefaultTransform = localTransform;
 }
 
 SceneNode::~SceneNode()
 {
-    _aligned_free( m_AlignedData );
+    // The children that outlive this node become root nodes of the transform hierarchy.
+    m_Transforms->Remove( m_TransformHandle );
 }
 
 const std::string& SceneNode::GetName() const
@@ -47,7 +47,7 @@ void SceneNode::SetSelection(bool value)
 
 DirectX::XMMATRIX SceneNode::GetLocalTransform() const
 {
-    return m_AlignedData->m_LocalTransform;
+    return m_Transforms->GetLocalTransform( m_TransformHandle );
 }
 
 DirectX::XMMATRIX SceneNode::GetDefaultTransform() const
@@ -57,37 +57,40 @@ DirectX::XMMATRIX SceneNode::GetDefaultTransform() const
 
 void SceneNode::SetLocalTransform( const DirectX::XMMATRIX& localTransform )
 {
-    m_AlignedData->m_LocalTransform   = localTransform;
-    m_AlignedData->m_InverseTransform = XMMatrixInverse( nullptr, localTransform );
+    m_Transforms->SetLocalTransform( m_TransformHandle, localTransform );
 }
 
 DirectX::XMVECTOR SceneNode::GetPosition()
 {
-    DirectX::XMVECTOR position = m_AlignedData->m_LocalTransform.r[3];
+    DirectX::XMVECTOR position = GetLocalTransform().r[3];
     return position;
 }
 
 void SceneNode::SetPosition( DirectX::XMVECTOR position )
 {
-   position = XMVectorSetW( position, XMVectorGetW( m_AlignedData->m_LocalTransform.r[3] ) );
-   m_AlignedData->m_LocalTransform.r[3] = position;
-
-
+    auto localTransform = GetLocalTransform();
+    localTransform.r[3] = XMVectorSetW( position, XMVectorGetW( localTransform.r[3] ) );
+    SetLocalTransform( localTransform );
 }
 
 DirectX::XMMATRIX SceneNode::GetInverseLocalTransform() const
 {
-    return m_AlignedData->m_InverseTransform;
+    return XMMatrixInverse( nullptr, GetLocalTransform() );
 }
 
 DirectX::XMMATRIX SceneNode::GetWorldTransform() const
 {
-    return m_AlignedData->m_LocalTransform * GetParentWorldTransform();
+    return m_Transforms->GetWorldTransform( m_TransformHandle );
 }
 
 DirectX::XMMATRIX SceneNode::GetInverseWorldTransform() const
 {
-    return XMMatrixInverse( nullptr, GetWorldTransform() );
+    return m_Transforms->GetInverseWorldTransform( m_TransformHandle );
+}
+
+void SceneNode::UpdateTransforms()
+{
+    m_Transforms->Update();
 }
 
 DirectX::XMMATRIX SceneNode::GetParentWorldTransform() const
@@ -101,6 +104,26 @@ DirectX::XMMATRIX SceneNode::GetParentWorldTransform() const
     return parentTransform;
 }
 
+void SceneNode::MoveTransforms( const std::shared_ptr<TransformHierarchy>& transforms,
+                                TransformHierarchy::Handle                 parent )
+{
+    // Parents are added before their children, so the moved transforms are already sorted.
+    auto handle = transforms->Add( GetLocalTransform(), parent );
+    if ( !m_Meshes.empty() )
+    {
+        transforms->SetBounds( handle, m_AABB );
+    }
+    m_Transforms->Remove( m_TransformHandle );
+
+    m_Transforms      = transforms;
+    m_TransformHandle = handle;
+
+    for ( auto& child: m_Children )
+    {
+        child->MoveTransforms( transforms, handle );
+    }
+}
+
 void SceneNode::AddChild( std::shared_ptr<SceneNode> childNode )
 {
     if ( childNode )
@@ -109,7 +132,29 @@ void SceneNode::AddChild( std::shared_ptr<SceneNode> childNode )
         if ( iter == m_Children.end() )
         {
             XMMATRIX worldTransform = childNode->GetWorldTransform();
+            childNode->Detach();
+
+            // The transforms of both trees are stored in one transform hierarchy. The smaller one is moved.
+            if ( childNode->m_Transforms != m_Transforms )
+            {
+                if ( childNode->m_Transforms->GetNumTransforms() > m_Transforms->GetNumTransforms() )
+                {
+                    auto root = shared_from_this();
+                    while ( auto parent = root->m_ParentNode.lock() )
+                    {
+                        root = parent;
+                    }
+                    root->MoveTransforms( childNode->m_Transforms, TransformHierarchy::InvalidHandle );
+                }
+                else
+                {
+                    childNode->MoveTransforms( m_Transforms, TransformHierarchy::InvalidHandle );
+                }
+            }
+
             childNode->m_ParentNode = shared_from_this();
+            m_Transforms->SetParent( childNode->m_TransformHandle, m_TransformHandle );
+
             XMMATRIX localTransform = worldTransform * GetInverseWorldTransform();
             childNode->SetLocalTransform( localTransform );
             m_Children.push_back( childNode );
@@ -128,15 +173,7 @@ void SceneNode::RemoveChild( std::shared_ptr<SceneNode> childNode )
         NodeList::const_iterator iter = std::find( m_Children.begin(), m_Children.end(), childNode );
         if ( iter != m_Children.cend() )
         {
-            childNode->SetParent( nullptr );
-            m_Children.erase( iter );
-
-            // Also remove it from the name map.
-            NodeNameMap::iterator iter2 = m_ChildrenByName.find( childNode->GetName() );
-            if ( iter2 != m_ChildrenByName.end() )
-            {
-                m_ChildrenByName.erase( iter2 );
-            }
+            childNode->Detach();
         }
         else
         {
@@ -162,16 +199,46 @@ void SceneNode::SetParent( std::shared_ptr<SceneNode> parentNode )
     {
         parentNode->AddChild( me );
     }
-    else if ( auto parent = m_ParentNode.lock() )
+    else
     {
-        // Setting parent to NULL.. remove from current parent and reset parent node.
-        auto worldTransform = GetWorldTransform();
-        parent->RemoveChild( me );
-        m_ParentNode.reset();
-        SetLocalTransform( worldTransform );
+        Detach();
     }
 }
 
+void SceneNode::Detach()
+{
+    auto parent = m_ParentNode.lock();
+    if ( !parent )
+    {
+        return;
+    }
+
+    // The subtree stays in the transform hierarchy of the parent as a separate tree.
+    auto worldTransform = GetWorldTransform();
+
+    auto me   = shared_from_this();
+    auto iter = std::find( parent->m_Children.begin(), parent->m_Children.end(), me );
+    if ( iter != parent->m_Children.end() )
+    {
+        parent->m_Children.erase( iter );
+    }
+
+    // Also remove it from the name map.
+    auto range = parent->m_ChildrenByName.equal_range( m_Name );
+    for ( auto iter2 = range.first; iter2 != range.second; ++iter2 )
+    {
+        if ( iter2->second == me )
+        {
+            parent->m_ChildrenByName.erase( iter2 );
+            break;
+        }
+    }
+
+    m_ParentNode.reset();
+    m_Transforms->SetParent( m_TransformHandle, TransformHierarchy::InvalidHandle );
+    SetLocalTransform( worldTransform );
+}
+
 size_t SceneNode::AddMesh( std::shared_ptr<Mesh> mesh )
 {
     size_t index = (size_t)-1;
@@ -183,8 +250,7 @@ size_t SceneNode::AddMesh( std::shared_ptr<Mesh> mesh )
             index = m_Meshes.size();
             m_Meshes.push_back( mesh );
 
-            // Merge the mesh's AABB with AABB of the scene node.
-            BoundingBox::CreateMerged( m_AABB, m_AABB, mesh->GetAABB() );
+            UpdateAABB();
         }
         else
         {
@@ -203,10 +269,31 @@ void SceneNode::RemoveMesh( std::shared_ptr<Mesh> mesh )
         if ( iter != m_Meshes.end() )
         {
             m_Meshes.erase( iter );
+            UpdateAABB();
         }
     }
 }
 
+void SceneNode::UpdateAABB()
+{
+    if ( m_Meshes.empty() )
+    {
+        m_AABB = BoundingBox( { 0, 0, 0 }, { 0, 0, 0 } );
+        m_Transforms->ClearBounds( m_TransformHandle );
+        return;
+    }
+
+    // Merge the AABBs of the meshes. The first mesh is not merged with the empty AABB, which would always
+    // include the origin.
+    m_AABB = m_Meshes[0]->GetAABB();
+    for ( size_t i = 1; i < m_Meshes.size(); ++i )
+    {
+        BoundingBox::CreateMerged( m_AABB, m_AABB, m_Meshes[i]->GetAABB() );
+    }
+
+    m_Transforms->SetBounds( m_TransformHandle, m_AABB );
+}
+
 std::shared_ptr<Mesh> SceneNode::GetMesh(size_t pos) 
 {
     std::shared_ptr<Mesh> mesh = nullptr;
@@ -223,19 +310,41 @@ const DirectX::BoundingBox& SceneNode::GetAABB() const
     return m_AABB;
 }
 
+DirectX::BoundingBox SceneNode::GetWorldAABB() const
+{
+    BoundingBox aabb( { 0, 0, 0 }, { 0, 0, 0 } );
+    m_Transforms->GetWorldBounds( m_TransformHandle, aabb );
+
+    return aabb;
+}
+
 void SceneNode::Accept( Visitor& visitor )
+{
+    AcceptNode( visitor );
+
+    // Visit children
+    for ( auto& child: m_Children )
+    {
+        child->Accept( visitor );
+    }
+}
+
+void SceneNode::AcceptNode( Visitor& visitor )
 {
     visitor.Visit( *this );
 
-    // Visit meshes
     for ( auto& mesh: m_Meshes )
     {
         mesh->Accept( visitor );
     }
+}
+
+void SceneNode::GetNodes( std::vector<SceneNode*>& nodes )
+{
+    nodes.push_back( this );
 
-    // Visit children
     for ( auto& child: m_Children )
     {
-        child->Accept( visitor );
+        child->GetNodes( nodes );
     }
 }
@@ -2,6 +2,7 @@
 
 #include <dx12lib/ShaderResourceView.h>
 
+#include <dx12lib/BindlessDescriptorHeap.h>
 #include <dx12lib/Device.h>
 #include <dx12lib/Resource.h>
 
@@ -11,6 +12,7 @@ ShaderResourceView::ShaderResourceView( Device& device, const std::shared_ptr<Re
                                         const D3D12_SHADER_RESOURCE_VIEW_DESC* srv )
 : m_Device( device )
 , m_Resource( resource )
+, m_BindlessIndex( BindlessDescriptorHeap::InvalidIndex )
 {
     assert( resource || srv );
 
@@ -20,4 +22,18 @@ ShaderResourceView::ShaderResourceView( Device& device, const std::shared_ptr<Re
     m_Descriptor = m_Device.AllocateDescriptors( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
 
     d3d12Device->CreateShaderResourceView( d3d12Resource.Get(), srv, m_Descriptor.GetDescriptorHandle() );
+
+    if ( auto bindlessDescriptorHeap = m_Device.GetBindlessDescriptorHeap() )
+    {
+        m_BindlessIndex = bindlessDescriptorHeap->Allocate();
+        bindlessDescriptorHeap->CopyDescriptor( m_BindlessIndex, m_Descriptor.GetDescriptorHandle() );
+    }
+}
+
+ShaderResourceView::~ShaderResourceView()
+{
+    if ( auto bindlessDescriptorHeap = m_Device.GetBindlessDescriptorHeap() )
+    {
+        bindlessDescriptorHeap->Free( m_BindlessIndex );
+    }
 }
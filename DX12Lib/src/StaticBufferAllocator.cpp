@@ -0,0 +1,233 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/StaticBufferAllocator.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+
+using namespace DX12_Library;
+
+StaticBufferAllocator::StaticBufferAllocator( Device& device, size_t blockSize )
+: m_Device( device )
+, m_BlockLists { BlockList( blockSize ), BlockList( blockSize ) }
+, m_NextAllocationID( 1 )
+{}
+
+StaticBufferAllocator::Allocation StaticBufferAllocator::Allocate( BufferType type, size_t sizeInBytes )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    ReleaseCompletedAllocations();
+
+    AllocationInfo info;
+    info.Type  = type;
+    info.Range = m_BlockLists[type].Allocator.Allocate( sizeInBytes, DefaultAlignment );
+
+    CreateBlocks( type );
+
+    uint64_t id = m_NextAllocationID++;
+    m_Allocations.emplace( id, info );
+
+    return MakeAllocation( id, info );
+}
+
+void StaticBufferAllocator::CreateBlocks( BufferType type )
+{
+    auto& blockList   = m_BlockLists[type];
+    auto  d3d12Device = m_Device.GetD3D12Device();
+
+    while ( blockList.Blocks.size() < blockList.Allocator.GetNumBlocks() )
+    {
+        auto blockIndex = static_cast<uint32_t>( blockList.Blocks.size() );
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> block;
+        ThrowIfFailed( d3d12Device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ), D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer( blockList.Allocator.GetBlockSize( blockIndex ) ),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS( &block ) ) );
+
+        block->SetName( type == VertexData ? L"Static Vertex Buffer Block" : L"Static Index Buffer Block" );
+
+        // The block is not added to the resource state tracker. It stays in the COMMON state between
+        // command lists, so that it can be written on the copy queue.
+
+        blockList.Blocks.push_back( block );
+    }
+}
+
+StaticBufferAllocator::Allocation StaticBufferAllocator::MakeAllocation( uint64_t id, const AllocationInfo& info ) const
+{
+    Allocation allocation;
+    allocation.Resource = m_BlockLists[info.Type].Blocks[info.Range.BlockIndex];
+    allocation.Offset   = info.Range.Offset;
+    allocation.Size     = info.Range.Size;
+    allocation.ID       = id;
+
+    return allocation;
+}
+
+void StaticBufferAllocator::SetRelocationCallback( uint64_t id, RelocationCallback callback )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    auto iter = m_Allocations.find( id );
+    assert( iter != m_Allocations.end() );
+
+    iter->second.OnRelocated = callback;
+}
+
+void StaticBufferAllocator::Free( uint64_t id )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    auto iter = m_Allocations.find( id );
+    if ( iter == m_Allocations.end() )
+    {
+        return;
+    }
+
+    m_StaleAllocations.push(
+        { iter->second.Type, iter->second.Range, DescriptorAllocatorPage::GetSignaledFenceValues( m_Device ) } );
+    m_Allocations.erase( iter );
+}
+
+void StaticBufferAllocator::ReleaseStaleAllocations()
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    ReleaseCompletedAllocations();
+}
+
+void StaticBufferAllocator::ReleaseCompletedAllocations()
+{
+    if ( m_StaleAllocations.empty() )
+    {
+        return;
+    }
+
+    auto completedFenceValues = DescriptorAllocatorPage::GetCompletedFenceValues( m_Device );
+
+    while ( !m_StaleAllocations.empty() )
+    {
+        auto& staleAllocation = m_StaleAllocations.front();
+
+        bool isComplete = true;
+        for ( size_t i = 0; i < completedFenceValues.size(); ++i )
+        {
+            isComplete = isComplete && staleAllocation.FenceValues[i] <= completedFenceValues[i];
+        }
+
+        if ( !isComplete )
+        {
+            break;
+        }
+
+        m_BlockLists[staleAllocation.Type].Allocator.Free( staleAllocation.Range );
+        m_StaleAllocations.pop();
+    }
+}
+
+uint32_t StaticBufferAllocator::Defragment( BufferType type, uint32_t maxMoves )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    ReleaseCompletedAllocations();
+
+    auto& blockList  = m_BlockLists[type];
+    auto  blockIndex = blockList.Allocator.FindDefragmentationCandidate();
+    if ( blockIndex == BufferBlockAllocator::InvalidBlock )
+    {
+        return 0;
+    }
+
+    // Map the ranges of the candidate block back to the allocations that own them.
+    std::map<size_t, uint64_t> owners;
+    for ( auto& allocation: m_Allocations )
+    {
+        auto& info = allocation.second;
+        if ( info.Type == type && info.Range.BlockIndex == blockIndex && info.OnRelocated )
+        {
+            owners.emplace( info.Range.Offset, allocation.first );
+        }
+    }
+
+    auto& copyQueue   = m_Device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COPY );
+    auto  commandList = copyQueue.GetCommandList();
+
+    // Moved allocations and their old ranges.
+    std::vector<std::pair<uint64_t, BufferBlockAllocator::Allocation>> moves;
+
+    for ( auto& owner: owners )
+    {
+        if ( moves.size() >= maxMoves )
+        {
+            break;
+        }
+
+        auto& info     = m_Allocations[owner.second];
+        auto  newRange = blockList.Allocator.Relocate( info.Range, DefaultAlignment );
+        if ( !newRange.IsValid() )
+        {
+            break;
+        }
+
+        // The blocks are never transitioned explicitly, so they are in the COMMON state between command lists
+        // and are implicitly promoted to the copy states on the copy queue.
+        commandList->GetD3D12CommandList()->CopyBufferRegion(
+            blockList.Blocks[newRange.BlockIndex].Get(), newRange.Offset, blockList.Blocks[blockIndex].Get(),
+            info.Range.Offset, info.Range.Size );
+
+        moves.emplace_back( owner.second, info.Range );
+        info.Range = newRange;
+    }
+
+    if ( moves.empty() )
+    {
+        return 0;
+    }
+
+    // Pending uploads to the moved ranges must be executed before they are copied.
+    m_Device.GetUploadManager().Flush();
+    auto syncPoint = copyQueue.ExecuteCommandList( commandList );
+
+    // The moved buffers can't be used before the copy is finished.
+    m_Device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT ).Wait( syncPoint );
+    m_Device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE ).Wait( syncPoint );
+
+    // The old ranges may still be read by the copy and by work that is already in flight.
+    auto fenceValues = DescriptorAllocatorPage::GetSignaledFenceValues( m_Device );
+    for ( auto& move: moves )
+    {
+        m_StaleAllocations.push( { type, move.second, fenceValues } );
+
+        auto& info = m_Allocations[move.first];
+        info.OnRelocated( MakeAllocation( move.first, info ) );
+    }
+
+    return static_cast<uint32_t>( moves.size() );
+}
+
+BufferBlockAllocator::Statistics StaticBufferAllocator::GetStatistics( BufferType type ) const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    return m_BlockLists[type].Allocator.GetStatistics();
+}
+
+std::vector<BufferBlockAllocator::BlockOccupancy> StaticBufferAllocator::GetBlockOccupancy( BufferType type ) const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    auto& allocator = m_BlockLists[type].Allocator;
+
+    std::vector<BufferBlockAllocator::BlockOccupancy> occupancy;
+    occupancy.reserve( allocator.GetNumBlocks() );
+
+    for ( uint32_t i = 0; i < allocator.GetNumBlocks(); ++i )
+    {
+        occupancy.push_back( allocator.GetBlockOccupancy( i ) );
+    }
+
+    return occupancy;
+}
@@ -184,6 +184,7 @@ UINT SwapChain::Present( const std::shared_ptr<Texture>& texture )
     m_CommandQueue.WaitForFenceValue( fenceValue );
 
     m_Device.ReleaseStaleDescriptors();
+    ResourceStateTracker::EndFrame();
 
     return m_CurrentBackBufferIndex;
 }
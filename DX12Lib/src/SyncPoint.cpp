@@ -0,0 +1,20 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/SyncPoint.h>
+
+#include <dx12lib/CommandQueue.h>
+
+using namespace DX12_Library;
+
+bool SyncPoint::IsComplete() const
+{
+    return !Queue || Queue->IsFenceComplete( FenceValue );
+}
+
+void SyncPoint::WaitForCompletion() const
+{
+    if ( Queue )
+    {
+        Queue->WaitForFenceValue( FenceValue );
+    }
+}
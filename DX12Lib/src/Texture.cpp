@@ -2,6 +2,7 @@
 
 #include <dx12lib/Texture.h>
 
+#include <dx12lib/BindlessDescriptorHeap.h>
 #include <dx12lib/Device.h>
 #include <dx12lib/Helpers.h>
 #include <dx12lib/ResourceStateTracker.h>
@@ -10,6 +11,7 @@ using namespace DX12_Library;
 
 Texture::Texture( Device& device, const D3D12_RESOURCE_DESC& resourceDesc, const D3D12_CLEAR_VALUE* clearValue )
 : Resource( device, resourceDesc, clearValue )
+, m_BindlessIndex( BindlessDescriptorHeap::InvalidIndex )
 {
     CreateViews();
 }
@@ -17,11 +19,18 @@ Texture::Texture( Device& device, const D3D12_RESOURCE_DESC& resourceDesc, const
 Texture::Texture( Device& device, ComPtr<ID3D12Resource> resource,
                   const D3D12_CLEAR_VALUE* clearValue )
 : Resource( device, resource, clearValue )
+, m_BindlessIndex( BindlessDescriptorHeap::InvalidIndex )
 {
     CreateViews();
 }
 
-Texture::~Texture() {}
+Texture::~Texture()
+{
+    if ( auto bindlessDescriptorHeap = m_Device.GetBindlessDescriptorHeap() )
+    {
+        bindlessDescriptorHeap->Free( m_BindlessIndex );
+    }
+}
 
 void Texture::Resize( uint32_t width, uint32_t height, uint32_t depthOrArraySize )
 {
@@ -38,14 +47,16 @@ void Texture::Resize( uint32_t width, uint32_t height, uint32_t depthOrArraySize
 
         auto d3d12Device = m_Device.GetD3D12Device();
 
+        Microsoft::WRL::ComPtr<ID3D12Resource> d3d12Resource;
         ThrowIfFailed( d3d12Device->CreateCommittedResource(
             &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ), D3D12_HEAP_FLAG_NONE, &resDesc,
-            D3D12_RESOURCE_STATE_COMMON, m_d3d12ClearValue.get(), IID_PPV_ARGS( &m_d3d12Resource ) ) );
+            D3D12_RESOURCE_STATE_COMMON, m_d3d12ClearValue.get(), IID_PPV_ARGS( &d3d12Resource ) ) );
 
         // Retain the name of the resource if one was already specified.
-        m_d3d12Resource->SetName( m_ResourceName.c_str() );
+        d3d12Resource->SetName( m_ResourceName.c_str() );
 
-        ResourceStateTracker::AddGlobalResourceState( m_d3d12Resource.Get(), D3D12_RESOURCE_STATE_COMMON );
+        ResourceStateTracker::AddGlobalResourceState( d3d12Resource.Get(), D3D12_RESOURCE_STATE_COMMON );
+        SetD3D12Resource( d3d12Resource );
 
         CreateViews();
     }
@@ -131,6 +142,17 @@ void Texture::CreateViews()
             m_ShaderResourceView = m_Device.AllocateDescriptors( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
             d3d12Device->CreateShaderResourceView( m_d3d12Resource.Get(), nullptr,
                                                    m_ShaderResourceView.GetDescriptorHandle() );
+
+            // Copy the SRV to the bindless descriptor heap.
+            // If the texture is resized, the previous index may still be in use by the GPU
+            // so a new index is allocated.
+            if ( auto bindlessDescriptorHeap = m_Device.GetBindlessDescriptorHeap() )
+            {
+                bindlessDescriptorHeap->Free( m_BindlessIndex );
+
+                m_BindlessIndex = bindlessDescriptorHeap->Allocate();
+                bindlessDescriptorHeap->CopyDescriptor( m_BindlessIndex, m_ShaderResourceView.GetDescriptorHandle() );
+            }
         }
         // Create UAV for each mip (only supported for 1D and 2D textures).
         if ( ( desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS ) != 0 && CheckUAVSupport() &&
@@ -0,0 +1,496 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/TransformHierarchy.h>
+
+using namespace DX12_Library;
+using namespace DirectX;
+
+// The constants are passed by reference, e.g. to the std::vector constructor, so they need a definition.
+const TransformHierarchy::Handle TransformHierarchy::InvalidHandle;
+const uint32_t                   TransformHierarchy::InvalidSlot;
+
+TransformHierarchy::TransformHierarchy()
+: m_NumTransforms( 0 )
+, m_Version( 0 )
+, m_UpdateCount( 0 )
+, m_NeedsSort( false )
+{}
+
+TransformHierarchy::~TransformHierarchy() {}
+
+TransformHierarchy::Handle TransformHierarchy::Add( const DirectX::XMMATRIX& localTransform, Handle parent )
+{
+    // The new slot is stored after its parent.
+    auto slot       = static_cast<uint32_t>( m_SlotHandles.size() );
+    auto parentSlot = parent != InvalidHandle ? GetSlot( parent ) : InvalidSlot;
+
+    Handle handle;
+    if ( !m_FreeHandles.empty() )
+    {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+        m_HandleSlots[handle] = slot;
+    }
+    else
+    {
+        handle = static_cast<Handle>( m_HandleSlots.size() );
+        m_HandleSlots.push_back( slot );
+    }
+
+    m_LocalTransforms.push_back( localTransform );
+    m_WorldTransforms.push_back( localTransform );
+    m_InverseWorldTransforms.push_back( XMMatrixIdentity() );
+    m_Parents.push_back( parentSlot );
+    m_SubtreeEnds.push_back( slot + 1 );
+    m_Dirty.push_back( 1 );
+    m_SlotHandles.push_back( handle );
+    m_LocalBounds.emplace_back();
+    m_WorldBounds.emplace_back();
+    m_HasLocalBounds.push_back( 0 );
+    m_HasWorldBounds.push_back( 0 );
+    m_BoundsDirty.push_back( 0 );
+
+    // If the subtree of the parent is the last range, so are the subtrees of all its parents, and the new
+    // slot extends them. Otherwise the subtree of the parent is no longer contiguous.
+    if ( parentSlot != InvalidSlot && !m_NeedsSort )
+    {
+        if ( m_SubtreeEnds[parentSlot] == slot )
+        {
+            for ( auto s = parentSlot; s != InvalidSlot; s = m_Parents[s] )
+            {
+                m_SubtreeEnds[s] = slot + 1;
+            }
+        }
+        else
+        {
+            m_NeedsSort = true;
+        }
+    }
+
+    // The new slot is updated with the subtree of a dirty parent.
+    if ( !m_NeedsSort && ( parentSlot == InvalidSlot || !m_Dirty[parentSlot] ) )
+    {
+        m_DirtySubtrees.push_back( slot );
+    }
+
+    ++m_NumTransforms;
+    ++m_Version;
+
+    return handle;
+}
+
+void TransformHierarchy::Remove( Handle handle )
+{
+    auto slot = GetSlot( handle );
+
+    // The slot is kept until the next sort, so the parent slots of the children stay valid.
+    // It is marked dirty since the world transforms of its children change.
+    m_SlotHandles[slot]   = InvalidHandle;
+    m_Dirty[slot]         = 1;
+    m_HandleSlots[handle] = InvalidSlot;
+    m_FreeHandles.push_back( handle );
+
+    --m_NumTransforms;
+    ++m_Version;
+    m_NeedsSort = true;
+}
+
+void TransformHierarchy::SetParent( Handle handle, Handle parent )
+{
+    auto slot       = GetSlot( handle );
+    auto parentSlot = parent != InvalidHandle ? GetSlot( parent ) : InvalidSlot;
+
+    // The subtree moves out of the ranges of its old parents, so the arrays are sorted by the next update,
+    // which also recomputes the bounds of the old and the new parents.
+    m_Parents[slot] = parentSlot;
+    m_Dirty[slot]   = 1;
+    m_NeedsSort     = true;
+    ++m_Version;
+}
+
+DirectX::XMMATRIX TransformHierarchy::GetLocalTransform( Handle handle ) const
+{
+    return m_LocalTransforms[GetSlot( handle )];
+}
+
+void TransformHierarchy::SetLocalTransform( Handle handle, const DirectX::XMMATRIX& localTransform )
+{
+    auto slot = GetSlot( handle );
+
+    m_LocalTransforms[slot] = localTransform;
+    MarkDirty( slot );
+}
+
+DirectX::XMMATRIX TransformHierarchy::GetWorldTransform( Handle handle ) const
+{
+    auto slot = GetSlot( handle );
+
+    return m_Dirty[slot] || m_NeedsSort ? ComputeWorldTransform( slot ) : m_WorldTransforms[slot];
+}
+
+DirectX::XMMATRIX TransformHierarchy::GetInverseWorldTransform( Handle handle ) const
+{
+    auto slot = GetSlot( handle );
+
+    return m_Dirty[slot] || m_NeedsSort ? XMMatrixInverse( nullptr, ComputeWorldTransform( slot ) )
+                                        : m_InverseWorldTransforms[slot];
+}
+
+void TransformHierarchy::SetBounds( Handle handle, const DirectX::BoundingBox& bounds )
+{
+    auto slot = GetSlot( handle );
+
+    m_LocalBounds[slot]    = bounds;
+    m_HasLocalBounds[slot] = 1;
+    InvalidateBounds( slot );
+    ++m_Version;
+}
+
+void TransformHierarchy::ClearBounds( Handle handle )
+{
+    auto slot = GetSlot( handle );
+
+    m_HasLocalBounds[slot] = 0;
+    InvalidateBounds( slot );
+    ++m_Version;
+}
+
+bool TransformHierarchy::GetWorldBounds( Handle handle, DirectX::BoundingBox& bounds ) const
+{
+    auto slot = GetSlot( handle );
+
+    if ( m_HasWorldBounds[slot] )
+    {
+        bounds = m_WorldBounds[slot];
+    }
+
+    return m_HasWorldBounds[slot] != 0;
+}
+
+void TransformHierarchy::InvalidateBounds( uint32_t slot )
+{
+    // The bounds of dirty slots are recomputed with their subtrees and all bounds are recomputed after a sort.
+    if ( !m_Dirty[slot] && !m_NeedsSort )
+    {
+        m_ChangedBounds.push_back( slot );
+    }
+}
+
+void TransformHierarchy::MarkDirty( uint32_t slot )
+{
+    // The subtree of a dirty slot is already dirty.
+    if ( m_Dirty[slot] )
+    {
+        return;
+    }
+
+    m_Dirty[slot] = 1;
+    if ( !m_NeedsSort )
+    {
+        std::fill( m_Dirty.begin() + slot + 1, m_Dirty.begin() + m_SubtreeEnds[slot], 1 );
+        m_DirtySubtrees.push_back( slot );
+    }
+}
+
+DirectX::XMMATRIX TransformHierarchy::ComputeWorldTransform( uint32_t slot ) const
+{
+    if ( m_NeedsSort )
+    {
+        // The children of a dirty slot are not marked, so the cached world transform is up to date if
+        // neither the slot nor one of its parents is dirty. Removed parents are included, since their
+        // children changed when they were removed.
+        bool isDirty = false;
+        for ( auto s = slot; s != InvalidSlot && !isDirty; s = m_Parents[s] )
+        {
+            isDirty = m_Dirty[s] != 0;
+        }
+
+        if ( !isDirty )
+        {
+            return m_WorldTransforms[slot];
+        }
+
+        XMMATRIX worldTransform = m_LocalTransforms[slot];
+        for ( auto s = GetParentSlot( slot ); s != InvalidSlot; s = GetParentSlot( s ) )
+        {
+            worldTransform = worldTransform * m_LocalTransforms[s];
+        }
+
+        return worldTransform;
+    }
+
+    // The subtree of a dirty slot is dirty, so the cached world transform of a clean parent is up to date.
+    XMMATRIX worldTransform = m_LocalTransforms[slot];
+    for ( auto s = m_Parents[slot]; s != InvalidSlot; s = m_Parents[s] )
+    {
+        if ( !m_Dirty[s] )
+        {
+            return worldTransform * m_WorldTransforms[s];
+        }
+        worldTransform = worldTransform * m_LocalTransforms[s];
+    }
+
+    return worldTransform;
+}
+
+void TransformHierarchy::Update()
+{
+    m_UpdatedHandles.clear();
+    ++m_UpdateCount;
+
+    if ( m_NeedsSort )
+    {
+        Sort();
+        UpdateAll();
+    }
+    else
+    {
+        UpdateDirtySubtrees();
+    }
+}
+
+void TransformHierarchy::UpdateWorldTransform( uint32_t slot )
+{
+    auto     parent         = m_Parents[slot];
+    XMMATRIX worldTransform = parent != InvalidSlot ? m_LocalTransforms[slot] * m_WorldTransforms[parent]
+                                                    : m_LocalTransforms[slot];
+
+    m_WorldTransforms[slot]        = worldTransform;
+    m_InverseWorldTransforms[slot] = XMMatrixInverse( nullptr, worldTransform );
+}
+
+void TransformHierarchy::UpdateBounds( uint32_t slot )
+{
+    // Start with the bounds of the slot itself, transformed to world space.
+    m_HasWorldBounds[slot] = m_HasLocalBounds[slot];
+    if ( m_HasLocalBounds[slot] )
+    {
+        m_LocalBounds[slot].Transform( m_WorldBounds[slot], m_WorldTransforms[slot] );
+    }
+
+    // The subtree of every child follows the child.
+    for ( auto child = slot + 1; child < m_SubtreeEnds[slot]; child = m_SubtreeEnds[child] )
+    {
+        if ( !m_HasWorldBounds[child] )
+        {
+            continue;
+        }
+
+        if ( m_HasWorldBounds[slot] )
+        {
+            BoundingBox::CreateMerged( m_WorldBounds[slot], m_WorldBounds[slot], m_WorldBounds[child] );
+        }
+        else
+        {
+            m_WorldBounds[slot]    = m_WorldBounds[child];
+            m_HasWorldBounds[slot] = 1;
+        }
+    }
+}
+
+void TransformHierarchy::UpdateAll()
+{
+    auto numSlots = static_cast<uint32_t>( m_SlotHandles.size() );
+
+    // The dirty flags were not propagated to the children while the arrays were not sorted. Parents precede
+    // their children, so the world transform of the parent is already updated and a slot is dirty if its
+    // parent is dirty.
+    for ( uint32_t i = 0; i < numSlots; ++i )
+    {
+        auto parent = m_Parents[i];
+        if ( parent != InvalidSlot && m_Dirty[parent] )
+        {
+            m_Dirty[i] = 1;
+        }
+
+        if ( m_Dirty[i] )
+        {
+            UpdateWorldTransform( i );
+            m_UpdatedHandles.push_back( m_SlotHandles[i] );
+        }
+    }
+
+    // The subtrees changed, so the bounds of all slots are recomputed, children before their parents.
+    for ( uint32_t i = numSlots; i-- > 0; )
+    {
+        UpdateBounds( i );
+    }
+
+    std::fill( m_Dirty.begin(), m_Dirty.end(), 0 );
+    m_DirtySubtrees.clear();
+    m_ChangedBounds.clear();
+}
+
+void TransformHierarchy::UpdateDirtySubtrees()
+{
+    // A subtree that is part of a dirty subtree of a parent is updated with the subtree of the parent,
+    // which precedes it.
+    std::sort( m_DirtySubtrees.begin(), m_DirtySubtrees.end() );
+    for ( auto root: m_DirtySubtrees )
+    {
+        if ( !m_Dirty[root] )
+        {
+            continue;
+        }
+
+        auto end = m_SubtreeEnds[root];
+        for ( auto i = root; i < end; ++i )
+        {
+            UpdateWorldTransform( i );
+            m_UpdatedHandles.push_back( m_SlotHandles[i] );
+        }
+        std::fill( m_Dirty.begin() + root, m_Dirty.begin() + end, 0 );
+
+        for ( auto i = end; i-- > root; )
+        {
+            UpdateBounds( i );
+        }
+
+        if ( m_Parents[root] != InvalidSlot )
+        {
+            m_ChangedBounds.push_back( m_Parents[root] );
+        }
+    }
+    m_DirtySubtrees.clear();
+
+    // Recompute the bounds of the slots whose bounds changed and of all their parents. The bounds of their
+    // children are complete, since the dirty subtrees were updated first.
+    auto numChangedBounds = m_ChangedBounds.size();
+    for ( size_t i = 0; i < numChangedBounds; ++i )
+    {
+        for ( auto s = m_ChangedBounds[i]; s != InvalidSlot && !m_BoundsDirty[s]; s = m_Parents[s] )
+        {
+            m_BoundsDirty[s] = 1;
+            m_ChangedBounds.push_back( s );
+        }
+    }
+
+    // Children are stored after their parents, so they are recomputed first.
+    std::sort( m_ChangedBounds.begin() + numChangedBounds, m_ChangedBounds.end(), std::greater<uint32_t>() );
+    for ( size_t i = numChangedBounds; i < m_ChangedBounds.size(); ++i )
+    {
+        UpdateBounds( m_ChangedBounds[i] );
+        m_BoundsDirty[m_ChangedBounds[i]] = 0;
+    }
+    m_ChangedBounds.clear();
+}
+
+void TransformHierarchy::Sort()
+{
+    auto numSlots = static_cast<uint32_t>( m_SlotHandles.size() );
+
+    // Gather the children of every slot, in the order of their slots. The children of removed transforms
+    // are root transforms, which are stored as the children of the extra slot numSlots.
+    std::vector<uint32_t> childOffsets( numSlots + 2, 0 );
+    for ( uint32_t slot = 0; slot < numSlots; ++slot )
+    {
+        if ( m_SlotHandles[slot] != InvalidHandle )
+        {
+            auto parent = GetParentSlot( slot );
+            ++childOffsets[( parent != InvalidSlot ? parent : numSlots ) + 1];
+        }
+    }
+    for ( uint32_t i = 1; i < childOffsets.size(); ++i )
+    {
+        childOffsets[i] += childOffsets[i - 1];
+    }
+
+    std::vector<uint32_t> children( m_NumTransforms );
+    std::vector<uint32_t> numChildren( numSlots + 1, 0 );
+    for ( uint32_t slot = 0; slot < numSlots; ++slot )
+    {
+        if ( m_SlotHandles[slot] != InvalidHandle )
+        {
+            auto parent = GetParentSlot( slot );
+            parent      = parent != InvalidSlot ? parent : numSlots;
+            children[childOffsets[parent] + numChildren[parent]++] = slot;
+        }
+    }
+
+    // Number the slots in depth-first order. The children are pushed in reverse, so that they keep their order.
+    std::vector<uint32_t> newSlots( numSlots, InvalidSlot );
+    std::vector<uint32_t> stack;
+    uint32_t              numSortedSlots = 0;
+
+    auto pushChildren = [&]( uint32_t parent ) {
+        for ( auto i = childOffsets[parent + 1]; i-- > childOffsets[parent]; )
+        {
+            stack.push_back( children[i] );
+        }
+    };
+
+    pushChildren( numSlots );
+    while ( !stack.empty() )
+    {
+        auto slot = stack.back();
+        stack.pop_back();
+
+        newSlots[slot] = numSortedSlots++;
+        pushChildren( slot );
+    }
+
+    // A circular reference would leave slots unsorted.
+    assert( numSortedSlots == m_NumTransforms );
+
+    std::vector<XMMATRIX>    localTransforms( m_NumTransforms );
+    std::vector<XMMATRIX>    worldTransforms( m_NumTransforms );
+    std::vector<XMMATRIX>    inverseWorldTransforms( m_NumTransforms );
+    std::vector<uint32_t>    parents( m_NumTransforms );
+    std::vector<uint8_t>     dirty( m_NumTransforms );
+    std::vector<Handle>      slotHandles( m_NumTransforms );
+    std::vector<BoundingBox> localBounds( m_NumTransforms );
+    std::vector<BoundingBox> worldBounds( m_NumTransforms );
+    std::vector<uint8_t>     hasLocalBounds( m_NumTransforms );
+    std::vector<uint8_t>     hasWorldBounds( m_NumTransforms );
+
+    for ( uint32_t slot = 0; slot < numSlots; ++slot )
+    {
+        auto newSlot = newSlots[slot];
+        if ( newSlot == InvalidSlot )
+        {
+            continue;
+        }
+
+        auto parent = m_Parents[slot];
+
+        localTransforms[newSlot]        = m_LocalTransforms[slot];
+        worldTransforms[newSlot]        = m_WorldTransforms[slot];
+        inverseWorldTransforms[newSlot] = m_InverseWorldTransforms[slot];
+        parents[newSlot]                = parent != InvalidSlot ? newSlots[parent] : InvalidSlot;
+        // The world transform of a child of a removed transform changes.
+        dirty[newSlot]          = m_Dirty[slot] || ( parent != InvalidSlot && newSlots[parent] == InvalidSlot );
+        slotHandles[newSlot]    = m_SlotHandles[slot];
+        localBounds[newSlot]    = m_LocalBounds[slot];
+        worldBounds[newSlot]    = m_WorldBounds[slot];
+        hasLocalBounds[newSlot] = m_HasLocalBounds[slot];
+        hasWorldBounds[newSlot] = m_HasWorldBounds[slot];
+
+        m_HandleSlots[m_SlotHandles[slot]] = newSlot;
+    }
+
+    // The subtree of a slot ends where the subtree of its last child ends.
+    std::vector<uint32_t> subtreeEnds( m_NumTransforms );
+    for ( auto slot = static_cast<uint32_t>( m_NumTransforms ); slot-- > 0; )
+    {
+        subtreeEnds[slot] = std::max( subtreeEnds[slot], slot + 1 );
+        if ( parents[slot] != InvalidSlot )
+        {
+            subtreeEnds[parents[slot]] = std::max( subtreeEnds[parents[slot]], subtreeEnds[slot] );
+        }
+    }
+
+    m_LocalTransforms        = std::move( localTransforms );
+    m_WorldTransforms        = std::move( worldTransforms );
+    m_InverseWorldTransforms = std::move( inverseWorldTransforms );
+    m_Parents                = std::move( parents );
+    m_SubtreeEnds            = std::move( subtreeEnds );
+    m_Dirty                  = std::move( dirty );
+    m_SlotHandles            = std::move( slotHandles );
+    m_LocalBounds            = std::move( localBounds );
+    m_WorldBounds            = std::move( worldBounds );
+    m_HasLocalBounds         = std::move( hasLocalBounds );
+    m_HasWorldBounds         = std::move( hasWorldBounds );
+    m_BoundsDirty.assign( m_NumTransforms, 0 );
+
+    m_NeedsSort = false;
+}
@@ -0,0 +1,187 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/TransientTextureAllocator.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/Device.h>
+#include <dx12lib/ResourceStateTracker.h>
+#include <dx12lib/Texture.h>
+
+using namespace DX12_Library;
+
+TransientTextureAllocator::TransientTextureAllocator( Device& device, size_t heapSize )
+: m_Device( device )
+, m_HeapSize( heapSize )
+, m_HeapAllocator( std::make_unique<BufferBlockAllocator>( heapSize ) )
+, m_FrameCounter( 0 )
+, m_PeakUsedSize( 0 )
+, m_RequestedSize( 0 )
+{}
+
+void TransientTextureAllocator::BeginFrame()
+{
+    for ( auto& activeTexture: m_ActiveTextures )
+    {
+        m_HeapAllocator->Free( activeTexture.second );
+    }
+    m_ActiveTextures.clear();
+
+    ++m_FrameCounter;
+    m_RequestedSize = 0;
+
+    // Release the textures that are no longer requested (for example, after the render targets were resized).
+    // Command lists that still use the textures keep them alive.
+    auto iter = m_PlacedTextures.begin();
+    while ( iter != m_PlacedTextures.end() )
+    {
+        if ( iter->LastUsedFrame + MaxUnusedFrames < m_FrameCounter )
+        {
+            iter = m_PlacedTextures.erase( iter );
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
+std::shared_ptr<Texture> TransientTextureAllocator::AcquireTexture( CommandList&               commandList,
+                                                                    const D3D12_RESOURCE_DESC& resourceDesc,
+                                                                    const D3D12_CLEAR_VALUE*   clearValue,
+                                                                    const std::wstring&        name )
+{
+    bool isRenderTarget = ( resourceDesc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET ) != 0;
+    bool isDepthStencil = ( resourceDesc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL ) != 0;
+    assert( ( isRenderTarget || isDepthStencil ) && "Transient textures must be render targets or depth buffers." );
+
+    auto allocationInfo = m_Device.GetD3D12Device()->GetResourceAllocationInfo( 0, 1, &resourceDesc );
+
+    auto range = m_HeapAllocator->Allocate( static_cast<size_t>( allocationInfo.SizeInBytes ),
+                                            static_cast<size_t>( allocationInfo.Alignment ) );
+    CreateHeaps();
+
+    auto texture = GetPlacedTexture( range, resourceDesc, clearValue );
+    if ( !name.empty() )
+    {
+        texture->SetName( name );
+    }
+
+    m_ActiveTextures[texture.get()] = range;
+
+    m_RequestedSize += range.Size;
+    m_PeakUsedSize = std::max( m_PeakUsedSize, m_HeapAllocator->GetStatistics().UsedSize );
+
+    // The texture may share its memory with textures that were used before.
+    commandList.AliasingBarrier( nullptr, texture );
+
+    // Aliased render targets and depth buffers must be initialized before they are used.
+    commandList.TransitionBarrier( texture,
+                                   isRenderTarget ? D3D12_RESOURCE_STATE_RENDER_TARGET : D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                                   D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, true );
+    commandList.GetD3D12CommandList()->DiscardResource( texture->GetD3D12Resource().Get(), nullptr );
+
+    commandList.TrackResource( texture );
+    commandList.TrackResource( m_Heaps[range.BlockIndex] );
+
+    return texture;
+}
+
+void TransientTextureAllocator::CreateHeaps()
+{
+    auto d3d12Device = m_Device.GetD3D12Device();
+
+    while ( m_Heaps.size() < m_HeapAllocator->GetNumBlocks() )
+    {
+        auto heapIndex = static_cast<uint32_t>( m_Heaps.size() );
+
+        // Use the MSAA alignment so that multisampled textures can be placed in any heap.
+        D3D12_HEAP_DESC heapDesc                 = {};
+        heapDesc.SizeInBytes                     = m_HeapAllocator->GetBlockSize( heapIndex );
+        heapDesc.Alignment                       = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags                           = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        heapDesc.Properties.CPUPageProperty      = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        heapDesc.Properties.Type                 = D3D12_HEAP_TYPE_DEFAULT;
+
+        Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+        ThrowIfFailed( d3d12Device->CreateHeap( &heapDesc, IID_PPV_ARGS( &heap ) ) );
+        heap->SetName( L"Transient Texture Heap" );
+
+        m_Heaps.push_back( heap );
+    }
+}
+
+std::shared_ptr<Texture>
+    TransientTextureAllocator::GetPlacedTexture( const BufferBlockAllocator::Allocation& range,
+                                                 const D3D12_RESOURCE_DESC&              resourceDesc,
+                                                 const D3D12_CLEAR_VALUE*                clearValue )
+{
+    for ( auto& placedTexture: m_PlacedTextures )
+    {
+        if ( placedTexture.HeapIndex == range.BlockIndex && placedTexture.Offset == range.Offset &&
+             memcmp( &placedTexture.ResourceDesc, &resourceDesc, sizeof( D3D12_RESOURCE_DESC ) ) == 0 &&
+             placedTexture.HasClearValue == ( clearValue != nullptr ) &&
+             ( !clearValue || memcmp( &placedTexture.ClearValue, clearValue, sizeof( D3D12_CLEAR_VALUE ) ) == 0 ) )
+        {
+            placedTexture.LastUsedFrame = m_FrameCounter;
+            return placedTexture.Texture;
+        }
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> d3d12Resource;
+    ThrowIfFailed( m_Device.GetD3D12Device()->CreatePlacedResource(
+        m_Heaps[range.BlockIndex].Get(), range.Offset, &resourceDesc, D3D12_RESOURCE_STATE_COMMON, clearValue,
+        IID_PPV_ARGS( &d3d12Resource ) ) );
+
+    ResourceStateTracker::AddGlobalResourceState( d3d12Resource.Get(), D3D12_RESOURCE_STATE_COMMON );
+
+    PlacedTexture placedTexture;
+    placedTexture.Texture       = m_Device.CreateTexture( d3d12Resource, clearValue );
+    placedTexture.HeapIndex     = range.BlockIndex;
+    placedTexture.Offset        = range.Offset;
+    placedTexture.ResourceDesc  = resourceDesc;
+    placedTexture.HasClearValue = clearValue != nullptr;
+    placedTexture.ClearValue    = clearValue ? *clearValue : D3D12_CLEAR_VALUE {};
+    placedTexture.LastUsedFrame = m_FrameCounter;
+
+    m_PlacedTextures.push_back( placedTexture );
+
+    return placedTexture.Texture;
+}
+
+void TransientTextureAllocator::ReleaseTexture( const std::shared_ptr<Texture>& texture )
+{
+    auto iter = m_ActiveTextures.find( texture.get() );
+    if ( iter != m_ActiveTextures.end() )
+    {
+        m_HeapAllocator->Free( iter->second );
+        m_ActiveTextures.erase( iter );
+    }
+}
+
+void TransientTextureAllocator::Reset()
+{
+    m_ActiveTextures.clear();
+    m_PlacedTextures.clear();
+    m_Heaps.clear();
+    m_HeapAllocator = std::make_unique<BufferBlockAllocator>( m_HeapSize );
+
+    m_PeakUsedSize  = 0;
+    m_RequestedSize = 0;
+}
+
+TransientTextureAllocator::Statistics TransientTextureAllocator::GetStatistics() const
+{
+    auto heapStatistics = m_HeapAllocator->GetStatistics();
+
+    Statistics statistics;
+    statistics.NumHeaps          = heapStatistics.NumBlocks;
+    statistics.HeapSize          = heapStatistics.TotalSize;
+    statistics.UsedSize          = heapStatistics.UsedSize;
+    statistics.PeakUsedSize      = m_PeakUsedSize;
+    statistics.RequestedSize     = m_RequestedSize;
+    statistics.NumActiveTextures = static_cast<uint32_t>( m_ActiveTextures.size() );
+    statistics.NumCachedTextures = static_cast<uint32_t>( m_PlacedTextures.size() );
+
+    return statistics;
+}
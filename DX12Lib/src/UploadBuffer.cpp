@@ -2,142 +2,90 @@
 
 #include <dx12lib/UploadBuffer.h>
 
-#include <dx12lib/Device.h>
 #include <dx12lib/Helpers.h>
 
 using namespace DX12_Library;
 
-UploadBuffer::UploadBuffer( Device& device, size_t pageSize )
-: m_Device( device )
-, m_PageSize( pageSize )
+UploadBuffer::UploadBuffer( UploadRingBuffer& ringBuffer, size_t blockSize )
+: m_RingBuffer( ringBuffer )
+, m_CurrentBlock( InvalidBlock )
+, m_Offset( 0 )
+, m_BlockSize( blockSize )
 {}
 
-UploadBuffer::~UploadBuffer() {}
-
-// The Allocate method is used to allocate a chunk of memory from a memory page.
-UploadBuffer::Allocation UploadBuffer::Allocate( size_t sizeInBytes, size_t alignment )
+UploadBuffer::~UploadBuffer()
 {
-    if ( sizeInBytes > m_PageSize )
-    {
-        throw std::bad_alloc();
-    }
-
-    // If there is no current page, or the requested allocation exceeds the
-    // remaining space in the current page, request a new page.
-    if ( !m_CurrentPage || !m_CurrentPage->HasSpace( sizeInBytes, alignment ) )
-    {
-        m_CurrentPage = RequestPage();
-    }
-    // Allocate takes two arguments
-    // The size of the allocation in bytes
-    // The memory alignment of the allocation in bytes.
-    // For example: allocation for constant buffers must be aligned to 256 bytes. 
-    return m_CurrentPage->Allocate( sizeInBytes, alignment );
+    Reset();
 }
 
-// If either the allocator or the Current Page doesnt have the available space
-// a new page gets retrieved from Available Pages or a new one gets created.
-std::shared_ptr<UploadBuffer::Page> UploadBuffer::RequestPage()
+// The Allocate method is used to allocate a chunk of memory from the current block.
+UploadBuffer::Allocation UploadBuffer::Allocate( size_t sizeInBytes, size_t alignment )
 {
-    std::shared_ptr<Page> page;
+    // The size and the starting address should be aligned to ensure correctness
+    // For example: allocation for constant buffers must be aligned to 256 bytes.
+    size_t alignedSize = Math::AlignUp( sizeInBytes, alignment );
 
-    if ( !m_AvailablePages.empty() )
+    if ( alignedSize > GetMaxSmallAllocationSize() )
     {
-        page = m_AvailablePages.front();
-        m_AvailablePages.pop_front();
+        // Medium and large allocations get a block of their own so they don't waste the
+        // rest of the current block. Blocks are only aligned to UploadRingBuffer::BlockAlignment
+        // so leave room to align the allocation.
+        m_Blocks.push_back( m_RingBuffer.Allocate( alignedSize + alignment ) );
+
+        return AllocateFromBlock( m_Blocks.back(), 0, alignedSize, alignment ).first;
     }
-    else
+
+    // If there is no current block, or the requested allocation exceeds the
+    // remaining space in the current block, reserve a new block from the ring buffer.
+    if ( m_CurrentBlock == InvalidBlock ||
+         AlignOffset( m_Blocks[m_CurrentBlock], m_Offset, alignment ) + alignedSize > m_Blocks[m_CurrentBlock].Size )
     {
-        page = std::make_shared<Page>( m_Device, m_PageSize );
-        m_PagePool.push_back( page );
+        m_Blocks.push_back( m_RingBuffer.Allocate( m_BlockSize ) );
+        m_CurrentBlock = m_Blocks.size() - 1;
+        m_Offset       = 0;
     }
 
-    return page;
-}
-
-// The Reset method is used to reset all of the memory allocations so that they can be reused
-// for the next frame(command list recording).
-// The Upload Buffer can only be reset if all of the allocations from it are
-// no longer on the command queue.
-void UploadBuffer::Reset()
-{
-    m_CurrentPage = nullptr;
-    // Reset all available pages.
-    m_AvailablePages = m_PagePool;
+    auto allocation = AllocateFromBlock( m_Blocks[m_CurrentBlock], m_Offset, alignedSize, alignment );
+    // The offset gets incremented by the aligned size
+    m_Offset = allocation.second;
 
-    for ( auto page: m_AvailablePages )
-    {
-        // Reset the page for new allocations.
-        page->Reset();
-    }
+    return allocation.first;
 }
 
-UploadBuffer::Page::Page( Device& device, size_t sizeInBytes )
-: m_Device( device )
-, m_PageSize( sizeInBytes )
-, m_Offset( 0 )
-, m_CPUPtr( nullptr )
-, m_GPUPtr( D3D12_GPU_VIRTUAL_ADDRESS( 0 ) )
+size_t UploadBuffer::AlignOffset( const UploadRingBuffer::Block& block, size_t offset, size_t alignment )
 {
-    auto d3d12Device = m_Device.GetD3D12Device();
-    // Create a commited resource that is large enough to
-    // store buffer data passed in a single page 
-    ThrowIfFailed( d3d12Device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer( m_PageSize ), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-        IID_PPV_ARGS( &m_d3d12Resource ) ) );
-
-    // Get the GPU and CPU addresses and map them
-    // As long as the resource is created in the Upload buffer it is
-    // okay to leave them mapped.
-    m_d3d12Resource->SetName( L"Upload Buffer (Page)" );
-
-    m_GPUPtr = m_d3d12Resource->GetGPUVirtualAddress();
-    m_d3d12Resource->Map( 0, nullptr, &m_CPUPtr );
+    return static_cast<size_t>( Math::AlignUp( block.GPU + offset, alignment ) - block.GPU );
 }
 
-// The Page destructor unmaps the resource memory and
-// resets the CPU and GPU pointers.
-UploadBuffer::Page::~Page()
+std::pair<UploadBuffer::Allocation, size_t> UploadBuffer::AllocateFromBlock( const UploadRingBuffer::Block& block,
+                                                                             size_t offset, size_t alignedSize,
+                                                                             size_t alignment )
 {
-    m_d3d12Resource->Unmap( 0, nullptr );
-    m_CPUPtr = nullptr;
-    m_GPUPtr = D3D12_GPU_VIRTUAL_ADDRESS( 0 );
-}
+    size_t alignedOffset = AlignOffset( block, offset, alignment );
 
-// The Page::HasSpace checks to see if the page has enough space to satisfy the
-// requested allocation. Returns: True if it does.. False if it doesn't..
-bool UploadBuffer::Page::HasSpace( size_t sizeInBytes, size_t alignment ) const
-{
-    size_t alignedSize   = Math::AlignUp( sizeInBytes, alignment );
-    size_t alignedOffset = Math::AlignUp( m_Offset, alignment );
+    // The GPU and CPU addresses are written to the allocation structure
+    Allocation allocation;
+    allocation.CPU = static_cast<uint8_t*>( block.CPU ) + alignedOffset;
+    allocation.GPU = block.GPU + alignedOffset;
 
-    return alignedOffset + alignedSize <= m_PageSize;
+    return { allocation, alignedOffset + alignedSize };
 }
 
-UploadBuffer::Allocation UploadBuffer::Page::Allocate( size_t sizeInBytes, size_t alignment )
+void UploadBuffer::Retire( uint64_t fenceValue )
 {
-    // Double check if the page size is enough to satisfy the allocation
-    if ( !HasSpace( sizeInBytes, alignment ) )
+    for ( auto& block: m_Blocks )
     {
-        // Can't allocate space from page.
-        throw std::bad_alloc();
+        m_RingBuffer.Retire( block, fenceValue );
     }
-    // The size and the starting address should be aligned to ensure correctness
-    size_t alignedSize = Math::AlignUp( sizeInBytes, alignment );
-    m_Offset           = Math::AlignUp( m_Offset, alignment );
-    // The GPU and CPU addresses are written to the allocation structure
-    Allocation allocation;
-    allocation.CPU = static_cast<uint8_t*>( m_CPUPtr ) + m_Offset;
-    allocation.GPU = m_GPUPtr + m_Offset;
-    // The offset pointer gets incremented by the aligned size
-    m_Offset += alignedSize;
 
-    return allocation;
+    m_Blocks.clear();
+    m_CurrentBlock = InvalidBlock;
+    m_Offset       = 0;
 }
 
-// Simply reset the page's pointer to 0 so it can be used again
-void UploadBuffer::Page::Reset()
+// Blocks are normally retired when the command list is executed. Anything that is
+// left over was never seen by the GPU and can be reused right away.
+void UploadBuffer::Reset()
 {
-    m_Offset = 0;
-}
\ No newline at end of file
+    Retire( 0 );
+}
@@ -0,0 +1,218 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/UploadManager.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+#include <dx12lib/Helpers.h>
+
+using namespace DX12_Library;
+
+UploadManager::UploadManager( Device& device )
+: m_Device( device )
+, m_CopyQueue( device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COPY ) )
+, m_RingBuffer( m_CopyQueue.GetUploadRingBuffer() )
+, m_BatchSize( 0 )
+, m_BatchID( 1 )
+, m_LastSubmittedBatchID( 0 )
+{
+    // Leave the other half of the ring buffer for the batch that is in flight.
+    m_MaxBatchSize = m_RingBuffer.GetSize() / 2;
+}
+
+UploadManager::~UploadManager()
+{
+    // The pending batch was never executed so the staging memory can be reused right away.
+    for ( auto& block: m_Blocks )
+    {
+        m_RingBuffer.Retire( block, 0 );
+    }
+}
+
+UploadManager::Ticket UploadManager::UploadBuffer( Microsoft::WRL::ComPtr<ID3D12Resource> destinationResource,
+                                                   size_t bufferSize, const void* bufferData,
+                                                   size_t destinationOffset )
+{
+    assert( destinationResource && bufferData );
+
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    auto upload      = BeginUpload( lock, bufferSize );
+    auto commandList = upload.first;
+    auto block       = upload.second;
+
+    memcpy( block.CPU, bufferData, bufferSize );
+
+    commandList->GetD3D12CommandList()->CopyBufferRegion( destinationResource.Get(), destinationOffset, block.Resource,
+                                                          block.Offset, bufferSize );
+    commandList->TrackResource( destinationResource );
+
+    return EndUpload( lock );
+}
+
+UploadManager::Ticket UploadManager::UploadTexture( Microsoft::WRL::ComPtr<ID3D12Resource> destinationResource,
+                                                    uint32_t firstSubresource, uint32_t numSubresources,
+                                                    const D3D12_SUBRESOURCE_DATA* subresourceData )
+{
+    assert( destinationResource && subresourceData );
+
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    UINT64 requiredSize = GetRequiredIntermediateSize( destinationResource.Get(), firstSubresource, numSubresources );
+
+    // Texture data must be aligned to 512 bytes in the staging memory.
+    auto upload =
+        BeginUpload( lock, static_cast<size_t>( requiredSize ) + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT );
+    auto commandList = upload.first;
+    auto block       = upload.second;
+
+    UINT64 offset = Math::AlignUp( block.Offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT );
+
+    UpdateSubresources( commandList->GetD3D12CommandList().Get(), destinationResource.Get(), block.Resource, offset,
+                        firstSubresource, numSubresources, subresourceData );
+    commandList->TrackResource( destinationResource );
+
+    return EndUpload( lock );
+}
+
+std::pair<CommandList*, UploadRingBuffer::Block> UploadManager::BeginUpload( std::unique_lock<std::mutex>& lock,
+                                                                             size_t sizeInBytes )
+{
+    // Don't let a single batch fill up the ring buffer.
+    if ( m_BatchSize > 0 && m_BatchSize + sizeInBytes > m_MaxBatchSize )
+    {
+        SubmitBatch( lock );
+    }
+
+    if ( !m_CommandList )
+    {
+        m_CommandList = m_CopyQueue.GetCommandList();
+    }
+
+    m_Blocks.push_back( m_RingBuffer.Allocate( sizeInBytes ) );
+    m_BatchSize += sizeInBytes;
+
+    return { m_CommandList.get(), m_Blocks.back() };
+}
+
+UploadManager::Ticket UploadManager::EndUpload( std::unique_lock<std::mutex>& lock )
+{
+    Ticket ticket;
+    ticket.BatchID = m_BatchID;
+
+    if ( m_BatchSize >= m_MaxBatchSize )
+    {
+        SubmitBatch( lock );
+    }
+
+    return ticket;
+}
+
+uint64_t UploadManager::SubmitBatch( std::unique_lock<std::mutex>& lock )
+{
+    if ( !m_CommandList )
+    {
+        return 0;
+    }
+
+    auto     commandList = std::move( m_CommandList );
+    auto     blocks      = std::move( m_Blocks );
+    uint64_t batchID     = m_BatchID;
+
+    m_CommandList = nullptr;
+    m_Blocks.clear();
+    m_BatchSize = 0;
+    ++m_BatchID;
+
+    // Another thread may still be executing the batch before this one.
+    m_BatchSubmittedCV.wait( lock, [&]() { return m_LastSubmittedBatchID + 1 == batchID; } );
+
+    lock.unlock();
+    uint64_t fenceValue = m_CopyQueue.ExecuteCommandList( commandList ).FenceValue;
+    lock.lock();
+
+    for ( auto& block: blocks )
+    {
+        m_RingBuffer.Retire( block, fenceValue );
+    }
+
+    m_SubmittedBatches.emplace_back( batchID, fenceValue );
+    m_LastSubmittedBatchID = batchID;
+
+    m_BatchSubmittedCV.notify_all();
+
+    return fenceValue;
+}
+
+uint64_t UploadManager::Flush()
+{
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    return SubmitBatch( lock );
+}
+
+uint64_t UploadManager::GetFenceValue( const Ticket& ticket )
+{
+    if ( ticket.BatchID == 0 )
+    {
+        return 0;
+    }
+
+    std::unique_lock<std::mutex> lock( m_Mutex );
+    assert( ticket.BatchID <= m_BatchID );
+
+    if ( ticket.BatchID == m_BatchID )
+    {
+        SubmitBatch( lock );
+    }
+
+    // The batch may still be executed by another thread.
+    m_BatchSubmittedCV.wait( lock, [&]() { return m_LastSubmittedBatchID >= ticket.BatchID; } );
+
+    // Forget the batches that are finished.
+    uint64_t completedFenceValue = m_CopyQueue.GetCompletedFenceValue();
+    while ( !m_SubmittedBatches.empty() && m_SubmittedBatches.front().second <= completedFenceValue )
+    {
+        m_SubmittedBatches.pop_front();
+    }
+
+    if ( m_SubmittedBatches.empty() || ticket.BatchID < m_SubmittedBatches.front().first )
+    {
+        return 0;
+    }
+
+    // Batch IDs are consecutive.
+    auto index = static_cast<size_t>( ticket.BatchID - m_SubmittedBatches.front().first );
+    assert( index < m_SubmittedBatches.size() );
+
+    return m_SubmittedBatches[index].second;
+}
+
+bool UploadManager::IsComplete( const Ticket& ticket )
+{
+    uint64_t fenceValue = GetFenceValue( ticket );
+
+    return fenceValue == 0 || m_CopyQueue.IsFenceComplete( fenceValue );
+}
+
+void UploadManager::Wait( CommandQueue& commandQueue, const Ticket& ticket )
+{
+    uint64_t fenceValue = GetFenceValue( ticket );
+
+    // Work on the copy queue is already executed in order.
+    if ( fenceValue > 0 && &commandQueue != &m_CopyQueue )
+    {
+        commandQueue.Wait( m_CopyQueue, fenceValue );
+    }
+}
+
+void UploadManager::WaitForCompletion( const Ticket& ticket )
+{
+    uint64_t fenceValue = GetFenceValue( ticket );
+
+    if ( fenceValue > 0 )
+    {
+        m_CopyQueue.WaitForFenceValue( fenceValue );
+    }
+}
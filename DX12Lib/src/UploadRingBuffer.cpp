@@ -0,0 +1,332 @@
+#include "DX12LibPCH.h"
+
+#include <dx12lib/UploadRingBuffer.h>
+
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+#include <dx12lib/Helpers.h>
+
+using namespace DX12_Library;
+
+UploadRingBuffer::UploadRingBuffer( Device& device, CommandQueue& commandQueue, size_t sizeInBytes )
+: m_Device( device )
+, m_CommandQueue( commandQueue )
+, m_CPUPtr( nullptr )
+, m_GPUPtr( D3D12_GPU_VIRTUAL_ADDRESS( 0 ) )
+, m_Size( Math::AlignUp( sizeInBytes, BlockAlignment ) )
+, m_Head( 0 )
+, m_Tail( 0 )
+, m_UsedSize( 0 )
+, m_FrontRegionID( 0 )
+, m_NextDedicatedBufferID( 0 )
+, m_DedicatedBufferSize( 0 )
+, m_IdleDedicatedBufferSize( 0 )
+, m_IdleLowWatermark( m_Size / 2 )
+, m_IdleHighWatermark( m_Size * 2 )
+, m_PeakUsedSize( 0 )
+, m_PeakDedicatedBufferSize( 0 )
+, m_NumOverflowAllocations( 0 )
+{
+    auto d3d12Device = m_Device.GetD3D12Device();
+
+    ThrowIfFailed( d3d12Device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer( m_Size ), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+        IID_PPV_ARGS( &m_d3d12Resource ) ) );
+
+    m_d3d12Resource->SetName( L"Upload Ring Buffer" );
+
+    // Upload heaps can stay mapped for the lifetime of the resource.
+    m_GPUPtr = m_d3d12Resource->GetGPUVirtualAddress();
+    m_d3d12Resource->Map( 0, nullptr, reinterpret_cast<void**>( &m_CPUPtr ) );
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+    for ( auto& dedicatedBuffer: m_DedicatedBuffers )
+    {
+        dedicatedBuffer.second.Resource->Unmap( 0, nullptr );
+    }
+    TrimIdleDedicatedBuffers( 0 );
+
+    m_d3d12Resource->Unmap( 0, nullptr );
+    m_CPUPtr = nullptr;
+    m_GPUPtr = D3D12_GPU_VIRTUAL_ADDRESS( 0 );
+}
+
+UploadRingBuffer::Block UploadRingBuffer::Allocate( size_t sizeInBytes )
+{
+    size_t alignedSize = Math::AlignUp( std::max<size_t>( sizeInBytes, 1 ), BlockAlignment );
+
+    std::unique_lock<std::mutex> lock( m_Mutex );
+
+    if ( alignedSize > GetMaxRingAllocationSize() )
+    {
+        // Large one-off allocations would stall the ring buffer.
+        return AllocateDedicated( alignedSize );
+    }
+
+    ReleaseCompletedRegions();
+    if ( !m_DedicatedBuffers.empty() )
+    {
+        ReleaseCompletedDedicatedBuffers();
+    }
+
+    size_t offset = 0;
+    while ( !TryAllocate( alignedSize, offset ) )
+    {
+        // Only retired regions can be waited on. If the oldest region is still
+        // being recorded, the ring buffer can't make progress until that command
+        // list is executed, so use a dedicated buffer instead.
+        if ( m_Regions.empty() || !m_Regions.front().IsRetired )
+        {
+            ++m_NumOverflowAllocations;
+            return AllocateDedicated( alignedSize );
+        }
+
+        // Don't block the other command lists of the queue while waiting for the GPU. They may allocate
+        // or retire blocks in the meantime, so the ring buffer is checked again after the wait.
+        uint64_t fenceValue = m_Regions.front().FenceValue;
+        lock.unlock();
+        m_CommandQueue.WaitForFenceValue( fenceValue );
+        lock.lock();
+
+        ReleaseCompletedRegions();
+    }
+
+    UpdatePeakSizes();
+
+    Block block;
+    block.CPU         = m_CPUPtr + offset;
+    block.GPU         = m_GPUPtr + offset;
+    block.Resource    = m_d3d12Resource.Get();
+    block.Offset      = offset;
+    block.Size        = alignedSize;
+    block.ID          = m_FrontRegionID + m_Regions.size() - 1;
+    block.IsDedicated = false;
+
+    return block;
+}
+
+UploadRingBuffer::Block UploadRingBuffer::AllocateDedicated( size_t sizeInBytes )
+{
+    ReleaseCompletedDedicatedBuffers();
+
+    // Round up to a power of two so that buffers can be reused for
+    // allocations of a similar size.
+    size_t sizeClass = MinDedicatedBufferSize;
+    while ( sizeClass < sizeInBytes )
+    {
+        sizeClass *= 2;
+    }
+
+    DedicatedBuffer dedicatedBuffer;
+
+    auto iter = std::find_if( m_IdleDedicatedBuffers.begin(), m_IdleDedicatedBuffers.end(),
+                              [sizeClass]( const DedicatedBuffer& buffer ) { return buffer.Size == sizeClass; } );
+    if ( iter != m_IdleDedicatedBuffers.end() )
+    {
+        dedicatedBuffer = *iter;
+        m_IdleDedicatedBuffers.erase( iter );
+        m_IdleDedicatedBufferSize -= sizeClass;
+    }
+    else
+    {
+        auto d3d12Device = m_Device.GetD3D12Device();
+
+        ThrowIfFailed( d3d12Device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer( sizeClass ), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+            IID_PPV_ARGS( &dedicatedBuffer.Resource ) ) );
+
+        dedicatedBuffer.Resource->SetName( L"Upload Buffer (Dedicated)" );
+
+        dedicatedBuffer.GPU = dedicatedBuffer.Resource->GetGPUVirtualAddress();
+        dedicatedBuffer.Resource->Map( 0, nullptr, &dedicatedBuffer.CPU );
+        dedicatedBuffer.Size = sizeClass;
+
+        m_DedicatedBufferSize += sizeClass;
+        UpdatePeakSizes();
+    }
+
+    dedicatedBuffer.FenceValue = 0;
+    dedicatedBuffer.IsRetired  = false;
+
+    Block block;
+    block.CPU         = dedicatedBuffer.CPU;
+    block.GPU         = dedicatedBuffer.GPU;
+    block.Resource    = dedicatedBuffer.Resource.Get();
+    block.Offset      = 0;
+    block.Size        = dedicatedBuffer.Size;
+    block.ID          = m_NextDedicatedBufferID++;
+    block.IsDedicated = true;
+
+    m_DedicatedBuffers.emplace( block.ID, std::move( dedicatedBuffer ) );
+
+    return block;
+}
+
+bool UploadRingBuffer::TryAllocate( size_t sizeInBytes, size_t& offset )
+{
+    if ( m_UsedSize == 0 )
+    {
+        // Start from the beginning when the ring buffer is empty to avoid wrapping.
+        m_Head = m_Tail = 0;
+    }
+
+    size_t padding = 0;
+    if ( m_Head >= m_Tail && m_UsedSize < m_Size )
+    {
+        // The free space is [head, size) and [0, tail).
+        if ( m_Head + sizeInBytes > m_Size )
+        {
+            if ( sizeInBytes > m_Tail )
+            {
+                return false;
+            }
+            // Skip the end of the ring buffer and wrap around to the beginning.
+            padding = m_Size - m_Head;
+        }
+    }
+    else if ( m_Head + sizeInBytes > m_Tail )
+    {
+        // The free space is [head, tail).
+        return false;
+    }
+
+    offset = padding > 0 ? 0 : m_Head;
+    m_Head = ( offset + sizeInBytes ) % m_Size;
+    m_UsedSize += padding + sizeInBytes;
+
+    m_Regions.push_back( { padding + sizeInBytes, 0, false } );
+
+    return true;
+}
+
+void UploadRingBuffer::Retire( const Block& block, uint64_t fenceValue )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    if ( block.IsDedicated )
+    {
+        auto iter = m_DedicatedBuffers.find( block.ID );
+        assert( iter != m_DedicatedBuffers.end() );
+
+        iter->second.FenceValue = fenceValue;
+        iter->second.IsRetired  = true;
+        return;
+    }
+
+    assert( block.ID >= m_FrontRegionID && block.ID - m_FrontRegionID < m_Regions.size() );
+
+    auto& region      = m_Regions[static_cast<size_t>( block.ID - m_FrontRegionID )];
+    region.FenceValue = fenceValue;
+    region.IsRetired  = true;
+}
+
+void UploadRingBuffer::ReleaseCompletedRegions()
+{
+    uint64_t completedFenceValue = m_CommandQueue.GetCompletedFenceValue();
+
+    while ( !m_Regions.empty() )
+    {
+        auto& region = m_Regions.front();
+        if ( !region.IsRetired || region.FenceValue > completedFenceValue )
+        {
+            break;
+        }
+
+        m_Tail = ( m_Tail + region.Size ) % m_Size;
+        m_UsedSize -= region.Size;
+
+        m_Regions.pop_front();
+        ++m_FrontRegionID;
+    }
+}
+
+void UploadRingBuffer::ReleaseCompletedDedicatedBuffers()
+{
+    uint64_t completedFenceValue = m_CommandQueue.GetCompletedFenceValue();
+
+    for ( auto iter = m_DedicatedBuffers.begin(); iter != m_DedicatedBuffers.end(); )
+    {
+        auto& dedicatedBuffer = iter->second;
+        if ( dedicatedBuffer.IsRetired && dedicatedBuffer.FenceValue <= completedFenceValue )
+        {
+            m_IdleDedicatedBufferSize += dedicatedBuffer.Size;
+            m_IdleDedicatedBuffers.push_back( std::move( dedicatedBuffer ) );
+            iter = m_DedicatedBuffers.erase( iter );
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    // A burst of large allocations should not pin the upload memory forever.
+    if ( m_IdleDedicatedBufferSize > m_IdleHighWatermark )
+    {
+        TrimIdleDedicatedBuffers( m_IdleLowWatermark );
+    }
+}
+
+void UploadRingBuffer::TrimIdleDedicatedBuffers( size_t maxIdleSize )
+{
+    while ( m_IdleDedicatedBufferSize > maxIdleSize && !m_IdleDedicatedBuffers.empty() )
+    {
+        auto& dedicatedBuffer = m_IdleDedicatedBuffers.front();
+        dedicatedBuffer.Resource->Unmap( 0, nullptr );
+
+        m_IdleDedicatedBufferSize -= dedicatedBuffer.Size;
+        m_DedicatedBufferSize -= dedicatedBuffer.Size;
+
+        m_IdleDedicatedBuffers.pop_front();
+    }
+}
+
+void UploadRingBuffer::SetIdleWatermarks( size_t lowWatermark, size_t highWatermark )
+{
+    assert( lowWatermark <= highWatermark );
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    m_IdleLowWatermark  = lowWatermark;
+    m_IdleHighWatermark = highWatermark;
+
+    ReleaseCompletedDedicatedBuffers();
+}
+
+void UploadRingBuffer::Trim()
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    ReleaseCompletedDedicatedBuffers();
+    TrimIdleDedicatedBuffers( 0 );
+}
+
+void UploadRingBuffer::UpdatePeakSizes()
+{
+    m_PeakUsedSize            = std::max( m_PeakUsedSize, m_UsedSize );
+    m_PeakDedicatedBufferSize = std::max( m_PeakDedicatedBufferSize, m_DedicatedBufferSize );
+}
+
+UploadRingBuffer::Statistics UploadRingBuffer::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    Statistics statistics;
+
+    statistics.RingBufferSize          = m_Size;
+    statistics.UsedRingBufferSize      = m_UsedSize;
+    statistics.PeakUsedRingBufferSize  = m_PeakUsedSize;
+    statistics.DedicatedBufferSize     = m_DedicatedBufferSize;
+    statistics.PeakDedicatedBufferSize = m_PeakDedicatedBufferSize;
+    statistics.IdleDedicatedBufferSize = m_IdleDedicatedBufferSize;
+    statistics.NumDedicatedBuffers =
+        static_cast<uint32_t>( m_DedicatedBuffers.size() + m_IdleDedicatedBuffers.size() );
+    statistics.NumOverflowAllocations = m_NumOverflowAllocations;
+    statistics.CurrentSize            = m_Size + m_DedicatedBufferSize;
+    statistics.PeakSize               = m_Size + m_PeakDedicatedBufferSize;
+
+    return statistics;
+}
@@ -2,13 +2,17 @@
 
 #include <dx12lib/VertexBuffer.h>
 
+#include <dx12lib/Device.h>
+
 using namespace DX12_Library;
 
 VertexBuffer::VertexBuffer( Device& device, size_t numVertices, size_t vertexStride )
 : Buffer( device, CD3DX12_RESOURCE_DESC::Buffer( numVertices * vertexStride ) )
 , m_NumVertices( numVertices )
 , m_VertexStride( vertexStride )
+, m_Offset( 0 )
 , m_VertexBufferView {}
+, m_StaticAllocationID( 0 )
 {
     CreateVertexBufferView();
 }
@@ -18,16 +22,44 @@ VertexBuffer::VertexBuffer( Device& device, Microsoft::WRL::ComPtr<ID3D12Resourc
 : Buffer( device, resource )
 , m_NumVertices( numVertices )
 , m_VertexStride( vertexStride )
+, m_Offset( 0 )
+, m_VertexBufferView {}
+, m_StaticAllocationID( 0 )
+{
+    CreateVertexBufferView();
+}
+
+VertexBuffer::VertexBuffer( Device& device, const StaticBufferAllocator::Allocation& allocation, size_t numVertices,
+                            size_t vertexStride )
+: Buffer( device, allocation.Resource )
+, m_NumVertices( numVertices )
+, m_VertexStride( vertexStride )
+, m_Offset( allocation.Offset )
 , m_VertexBufferView {}
+, m_StaticAllocationID( allocation.ID )
 {
     CreateVertexBufferView();
+
+    // Update the view if the vertex data is moved to a different block.
+    m_Device.GetStaticBufferAllocator().SetRelocationCallback(
+        m_StaticAllocationID, [this]( const StaticBufferAllocator::Allocation& newAllocation ) {
+            SetD3D12Resource( newAllocation.Resource );
+            m_Offset = newAllocation.Offset;
+            CreateVertexBufferView();
+        } );
 }
 
-VertexBuffer::~VertexBuffer() {}
+VertexBuffer::~VertexBuffer()
+{
+    if ( m_StaticAllocationID != 0 )
+    {
+        m_Device.GetStaticBufferAllocator().Free( m_StaticAllocationID );
+    }
+}
 
 void VertexBuffer::CreateVertexBufferView()
 {
-    m_VertexBufferView.BufferLocation = m_d3d12Resource->GetGPUVirtualAddress();
+    m_VertexBufferView.BufferLocation = m_d3d12Resource->GetGPUVirtualAddress() + m_Offset;
     m_VertexBufferView.SizeInBytes    = static_cast<UINT>( m_NumVertices * m_VertexStride );
     m_VertexBufferView.StrideInBytes  = static_cast<UINT>( m_VertexStride );
 }
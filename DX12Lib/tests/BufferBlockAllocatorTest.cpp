@@ -0,0 +1,209 @@
+#include "Test.h"
+
+#include <dx12lib/BufferBlockAllocator.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+using Allocation = BufferBlockAllocator::Allocation;
+
+void TestAlignment()
+{
+    BufferBlockAllocator allocator( 4096 );
+
+    auto a = allocator.Allocate( 1, 1 );
+    auto b = allocator.Allocate( 256, 256 );
+    CHECK( a.IsValid() && a.BlockIndex == 0 && a.Offset == 0 );
+    CHECK( b.IsValid() && b.BlockIndex == 0 && b.Offset == 256 );
+
+    // The padding before the aligned allocation is returned to the block.
+    auto c = allocator.Allocate( 16, 16 );
+    CHECK( c.BlockIndex == 0 && c.Offset == 16 );
+
+    for ( size_t alignment = 1; alignment <= 1024; alignment *= 2 )
+    {
+        auto allocation = allocator.Allocate( 3, alignment );
+        CHECK( allocation.Offset % alignment == 0 );
+    }
+}
+
+void TestBestFit()
+{
+    BufferBlockAllocator allocator( 1000 );
+
+    auto a = allocator.Allocate( 100, 1 );
+    auto b = allocator.Allocate( 300, 1 );
+    auto c = allocator.Allocate( 100, 1 );
+    auto d = allocator.Allocate( 200, 1 );
+    auto e = allocator.Allocate( 300, 1 );
+    CHECK( allocator.GetNumBlocks() == 1 );
+    CHECK( allocator.GetBlockOccupancy( 0 ).UsedSize == 1000 );
+
+    // The smallest free range that is large enough is used.
+    allocator.Free( b );
+    allocator.Free( d );
+    auto f = allocator.Allocate( 150, 1 );
+    CHECK( f.BlockIndex == 0 && f.Offset == d.Offset );
+
+    // Freeing everything merges the block back into a single free range.
+    allocator.Free( a );
+    allocator.Free( c );
+    allocator.Free( e );
+    allocator.Free( f );
+
+    auto occupancy = allocator.GetBlockOccupancy( 0 );
+    CHECK( occupancy.UsedSize == 0 );
+    CHECK( occupancy.NumAllocations == 0 );
+    CHECK( occupancy.LargestFreeRange == 1000 );
+}
+
+void TestBlocks()
+{
+    BufferBlockAllocator allocator( 1024 );
+
+    auto a = allocator.Allocate( 1000, 1 );
+    auto b = allocator.Allocate( 100, 1 );
+    CHECK( a.BlockIndex == 0 && b.BlockIndex == 1 );
+
+    // Allocations larger than the block size get a block of their own.
+    auto c = allocator.Allocate( 5000, 1 );
+    CHECK( c.BlockIndex == 2 && c.Offset == 0 );
+    CHECK( allocator.GetBlockSize( 2 ) == 5000 );
+
+    // The first block with room is used, even if a later block is a better fit.
+    allocator.Free( a );
+    auto d = allocator.Allocate( 100, 1 );
+    CHECK( d.BlockIndex == 0 );
+
+    auto statistics = allocator.GetStatistics();
+    CHECK( statistics.NumBlocks == 3 );
+    CHECK( statistics.NumAllocations == 3 );
+    CHECK( statistics.TotalSize == 1024 + 1024 + 5000 );
+    CHECK( statistics.UsedSize == 100 + 100 + 5000 );
+    CHECK( statistics.LargestFreeRange == 1024 - 100 );
+}
+
+void TestDefragmentation()
+{
+    BufferBlockAllocator allocator( 1024 );
+
+    std::vector<Allocation> allocations;
+    for ( int i = 0; i < 12; ++i )
+    {
+        allocations.push_back( allocator.Allocate( 256, 256 ) );
+    }
+    CHECK( allocator.GetNumBlocks() == 3 );
+
+    // Nothing can be moved while all blocks are full.
+    CHECK( allocator.FindDefragmentationCandidate() == BufferBlockAllocator::InvalidBlock );
+
+    // Free most of the first and the last block.
+    allocator.Free( allocations[0] );
+    allocator.Free( allocations[1] );
+    allocator.Free( allocations[8] );
+    allocator.Free( allocations[9] );
+    allocator.Free( allocations[10] );
+
+    // The least occupied block is the candidate and its allocations are moved to fuller blocks.
+    uint32_t candidate = allocator.FindDefragmentationCandidate();
+    CHECK( candidate == 2 );
+
+    auto blockAllocations = allocator.GetAllocations( candidate );
+    CHECK( blockAllocations.size() == 1 );
+    for ( auto& allocation: blockAllocations )
+    {
+        auto relocated = allocator.Relocate( allocation, 256 );
+        CHECK( relocated.IsValid() && relocated.BlockIndex == 0 );
+        allocator.Free( allocation );
+    }
+
+    CHECK( allocator.GetBlockOccupancy( 2 ).UsedSize == 0 );
+    CHECK( allocator.GetBlockOccupancy( 0 ).UsedSize == 3 * 256 );
+
+    // Allocations are never moved to a less occupied block.
+    auto allocation = allocator.GetAllocations( 1 ).front();
+    CHECK( !allocator.Relocate( allocation, 256 ).IsValid() );
+}
+
+// Allocations must be aligned, must not overlap and the counters must match the live allocations.
+void TestRandom()
+{
+    BufferBlockAllocator allocator( 64 * 1024 );
+    std::mt19937         random( 1 );
+
+    std::vector<Allocation> allocations;
+
+    for ( int i = 0; i < 20000; ++i )
+    {
+        if ( allocations.empty() || random() % 3 != 0 )
+        {
+            size_t size       = 1 + random() % ( random() % 16 == 0 ? 32 * 1024 : 1024 );
+            size_t alignment  = size_t( 1 ) << ( random() % 9 );
+            auto   allocation = allocator.Allocate( size, alignment );
+
+            CHECK( allocation.IsValid() );
+            CHECK( allocation.Size == size );
+            CHECK( allocation.Offset % alignment == 0 );
+            CHECK( allocation.Offset + size <= allocator.GetBlockSize( allocation.BlockIndex ) );
+            allocations.push_back( allocation );
+        }
+        else
+        {
+            size_t index = random() % allocations.size();
+            allocator.Free( allocations[index] );
+            allocations[index] = allocations.back();
+            allocations.pop_back();
+        }
+    }
+
+    auto sorted = allocations;
+    std::sort( sorted.begin(), sorted.end(), []( const Allocation& a, const Allocation& b ) {
+        return a.BlockIndex != b.BlockIndex ? a.BlockIndex < b.BlockIndex : a.Offset < b.Offset;
+    } );
+    for ( size_t i = 1; i < sorted.size(); ++i )
+    {
+        if ( sorted[i].BlockIndex == sorted[i - 1].BlockIndex )
+        {
+            CHECK( sorted[i - 1].Offset + sorted[i - 1].Size <= sorted[i].Offset );
+        }
+    }
+
+    size_t usedSize = 0;
+    for ( auto& allocation: allocations )
+    {
+        usedSize += allocation.Size;
+    }
+
+    auto statistics = allocator.GetStatistics();
+    CHECK( statistics.NumAllocations == allocations.size() );
+    CHECK( statistics.UsedSize == usedSize );
+
+    for ( auto& allocation: allocations )
+    {
+        allocator.Free( allocation );
+    }
+
+    for ( uint32_t i = 0; i < allocator.GetNumBlocks(); ++i )
+    {
+        CHECK( allocator.GetBlockOccupancy( i ).LargestFreeRange == allocator.GetBlockSize( i ) );
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    TestAlignment();
+    TestBestFit();
+    TestBlocks();
+    TestDefragmentation();
+    TestRandom();
+
+    return Test::Result();
+}
@@ -0,0 +1,246 @@
+#include "Test.h"
+
+#include <dx12lib/CommandStream.h>
+#include <dx12lib/NullCommandBackend.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+// D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT and D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST.
+const uint32_t RenderTargetState    = 0x4;
+const uint32_t PresentState         = 0;
+const uint32_t TriangleListTopology = 4;
+
+// The root parameters of the root signature that the scene is drawn with.
+const uint32_t MatricesRootParameter = 0;
+const uint32_t MaterialRootParameter = 1;
+const uint32_t NumRootParameters     = 2;
+
+struct Matrices
+{
+    float ModelMatrix[16];
+    float ModelViewMatrix[16];
+    float InverseTransposeModelViewMatrix[16];
+    float ModelViewProjectionMatrix[16];
+};
+
+struct Material
+{
+    float Diffuse[4];
+    float Specular[4];
+};
+
+// A mesh instance of the scene, like the ones that the scene visitors draw.
+struct Instance
+{
+    CommandObjectHandle PipelineState;
+    CommandObjectHandle VertexBuffer;
+    CommandObjectHandle IndexBuffer;
+    uint32_t            NumIndices;
+    uint32_t            Material;
+};
+
+struct Scene
+{
+    std::vector<Instance> Instances;
+    std::vector<Material> Materials;
+    // The number of indices of the index buffers, by handle.
+    std::vector<uint32_t> NumIndices;
+};
+
+Scene CreateScene( uint32_t numInstances )
+{
+    const uint32_t NumPipelineStates = 8;
+    const uint32_t NumMeshes         = 256;
+    const uint32_t NumMaterials      = 64;
+
+    std::mt19937 random( 1 );
+
+    Scene scene;
+    for ( uint32_t i = 0; i < NumMeshes; ++i )
+    {
+        scene.NumIndices.push_back( 3 * ( 16 + random() % 4096 ) );
+    }
+    scene.Materials.resize( NumMaterials, Material {} );
+
+    // The instances are sorted by pipeline state, like the opaque pass of a renderer.
+    for ( uint32_t i = 0; i < numInstances; ++i )
+    {
+        uint32_t mesh = random() % NumMeshes;
+
+        Instance instance;
+        instance.PipelineState = i * NumPipelineStates / numInstances;
+        instance.VertexBuffer  = mesh;
+        instance.IndexBuffer   = mesh;
+        instance.NumIndices    = scene.NumIndices[mesh];
+        instance.Material      = random() % NumMaterials;
+        scene.Instances.push_back( instance );
+    }
+
+    return scene;
+}
+
+// Record the commands of a frame that draws every instance of the scene.
+void RecordFrame( const Scene& scene, CommandStream& commandStream )
+{
+    const CommandObjectHandle BackBuffer    = 0;
+    const CommandObjectHandle DepthBuffer   = 1;
+    const CommandObjectHandle RootSignature = 0;
+
+    CommandViewport viewport    = { 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+    CommandRect     scissorRect = { 0, 0, 1920, 1080 };
+
+    // The color attachment and the depth-stencil attachment (see AttachmentPoint).
+    CommandObjectHandle renderTarget[9] = {
+        BackBuffer,           InvalidCommandObject, InvalidCommandObject, InvalidCommandObject, InvalidCommandObject,
+        InvalidCommandObject, InvalidCommandObject, InvalidCommandObject, DepthBuffer,
+    };
+
+    commandStream.TransitionBarrier( BackBuffer, RenderTargetState );
+    commandStream.SetRenderTarget( renderTarget, 9 );
+    commandStream.SetViewports( &viewport, 1 );
+    commandStream.SetScissorRects( &scissorRect, 1 );
+    commandStream.SetGraphicsRootSignature( RootSignature );
+    commandStream.SetPrimitiveTopology( TriangleListTopology );
+
+    Matrices            matrices      = {};
+    CommandObjectHandle pipelineState = InvalidCommandObject;
+    for ( const auto& instance: scene.Instances )
+    {
+        if ( instance.PipelineState != pipelineState )
+        {
+            pipelineState = instance.PipelineState;
+            commandStream.SetPipelineState( pipelineState );
+        }
+
+        matrices.ModelMatrix[12] += 1.0f;
+        commandStream.SetGraphicsDynamicConstantBuffer( MatricesRootParameter, sizeof( Matrices ), &matrices );
+        commandStream.SetGraphicsDynamicConstantBuffer( MaterialRootParameter, sizeof( Material ),
+                                                        &scene.Materials[instance.Material] );
+        commandStream.SetVertexBuffer( 0, instance.VertexBuffer );
+        commandStream.SetIndexBuffer( instance.IndexBuffer );
+        commandStream.DrawIndexed( instance.NumIndices );
+    }
+
+    commandStream.TransitionBarrier( BackBuffer, PresentState );
+}
+
+void DescribeScene( const Scene& scene, NullCommandBackend& backend )
+{
+    backend.DescribeRootSignature( 0, NumRootParameters );
+    for ( uint32_t i = 0; i < scene.NumIndices.size(); ++i )
+    {
+        backend.DescribeIndexBuffer( i, scene.NumIndices[i] );
+    }
+}
+
+// The null backend must find the state that is missing or out of range.
+void TestValidation()
+{
+    CommandStream      commandStream;
+    NullCommandBackend backend;
+    backend.DescribeRootSignature( 0, NumRootParameters );
+    backend.DescribeIndexBuffer( 0, 300 );
+
+    // Nothing is bound.
+    commandStream.Draw( 3 );
+    commandStream.Replay( backend );
+    CHECK( backend.GetStatistics().NumValidationErrors == 6 );
+    CHECK( backend.GetErrors().size() == 6 );
+
+    CommandViewport     viewport    = { 0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f };
+    CommandRect         scissorRect = { 0, 0, 64, 64 };
+    CommandObjectHandle texture     = 0;
+
+    commandStream.Clear();
+    commandStream.SetRenderTarget( &texture, 1 );
+    commandStream.SetViewports( &viewport, 1 );
+    commandStream.SetScissorRects( &scissorRect, 1 );
+    commandStream.SetGraphicsRootSignature( 0 );
+    commandStream.SetPipelineState( 0 );
+    commandStream.SetPipelineState( 0 );
+    commandStream.SetPrimitiveTopology( TriangleListTopology );
+    commandStream.SetIndexBuffer( 0 );
+    commandStream.DrawIndexed( 300 );
+    backend.Reset();
+    commandStream.Replay( backend );
+    CHECK( backend.GetStatistics().NumValidationErrors == 0 );
+    CHECK( backend.GetStatistics().NumRedundantBinds == 1 );
+    CHECK( backend.GetStatistics().NumIndices == 300 );
+
+    // The indices are out of range of the index buffer and the root parameter doesn't exist.
+    uint32_t constant = 0;
+    commandStream.DrawIndexed( 3, 1, 298 );
+    commandStream.SetGraphics32BitConstants( NumRootParameters, 1, &constant );
+    commandStream.CopyResource( 1, 1 );
+    backend.Reset();
+    commandStream.Replay( backend );
+    CHECK( backend.GetStatistics().NumValidationErrors == 3 );
+}
+
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    bool isQuick = Test::IsQuick( argc, argv );
+
+    TestValidation();
+
+    const uint32_t NumInstances = isQuick ? 1000 : 100000;
+    const uint32_t NumFrames    = isQuick ? 2 : 20;
+
+    Scene scene = CreateScene( NumInstances );
+
+    CommandStream      commandStream;
+    NullCommandBackend backend;
+    DescribeScene( scene, backend );
+
+    uint64_t numIndices = 0;
+    for ( const auto& instance: scene.Instances )
+    {
+        numIndices += instance.NumIndices;
+    }
+
+    // The stream keeps its memory, so only the first frame grows it.
+    double recordTime = 0.0;
+    double replayTime = 0.0;
+    for ( uint32_t frame = 0; frame < NumFrames; ++frame )
+    {
+        commandStream.Clear();
+
+        Test::Timer recordTimer;
+        RecordFrame( scene, commandStream );
+        recordTime += recordTimer.GetElapsedMilliseconds();
+
+        backend.Reset();
+
+        Test::Timer replayTimer;
+        commandStream.Replay( backend );
+        replayTime += replayTimer.GetElapsedMilliseconds();
+
+        const auto& statistics = backend.GetStatistics();
+        CHECK( statistics.NumCommands == commandStream.GetNumCommands() );
+        CHECK( statistics.NumDraws == NumInstances );
+        CHECK( statistics.NumIndices == numIndices );
+        CHECK( statistics.NumPipelineStateChanges == 8 );
+        CHECK( statistics.NumRootArguments == 2 * NumInstances );
+        CHECK( statistics.NumInlineBytes == NumInstances * ( sizeof( Matrices ) + sizeof( Material ) ) );
+        CHECK( statistics.NumValidationErrors == 0 );
+    }
+
+    double numCommands = static_cast<double>( commandStream.GetNumCommands() ) * NumFrames;
+    std::printf( "%u instances, %zu commands (%.1f MB) per frame: record %.2f ms/frame (%.1f ns/command), "
+                 "null replay %.2f ms/frame (%.1f ns/command)\n",
+                 NumInstances, commandStream.GetNumCommands(), commandStream.GetSizeInBytes() / ( 1024.0 * 1024.0 ),
+                 recordTime / NumFrames, recordTime * 1e6 / numCommands, replayTime / NumFrames,
+                 replayTime * 1e6 / numCommands );
+
+    return Test::Result();
+}
@@ -0,0 +1,249 @@
+#include "Test.h"
+
+#include <dx12lib/DescriptorFreeList.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+// The free list that DescriptorAllocatorPage used before DescriptorFreeList: the free blocks are stored in a
+// map by offset and in a multimap by size.
+class MapFreeList
+{
+public:
+    explicit MapFreeList( uint32_t capacity )
+    : m_NumFreeHandles( capacity )
+    {
+        AddNewBlock( 0, capacity );
+    }
+
+    uint32_t Allocate( uint32_t numDescriptors )
+    {
+        if ( numDescriptors > m_NumFreeHandles )
+        {
+            return DescriptorFreeList::InvalidOffset;
+        }
+
+        auto smallestBlockIt = m_FreeListBySize.lower_bound( numDescriptors );
+        if ( smallestBlockIt == m_FreeListBySize.end() )
+        {
+            return DescriptorFreeList::InvalidOffset;
+        }
+
+        auto blockSize = smallestBlockIt->first;
+        auto offsetIt  = smallestBlockIt->second;
+        auto offset    = offsetIt->first;
+
+        m_FreeListBySize.erase( smallestBlockIt );
+        m_FreeListByOffset.erase( offsetIt );
+
+        if ( blockSize > numDescriptors )
+        {
+            AddNewBlock( offset + numDescriptors, blockSize - numDescriptors );
+        }
+
+        m_NumFreeHandles -= numDescriptors;
+
+        return offset;
+    }
+
+    void Free( uint32_t offset, uint32_t numDescriptors )
+    {
+        auto nextBlockIt = m_FreeListByOffset.upper_bound( offset );
+        auto prevBlockIt = nextBlockIt;
+        if ( prevBlockIt != m_FreeListByOffset.begin() )
+        {
+            --prevBlockIt;
+        }
+        else
+        {
+            prevBlockIt = m_FreeListByOffset.end();
+        }
+
+        m_NumFreeHandles += numDescriptors;
+
+        if ( prevBlockIt != m_FreeListByOffset.end() && offset == prevBlockIt->first + prevBlockIt->second.Size )
+        {
+            offset = prevBlockIt->first;
+            numDescriptors += prevBlockIt->second.Size;
+
+            m_FreeListBySize.erase( prevBlockIt->second.FreeListBySizeIt );
+            m_FreeListByOffset.erase( prevBlockIt );
+        }
+
+        if ( nextBlockIt != m_FreeListByOffset.end() && offset + numDescriptors == nextBlockIt->first )
+        {
+            numDescriptors += nextBlockIt->second.Size;
+
+            m_FreeListBySize.erase( nextBlockIt->second.FreeListBySizeIt );
+            m_FreeListByOffset.erase( nextBlockIt );
+        }
+
+        AddNewBlock( offset, numDescriptors );
+    }
+
+    uint32_t NumFreeHandles() const
+    {
+        return m_NumFreeHandles;
+    }
+
+private:
+    struct FreeBlockInfo;
+    using FreeListByOffset = std::map<uint32_t, FreeBlockInfo>;
+    using FreeListBySize   = std::multimap<uint32_t, FreeListByOffset::iterator>;
+
+    struct FreeBlockInfo
+    {
+        FreeBlockInfo( uint32_t size )
+        : Size( size )
+        {}
+
+        uint32_t                 Size;
+        FreeListBySize::iterator FreeListBySizeIt;
+    };
+
+    void AddNewBlock( uint32_t offset, uint32_t numDescriptors )
+    {
+        auto offsetIt                           = m_FreeListByOffset.emplace( offset, numDescriptors );
+        auto sizeIt                             = m_FreeListBySize.emplace( numDescriptors, offsetIt.first );
+        offsetIt.first->second.FreeListBySizeIt = sizeIt;
+    }
+
+    FreeListByOffset m_FreeListByOffset;
+    FreeListBySize   m_FreeListBySize;
+    uint32_t         m_NumFreeHandles;
+};
+
+struct Operation
+{
+    // The size of an allocation, or 0 to free the allocation at Index.
+    uint32_t Size;
+    uint32_t Index;
+};
+
+// A page that is kept about half full, with allocations of the sizes of descriptor tables and views.
+std::vector<Operation> CreateWorkload( uint32_t capacity, size_t numOperations )
+{
+    std::mt19937           random( 1 );
+    std::vector<Operation> operations;
+    uint32_t               numLive = 0;
+    uint32_t               numUsed = 0;
+    std::vector<uint32_t>  liveSizes;
+
+    operations.reserve( numOperations );
+    while ( operations.size() < numOperations )
+    {
+        bool allocate = liveSizes.empty() || ( numUsed < capacity / 2 && random() % 4 != 0 ) || random() % 2 == 0;
+        if ( allocate )
+        {
+            uint32_t size = random() % 16 == 0 ? 8 + random() % 56 : 1 + random() % 8;
+            if ( numUsed + size > capacity / 2 + capacity / 4 )
+            {
+                continue;
+            }
+            operations.push_back( { size, numLive++ } );
+            liveSizes.push_back( size );
+            numUsed += size;
+        }
+        else
+        {
+            uint32_t index = random() % static_cast<uint32_t>( liveSizes.size() );
+            operations.push_back( { 0, index } );
+            numUsed -= liveSizes[index];
+            liveSizes[index] = liveSizes.back();
+            liveSizes.pop_back();
+        }
+    }
+
+    return operations;
+}
+
+// Run the workload. The live allocations are stored in a vector and freed by swapping with the last one,
+// which is replayed identically for both free lists. The remaining allocations are freed afterwards.
+template<typename FreeList>
+double Run( FreeList& freeList, const std::vector<Operation>& operations, uint32_t& numFailed )
+{
+    struct Allocation
+    {
+        uint32_t Offset;
+        uint32_t Size;
+    };
+    std::vector<Allocation> live;
+    live.reserve( operations.size() );
+    numFailed = 0;
+
+    Test::Timer timer;
+    for ( const auto& operation: operations )
+    {
+        if ( operation.Size > 0 )
+        {
+            uint32_t offset = freeList.Allocate( operation.Size );
+            numFailed += offset == DescriptorFreeList::InvalidOffset;
+            live.push_back( { offset, operation.Size } );
+        }
+        else
+        {
+            auto allocation = live[operation.Index];
+            live[operation.Index] = live.back();
+            live.pop_back();
+            if ( allocation.Offset != DescriptorFreeList::InvalidOffset )
+            {
+                freeList.Free( allocation.Offset, allocation.Size );
+            }
+        }
+    }
+
+    double time = timer.GetElapsedMilliseconds();
+
+    for ( auto allocation: live )
+    {
+        if ( allocation.Offset != DescriptorFreeList::InvalidOffset )
+        {
+            freeList.Free( allocation.Offset, allocation.Size );
+        }
+    }
+
+    return time;
+}
+
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    // The default page size of DescriptorAllocator.
+    const uint32_t Capacity      = 256;
+    const uint32_t LargeCapacity = 65536;
+
+    bool   isQuick       = Test::IsQuick( argc, argv );
+    size_t numOperations = isQuick ? 10000 : 2000000;
+
+    for ( uint32_t capacity: { Capacity, LargeCapacity } )
+    {
+        auto operations = CreateWorkload( capacity, numOperations );
+
+        DescriptorFreeList freeList( capacity );
+        MapFreeList        mapFreeList( capacity );
+
+        uint32_t numFailed, numMapFailed;
+        double   time    = Run( freeList, operations, numFailed );
+        double   mapTime = Run( mapFreeList, operations, numMapFailed );
+
+        // After all allocations are freed, the blocks are merged into one again.
+        CHECK( freeList.NumFreeHandles() == capacity && freeList.Allocate( capacity ) == 0 );
+        CHECK( mapFreeList.NumFreeHandles() == capacity && mapFreeList.Allocate( capacity ) == 0 );
+
+        std::printf( "%u descriptors, %zu operations: TLSF %.1f ms (%.1f ns/op, %u failed), "
+                     "map %.1f ms (%.1f ns/op, %u failed)\n",
+                     capacity, operations.size(), time, time * 1e6 / operations.size(), numFailed, mapTime,
+                     mapTime * 1e6 / operations.size(), numMapFailed );
+    }
+
+    return Test::Result();
+}
@@ -0,0 +1,135 @@
+#include "Test.h"
+
+#include <dx12lib/DescriptorFreeList.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+void TestWholePage()
+{
+    DescriptorFreeList freeList( 1024 );
+
+    CHECK( freeList.HasSpace( 1024 ) );
+    CHECK( !freeList.HasSpace( 1025 ) );
+
+    // A request for the whole page only fits the block in its own bin.
+    uint32_t offset = freeList.Allocate( 1024 );
+    CHECK( offset == 0 );
+    CHECK( freeList.NumFreeHandles() == 0 );
+    CHECK( freeList.Allocate( 1 ) == DescriptorFreeList::InvalidOffset );
+
+    freeList.Free( offset, 1024 );
+    CHECK( freeList.NumFreeHandles() == 1024 );
+    CHECK( freeList.Allocate( 1024 ) == 0 );
+}
+
+void TestCoalescing()
+{
+    DescriptorFreeList freeList( 300 );
+
+    uint32_t a = freeList.Allocate( 100 );
+    uint32_t b = freeList.Allocate( 100 );
+    uint32_t c = freeList.Allocate( 100 );
+    CHECK( a != DescriptorFreeList::InvalidOffset && b != DescriptorFreeList::InvalidOffset &&
+           c != DescriptorFreeList::InvalidOffset );
+
+    // Freeing the outer blocks leaves two blocks of 100 that can't hold 200 descriptors.
+    freeList.Free( a, 100 );
+    freeList.Free( c, 100 );
+    CHECK( freeList.NumFreeHandles() == 200 );
+    CHECK( !freeList.HasSpace( 200 ) );
+
+    // Freeing the middle block merges all three.
+    freeList.Free( b, 100 );
+    CHECK( freeList.HasSpace( 300 ) );
+    CHECK( freeList.Allocate( 300 ) == 0 );
+}
+
+// Compare the free list with a bitmap of the used descriptors: allocations must not overlap, and an
+// allocation must succeed if (and only if) there is a large enough run of free descriptors, since freed
+// blocks are always merged with their free neighbours.
+void TestRandom()
+{
+    const uint32_t Capacity = 4096;
+
+    DescriptorFreeList freeList( Capacity );
+    std::vector<bool>  used( Capacity, false );
+    std::mt19937       random( 1 );
+
+    struct Allocation
+    {
+        uint32_t Offset;
+        uint32_t Size;
+    };
+    std::vector<Allocation> allocations;
+
+    auto getLongestFreeRun = [&]() {
+        uint32_t longest = 0, run = 0;
+        for ( uint32_t i = 0; i < Capacity; ++i )
+        {
+            run     = used[i] ? 0 : run + 1;
+            longest = std::max( longest, run );
+        }
+        return longest;
+    };
+
+    for ( int i = 0; i < 20000; ++i )
+    {
+        if ( allocations.empty() || random() % 3 != 0 )
+        {
+            // Mostly small allocations with an occasional large one.
+            uint32_t size   = random() % 8 == 0 ? 1 + random() % 512 : 1 + random() % 16;
+            bool     fits   = getLongestFreeRun() >= size;
+            uint32_t offset = freeList.Allocate( size );
+
+            CHECK( ( offset != DescriptorFreeList::InvalidOffset ) == fits );
+            if ( offset != DescriptorFreeList::InvalidOffset )
+            {
+                CHECK( offset + size <= Capacity );
+                for ( uint32_t j = offset; j < offset + size && j < Capacity; ++j )
+                {
+                    CHECK( !used[j] );
+                    used[j] = true;
+                }
+                allocations.push_back( { offset, size } );
+            }
+        }
+        else
+        {
+            size_t index      = random() % allocations.size();
+            auto   allocation = allocations[index];
+            allocations[index] = allocations.back();
+            allocations.pop_back();
+
+            freeList.Free( allocation.Offset, allocation.Size );
+            for ( uint32_t j = allocation.Offset; j < allocation.Offset + allocation.Size; ++j )
+            {
+                used[j] = false;
+            }
+        }
+
+        uint32_t numUsed = 0;
+        for ( auto allocation: allocations )
+        {
+            numUsed += allocation.Size;
+        }
+        CHECK( freeList.NumFreeHandles() == Capacity - numUsed );
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    TestWholePage();
+    TestCoalescing();
+    TestRandom();
+
+    return Test::Result();
+}
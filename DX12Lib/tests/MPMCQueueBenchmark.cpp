@@ -0,0 +1,182 @@
+#include "Test.h"
+
+#include <dx12lib/MPMCQueue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+// The queue that the command queues used before MPMCQueue: a std::queue that is protected by a mutex.
+// Consumers poll it with TryPop.
+template<typename T>
+class LockedQueue
+{
+public:
+    void Push( T value )
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Queue.push( std::move( value ) );
+    }
+
+    bool TryPop( T& value )
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        if ( m_Queue.empty() )
+        {
+            return false;
+        }
+
+        value = std::move( m_Queue.front() );
+        m_Queue.pop();
+
+        return true;
+    }
+
+private:
+    std::queue<T> m_Queue;
+    std::mutex    m_Mutex;
+};
+
+// Pushes and pops that poll the queue, like the command queues that look for available command lists.
+struct PollingMPMCQueue
+{
+    PollingMPMCQueue()
+    : Queue( 1024 )
+    {}
+
+    void Push( uint64_t value )
+    {
+        while ( !Queue.TryPush( value ) )
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    bool TryPop( uint64_t& value )
+    {
+        return Queue.TryPop( value );
+    }
+
+    MPMCQueue<uint64_t> Queue;
+};
+
+// Pushes and pops that block, like the threads that wait for command lists in flight.
+struct BlockingMPMCQueue
+{
+    BlockingMPMCQueue()
+    : Queue( 1024 )
+    {}
+
+    void Push( uint64_t value )
+    {
+        Queue.Push( value );
+    }
+
+    bool TryPop( uint64_t& value )
+    {
+        Queue.Pop( value );
+        return true;
+    }
+
+    MPMCQueue<uint64_t> Queue;
+};
+
+// Push the values 1..numValues on each producer and pop them on the consumers. A value of 0 stops a consumer.
+// Returns the time in milliseconds.
+template<typename Queue>
+double Run( uint32_t numProducers, uint32_t numConsumers, uint64_t numValues )
+{
+    Queue                    queue;
+    std::atomic_uint64_t     sum( 0 );
+    std::atomic_uint64_t     count( 0 );
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+
+    Test::Timer timer;
+    for ( uint32_t i = 0; i < numConsumers; ++i )
+    {
+        consumers.emplace_back( [&]() {
+            uint64_t localSum = 0, localCount = 0, value;
+            while ( true )
+            {
+                if ( !queue.TryPop( value ) )
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if ( value == 0 )
+                {
+                    break;
+                }
+                localSum += value;
+                ++localCount;
+            }
+            sum += localSum;
+            count += localCount;
+        } );
+    }
+    for ( uint32_t i = 0; i < numProducers; ++i )
+    {
+        producers.emplace_back( [&]() {
+            for ( uint64_t value = 1; value <= numValues; ++value )
+            {
+                queue.Push( value );
+            }
+        } );
+    }
+
+    for ( auto& producer: producers )
+    {
+        producer.join();
+    }
+    for ( uint32_t i = 0; i < numConsumers; ++i )
+    {
+        queue.Push( 0 );
+    }
+    for ( auto& consumer: consumers )
+    {
+        consumer.join();
+    }
+    double time = timer.GetElapsedMilliseconds();
+
+    // Every value must be popped exactly once.
+    CHECK( count == numProducers * numValues );
+    CHECK( sum == numProducers * numValues * ( numValues + 1 ) / 2 );
+
+    return time;
+}
+
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    bool isQuick = Test::IsQuick( argc, argv );
+
+    const uint64_t NumValues = isQuick ? 10000 : 1000000;
+
+    uint32_t maxThreads = std::max( 2u, std::min( 16u, std::thread::hardware_concurrency() ) );
+    for ( uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+    {
+        double lockedTime   = Run<LockedQueue<uint64_t>>( numThreads, numThreads, NumValues );
+        double pollingTime  = Run<PollingMPMCQueue>( numThreads, numThreads, NumValues );
+        double blockingTime = Run<BlockingMPMCQueue>( numThreads, numThreads, NumValues );
+
+        double numValues = static_cast<double>( numThreads * NumValues );
+        std::printf( "%u producer(s), %u consumer(s): locked queue %.1f ns/value, MPMC queue %.1f ns/value, "
+                     "blocking MPMC queue %.1f ns/value\n",
+                     numThreads, numThreads, lockedTime * 1e6 / numValues, pollingTime * 1e6 / numValues,
+                     blockingTime * 1e6 / numValues );
+    }
+
+    return Test::Result();
+}
@@ -0,0 +1,159 @@
+#include "Test.h"
+
+#include <dx12lib/ProfileAggregator.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+using Scope  = ProfileAggregator::Scope;
+using Timing = ProfileAggregator::Timing;
+
+// One tick is a millisecond.
+const uint64_t Frequency = 1000;
+
+bool IsNear( double a, double b )
+{
+    return std::abs( a - b ) < 1e-9;
+}
+
+const Timing* FindTiming( const ProfileAggregator& aggregator, const std::string& name, uint32_t depth )
+{
+    for ( const auto& timing: aggregator.GetTimings() )
+    {
+        if ( timing.Name == name && timing.Depth == depth )
+        {
+            return &timing;
+        }
+    }
+    return nullptr;
+}
+
+void TestHierarchy()
+{
+    ProfileAggregator aggregator;
+
+    std::vector<Scope> scopes = {
+        { "Frame", ProfileAggregator::InvalidScope, 0, 16 },
+        { "Shadows", 0, 0, 4 },
+        { "Main", 0, 4, 14 },
+        { "Opaque", 2, 5, 10 },
+        { "Transparent", 2, 10, 13 },
+        { "Present", ProfileAggregator::InvalidScope, 16, 17 },
+    };
+    aggregator.AddFrame( scopes, Frequency );
+
+    // The timings are in depth-first order.
+    const auto& timings = aggregator.GetTimings();
+    CHECK( timings.size() == 6 );
+    const char*    names[]  = { "Frame", "Shadows", "Main", "Opaque", "Transparent", "Present" };
+    const uint32_t depths[] = { 0, 1, 1, 2, 2, 0 };
+    const double   ms[]     = { 16.0, 4.0, 10.0, 5.0, 3.0, 1.0 };
+    for ( size_t i = 0; i < timings.size() && i < 6; ++i )
+    {
+        CHECK( timings[i].Name == names[i] );
+        CHECK( timings[i].Depth == depths[i] );
+        CHECK( IsNear( timings[i].LastMs, ms[i] ) );
+        CHECK( IsNear( timings[i].MinMs, ms[i] ) && IsNear( timings[i].MaxMs, ms[i] ) );
+        CHECK( timings[i].NumSamples == 1 );
+    }
+    CHECK( aggregator.GetNumFrames() == 1 );
+
+    // Scopes are identified by their path and not by the order in which they are recorded.
+    scopes = {
+        { "Frame", ProfileAggregator::InvalidScope, 0, 20 },
+        { "Main", 0, 0, 12 },
+        { "Transparent", 1, 0, 2 },
+        { "Opaque", 1, 2, 12 },
+        { "Shadows", 0, 12, 20 },
+    };
+    aggregator.AddFrame( scopes, Frequency );
+
+    CHECK( timings.size() == 6 );
+    CHECK( timings[1].Name == "Shadows" && IsNear( timings[1].LastMs, 8.0 ) && IsNear( timings[1].AvgMs, 6.0 ) );
+    CHECK( timings[3].Name == "Opaque" && IsNear( timings[3].LastMs, 10.0 ) && IsNear( timings[3].MinMs, 5.0 ) );
+
+    // Present was not measured in the second frame.
+    CHECK( timings[5].Name == "Present" && timings[5].NumSamples == 1 && IsNear( timings[5].LastMs, 1.0 ) );
+}
+
+void TestRollingWindow()
+{
+    ProfileAggregator aggregator( 4 );
+
+    // The durations are 1, 2, ..., 6 ms. Only the last 4 frames are in the window.
+    for ( uint64_t frame = 1; frame <= 6; ++frame )
+    {
+        std::vector<Scope> scopes = { { "Frame", ProfileAggregator::InvalidScope, 100 * frame, 101 * frame } };
+        aggregator.AddFrame( scopes, Frequency );
+    }
+
+    auto timing = FindTiming( aggregator, "Frame", 0 );
+    CHECK( timing != nullptr );
+    if ( timing )
+    {
+        CHECK( timing->NumSamples == 4 );
+        CHECK( IsNear( timing->LastMs, 6.0 ) );
+        CHECK( IsNear( timing->MinMs, 3.0 ) );
+        CHECK( IsNear( timing->AvgMs, 4.5 ) );
+        CHECK( IsNear( timing->MaxMs, 6.0 ) );
+    }
+
+    // A scope that is not measured for a whole window is hidden, but its children are still shown.
+    for ( int frame = 0; frame < 4; ++frame )
+    {
+        std::vector<Scope> scopes = {
+            { "Frame", ProfileAggregator::InvalidScope, 10, 0 },
+            { "Child", 0, 0, 2 },
+        };
+        aggregator.AddFrame( scopes, Frequency );
+    }
+
+    CHECK( FindTiming( aggregator, "Frame", 0 ) == nullptr );
+    timing = FindTiming( aggregator, "Child", 1 );
+    CHECK( timing != nullptr && timing->NumSamples == 4 && IsNear( timing->AvgMs, 2.0 ) );
+    CHECK( aggregator.GetNumFrames() == 10 );
+}
+
+void TestSummedScopes()
+{
+    ProfileAggregator aggregator;
+
+    // Scopes with the same path in a frame are summed (for example a pass that is recorded in chunks), but scopes
+    // with the same name and different parents are not.
+    std::vector<Scope> scopes = {
+        { "Frame", ProfileAggregator::InvalidScope, 0, 30 },
+        { "Draw", 0, 0, 5 },
+        { "Draw", 0, 10, 12 },
+        { "Post", 0, 20, 30 },
+        { "Draw", 3, 21, 22 },
+    };
+    aggregator.AddFrame( scopes, 2 * Frequency );
+
+    CHECK( aggregator.GetTimings().size() == 4 );
+
+    auto draw = FindTiming( aggregator, "Draw", 1 );
+    CHECK( draw != nullptr && IsNear( draw->LastMs, 3.5 ) );
+    auto postDraw = FindTiming( aggregator, "Draw", 2 );
+    CHECK( postDraw != nullptr && IsNear( postDraw->LastMs, 0.5 ) );
+
+    aggregator.Reset();
+    CHECK( aggregator.GetTimings().empty() );
+    CHECK( aggregator.GetNumFrames() == 0 );
+}
+
+}  // namespace
+
+int main()
+{
+    TestHierarchy();
+    TestRollingWindow();
+    TestSummedScopes();
+
+    return Test::Result();
+}
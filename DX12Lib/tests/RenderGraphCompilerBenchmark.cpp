@@ -0,0 +1,222 @@
+#include "Test.h"
+
+#include <dx12lib/RenderGraphCompiler.h>
+#include <dx12lib/ResourceBarrierOptimizer.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+using Compiler = RenderGraphCompiler;
+
+const uint32_t NumBuffers = 4;
+
+// Add a synthetic frame: graphics passes that render into transient textures and sample the results of
+// recent passes, compute passes that update imported buffers and may run on the compute queue, passes whose
+// results are never used and a last pass that writes the back buffer. The passes are also appended to a vector,
+// because the compiler doesn't return them.
+void AddFrame( Compiler& compiler, uint32_t numPasses, std::mt19937& random, std::vector<Compiler::PassDesc>& passes )
+{
+    auto backBuffer = compiler.AddResource( { true, D3D12_RESOURCE_STATE_PRESENT } );
+
+    std::vector<uint32_t> buffers;
+    for ( uint32_t i = 0; i < NumBuffers; ++i )
+    {
+        buffers.push_back( compiler.AddResource( { true, D3D12_RESOURCE_STATE_UNORDERED_ACCESS } ) );
+    }
+
+    auto depth = compiler.AddResource( { false, D3D12_RESOURCE_STATE_COMMON } );
+
+    // The textures that were written by the graphics passes.
+    std::vector<uint32_t> textures;
+    bool                  hasDepth = false;
+
+    for ( uint32_t pass = 0; pass + 1 < numPasses; ++pass )
+    {
+        Compiler::PassDesc passDesc = {};
+
+        if ( random() % 4 == 0 )
+        {
+            uint32_t buffer = random() % NumBuffers;
+            passDesc.Accesses.push_back(
+                { buffers[buffer], D3D12_RESOURCE_STATE_UNORDERED_ACCESS, Compiler::ReadWrite } );
+            passDesc.Accesses.push_back( { buffers[( buffer + 1 ) % NumBuffers],
+                                           D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, Compiler::Read } );
+            passDesc.Flags = Compiler::PassFlagAllowAsyncCompute;
+        }
+        else
+        {
+            // The results of some passes are never read.
+            bool isUnused = random() % 8 == 0;
+
+            for ( uint32_t i = 0, numReads = random() % 3; i < numReads && !textures.empty(); ++i )
+            {
+                uint32_t recent = std::min<uint32_t>( static_cast<uint32_t>( textures.size() ), 8 );
+                passDesc.Accesses.push_back( { textures[textures.size() - 1 - random() % recent],
+                                               D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, Compiler::Read } );
+            }
+            if ( random() % 2 == 0 )
+            {
+                passDesc.Accesses.push_back(
+                    { buffers[random() % NumBuffers], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, Compiler::Read } );
+            }
+            if ( !isUnused )
+            {
+                passDesc.Accesses.push_back( { depth, D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                                               hasDepth ? Compiler::ReadWrite : Compiler::Write } );
+                hasDepth = true;
+            }
+
+            auto texture = compiler.AddResource( { false, D3D12_RESOURCE_STATE_COMMON } );
+            passDesc.Accesses.push_back( { texture, D3D12_RESOURCE_STATE_RENDER_TARGET, Compiler::Write } );
+            if ( !isUnused )
+            {
+                textures.push_back( texture );
+            }
+        }
+
+        compiler.AddPass( passDesc );
+        passes.push_back( passDesc );
+    }
+
+    Compiler::PassDesc present = {};
+    for ( uint32_t i = 0; i < 4 && i < textures.size(); ++i )
+    {
+        present.Accesses.push_back(
+            { textures[textures.size() - 1 - i], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, Compiler::Read } );
+    }
+    present.Accesses.push_back( { backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, Compiler::Write } );
+    compiler.AddPass( present );
+    passes.push_back( present );
+}
+
+// Check that the compiled passes are in a valid order and that the barriers take every resource from the
+// state of its last use to the state of its next use.
+void CheckCompiledPasses( const Compiler& compiler, const std::vector<Compiler::PassDesc>& passes )
+{
+    const auto& compiledPasses = compiler.GetCompiledPasses();
+
+    std::vector<uint32_t> compiledPassIndices( passes.size(), Compiler::InvalidIndex );
+    for ( uint32_t i = 0; i < compiledPasses.size(); ++i )
+    {
+        compiledPassIndices[compiledPasses[i].PassIndex] = i;
+    }
+
+    // Every pass that is executed comes after the last pass that was added before it and wrote what it reads.
+    std::vector<uint32_t> lastWriters( compiler.GetNumResources(), Compiler::InvalidIndex );
+    for ( uint32_t pass = 0; pass < passes.size(); ++pass )
+    {
+        for ( const auto& access: passes[pass].Accesses )
+        {
+            auto lastWriter = lastWriters[access.Resource];
+            if ( compiledPassIndices[pass] != Compiler::InvalidIndex && access.Type != Compiler::Write &&
+                 lastWriter != Compiler::InvalidIndex )
+            {
+                CHECK( compiledPassIndices[lastWriter] < compiledPassIndices[pass] );
+            }
+            if ( access.Type != Compiler::Read )
+            {
+                lastWriters[access.Resource] = pass;
+            }
+        }
+    }
+
+    // AddFrame adds the imported resources first: the back buffer and the buffers.
+    std::vector<D3D12_RESOURCE_STATES> states( compiler.GetNumResources(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS );
+    std::vector<bool>                  isUsed( compiler.GetNumResources(), false );
+    states[0] = D3D12_RESOURCE_STATE_PRESENT;
+    std::fill( isUsed.begin(), isUsed.begin() + 1 + NumBuffers, true );
+
+    uint32_t numSplitBarriers = 0;
+    for ( uint32_t i = 0; i < compiledPasses.size(); ++i )
+    {
+        const auto& compiledPass = compiledPasses[i];
+
+        for ( const auto& barrier: compiledPass.BarriersBefore )
+        {
+            if ( barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION )
+            {
+                CHECK( barrier.StateBefore == states[barrier.Resource] );
+                states[barrier.Resource] = barrier.StateAfter;
+            }
+        }
+        for ( const auto& barrier: compiledPass.BarriersAfter )
+        {
+            CHECK( barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY );
+            ++numSplitBarriers;
+        }
+
+        for ( const auto& access: passes[compiledPass.PassIndex].Accesses )
+        {
+            if ( !isUsed[access.Resource] )
+            {
+                // Transient resources are initialized by their first pass.
+                CHECK( compiler.GetLifetime( access.Resource ).FirstPass == i );
+                states[access.Resource] = access.State;
+                isUsed[access.Resource] = true;
+            }
+            CHECK( ResourceBarrierOptimizer::IsStateCompatible( states[access.Resource], access.State ) );
+            CHECK( compiler.GetLifetime( access.Resource ).LastPass >= i );
+        }
+    }
+    CHECK( numSplitBarriers == compiler.GetStatistics().NumSplitBarriers );
+}
+
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    bool isQuick = Test::IsQuick( argc, argv );
+
+    const uint32_t NumPasses     = 200;
+    const uint32_t NumGraphs     = isQuick ? 4 : 32;
+    const uint32_t NumIterations = isQuick ? 10 : 1000;
+
+    std::mt19937 random( 1 );
+
+    double   compileTime           = 0.0;
+    uint32_t numCulledPasses       = 0;
+    uint32_t numAsyncComputePasses = 0;
+    uint32_t numBarriers           = 0;
+    uint32_t numSplitBarriers      = 0;
+
+    for ( uint32_t graph = 0; graph < NumGraphs; ++graph )
+    {
+        Compiler                        compiler;
+        std::vector<Compiler::PassDesc> passes;
+        AddFrame( compiler, NumPasses, random, passes );
+
+        // The render graph compiles the passes every frame.
+        Test::Timer timer;
+        for ( uint32_t iteration = 0; iteration < NumIterations; ++iteration )
+        {
+            compiler.Compile();
+        }
+        compileTime += timer.GetElapsedMilliseconds();
+
+        CheckCompiledPasses( compiler, passes );
+
+        auto statistics = compiler.GetStatistics();
+        CHECK( statistics.NumPasses == NumPasses );
+        CHECK( statistics.NumCulledPasses > 0 );
+        numCulledPasses += statistics.NumCulledPasses;
+        numAsyncComputePasses += statistics.NumAsyncComputePasses;
+        numBarriers += statistics.NumBarriers;
+        numSplitBarriers += statistics.NumSplitBarriers;
+    }
+
+    std::printf( "%u passes: %.1f us/compile, %.1f culled, %.1f async compute passes, %.1f barriers "
+                 "(%.1f split)\n",
+                 NumPasses, compileTime * 1e3 / ( NumGraphs * NumIterations ), double( numCulledPasses ) / NumGraphs,
+                 double( numAsyncComputePasses ) / NumGraphs, double( numBarriers ) / NumGraphs,
+                 double( numSplitBarriers ) / NumGraphs );
+
+    return Test::Result();
+}
@@ -0,0 +1,162 @@
+#include "Test.h"
+
+#include <dx12lib/ResourceBarrierOptimizer.h>
+#include <dx12lib/d3dx12.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+// The resources are never dereferenced, they are only compared.
+struct alignas( 16 ) FakeResource
+{
+    uint8_t Data[16];
+};
+
+const D3D12_RESOURCE_STATES States[] = {
+    D3D12_RESOURCE_STATE_RENDER_TARGET,         D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+    D3D12_RESOURCE_STATE_COPY_SOURCE,           D3D12_RESOURCE_STATE_COPY_DEST,
+};
+
+// Generate batches of barriers like the ones that are flushed between the passes of a frame: transitions
+// of a few resources (some of them several times), UAV barriers and split barriers.
+std::vector<std::vector<D3D12_RESOURCE_BARRIER>> GenerateBatches( uint32_t numBatches, uint32_t numResources )
+{
+    static std::vector<FakeResource> fakeResources( numResources );
+
+    std::mt19937                       random( 1 );
+    std::vector<D3D12_RESOURCE_STATES> resourceStates( numResources, D3D12_RESOURCE_STATE_COMMON );
+
+    std::vector<std::vector<D3D12_RESOURCE_BARRIER>> batches( numBatches );
+    for ( auto& batch: batches )
+    {
+        uint32_t numBarriers = 4 + random() % 28;
+        for ( uint32_t i = 0; i < numBarriers; ++i )
+        {
+            // Most barriers of a batch use a small set of resources.
+            uint32_t index    = random() % 2 == 0 ? random() % 8 : random() % numResources;
+            auto     resource = reinterpret_cast<ID3D12Resource*>( &fakeResources[index] );
+            auto&    state    = resourceStates[index];
+
+            switch ( random() % 8 )
+            {
+            case 0:
+                batch.push_back( CD3DX12_RESOURCE_BARRIER::UAV( resource ) );
+                break;
+            case 1:
+            {
+                auto stateAfter = States[random() % 6];
+                if ( stateAfter != state )
+                {
+                    batch.push_back( CD3DX12_RESOURCE_BARRIER::Transition(
+                        resource, state, stateAfter, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                        D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY ) );
+                    batch.push_back( CD3DX12_RESOURCE_BARRIER::Transition(
+                        resource, state, stateAfter, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                        D3D12_RESOURCE_BARRIER_FLAG_END_ONLY ) );
+                    state = stateAfter;
+                }
+                break;
+            }
+            default:
+            {
+                auto stateAfter = States[random() % 6];
+                if ( stateAfter != state )
+                {
+                    batch.push_back( CD3DX12_RESOURCE_BARRIER::Transition( resource, state, stateAfter ) );
+                    state = stateAfter;
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    return batches;
+}
+
+// The state every resource is in after a batch.
+std::map<ID3D12Resource*, D3D12_RESOURCE_STATES> GetFinalStates( const std::vector<D3D12_RESOURCE_BARRIER>& batch )
+{
+    std::map<ID3D12Resource*, D3D12_RESOURCE_STATES> finalStates;
+    for ( const auto& barrier: batch )
+    {
+        if ( barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+             barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY )
+        {
+            finalStates[barrier.Transition.pResource] = barrier.Transition.StateAfter;
+        }
+    }
+    return finalStates;
+}
+
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    bool isQuick = Test::IsQuick( argc, argv );
+
+    const uint32_t NumBatches    = 4096;
+    const uint32_t NumResources  = 256;
+    const uint32_t NumIterations = isQuick ? 1 : 100;
+
+    auto batches = GenerateBatches( NumBatches, NumResources );
+
+    ResourceBarrierOptimizer            optimizer;
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+    // The optimized batch must leave every resource in the state the batch transitions it to, or in a
+    // combination of read states that includes it.
+    for ( const auto& batch: batches )
+    {
+        barriers = batch;
+        optimizer.Optimize( barriers );
+        CHECK( barriers.size() <= batch.size() );
+
+        auto finalStates = GetFinalStates( batch );
+        for ( const auto& combinedState: optimizer.GetCombinedStates() )
+        {
+            CHECK( ResourceBarrierOptimizer::IsStateCompatible( combinedState.State,
+                                                                finalStates[combinedState.Resource] ) );
+            finalStates[combinedState.Resource] = combinedState.State;
+        }
+
+        for ( const auto& finalState: GetFinalStates( barriers ) )
+        {
+            CHECK( finalStates[finalState.first] == finalState.second );
+        }
+    }
+    optimizer.ResetStatistics();
+
+    Test::Timer timer;
+    for ( uint32_t iteration = 0; iteration < NumIterations; ++iteration )
+    {
+        for ( const auto& batch: batches )
+        {
+            barriers.assign( batch.begin(), batch.end() );
+            optimizer.Optimize( barriers );
+        }
+    }
+    double time = timer.GetElapsedMilliseconds();
+
+    auto statistics = optimizer.GetStatistics();
+    CHECK( statistics.NumRemovedBarriers > 0 );
+    CHECK( statistics.NumCombinedReadStates > 0 );
+    CHECK( statistics.NumCollapsedSplitBarriers > 0 );
+
+    std::printf( "%u batches, %u barriers: %.1f ms (%.1f ns/barrier), %.1f%% removed, %u combined read states, "
+                 "%u collapsed split barriers\n",
+                 NumBatches * NumIterations, statistics.NumBarriers, time, time * 1e6 / statistics.NumBarriers,
+                 100.0 * statistics.NumRemovedBarriers / statistics.NumBarriers, statistics.NumCombinedReadStates,
+                 statistics.NumCollapsedSplitBarriers );
+
+    return Test::Result();
+}
@@ -0,0 +1,198 @@
+#include "Test.h"
+
+#include <dx12lib/ResourceBarrierOptimizer.h>
+#include <dx12lib/d3dx12.h>
+
+#include <cstdint>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+// The resources are never dereferenced, they are only compared.
+struct alignas( 16 ) FakeResource
+{
+    uint8_t Data[16];
+};
+
+FakeResource g_FakeResources[2];
+
+ID3D12Resource* const R1 = reinterpret_cast<ID3D12Resource*>( &g_FakeResources[0] );
+ID3D12Resource* const R2 = reinterpret_cast<ID3D12Resource*>( &g_FakeResources[1] );
+
+using Barriers = std::vector<D3D12_RESOURCE_BARRIER>;
+
+D3D12_RESOURCE_BARRIER Transition( ID3D12Resource* resource, D3D12_RESOURCE_STATES stateBefore,
+                                   D3D12_RESOURCE_STATES stateAfter,
+                                   UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                                   D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE )
+{
+    return CD3DX12_RESOURCE_BARRIER::Transition( resource, stateBefore, stateAfter, subresource, flags );
+}
+
+void TestMergeTransitions()
+{
+    ResourceBarrierOptimizer optimizer;
+
+    // A->B, B->C becomes A->C. Barriers of other resources are kept in order.
+    Barriers barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_UNORDERED_ACCESS ),
+        Transition( R2, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST ),
+        Transition( R1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 1 );
+    CHECK( barriers.size() == 2 );
+    CHECK( barriers[0].Transition.pResource == R1 );
+    CHECK( barriers[0].Transition.StateBefore == D3D12_RESOURCE_STATE_RENDER_TARGET );
+    CHECK( barriers[0].Transition.StateAfter == D3D12_RESOURCE_STATE_COPY_DEST );
+    CHECK( barriers[1].Transition.pResource == R2 );
+
+    // Subresources are merged independently.
+    barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0 ),
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 1 ),
+        Transition( R1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RENDER_TARGET, 0 ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 2 );
+    CHECK( barriers.size() == 1 );
+    CHECK( barriers[0].Transition.Subresource == 1 );
+
+    // Transitions are not merged across an aliasing barrier.
+    barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_UNORDERED_ACCESS ),
+        CD3DX12_RESOURCE_BARRIER::Aliasing( nullptr, R2 ),
+        Transition( R1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RENDER_TARGET ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 0 );
+    CHECK( barriers.size() == 3 );
+}
+
+void TestCancelTransitions()
+{
+    ResourceBarrierOptimizer optimizer;
+
+    // A->B, B->A is removed.
+    Barriers barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS ),
+        Transition( R1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 2 );
+    CHECK( barriers.empty() );
+
+    // The UAV barrier after the cancelled transitions is kept.
+    barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE ),
+        Transition( R1, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ),
+        CD3DX12_RESOURCE_BARRIER::UAV( R1 ),
+    };
+    optimizer.Optimize( barriers );
+    CHECK( barriers.size() == 1 );
+    CHECK( barriers[0].Type == D3D12_RESOURCE_BARRIER_TYPE_UAV );
+}
+
+void TestCombineReadStates()
+{
+    ResourceBarrierOptimizer optimizer;
+
+    const auto readStates =
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+    // A->SRV, SRV->NON_PIXEL_SRV becomes A->SRV|NON_PIXEL_SRV.
+    Barriers barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ),
+        Transition( R1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 1 );
+    CHECK( barriers.size() == 1 );
+    CHECK( barriers[0].Transition.StateAfter == readStates );
+    CHECK( optimizer.GetCombinedStates().size() == 1 );
+    CHECK( optimizer.GetCombinedStates()[0].Resource == R1 );
+    CHECK( optimizer.GetCombinedStates()[0].State == readStates );
+
+    // A transition of a subresource closes the combined transition, which is undone.
+    barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ),
+        Transition( R1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE ),
+        Transition( R1, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST, 2 ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 1 );
+    CHECK( barriers.size() == 2 );
+    CHECK( barriers[0].Transition.StateAfter == D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+    CHECK( optimizer.GetCombinedStates().empty() );
+
+    CHECK( ResourceBarrierOptimizer::IsStateCompatible( D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                        D3D12_RESOURCE_STATE_COPY_SOURCE ) );
+    CHECK( ResourceBarrierOptimizer::IsStateCompatible( readStates, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ) );
+    CHECK( !ResourceBarrierOptimizer::IsStateCompatible( D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                         D3D12_RESOURCE_STATE_COMMON ) );
+    CHECK( !ResourceBarrierOptimizer::IsStateCompatible( D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                                                         D3D12_RESOURCE_STATE_GENERIC_READ ) );
+}
+
+void TestSplitBarriers()
+{
+    ResourceBarrierOptimizer optimizer;
+
+    // A split barrier that begins and ends in the same batch becomes a normal barrier.
+    Barriers barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                    D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY ),
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                    D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 1 );
+    CHECK( barriers.size() == 1 );
+    CHECK( barriers[0].Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE );
+    CHECK( optimizer.GetStatistics().NumCollapsedSplitBarriers == 1 );
+
+    // A split barrier that only begins is kept.
+    barriers = {
+        Transition( R1, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                    D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY ),
+        Transition( R2, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 0 );
+    CHECK( barriers[0].Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY );
+}
+
+void TestUAVBarriers()
+{
+    ResourceBarrierOptimizer optimizer;
+
+    // The duplicate UAV barrier of R1 and the UAV barrier of R2, which is covered by the UAV barrier
+    // of all resources, are removed.
+    Barriers barriers = {
+        CD3DX12_RESOURCE_BARRIER::UAV( R1 ),
+        CD3DX12_RESOURCE_BARRIER::UAV( R1 ),
+        CD3DX12_RESOURCE_BARRIER::UAV( nullptr ),
+        CD3DX12_RESOURCE_BARRIER::UAV( R2 ),
+    };
+    CHECK( optimizer.Optimize( barriers ) == 2 );
+    CHECK( barriers.size() == 2 );
+    CHECK( barriers[0].UAV.pResource == R1 );
+    CHECK( barriers[1].UAV.pResource == nullptr );
+
+    auto statistics = optimizer.GetStatistics();
+    CHECK( statistics.NumBarriers == 4 );
+    CHECK( statistics.NumRemovedBarriers == 2 );
+
+    optimizer.ResetStatistics();
+    CHECK( optimizer.GetStatistics().NumBarriers == 0 );
+}
+
+}  // namespace
+
+int main()
+{
+    TestMergeTransitions();
+    TestCancelTransitions();
+    TestCombineReadStates();
+    TestSplitBarriers();
+    TestUAVBarriers();
+
+    return Test::Result();
+}
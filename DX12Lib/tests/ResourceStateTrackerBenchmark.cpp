@@ -0,0 +1,262 @@
+#include "Test.h"
+
+#include <dx12lib/ResourceStateTracker.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace DX12_Library;
+
+namespace
+{
+
+// The resource state tracker that was used before the states were stored in per-resource blocks: the final states
+// of a command list and the global states are hash maps, and the global states are protected by a single lock.
+class GlobalLockStateTracker
+{
+public:
+    void TransitionResource( ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter )
+    {
+        auto iter = m_FinalResourceStates.find( resource );
+        if ( iter != m_FinalResourceStates.end() )
+        {
+            auto state = iter->second.GetSubresourceState( D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+            if ( state != stateAfter )
+            {
+                m_ResourceBarriers.push_back( CD3DX12_RESOURCE_BARRIER::Transition( resource, state, stateAfter ) );
+            }
+        }
+        else
+        {
+            m_PendingResourceBarriers.push_back(
+                CD3DX12_RESOURCE_BARRIER::Transition( resource, D3D12_RESOURCE_STATE_COMMON, stateAfter ) );
+        }
+
+        m_FinalResourceStates[resource].SetSubresourceState( D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, stateAfter );
+    }
+
+    uint32_t ResolvePendingResourceBarriers( std::vector<D3D12_RESOURCE_BARRIER>& resourceBarriers )
+    {
+        size_t firstBarrier = resourceBarriers.size();
+
+        std::lock_guard<std::mutex> lock( ms_GlobalMutex );
+
+        for ( auto barrier: m_PendingResourceBarriers )
+        {
+            auto iter = ms_GlobalResourceStates.find( barrier.Transition.pResource );
+            if ( iter != ms_GlobalResourceStates.end() )
+            {
+                auto globalState = iter->second.GetSubresourceState( D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES );
+                if ( globalState != barrier.Transition.StateAfter )
+                {
+                    barrier.Transition.StateBefore = globalState;
+                    resourceBarriers.push_back( barrier );
+                }
+            }
+        }
+
+        for ( const auto& finalState: m_FinalResourceStates )
+        {
+            ms_GlobalResourceStates[finalState.first] = finalState.second;
+        }
+
+        m_PendingResourceBarriers.clear();
+        m_FinalResourceStates.clear();
+
+        return static_cast<uint32_t>( resourceBarriers.size() - firstBarrier );
+    }
+
+    void Reset()
+    {
+        m_PendingResourceBarriers.clear();
+        m_ResourceBarriers.clear();
+        m_FinalResourceStates.clear();
+    }
+
+private:
+    std::vector<D3D12_RESOURCE_BARRIER>                 m_PendingResourceBarriers;
+    std::vector<D3D12_RESOURCE_BARRIER>                 m_ResourceBarriers;
+    std::unordered_map<ID3D12Resource*, ResourceState> m_FinalResourceStates;
+
+    static std::unordered_map<ID3D12Resource*, ResourceState> ms_GlobalResourceStates;
+    static std::mutex                                         ms_GlobalMutex;
+};
+
+std::unordered_map<ID3D12Resource*, ResourceState> GlobalLockStateTracker::ms_GlobalResourceStates;
+std::mutex                                         GlobalLockStateTracker::ms_GlobalMutex;
+
+// Adapts ResourceStateTracker to the interface of GlobalLockStateTracker. Like Resource objects, the tracked
+// states are looked up once.
+class BlockStateTracker
+{
+public:
+    void TransitionResource( TrackedResourceState* trackedState, D3D12_RESOURCE_STATES stateAfter )
+    {
+        m_Tracker.TransitionResource( trackedState, stateAfter );
+    }
+
+    uint32_t ResolvePendingResourceBarriers( std::vector<D3D12_RESOURCE_BARRIER>& resourceBarriers )
+    {
+        return m_Tracker.ResolvePendingResourceBarriers( resourceBarriers );
+    }
+
+    void Reset()
+    {
+        m_Tracker.Reset();
+    }
+
+private:
+    ResourceStateTracker m_Tracker;
+};
+
+// The resources are never dereferenced, they are only used as keys.
+struct alignas( 16 ) FakeResource
+{
+    uint8_t Data[16];
+};
+
+struct Workload
+{
+    // The resources and their tracked states (the same index is the same resource).
+    std::vector<ID3D12Resource*>       Resources;
+    std::vector<TrackedResourceState*> TrackedStates;
+
+    // The indices of the resources that are transitioned by every command list.
+    uint32_t              NumResourcesPerCommandList;
+    std::vector<uint32_t> ResourceIndices;
+};
+
+const D3D12_RESOURCE_STATES States[] = {
+    D3D12_RESOURCE_STATE_RENDER_TARGET,
+    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+    D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+};
+
+// Record and resolve the command lists of one thread. Every resource is transitioned twice in a command list.
+template<typename Tracker, typename GetResource>
+uint64_t RecordCommandLists( const Workload& workload, uint32_t firstCommandList, uint32_t numCommandLists,
+                             GetResource getResource )
+{
+    Tracker                             tracker;
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    uint64_t                            numBarriers = 0;
+
+    for ( uint32_t commandList = firstCommandList; commandList < firstCommandList + numCommandLists; ++commandList )
+    {
+        size_t first = static_cast<size_t>( commandList ) * workload.NumResourcesPerCommandList;
+        for ( uint32_t pass = 0; pass < 2; ++pass )
+        {
+            for ( uint32_t i = 0; i < workload.NumResourcesPerCommandList; ++i )
+            {
+                uint32_t index = workload.ResourceIndices[first + i];
+                tracker.TransitionResource( getResource( index ), States[( index + pass + commandList ) % 4] );
+            }
+        }
+
+        barriers.clear();
+        numBarriers += tracker.ResolvePendingResourceBarriers( barriers );
+        tracker.Reset();
+    }
+
+    return numBarriers;
+}
+
+// Record the command lists on a number of threads. Returns the time in milliseconds.
+template<typename Tracker, typename GetResource>
+double Run( const Workload& workload, uint32_t numCommandLists, uint32_t numThreads, GetResource getResource,
+            uint64_t& numBarriers )
+{
+    std::vector<std::thread> threads;
+    std::vector<uint64_t>    threadBarriers( numThreads, 0 );
+    uint32_t                 numCommandListsPerThread = numCommandLists / numThreads;
+
+    Test::Timer timer;
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        threads.emplace_back( [&, i]() {
+            threadBarriers[i] = RecordCommandLists<Tracker>( workload, i * numCommandListsPerThread,
+                                                             numCommandListsPerThread, getResource );
+        } );
+    }
+    for ( auto& thread: threads )
+    {
+        thread.join();
+    }
+    double time = timer.GetElapsedMilliseconds();
+
+    numBarriers = 0;
+    for ( auto n: threadBarriers )
+    {
+        numBarriers += n;
+    }
+
+    return time;
+}
+
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    bool isQuick = Test::IsQuick( argc, argv );
+
+    const uint32_t NumResources               = 4096;
+    const uint32_t NumResourcesPerCommandList = 64;
+    const uint32_t NumCommandLists            = isQuick ? 256 : 32768;
+
+    static FakeResource fakeResources[2 * NumResources];
+
+    // Both trackers keep global states, so they use different resources.
+    Workload workload;
+    Workload globalLockWorkload;
+    for ( uint32_t i = 0; i < NumResources; ++i )
+    {
+        auto resource = reinterpret_cast<ID3D12Resource*>( &fakeResources[i] );
+        workload.Resources.push_back( resource );
+        workload.TrackedStates.push_back( ResourceStateTracker::GetTrackedResourceState( resource ).get() );
+        globalLockWorkload.Resources.push_back( reinterpret_cast<ID3D12Resource*>( &fakeResources[NumResources + i] ) );
+    }
+
+    // Most command lists use a few frequently used resources (the render targets and shared textures)
+    // and otherwise resources of their own.
+    std::mt19937 random( 1 );
+    workload.NumResourcesPerCommandList = NumResourcesPerCommandList;
+    for ( uint32_t i = 0; i < NumCommandLists * NumResourcesPerCommandList; ++i )
+    {
+        workload.ResourceIndices.push_back( random() % 4 == 0 ? random() % 32 : random() % NumResources );
+    }
+    globalLockWorkload.NumResourcesPerCommandList = NumResourcesPerCommandList;
+    globalLockWorkload.ResourceIndices            = workload.ResourceIndices;
+
+    auto getTrackedState = [&]( uint32_t index ) { return workload.TrackedStates[index]; };
+    auto getResource     = [&]( uint32_t index ) { return globalLockWorkload.Resources[index]; };
+
+    // On a single thread both trackers must add the same barriers.
+    uint64_t numBarriers, numGlobalLockBarriers;
+    Run<BlockStateTracker>( workload, NumCommandLists, 1, getTrackedState, numBarriers );
+    Run<GlobalLockStateTracker>( globalLockWorkload, NumCommandLists, 1, getResource, numGlobalLockBarriers );
+    CHECK( numBarriers == numGlobalLockBarriers );
+    CHECK( numBarriers > 0 );
+
+    uint32_t maxThreads = std::max( 2u, std::min( 16u, std::thread::hardware_concurrency() ) );
+    for ( uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+    {
+        double time = Run<BlockStateTracker>( workload, NumCommandLists, numThreads, getTrackedState, numBarriers );
+        double globalLockTime = Run<GlobalLockStateTracker>( globalLockWorkload, NumCommandLists, numThreads,
+                                                             getResource, numGlobalLockBarriers );
+
+        double numTransitions = 2.0 * NumCommandLists * NumResourcesPerCommandList;
+        std::printf( "%u thread(s), %u command lists: per-resource blocks %.1f ms (%.1f ns/transition), "
+                     "global lock %.1f ms (%.1f ns/transition)\n",
+                     numThreads, NumCommandLists, time, time * 1e6 / numTransitions, globalLockTime,
+                     globalLockTime * 1e6 / numTransitions );
+    }
+
+    return Test::Result();
+}
@@ -0,0 +1,249 @@
+#include "Test.h"
+
+#include <dx12lib/Mesh.h>
+#include <dx12lib/Scene.h>
+#include <dx12lib/SceneBVH.h>
+#include <dx12lib/SceneNode.h>
+#include <dx12lib/Visitor.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace DX12_Library;
+using namespace DirectX;
+
+namespace
+{
+
+// A mesh of a scene node.
+using InstanceKey = std::pair<const SceneNode*, const Mesh*>;
+
+// Collect the scene nodes and the meshes of a scene with their world space AABBs, without the BVH.
+class SceneCollector : public Visitor
+{
+public:
+    void Visit( Scene& ) override {}
+
+    void Visit( SceneNode& sceneNode ) override
+    {
+        m_Node = &sceneNode;
+        Nodes.push_back( sceneNode.shared_from_this() );
+    }
+
+    void Visit( Mesh& mesh ) override
+    {
+        BoundingBox aabb;
+        mesh.GetAABB().Transform( aabb, m_Node->GetWorldTransform() );
+
+        Instances.emplace_back( m_Node, &mesh );
+        AABBs.push_back( aabb );
+    }
+
+    std::vector<std::shared_ptr<SceneNode>> Nodes;
+    std::vector<InstanceKey>                Instances;
+    std::vector<BoundingBox>                AABBs;
+
+private:
+    SceneNode* m_Node = nullptr;
+};
+
+float GetRandom( std::mt19937& random, float min, float max )
+{
+    return std::uniform_real_distribution<float>( min, max )( random );
+}
+
+XMMATRIX CreateLocalTransform( std::mt19937& random )
+{
+    return XMMatrixTranslation( GetRandom( random, -50.0f, 50.0f ), GetRandom( random, -50.0f, 50.0f ),
+                                GetRandom( random, -50.0f, 50.0f ) );
+}
+
+// The BVH must find the same instances as testing the AABB of every mesh.
+template<typename Volume>
+void CheckQuery( const SceneBVH& bvh, const SceneCollector& scene, const Volume& volume )
+{
+    std::vector<uint32_t> instances;
+    bvh.Query( volume, instances );
+
+    std::vector<InstanceKey> foundInstances;
+    for ( auto index: instances )
+    {
+        const auto& instance = bvh.GetInstance( index );
+        foundInstances.emplace_back( instance.Node.lock().get(), instance.Mesh.lock().get() );
+    }
+
+    std::vector<InstanceKey> expectedInstances;
+    for ( size_t i = 0; i < scene.Instances.size(); ++i )
+    {
+        if ( volume.Intersects( scene.AABBs[i] ) )
+        {
+            expectedInstances.push_back( scene.Instances[i] );
+        }
+    }
+
+    std::sort( foundInstances.begin(), foundInstances.end() );
+    std::sort( expectedInstances.begin(), expectedInstances.end() );
+    CHECK( foundInstances == expectedInstances );
+}
+
+void CheckRayCast( const SceneBVH& bvh, const SceneCollector& scene, FXMVECTOR origin, FXMVECTOR direction )
+{
+    uint32_t instance;
+    float    distance;
+    bool     isHit = bvh.RayCast( origin, direction, instance, distance );
+
+    bool  isExpectedHit    = false;
+    float expectedDistance = FLT_MAX;
+    for ( const auto& aabb: scene.AABBs )
+    {
+        float d;
+        if ( aabb.Intersects( origin, direction, d ) && d < expectedDistance )
+        {
+            isExpectedHit    = true;
+            expectedDistance = d;
+        }
+    }
+
+    CHECK( isHit == isExpectedHit );
+    if ( isHit && isExpectedHit )
+    {
+        CHECK( distance == expectedDistance );
+    }
+}
+
+void CheckScene( Scene& scene, std::mt19937& random )
+{
+    SceneCollector collector;
+    scene.Accept( collector );
+
+    const auto& bvh = scene.GetBVH();
+    CHECK( !bvh.IsStale( scene ) );
+    CHECK( bvh.GetNumInstances() == collector.Instances.size() );
+
+    // Every instance refers to a scene node and a mesh of the scene.
+    std::vector<InstanceKey> instances;
+    for ( uint32_t i = 0; i < bvh.GetNumInstances(); ++i )
+    {
+        const auto& instance = bvh.GetInstance( i );
+        instances.emplace_back( instance.Node.lock().get(), instance.Mesh.lock().get() );
+    }
+
+    auto expectedInstances = collector.Instances;
+    std::sort( instances.begin(), instances.end() );
+    std::sort( expectedInstances.begin(), expectedInstances.end() );
+    CHECK( instances == expectedInstances );
+
+    for ( int i = 0; i < 100; ++i )
+    {
+        BoundingBox box( { GetRandom( random, -100.0f, 100.0f ), GetRandom( random, -100.0f, 100.0f ),
+                           GetRandom( random, -100.0f, 100.0f ) },
+                         { GetRandom( random, 1.0f, 30.0f ), GetRandom( random, 1.0f, 30.0f ),
+                           GetRandom( random, 1.0f, 30.0f ) } );
+        CheckQuery( bvh, collector, box );
+
+        BoundingSphere sphere( { GetRandom( random, -100.0f, 100.0f ), GetRandom( random, -100.0f, 100.0f ),
+                                 GetRandom( random, -100.0f, 100.0f ) },
+                               GetRandom( random, 1.0f, 40.0f ) );
+        CheckQuery( bvh, collector, sphere );
+
+        XMVECTOR origin = XMVectorSet( GetRandom( random, -100.0f, 100.0f ), GetRandom( random, -100.0f, 100.0f ),
+                                       GetRandom( random, -100.0f, 100.0f ), 1.0f );
+        XMVECTOR direction = XMVectorSet( GetRandom( random, -1.0f, 1.0f ), GetRandom( random, -1.0f, 1.0f ),
+                                          GetRandom( random, -1.0f, 1.0f ), 0.0f );
+        CheckRayCast( bvh, collector, origin, XMVector3Normalize( direction ) );
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    const uint32_t NumMeshes        = 16;
+    const uint32_t NumNodes         = 2000;
+    const uint32_t NumMovedNodes    = 20;
+    const uint32_t NumFrames        = 4;
+    const uint32_t NumRemovedMeshes = 20;
+
+    std::mt19937 random( 1 );
+
+    // The meshes are shared by the scene nodes, like the meshes of a loaded scene.
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    for ( uint32_t i = 0; i < NumMeshes; ++i )
+    {
+        auto mesh = std::make_shared<Mesh>();
+        mesh->SetAABB( BoundingBox(
+            { GetRandom( random, -1.0f, 1.0f ), GetRandom( random, -1.0f, 1.0f ), GetRandom( random, -1.0f, 1.0f ) },
+            { GetRandom( random, 0.1f, 2.0f ), GetRandom( random, 0.1f, 2.0f ), GetRandom( random, 0.1f, 2.0f ) } ) );
+        meshes.push_back( mesh );
+    }
+
+    auto                                    rootNode = std::make_shared<SceneNode>();
+    std::vector<std::shared_ptr<SceneNode>> nodes    = { rootNode };
+    for ( uint32_t i = 0; i < NumNodes; ++i )
+    {
+        auto node = std::make_shared<SceneNode>( CreateLocalTransform( random ) );
+        for ( uint32_t j = random() % 3; j > 0; --j )
+        {
+            node->AddMesh( meshes[random() % NumMeshes] );
+        }
+
+        nodes[random() % nodes.size()]->AddChild( node );
+        nodes.push_back( node );
+    }
+
+    // Like the scenes of CommandList::CreateScene, the BVH is built when the root node is set.
+    Scene scene;
+    scene.SetRootNode( rootNode );
+    CHECK( !scene.GetBVH().IsEmpty() );
+    CheckScene( scene, random );
+
+    // Moving a few scene nodes refits the instances of the moved nodes.
+    for ( uint32_t frame = 0; frame < NumFrames; ++frame )
+    {
+        for ( uint32_t i = 0; i < NumMovedNodes; ++i )
+        {
+            nodes[1 + random() % NumNodes]->SetLocalTransform( CreateLocalTransform( random ) );
+        }
+
+        scene.UpdateTransforms();
+        CheckScene( scene, random );
+    }
+
+    // Moving the root node refits all instances.
+    rootNode->SetLocalTransform( CreateLocalTransform( random ) );
+    scene.UpdateTransforms();
+    CheckScene( scene, random );
+
+    // Remove a subtree and some meshes. The removed scene nodes are released before the scene is updated,
+    // which rebuilds the BVH.
+    rootNode->RemoveChild( nodes[1 + random() % NumNodes] );
+    for ( uint32_t i = 0; i < NumRemovedMeshes; ++i )
+    {
+        auto& node = nodes[1 + random() % NumNodes];
+        node->RemoveMesh( node->GetMesh() );
+    }
+
+    nodes.clear();
+    CHECK( scene.GetBVH().IsStale( scene ) );
+
+    scene.UpdateTransforms();
+    CheckScene( scene, random );
+
+    // The scene nodes that are still part of the scene can be moved again.
+    SceneCollector collector;
+    scene.Accept( collector );
+    for ( uint32_t i = 0; i < NumMovedNodes; ++i )
+    {
+        collector.Nodes[random() % collector.Nodes.size()]->SetLocalTransform( CreateLocalTransform( random ) );
+    }
+
+    scene.UpdateTransforms();
+    CheckScene( scene, random );
+
+    return Test::Result();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+/*
+ * A minimal test harness for the tests and benchmarks of DX12Lib.
+ *
+ * A failed CHECK prints the condition but doesn't stop the test, main returns Test::Result().
+ * Benchmarks are also run by ctest with --quick, which only checks that they work with small sizes.
+ */
+namespace Test
+{
+
+inline int& NumFailures()
+{
+    static int numFailures = 0;
+    return numFailures;
+}
+
+inline int Result()
+{
+    if ( NumFailures() > 0 )
+    {
+        std::printf( "%d check(s) failed\n", NumFailures() );
+        return 1;
+    }
+
+    std::printf( "All checks passed\n" );
+    return 0;
+}
+
+inline bool IsQuick( int argc, char** argv )
+{
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( std::strcmp( argv[i], "--quick" ) == 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+class Timer
+{
+public:
+    Timer()
+    : m_Start( std::chrono::steady_clock::now() )
+    {}
+
+    double GetElapsedMilliseconds() const
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_Start ).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_Start;
+};
+
+}  // namespace Test
+
+#define CHECK( condition )                                                                 \
+    do                                                                                     \
+    {                                                                                      \
+        if ( !( condition ) )                                                              \
+        {                                                                                  \
+            ++Test::NumFailures();                                                         \
+            std::printf( "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #condition );   \
+        }                                                                                  \
+    } while ( false )
@@ -0,0 +1,288 @@
+#include "Test.h"
+
+#include <dx12lib/TransformHierarchy.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DX12_Library;
+using namespace DirectX;
+
+namespace
+{
+
+const uint32_t NoParent = UINT32_MAX;
+const uint32_t MaxDepth = 24;
+
+// The transforms of a large scene. The parents and local transforms of the nodes are kept to compute the
+// expected world transforms.
+struct Tree
+{
+    TransformHierarchy                      Transforms;
+    std::vector<TransformHierarchy::Handle> Handles;
+    std::vector<uint32_t>                   Parents;
+    std::vector<XMMATRIX>                   LocalTransforms;
+    // The node was removed from the hierarchy.
+    std::vector<uint8_t> IsRemoved;
+};
+
+// Small rotations and translations, so that the world transforms of deep nodes stay in a sensible range.
+XMMATRIX CreateLocalTransform( std::mt19937& random )
+{
+    float angle = static_cast<float>( random() % 64 ) * 0.01f;
+    float x     = static_cast<float>( random() % 16 ) * 0.1f;
+    float y     = static_cast<float>( random() % 16 ) * 0.1f;
+
+    return XMMatrixRotationZ( angle ) * XMMatrixTranslation( x, y, 0.5f );
+}
+
+// Add the nodes in depth-first order, like a loaded scene. The depth of the nodes is a random walk, so
+// that the subtrees have very different sizes.
+void CreateTree( Tree& tree, uint32_t numNodes, std::mt19937& random )
+{
+    const BoundingBox Bounds( { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.5f } );
+
+    std::vector<uint32_t> path;
+    for ( uint32_t i = 0; i < numNodes; ++i )
+    {
+        while ( path.size() > MaxDepth || ( path.size() > 1 && random() % 2 == 0 ) )
+        {
+            path.pop_back();
+        }
+
+        uint32_t parent         = path.empty() ? NoParent : path.back();
+        XMMATRIX localTransform = CreateLocalTransform( random );
+
+        auto handle = tree.Transforms.Add( localTransform, parent != NoParent ? tree.Handles[parent]
+                                                                              : TransformHierarchy::InvalidHandle );
+        tree.Transforms.SetBounds( handle, Bounds );
+
+        tree.Handles.push_back( handle );
+        tree.Parents.push_back( parent );
+        tree.LocalTransforms.push_back( localTransform );
+        tree.IsRemoved.push_back( 0 );
+        path.push_back( i );
+    }
+}
+
+// Compute the world transforms from the local transforms. Parents are not always stored before their children
+// after nodes were reparented, so the parents are walked.
+std::vector<XMMATRIX> ComputeWorldTransforms( const Tree& tree )
+{
+    std::vector<XMMATRIX> worldTransforms( tree.Parents.size() );
+    for ( size_t i = 0; i < tree.Parents.size(); ++i )
+    {
+        XMMATRIX worldTransform = tree.LocalTransforms[i];
+        for ( auto parent = tree.Parents[i]; parent != NoParent; parent = tree.Parents[parent] )
+        {
+            worldTransform = worldTransform * tree.LocalTransforms[parent];
+        }
+        worldTransforms[i] = worldTransform;
+    }
+
+    return worldTransforms;
+}
+
+float GetMaxDifference( const XMMATRIX& a, const XMMATRIX& b )
+{
+    float difference = 0.0f;
+    for ( int row = 0; row < 4; ++row )
+    {
+        for ( int column = 0; column < 4; ++column )
+        {
+            difference = std::max( difference, std::fabs( XMVectorGetByIndex( a.r[row], column ) -
+                                                          XMVectorGetByIndex( b.r[row], column ) ) );
+        }
+    }
+
+    return difference;
+}
+
+// Check the world transforms of all nodes and the world bounds of the first root.
+void CheckTree( const Tree& tree )
+{
+    const float Tolerance = 1e-3f;
+
+    auto worldTransforms = ComputeWorldTransforms( tree );
+
+    float maxDifference = 0.0f;
+    for ( size_t i = 0; i < tree.Handles.size(); ++i )
+    {
+        if ( !tree.IsRemoved[i] )
+        {
+            XMMATRIX worldTransform = tree.Transforms.GetWorldTransform( tree.Handles[i] );
+            maxDifference           = std::max( maxDifference, GetMaxDifference( worldTransform, worldTransforms[i] ) );
+        }
+    }
+    CHECK( maxDifference < Tolerance );
+
+    // The bounds of the first root contain the bounds of all nodes of its tree.
+    const BoundingBox Bounds( { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.5f } );
+
+    BoundingBox expectedBounds;
+    bool        hasBounds = false;
+    for ( size_t i = 0; i < tree.Handles.size(); ++i )
+    {
+        auto root = static_cast<uint32_t>( i );
+        while ( tree.Parents[root] != NoParent )
+        {
+            root = tree.Parents[root];
+        }
+        if ( root != 0 || tree.IsRemoved[i] )
+        {
+            continue;
+        }
+
+        BoundingBox bounds;
+        Bounds.Transform( bounds, worldTransforms[i] );
+        if ( hasBounds )
+        {
+            BoundingBox::CreateMerged( expectedBounds, expectedBounds, bounds );
+        }
+        else
+        {
+            expectedBounds = bounds;
+            hasBounds      = true;
+        }
+    }
+
+    BoundingBox bounds;
+    CHECK( tree.Transforms.GetWorldBounds( tree.Handles[0], bounds ) );
+    CHECK( std::fabs( bounds.Center.x - expectedBounds.Center.x ) < Tolerance );
+    CHECK( std::fabs( bounds.Center.y - expectedBounds.Center.y ) < Tolerance );
+    CHECK( std::fabs( bounds.Center.z - expectedBounds.Center.z ) < Tolerance );
+    CHECK( std::fabs( bounds.Extents.x - expectedBounds.Extents.x ) < Tolerance );
+    CHECK( std::fabs( bounds.Extents.y - expectedBounds.Extents.y ) < Tolerance );
+    CHECK( std::fabs( bounds.Extents.z - expectedBounds.Extents.z ) < Tolerance );
+}
+
+// Move random nodes, e.g. the animated objects of a frame.
+void MoveNodes( Tree& tree, uint32_t numMovedNodes, std::mt19937& random )
+{
+    for ( uint32_t i = 0; i < numMovedNodes; ++i )
+    {
+        auto node = static_cast<uint32_t>( random() % tree.Handles.size() );
+        if ( tree.IsRemoved[node] )
+        {
+            continue;
+        }
+
+        tree.LocalTransforms[node] = CreateLocalTransform( random );
+        tree.Transforms.SetLocalTransform( tree.Handles[node], tree.LocalTransforms[node] );
+    }
+}
+
+// Remove and reparent random nodes, which sorts the hierarchy by the next update.
+void ChangeTree( Tree& tree, uint32_t numChanges, std::mt19937& random )
+{
+    auto numNodes = static_cast<uint32_t>( tree.Handles.size() );
+
+    for ( uint32_t i = 0; i < numChanges; ++i )
+    {
+        // The first root is kept for the bounds check.
+        uint32_t node = 1 + random() % ( numNodes - 1 );
+        if ( tree.IsRemoved[node] )
+        {
+            continue;
+        }
+
+        if ( random() % 2 == 0 )
+        {
+            // The children of a removed node become root nodes.
+            tree.Transforms.Remove( tree.Handles[node] );
+            tree.IsRemoved[node] = 1;
+            for ( auto& parent: tree.Parents )
+            {
+                if ( parent == node )
+                {
+                    parent = NoParent;
+                }
+            }
+            continue;
+        }
+
+        uint32_t parent = random() % numNodes;
+
+        // The new parent must not be removed or part of the subtree of the node.
+        bool isValid = !tree.IsRemoved[parent];
+        for ( auto p = parent; p != NoParent && isValid; p = tree.Parents[p] )
+        {
+            isValid = p != node;
+        }
+        if ( isValid )
+        {
+            tree.Transforms.SetParent( tree.Handles[node], tree.Handles[parent] );
+            tree.Parents[node] = parent;
+        }
+    }
+}
+
+}  // namespace
+
+int main( int argc, char** argv )
+{
+    bool isQuick = Test::IsQuick( argc, argv );
+
+    const uint32_t NumNodes      = isQuick ? 10000 : 1000000;
+    const uint32_t NumMovedNodes = isQuick ? 10 : 1000;
+    const uint32_t NumFrames     = isQuick ? 2 : 20;
+
+    std::mt19937 random( 1 );
+
+    Tree tree;
+    CreateTree( tree, NumNodes, random );
+
+    Test::Timer fullUpdateTimer;
+    tree.Transforms.Update();
+    double fullUpdateTime = fullUpdateTimer.GetElapsedMilliseconds();
+
+    CheckTree( tree );
+
+    // Only the subtrees of the moved nodes are updated. The world transforms of the other nodes are read
+    // from the cache while some nodes are dirty.
+    double   readTime   = 0.0;
+    double   updateTime = 0.0;
+    uint64_t checksum   = 0;
+    for ( uint32_t frame = 0; frame < NumFrames; ++frame )
+    {
+        MoveNodes( tree, NumMovedNodes, random );
+
+        Test::Timer readTimer;
+        for ( auto handle: tree.Handles )
+        {
+            checksum += XMVectorGetByIndex( tree.Transforms.GetWorldTransform( handle ).r[3], 0 ) > 0.0f;
+        }
+        readTime += readTimer.GetElapsedMilliseconds();
+
+        Test::Timer updateTimer;
+        tree.Transforms.Update();
+        updateTime += updateTimer.GetElapsedMilliseconds();
+    }
+
+    CheckTree( tree );
+
+    ChangeTree( tree, NumMovedNodes, random );
+
+    Test::Timer sortTimer;
+    tree.Transforms.Update();
+    double sortTime = sortTimer.GetElapsedMilliseconds();
+
+    CheckTree( tree );
+
+    MoveNodes( tree, NumMovedNodes, random );
+    tree.Transforms.Update();
+
+    CheckTree( tree );
+
+    std::printf( "%u nodes: full update %.2f ms, %u moved nodes: update %.3f ms/frame, read all world transforms "
+                 "%.2f ms/frame (%.1f ns/read), sort and update %.2f ms (checksum %llu)\n",
+                 NumNodes, fullUpdateTime, NumMovedNodes, updateTime / NumFrames, readTime / NumFrames,
+                 readTime * 1e6 / ( static_cast<double>( NumNodes ) * NumFrames ), sortTime,
+                 static_cast<unsigned long long>( checksum ) );
+
+    return Test::Result();
+}
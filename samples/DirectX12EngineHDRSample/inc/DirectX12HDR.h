@@ -25,6 +25,7 @@ class Scene;
 class ShaderResourceView;
 class SwapChain;
 class Texture;
+class TransientTextureAllocator;
 }  // namespace DX12_Library
 
 class Window;  // From GameFramework.
@@ -115,9 +116,13 @@ private:
     std::shared_ptr<DX12_Library::Texture> m_EviningSunCubemap;
     std::shared_ptr<DX12_Library::ShaderResourceView> m_EviningSunCubemapSRV;
 
-    // HDR Render target
+    // HDR Render target. The textures are acquired from the transient texture allocator every frame.
     DX12_Library::RenderTarget m_HDRRenderTarget;
-    std::shared_ptr<DX12_Library::Texture> m_HDRTexture;
+    std::shared_ptr<DX12_Library::TransientTextureAllocator> m_TransientTextureAllocator;
+    D3D12_RESOURCE_DESC m_HDRTextureDesc;
+    D3D12_CLEAR_VALUE   m_HDRClearValue;
+    D3D12_RESOURCE_DESC m_DepthTextureDesc;
+    D3D12_CLEAR_VALUE   m_DepthClearValue;
 
     // Root signatures
     std::shared_ptr<DX12_Library::RootSignature> m_SkyboxSignature;
@@ -15,6 +15,7 @@
 #include <dx12lib/Scene.h>
 #include <dx12lib/SwapChain.h>
 #include <dx12lib/Texture.h>
+#include <dx12lib/TransientTextureAllocator.h>
 
 #include <GameFramework/Window.h>
 
@@ -251,34 +252,31 @@ bool DirectX12HDR::LoadContent()
     DXGI_FORMAT HDRFormat         = DXGI_FORMAT_R16G16B16A16_FLOAT;
     DXGI_FORMAT depthBufferFormat = DXGI_FORMAT_D32_FLOAT;
 
-    // Create an off-screen render target with a single color buffer and a depth buffer.
-    auto colorDesc  = CD3DX12_RESOURCE_DESC::Tex2D( HDRFormat, m_Width, m_Height );
-    colorDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+    // The HDR render target only lives during the frame so its textures are placed
+    // in the transient texture heaps. Rescaling the render target reuses the same memory.
+    m_TransientTextureAllocator = m_Device->CreateTransientTextureAllocator();
 
-    D3D12_CLEAR_VALUE colorClearValue;
-    colorClearValue.Format   = colorDesc.Format;
-    colorClearValue.Color[0] = 0.4f;
-    colorClearValue.Color[1] = 0.6f;
-    colorClearValue.Color[2] = 0.9f;
-    colorClearValue.Color[3] = 1.0f;
+    // Describe an off-screen render target with a single color buffer and a depth buffer.
+    m_HDRTextureDesc       = CD3DX12_RESOURCE_DESC::Tex2D( HDRFormat, m_Width, m_Height );
+    m_HDRTextureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-    m_HDRTexture = m_Device->CreateTexture( colorDesc, &colorClearValue );
-    m_HDRTexture->SetName( L"HDR Texture" );
+    m_HDRClearValue.Format   = m_HDRTextureDesc.Format;
+    m_HDRClearValue.Color[0] = 0.4f;
+    m_HDRClearValue.Color[1] = 0.6f;
+    m_HDRClearValue.Color[2] = 0.9f;
+    m_HDRClearValue.Color[3] = 1.0f;
 
-    // Create a depth buffer for the HDR render target.
-    auto depthDesc  = CD3DX12_RESOURCE_DESC::Tex2D( depthBufferFormat, m_Width, m_Height );
-    depthDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+    // Describe a depth buffer for the HDR render target.
+    m_DepthTextureDesc       = CD3DX12_RESOURCE_DESC::Tex2D( depthBufferFormat, m_Width, m_Height );
+    m_DepthTextureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
-    D3D12_CLEAR_VALUE depthClearValue;
-    depthClearValue.Format       = depthDesc.Format;
-    depthClearValue.DepthStencil = { 1.0f, 0 };
+    m_DepthClearValue.Format       = m_DepthTextureDesc.Format;
+    m_DepthClearValue.DepthStencil = { 1.0f, 0 };
 
-    auto depthTexture = m_Device->CreateTexture( depthDesc, &depthClearValue );
-    depthTexture->SetName( L"Depth Render Target" );
-
-    // Attach the HDR texture to the HDR render target.
-    m_HDRRenderTarget.AttachTexture( AttachmentPoint::Color0, m_HDRTexture );
-    m_HDRRenderTarget.AttachTexture( AttachmentPoint::DepthStencil, depthTexture );
+    // The formats of the HDR render target.
+    D3D12_RT_FORMAT_ARRAY hdrRenderTargetFormats = {};
+    hdrRenderTargetFormats.NumRenderTargets      = 1;
+    hdrRenderTargetFormats.RTFormats[0]          = HDRFormat;
 
     // Create a root signature and PSO for the skybox shaders.
     {
@@ -331,7 +329,7 @@ bool DirectX12HDR::LoadContent()
         skyboxPipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
         skyboxPipelineStateStream.VS                    = CD3DX12_SHADER_BYTECODE( vs.Get() );
         skyboxPipelineStateStream.PS                    = CD3DX12_SHADER_BYTECODE( ps.Get() );
-        skyboxPipelineStateStream.RTVFormats            = m_HDRRenderTarget.GetRenderTargetFormats();
+        skyboxPipelineStateStream.RTVFormats            = hdrRenderTargetFormats;
 
         m_SkyboxPipelineState = m_Device->CreatePipelineStateObject( skyboxPipelineStateStream );
     }
@@ -392,8 +390,8 @@ bool DirectX12HDR::LoadContent()
         hdrPipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
         hdrPipelineStateStream.VS                    = CD3DX12_SHADER_BYTECODE( vs.Get() );
         hdrPipelineStateStream.PS                    = CD3DX12_SHADER_BYTECODE( ps.Get() );
-        hdrPipelineStateStream.DSVFormat             = m_HDRRenderTarget.GetDepthStencilFormat();
-        hdrPipelineStateStream.RTVFormats            = m_HDRRenderTarget.GetRenderTargetFormats();
+        hdrPipelineStateStream.DSVFormat             = depthBufferFormat;
+        hdrPipelineStateStream.RTVFormats            = hdrRenderTargetFormats;
 
         m_HDRPipelineState = m_Device->CreatePipelineStateObject( hdrPipelineStateStream );
 
@@ -466,7 +464,11 @@ void DirectX12HDR::RescaleHDRRenderTarget( float scale )
     width  = std::clamp<uint32_t>( width, 1, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION );
     height = std::clamp<uint32_t>( height, 1, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION );
 
-    m_HDRRenderTarget.Resize( width, height );
+    // The textures are acquired with the new size in the next frame.
+    m_HDRTextureDesc.Width    = width;
+    m_HDRTextureDesc.Height   = height;
+    m_DepthTextureDesc.Width  = width;
+    m_DepthTextureDesc.Height = height;
 }
 
 void DirectX12HDR::OnResize( ResizeEventArgs& e )
@@ -513,6 +515,7 @@ void DirectX12HDR::UnloadContent()
     m_UnlitPipelineState.reset();
 
     m_HDRRenderTarget.Reset();
+    m_TransientTextureAllocator.reset();
 
     m_GUI.reset();
     m_SwapChain.reset();
@@ -748,9 +751,9 @@ void DirectX12HDR::OnGUI( const std::shared_ptr<DX12_Library::CommandList>& comm
             renderScale = std::clamp( renderScale, 0.0f, 2.0f );
 
             // Output current resolution of render target.
-            auto size = m_HDRRenderTarget.GetSize();
             ImGui::SameLine();
-            sprintf_s( buffer, _countof( buffer ), "(%ux%u)", size.x, size.y );
+            sprintf_s( buffer, _countof( buffer ), "(%ux%u)", static_cast<uint32_t>( m_HDRTextureDesc.Width ),
+                       m_HDRTextureDesc.Height );
             ImGui::Text( buffer );
 
             // Resize HDR render target if the scale changed.
@@ -860,6 +863,17 @@ void DirectX12HDR::OnRender()
     // Create a scene visitor that is used to perform the actual rendering of the meshes in the scenes.
     SceneVisitor visitor( *commandList );
 
+    // Acquire the textures of the HDR render target for this frame.
+    m_TransientTextureAllocator->BeginFrame();
+
+    auto hdrTexture = m_TransientTextureAllocator->AcquireTexture( *commandList, m_HDRTextureDesc, &m_HDRClearValue,
+                                                                   L"HDR Texture" );
+    auto depthTexture = m_TransientTextureAllocator->AcquireTexture( *commandList, m_DepthTextureDesc,
+                                                                     &m_DepthClearValue, L"Depth Render Target" );
+
+    m_HDRRenderTarget.AttachTexture( AttachmentPoint::Color0, hdrTexture );
+    m_HDRRenderTarget.AttachTexture( AttachmentPoint::DepthStencil, depthTexture );
+
     // Clear the render targets.
     {
         FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
@@ -1080,6 +1094,9 @@ void DirectX12HDR::OnRender()
         m_Cone->Accept( visitor );
     }
 
+    // The depth buffer is not needed for tonemapping.
+    m_TransientTextureAllocator->ReleaseTexture( depthTexture );
+
     // Perform HDR -> SDR tonemapping directly to the SwapChain's render target.
     commandList->SetRenderTarget( m_SwapChain->GetRenderTarget() );
     commandList->SetViewport( m_SwapChain->GetRenderTarget().GetViewport() );
@@ -1087,10 +1104,12 @@ void DirectX12HDR::OnRender()
     commandList->SetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
     commandList->SetGraphicsRootSignature( m_SDRRootSignature );
     commandList->SetGraphics32BitConstants( 0, g_TonemapParameters );
-    commandList->SetShaderResourceView( 1, 0, m_HDRTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
+    commandList->SetShaderResourceView( 1, 0, hdrTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
 
     commandList->Draw( 3 );
 
+    m_TransientTextureAllocator->ReleaseTexture( hdrTexture );
+
     // Render GUI.
     OnGUI( commandList, m_SwapChain->GetRenderTarget() );
 
@@ -18,12 +18,16 @@ namespace DX12_Library
 class ShaderResourceView;
 class CommandList;
 class Device;
+class GpuProfiler;
 class GUI;
+class ParallelCommandRecorder;
 class PipelineStateObject;
+class RenderGraph;
 class RenderTarget;
 class RootSignature;
 class Scene;
 class SwapChain;
+class TransientTextureAllocator;
 }  // namespace DX12_Library
 
 class EffectPSO;
@@ -126,6 +130,12 @@ protected:
      */
     void OnGUI( const std::shared_ptr<DX12_Library::CommandList>& commandList, const DX12_Library::RenderTarget& renderTarget );
 
+    // Render the axis and the lights.
+    void RenderScene( DX12_Library::CommandList& commandList );
+
+    // Render a chunk of the nodes of the assets.
+    void RenderSceneChunk( DX12_Library::CommandList& commandList, uint32_t chunk, uint32_t numChunks );
+
 private:
     /**
      * Load all of the assets (scene file, shaders, etc...).
@@ -198,12 +208,27 @@ private:
     
     std::vector<std::shared_ptr<DX12_Library::Scene>> m_AssetsList;
     // Pipeline state object for rendering the scene.
-    std::shared_ptr<EffectPSO> m_LightingPSO;
-    std::shared_ptr<EffectPSO> m_DecalPSO;
-    std::shared_ptr<EffectPSO> m_UnlitPSO;
+    // The effects keep the state of the command list they are applied to, so every chunk
+    // of the scene that is recorded in parallel has its own lighting and decal effects.
+    std::vector<std::shared_ptr<EffectPSO>> m_LightingPSOs;
+    std::vector<std::shared_ptr<EffectPSO>> m_DecalPSOs;
+    std::shared_ptr<EffectPSO>              m_UnlitPSO;
+
+    // Records the chunks of the scene on multiple threads.
+    std::shared_ptr<DX12_Library::ParallelCommandRecorder> m_ParallelCommandRecorder;
+    uint32_t                                               m_NumSceneChunks;
 
-    // Render target
+    // Render target. The textures are acquired from the transient texture allocator every frame.
     DX12_Library::RenderTarget m_RenderTarget;
+    std::shared_ptr<DX12_Library::TransientTextureAllocator> m_TransientTextureAllocator;
+    // The passes of a frame. The graph is built again every frame.
+    std::shared_ptr<DX12_Library::RenderGraph> m_RenderGraph;
+    // Measures the GPU time of the passes of the render graph.
+    std::shared_ptr<DX12_Library::GpuProfiler> m_GpuProfiler;
+    D3D12_RESOURCE_DESC m_ColorTextureDesc;
+    D3D12_CLEAR_VALUE   m_ColorClearValue;
+    D3D12_RESOURCE_DESC m_DepthTextureDesc;
+    D3D12_CLEAR_VALUE   m_DepthClearValue;
 
     std::shared_ptr<Window> m_Window;
 
@@ -236,6 +261,7 @@ private:
     bool              m_CancelLoading;
     bool              m_ShowControls;
     bool              m_ShowInspector;
+    bool              m_ShowGpuTimings;
     bool              m_Selected=false;
     std::atomic_bool  m_IsLoading;
     std::future<bool> m_LoadingTask;
@@ -39,6 +39,19 @@ public:
         DirectX::XMMATRIX ModelViewProjectionMatrix;
     };
 
+    // Indices of the material's textures in the bindless descriptor heap.
+    struct TextureIndices
+    {
+        uint32_t Ambient;
+        uint32_t Emissive;
+        uint32_t Diffuse;
+        uint32_t Specular;
+        uint32_t SpecularPower;
+        uint32_t Normal;
+        uint32_t Bump;
+        uint32_t Opacity;
+    };
+
     // An enum for root signature parameters.
     // I'm not using scoped enums to avoid the explicit cast that would be required
     // to use these as root indices in the root signature.
@@ -63,6 +76,10 @@ public:
                    // Texture2D NormalTexture : register( t8 );
                    // Texture2D BumpTexture : register( t9 );
                    // Texture2D OpacityTexture : register( t10 );
+                   // or (bindless)
+                   // Texture2D BindlessTextures[] : register( t0, space2 );
+
+        TextureIndicesCB,  // ConstantBuffer<TextureIndices> TextureIndicesCB : register( b2 ); (bindless only)
         NumRootParameters
     };
 
@@ -166,6 +183,10 @@ private:
     inline void BindTexture( DX12_Library::CommandList& commandList, uint32_t offset,
                              const std::shared_ptr<DX12_Library::Texture>& texture );
 
+    // Helper function to get the bindless index of a texture (or the default SRV).
+    inline uint32_t GetBindlessIndex( DX12_Library::CommandList&                    commandList,
+                                      const std::shared_ptr<DX12_Library::Texture>& texture );
+
     std::shared_ptr<DX12_Library::Device>              m_Device;
     std::shared_ptr<DX12_Library::RootSignature>       m_RootSignature;
     std::shared_ptr<DX12_Library::PipelineStateObject> m_PipelineStateObject;
@@ -190,4 +211,6 @@ private:
 
     bool m_EnableLighting;
     bool m_EnableDecal;
+    // Textures are fetched by index from the bindless descriptor heap (if the device supports it).
+    bool m_EnableBindless;
 };
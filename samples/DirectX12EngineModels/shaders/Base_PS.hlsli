@@ -116,6 +116,34 @@ StructuredBuffer<DirectionalLight> DirectionalLights : register( t2 );
 
 ConstantBuffer<Material> MaterialCB : register( b0, space1 );
 
+#if ENABLE_BINDLESS
+// Indices of the material's textures in the bindless descriptor heap.
+struct TextureIndices
+{
+    uint Ambient;
+    uint Emissive;
+    uint Diffuse;
+    uint Specular;
+    uint SpecularPower;
+    uint Normal;
+    uint Bump;
+    uint Opacity;
+};
+
+ConstantBuffer<TextureIndices> TextureIndicesCB : register( b2 );
+
+// The bindless descriptor heap.
+Texture2D BindlessTextures[] : register( t0, space2 );
+
+#define AmbientTexture       BindlessTextures[TextureIndicesCB.Ambient]
+#define EmissiveTexture      BindlessTextures[TextureIndicesCB.Emissive]
+#define DiffuseTexture       BindlessTextures[TextureIndicesCB.Diffuse]
+#define SpecularTexture      BindlessTextures[TextureIndicesCB.Specular]
+#define SpecularPowerTexture BindlessTextures[TextureIndicesCB.SpecularPower]
+#define NormalTexture        BindlessTextures[TextureIndicesCB.Normal]
+#define BumpTexture          BindlessTextures[TextureIndicesCB.Bump]
+#define OpacityTexture       BindlessTextures[TextureIndicesCB.Opacity]
+#else
 // Textures
 Texture2D AmbientTexture       : register( t3 );
 Texture2D EmissiveTexture      : register( t4 );
@@ -125,6 +153,7 @@ Texture2D SpecularPowerTexture : register( t7 );
 Texture2D NormalTexture        : register( t8 );
 Texture2D BumpTexture          : register( t9 );
 Texture2D OpacityTexture       : register( t10 );
+#endif // ENABLE_BINDLESS
 
 SamplerState TextureSampler    : register(s0);
 
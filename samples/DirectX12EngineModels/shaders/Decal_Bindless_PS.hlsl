@@ -0,0 +1,5 @@
+#define ENABLE_LIGHTING 1
+#define ENABLE_DECAL    1
+#define ENABLE_BINDLESS 1
+
+#include "Base_PS.hlsli"
\ No newline at end of file
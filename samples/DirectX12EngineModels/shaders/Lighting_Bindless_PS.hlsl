@@ -0,0 +1,4 @@
+#define ENABLE_LIGHTING 1
+#define ENABLE_BINDLESS 1
+
+#include "Base_PS.hlsli"
\ No newline at end of file
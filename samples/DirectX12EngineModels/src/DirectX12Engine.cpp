@@ -9,14 +9,19 @@
 #include <dx12lib/CommandQueue.h>
 #include <dx12lib/Device.h>
 #include <dx12lib/GUI.h>
+#include <dx12lib/GpuProfiler.h>
 #include <dx12lib/Helpers.h>
 #include <dx12lib/Material.h>
 #include <dx12lib/Mesh.h>
+#include <dx12lib/MipGenerator.h>
+#include <dx12lib/ParallelCommandRecorder.h>
+#include <dx12lib/RenderGraph.h>
 #include <dx12lib/RootSignature.h>
 #include <dx12lib/Scene.h>
 #include <dx12lib/SceneNode.h>
 #include <dx12lib/SwapChain.h>
 #include <dx12lib/Texture.h>
+#include <dx12lib/TransientTextureAllocator.h>
 
 #include <assimp/DefaultLogger.hpp>
 
@@ -87,7 +92,8 @@ using WarnLogStream  = LogStream<spdlog::level::warn>;
 using ErrorLogStream = LogStream<spdlog::level::err>;
 
 DirectX12Engine::DirectX12Engine( const std::wstring& name, int width, int height, bool vSync )
-: m_ScissorRect { 0, 0, LONG_MAX, LONG_MAX }
+: m_NumSceneChunks( 0 )
+, m_ScissorRect { 0, 0, LONG_MAX, LONG_MAX }
 , m_Viewport( CD3DX12_VIEWPORT( 0.0f, 0.0f, static_cast<float>( width ), static_cast<float>( height ) ) )
 , m_CameraController( m_Camera )
 , m_AnimateLights( false )
@@ -97,6 +103,7 @@ DirectX12Engine::DirectX12Engine( const std::wstring& name, int width, int heigh
 , m_CancelLoading( false )
 , m_ShowControls( true )
 , m_ShowInspector( true )
+, m_ShowGpuTimings( false )
 , m_Width( width )
 , m_Height( height )
 , m_IsLoading( true )
@@ -212,6 +219,10 @@ bool DirectX12Engine::LoadScene( const std::wstring& sceneFile )
 
     commandQueue.ExecuteCommandList( commandList );
 
+    // Start generating the mips of the loaded textures on the compute queue. The mips are generated while
+    // the scene is rendered and the first frame that uses the textures waits for them on the GPU.
+    m_Device->GetMipGenerator().Flush();
+
     // Ensure that the scene is completely loaded before rendering.
     commandQueue.Flush();
 
@@ -223,7 +234,9 @@ bool DirectX12Engine::LoadScene( const std::wstring& sceneFile )
 
 void DirectX12Engine::LoadContent()
 {
-    m_Device = Device::Create();
+    // Fetch textures by index from the bindless descriptor heap instead of
+    // copying the descriptors of every material before each draw.
+    m_Device = Device::Create( nullptr, true );
     m_Logger->info( L"Device created: {}", m_Device->GetDescription() );
 
     m_SwapChain = m_Device->CreateSwapChain( m_Window->GetWindowHandle(), DXGI_FORMAT_R8G8B8A8_UNORM );
@@ -292,12 +305,19 @@ void DirectX12Engine::LoadContent()
     m_Rock->GetRootNode()->SetLocalTransform( XMMatrixScaling( 0.46f,0.65,0.46 ) * XMMatrixTranslation( -22.0f,19.0f,-10.0f ) );
     
 
-    auto fence = commandQueue.ExecuteCommandList( commandList );
+    auto syncPoint = commandQueue.ExecuteCommandList( commandList );
 
     // Create a PSOs
-    m_LightingPSO = std::make_shared<EffectPSO>( m_Device, true, false );
-    m_DecalPSO    = std::make_shared<EffectPSO>( m_Device, true, true );
-    m_UnlitPSO    = std::make_shared<EffectPSO>( m_Device, false, false );
+    m_ParallelCommandRecorder = m_Device->CreateParallelCommandRecorder();
+    // The thread that records the scene pass records a chunk as well.
+    m_NumSceneChunks = m_ParallelCommandRecorder->GetNumThreads() + 1;
+
+    for ( uint32_t i = 0; i < m_NumSceneChunks; ++i )
+    {
+        m_LightingPSOs.push_back( std::make_shared<EffectPSO>( m_Device, true, false ) );
+        m_DecalPSOs.push_back( std::make_shared<EffectPSO>( m_Device, true, true ) );
+    }
+    m_UnlitPSO = std::make_shared<EffectPSO>( m_Device, false, false );
 
     // Create a color buffer with sRGB for gamma correction.
     DXGI_FORMAT backBufferFormat  = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
@@ -306,35 +326,31 @@ void DirectX12Engine::LoadContent()
     // Check the best multisample quality level that can be used for the given back buffer format.
     DXGI_SAMPLE_DESC sampleDesc = m_Device->GetMultisampleQualityLevels( backBufferFormat );
 
-    // Create an off-screen render target with a single color buffer and a depth buffer.
-    auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D( backBufferFormat, m_Width, m_Height, 1, 1, sampleDesc.Count,
-                                                   sampleDesc.Quality, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET );
-    D3D12_CLEAR_VALUE colorClearValue;
-    colorClearValue.Format   = colorDesc.Format;
-    colorClearValue.Color[0] = 0.4f;
-    colorClearValue.Color[1] = 0.6f;
-    colorClearValue.Color[2] = 0.9f;
-    colorClearValue.Color[3] = 1.0f;
-
-    auto colorTexture = m_Device->CreateTexture( colorDesc, &colorClearValue );
-    colorTexture->SetName( L"Color Render Target" );
-
-    // Create a depth buffer.
-    auto depthDesc = CD3DX12_RESOURCE_DESC::Tex2D( depthBufferFormat, m_Width, m_Height, 1, 1, sampleDesc.Count,
-                                                   sampleDesc.Quality, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL );
-    D3D12_CLEAR_VALUE depthClearValue;
-    depthClearValue.Format       = depthDesc.Format;
-    depthClearValue.DepthStencil = { 1.0f, 0 };
-
-    auto depthTexture = m_Device->CreateTexture( depthDesc, &depthClearValue );
-    depthTexture->SetName( L"Depth Render Target" );
-
-    // Attach the textures to the render target.
-    m_RenderTarget.AttachTexture( AttachmentPoint::Color0, colorTexture );
-    m_RenderTarget.AttachTexture( AttachmentPoint::DepthStencil, depthTexture );
+    // The MSAA render target only lives during the frame so its textures are placed
+    // in the transient texture heaps.
+    m_TransientTextureAllocator = m_Device->CreateTransientTextureAllocator();
+    m_RenderGraph               = m_Device->CreateRenderGraph( *m_TransientTextureAllocator );
+
+    m_GpuProfiler = m_Device->CreateGpuProfiler();
+    m_RenderGraph->SetProfiler( m_GpuProfiler.get() );
+
+    // Describe an off-screen render target with a single color buffer and a depth buffer.
+    m_ColorTextureDesc = CD3DX12_RESOURCE_DESC::Tex2D( backBufferFormat, m_Width, m_Height, 1, 1, sampleDesc.Count,
+                                                       sampleDesc.Quality, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET );
+    m_ColorClearValue.Format   = m_ColorTextureDesc.Format;
+    m_ColorClearValue.Color[0] = 0.4f;
+    m_ColorClearValue.Color[1] = 0.6f;
+    m_ColorClearValue.Color[2] = 0.9f;
+    m_ColorClearValue.Color[3] = 1.0f;
+
+    // Describe a depth buffer.
+    m_DepthTextureDesc = CD3DX12_RESOURCE_DESC::Tex2D( depthBufferFormat, m_Width, m_Height, 1, 1, sampleDesc.Count,
+                                                       sampleDesc.Quality, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL );
+    m_DepthClearValue.Format       = m_DepthTextureDesc.Format;
+    m_DepthClearValue.DepthStencil = { 1.0f, 0 };
 
     // Make sure the copy command queue is finished before leaving this function.
-    commandQueue.WaitForFenceValue( fence );
+    syncPoint.WaitForCompletion();
 }
 
 void DirectX12Engine::UnloadContent()
@@ -354,6 +370,11 @@ void DirectX12Engine::UnloadContent()
 
 
     m_HDRRenderTarget.Reset();
+    m_RenderTarget.Reset();
+    m_RenderGraph.reset();
+    m_GpuProfiler.reset();
+    m_TransientTextureAllocator.reset();
+    m_ParallelCommandRecorder.reset();
 
     m_GUI.reset();
     m_SwapChain.reset();
@@ -487,8 +508,11 @@ void DirectX12Engine::OnUpdate( UpdateEventArgs& e )
         l.Color = XMFLOAT4( LightColors[i] );
     }
 
-    m_LightingPSO->SetDirectionalLights( m_DirectionalLights );
-    m_DecalPSO->SetDirectionalLights( m_DirectionalLights );
+    for ( uint32_t i = 0; i < m_NumSceneChunks; ++i )
+    {
+        m_LightingPSOs[i]->SetDirectionalLights( m_DirectionalLights );
+        m_DecalPSOs[i]->SetDirectionalLights( m_DirectionalLights );
+    }
 
     NearestEntity();
 
@@ -507,7 +531,11 @@ void DirectX12Engine::OnResize( ResizeEventArgs& e )
     m_Camera.set_Projection( 45.0f, m_Width / (float)m_Height, 0.1f, 100.0f );
     m_Viewport = CD3DX12_VIEWPORT( 0.0f, 0.0f, static_cast<float>( m_Width ), static_cast<float>( m_Height ) );
 
-    m_RenderTarget.Resize( m_Width, m_Height );
+    // The textures are acquired with the new size in the next frame.
+    m_ColorTextureDesc.Width  = m_Width;
+    m_ColorTextureDesc.Height = m_Height;
+    m_DepthTextureDesc.Width  = m_Width;
+    m_DepthTextureDesc.Height = m_Height;
 
     m_SwapChain->Resize( m_Width, m_Height );
 }
@@ -517,90 +545,149 @@ void DirectX12Engine::OnRender()
     // This is done here to prevent the window switching to fullscreen while rendering the GUI.
     m_Window->SetFullscreen( m_Fullscreen );
 
-    auto& commandQueue = m_Device->GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT );
-    auto  commandList  = commandQueue.GetCommandList();
+    // The passes of the frame are declared in the render graph, which orders them, records the barriers
+    // between them and acquires the textures of the MSAA render target from the transient texture allocator.
+    m_RenderGraph->Reset();
+    m_TransientTextureAllocator->BeginFrame();
+    m_GpuProfiler->BeginFrame();
 
-    const auto& renderTarget = m_IsLoading ? m_SwapChain->GetRenderTarget() : m_RenderTarget;
+    auto backBuffer = m_RenderGraph->ImportTexture(
+        m_SwapChain->GetRenderTarget().GetTexture( AttachmentPoint::Color0 ), D3D12_RESOURCE_STATE_PRESENT );
 
     if ( m_IsLoading )
     {
-        FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
-        commandList->ClearTexture( renderTarget.GetTexture( AttachmentPoint::Color0 ), clearColor );
-
-        // TODO: Render a loading screen.
+        m_RenderGraph
+            ->AddPass( L"Clear",
+                       [backBuffer]( CommandList& commandList, const RenderGraph& renderGraph ) {
+                           FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
+                           commandList.ClearTexture( renderGraph.GetTexture( backBuffer ), clearColor );
+
+                           // TODO: Render a loading screen.
+                       } )
+            .Write( backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET );
     }
     else
     {
-        SceneVisitor opaquePass( *commandList, m_Camera, *m_LightingPSO, false );
-        SceneVisitor transparentPass( *commandList, m_Camera, *m_DecalPSO, true );
-        SceneVisitor unlitPass( *commandList, m_Camera, *m_UnlitPSO, false );
-
-        // Clear the render targets.
-        {
-            FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
-
-            commandList->ClearTexture( renderTarget.GetTexture( AttachmentPoint::Color0 ), clearColor );
-            commandList->ClearDepthStencilTexture( renderTarget.GetTexture( AttachmentPoint::DepthStencil ),
-                                                   D3D12_CLEAR_FLAG_DEPTH );
-        }
-
-        commandList->SetViewport( m_Viewport );
-        commandList->SetScissorRect( m_ScissorRect );
-        commandList->SetRenderTarget( m_RenderTarget );
-
-        // Render the scene.
-    
-        m_Axis->Accept( unlitPass );
-        
+        // The world transforms are read by the scene chunks on multiple threads, so they are updated before.
         for ( auto it: m_AssetsList )
         {
-            it->Accept( opaquePass );
-            it->Accept( transparentPass );
+            it->UpdateTransforms();
         }
-        
 
-        MaterialProperties lightMaterial = Material::Black;
-        for ( const auto& l: m_PointLights )
-        {
-            lightMaterial.Emissive = l.Color;
-            auto lightPos          = XMLoadFloat4( &l.PositionWS );
-            auto worldMatrix       = XMMatrixTranslationFromVector( lightPos );
+        auto colorTexture =
+            m_RenderGraph->CreateTexture( m_ColorTextureDesc, &m_ColorClearValue, L"Color Render Target" );
+        auto depthTexture =
+            m_RenderGraph->CreateTexture( m_DepthTextureDesc, &m_DepthClearValue, L"Depth Render Target" );
+
+        // The nodes of the assets are recorded on multiple threads into command lists that inherit
+        // the render target, viewport and scissor rectangle of the scene pass.
+        m_RenderGraph
+            ->AddParallelPass(
+                L"Scene",
+                [this, colorTexture, depthTexture]( CommandList& commandList, const RenderGraph& renderGraph ) {
+                    m_RenderTarget.AttachTexture( AttachmentPoint::Color0, renderGraph.GetTexture( colorTexture ) );
+                    m_RenderTarget.AttachTexture( AttachmentPoint::DepthStencil,
+                                                  renderGraph.GetTexture( depthTexture ) );
+
+                    // Clear the render targets.
+                    {
+                        FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
 
-            m_Sphere->GetRootNode()->SetLocalTransform( worldMatrix );
-            m_Sphere->GetRootNode()->GetMesh()->GetMaterial()->SetMaterialProperties( lightMaterial );
-            m_Sphere->Accept( unlitPass );
-        }
+                        commandList.ClearTexture( m_RenderTarget.GetTexture( AttachmentPoint::Color0 ), clearColor );
+                        commandList.ClearDepthStencilTexture( m_RenderTarget.GetTexture( AttachmentPoint::DepthStencil ),
+                                                              D3D12_CLEAR_FLAG_DEPTH );
+                    }
 
-        for ( const auto& l: m_SpotLights )
-        {
-            lightMaterial.Emissive = l.Color;
-            XMVECTOR lightPos      = XMLoadFloat4( &l.PositionWS );
-            XMVECTOR lightDir      = XMLoadFloat4( &l.DirectionWS );
-            XMVECTOR up            = XMVectorSet( 0, 1, 0, 0 );
-
-            // Rotate the cone so it is facing the Z axis.
-            auto rotationMatrix = XMMatrixRotationX( XMConvertToRadians( -90.0f ) );
-            auto worldMatrix    = rotationMatrix * LookAtMatrix( lightPos, lightDir, up );
-
-            m_Cone->GetRootNode()->SetLocalTransform( worldMatrix );
-            m_Cone->GetRootNode()->GetMesh()->GetMaterial()->SetMaterialProperties( lightMaterial );
-            m_Cone->Accept( unlitPass );
-        }
+                    commandList.SetViewport( m_Viewport );
+                    commandList.SetScissorRect( m_ScissorRect );
+                    commandList.SetRenderTarget( m_RenderTarget );
 
-        // Resolve the MSAA render target to the swapchain's backbuffer.
-        auto swapChainBackBuffer = m_SwapChain->GetRenderTarget().GetTexture( AttachmentPoint::Color0 );
-        auto msaaRenderTarget    = m_RenderTarget.GetTexture( AttachmentPoint::Color0 );
+                    RenderScene( commandList );
+                },
+                *m_ParallelCommandRecorder, m_NumSceneChunks,
+                [this]( CommandList& commandList, uint32_t chunk, uint32_t numChunks, const RenderGraph& ) {
+                    RenderSceneChunk( commandList, chunk, numChunks );
+                } )
+            .Write( colorTexture, D3D12_RESOURCE_STATE_RENDER_TARGET )
+            .Write( depthTexture, D3D12_RESOURCE_STATE_DEPTH_WRITE );
 
-        commandList->ResolveSubresource( swapChainBackBuffer, msaaRenderTarget );
+        // Resolve the MSAA render target to the swapchain's backbuffer.
+        m_RenderGraph
+            ->AddPass( L"Resolve",
+                       [backBuffer, colorTexture]( CommandList& commandList, const RenderGraph& renderGraph ) {
+                           commandList.ResolveSubresource( renderGraph.GetTexture( backBuffer ),
+                                                           renderGraph.GetTexture( colorTexture ) );
+                       } )
+            .Read( colorTexture, D3D12_RESOURCE_STATE_RESOLVE_SOURCE )
+            .Write( backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST );
     }
 
-    OnGUI( commandList, m_SwapChain->GetRenderTarget() );
+    m_RenderGraph
+        ->AddPass( L"GUI",
+                   [this]( CommandList& commandList, const RenderGraph& ) {
+                       OnGUI( commandList.shared_from_this(), m_SwapChain->GetRenderTarget() );
+                   } )
+        .ReadWrite( backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET );
 
-    commandQueue.ExecuteCommandList( commandList );
+    m_RenderGraph->Compile();
+    m_RenderGraph->Execute();
+    m_GpuProfiler->EndFrame();
 
     m_SwapChain->Present();
 }
 
+void DirectX12Engine::RenderScene( CommandList& commandList )
+{
+    SceneVisitor unlitPass( commandList, m_Camera, *m_UnlitPSO, false );
+
+    m_Axis->Accept( unlitPass );
+
+    // The light meshes are shared by all lights, so they are not recorded in parallel. The transforms of the
+    // light meshes are updated after they are moved, so that the scene visitor reads up to date world
+    // transforms instead of recomputing them from the dirty hierarchy.
+    MaterialProperties lightMaterial = Material::Black;
+    for ( const auto& l: m_PointLights )
+    {
+        lightMaterial.Emissive = l.Color;
+        auto lightPos          = XMLoadFloat4( &l.PositionWS );
+        auto worldMatrix       = XMMatrixTranslationFromVector( lightPos );
+
+        m_Sphere->GetRootNode()->SetLocalTransform( worldMatrix );
+        m_Sphere->UpdateTransforms();
+        m_Sphere->GetRootNode()->GetMesh()->GetMaterial()->SetMaterialProperties( lightMaterial );
+        m_Sphere->Accept( unlitPass );
+    }
+
+    for ( const auto& l: m_SpotLights )
+    {
+        lightMaterial.Emissive = l.Color;
+        XMVECTOR lightPos      = XMLoadFloat4( &l.PositionWS );
+        XMVECTOR lightDir      = XMLoadFloat4( &l.DirectionWS );
+        XMVECTOR up            = XMVectorSet( 0, 1, 0, 0 );
+
+        // Rotate the cone so it is facing the Z axis.
+        auto rotationMatrix = XMMatrixRotationX( XMConvertToRadians( -90.0f ) );
+        auto worldMatrix    = rotationMatrix * LookAtMatrix( lightPos, lightDir, up );
+
+        m_Cone->GetRootNode()->SetLocalTransform( worldMatrix );
+        m_Cone->UpdateTransforms();
+        m_Cone->GetRootNode()->GetMesh()->GetMaterial()->SetMaterialProperties( lightMaterial );
+        m_Cone->Accept( unlitPass );
+    }
+}
+
+void DirectX12Engine::RenderSceneChunk( CommandList& commandList, uint32_t chunk, uint32_t numChunks )
+{
+    SceneVisitor opaquePass( commandList, m_Camera, *m_LightingPSOs[chunk], false );
+    SceneVisitor transparentPass( commandList, m_Camera, *m_DecalPSOs[chunk], true );
+
+    for ( auto it: m_AssetsList )
+    {
+        it->Accept( opaquePass, chunk, numChunks );
+        it->Accept( transparentPass, chunk, numChunks );
+    }
+}
+
 
 void DirectX12Engine::OnRotateY(float amount)
 {
@@ -847,6 +934,7 @@ void DirectX12Engine::OnGUI( const std::shared_ptr<CommandList>& commandList, co
         if ( ImGui::BeginMenu( "View" ) )
         {
             ImGui::MenuItem( "Controls", nullptr, &m_ShowControls );
+            ImGui::MenuItem( "GPU Timings", nullptr, &m_ShowGpuTimings );
 
             ImGui::EndMenu();
         }
@@ -908,6 +996,43 @@ void DirectX12Engine::OnGUI( const std::shared_ptr<CommandList>& commandList, co
         ImGui::End();
     }
 
+    if ( m_ShowGpuTimings )
+    {
+        ImGui::Begin( "GPU Timings", &m_ShowGpuTimings );
+
+        // The timings are read back a few frames after they are measured.
+        ImGui::Columns( 5 );
+        ImGui::Text( "Pass" );
+        ImGui::NextColumn();
+        ImGui::Text( "Last (ms)" );
+        ImGui::NextColumn();
+        ImGui::Text( "Min (ms)" );
+        ImGui::NextColumn();
+        ImGui::Text( "Avg (ms)" );
+        ImGui::NextColumn();
+        ImGui::Text( "Max (ms)" );
+        ImGui::NextColumn();
+        ImGui::Separator();
+
+        for ( const auto& timing: m_GpuProfiler->GetTimings() )
+        {
+            // Nested scopes are indented below their parent.
+            ImGui::Text( "%*s%s", timing.Depth * 2, "", timing.Name.c_str() );
+            ImGui::NextColumn();
+            ImGui::Text( "%.3f", timing.LastMs );
+            ImGui::NextColumn();
+            ImGui::Text( "%.3f", timing.MinMs );
+            ImGui::NextColumn();
+            ImGui::Text( "%.3f", timing.AvgMs );
+            ImGui::NextColumn();
+            ImGui::Text( "%.3f", timing.MaxMs );
+            ImGui::NextColumn();
+        }
+
+        ImGui::Columns( 1 );
+        ImGui::End();
+    }
+
     if ( m_ShowControls )
     {
         ImGui::Begin( "Controls", &m_ShowControls );
@@ -1,5 +1,6 @@
 #include <EffectPSO.h>
 
+#include <dx12lib/BindlessDescriptorHeap.h>
 #include <dx12lib/CommandList.h>
 #include <dx12lib/Device.h>
 #include <dx12lib/Helpers.h>
@@ -21,6 +22,7 @@ EffectPSO::EffectPSO( std::shared_ptr<DX12_Library::Device> device, bool enableL
 , m_pPreviousCommandList( nullptr )
 , m_EnableLighting(enableLighting)
 , m_EnableDecal(enableDecal)
+, m_EnableBindless( device->GetBindlessDescriptorHeap() != nullptr )
 {
     m_pAlignedMVP = (MVP*)_aligned_malloc( sizeof( MVP ), 16 );
 
@@ -33,16 +35,22 @@ EffectPSO::EffectPSO( std::shared_ptr<DX12_Library::Device> device, bool enableL
     ComPtr<ID3DBlob> pixelShaderBlob;
     if (enableLighting) {
         if (enableDecal) {
-            ThrowIfFailed( D3DReadFileToBlob( L"data/shaders/DirectX12EngineModels/Decal_PS.cso", &pixelShaderBlob ) );
+            ThrowIfFailed( D3DReadFileToBlob( m_EnableBindless ? L"data/shaders/DirectX12EngineModels/Decal_Bindless_PS.cso"
+                                                               : L"data/shaders/DirectX12EngineModels/Decal_PS.cso",
+                                              &pixelShaderBlob ) );
         }
         else
         {
-            ThrowIfFailed( D3DReadFileToBlob( L"data/shaders/DirectX12EngineModels/Lighting_PS.cso", &pixelShaderBlob ) );
+            ThrowIfFailed( D3DReadFileToBlob( m_EnableBindless ? L"data/shaders/DirectX12EngineModels/Lighting_Bindless_PS.cso"
+                                                               : L"data/shaders/DirectX12EngineModels/Lighting_PS.cso",
+                                              &pixelShaderBlob ) );
         }
     }
     else
     {
-        ThrowIfFailed( D3DReadFileToBlob( L"data/shaders/DirectX12EngineModels/Unlit_PS.cso", &pixelShaderBlob ) );
+        ThrowIfFailed( D3DReadFileToBlob( m_EnableBindless ? L"data/shaders/DirectX12EngineModels/Unlit_Bindless_PS.cso"
+                                                           : L"data/shaders/DirectX12EngineModels/Unlit_PS.cso",
+                                          &pixelShaderBlob ) );
     }
 
     // Create a root signature.
@@ -53,7 +61,14 @@ EffectPSO::EffectPSO( std::shared_ptr<DX12_Library::Device> device, bool enableL
                                                     D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
     // Descriptor range for the textures.
+    // With bindless descriptors, the range covers the whole bindless descriptor heap. The descriptors
+    // in the heap may change while the command list is in-flight so they can't be static.
     CD3DX12_DESCRIPTOR_RANGE1 descriptorRage( D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 8, 3 );
+    if ( m_EnableBindless )
+    {
+        descriptorRage.Init( D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 2,
+                             D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE );
+    }
 
     // clang-format off
     CD3DX12_ROOT_PARAMETER1 rootParameters[RootParameters::NumRootParameters];
@@ -64,6 +79,7 @@ EffectPSO::EffectPSO( std::shared_ptr<DX12_Library::Device> device, bool enableL
     rootParameters[RootParameters::SpotLights].InitAsShaderResourceView( 1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL );
     rootParameters[RootParameters::DirectionalLights].InitAsShaderResourceView( 2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL );
     rootParameters[RootParameters::Textures].InitAsDescriptorTable( 1, &descriptorRage, D3D12_SHADER_VISIBILITY_PIXEL );
+    rootParameters[RootParameters::TextureIndicesCB].InitAsConstants( sizeof( TextureIndices ) / 4, 2, 0, D3D12_SHADER_VISIBILITY_PIXEL );
 
     CD3DX12_STATIC_SAMPLER_DESC anisotropicSampler( 0, D3D12_FILTER_ANISOTROPIC );
 
@@ -134,6 +150,16 @@ EffectPSO::~EffectPSO()
     _aligned_free( m_pAlignedMVP );
 }
 
+inline uint32_t EffectPSO::GetBindlessIndex( CommandList& commandList, const std::shared_ptr<Texture>& texture )
+{
+    if ( texture )
+    {
+        return commandList.SetBindlessShaderResourceView( texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
+    }
+
+    return commandList.SetBindlessShaderResourceView( m_DefaultSRV, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
+}
+
 inline void EffectPSO::BindTexture( CommandList& commandList, uint32_t offset, const std::shared_ptr<Texture>& texture )
 {
     if ( texture )
@@ -174,14 +200,33 @@ void EffectPSO::Apply( CommandList& commandList )
 
             using TextureType = Material::TextureType;
 
-            BindTexture( commandList, 0, m_Material->GetTexture( TextureType::Ambient ) );
-            BindTexture( commandList, 1, m_Material->GetTexture( TextureType::Emissive ) );
-            BindTexture( commandList, 2, m_Material->GetTexture( TextureType::Diffuse ) );
-            BindTexture( commandList, 3, m_Material->GetTexture( TextureType::Specular ) );
-            BindTexture( commandList, 4, m_Material->GetTexture( TextureType::SpecularPower ) );
-            BindTexture( commandList, 5, m_Material->GetTexture( TextureType::Normal ) );
-            BindTexture( commandList, 6, m_Material->GetTexture( TextureType::Bump ) );
-            BindTexture( commandList, 7, m_Material->GetTexture( TextureType::Opacity ) );
+            if ( m_EnableBindless )
+            {
+                // The textures are fetched by index so no descriptors need to be copied.
+                TextureIndices textureIndices;
+                textureIndices.Ambient  = GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::Ambient ) );
+                textureIndices.Emissive = GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::Emissive ) );
+                textureIndices.Diffuse  = GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::Diffuse ) );
+                textureIndices.Specular = GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::Specular ) );
+                textureIndices.SpecularPower =
+                    GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::SpecularPower ) );
+                textureIndices.Normal  = GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::Normal ) );
+                textureIndices.Bump    = GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::Bump ) );
+                textureIndices.Opacity = GetBindlessIndex( commandList, m_Material->GetTexture( TextureType::Opacity ) );
+
+                commandList.SetGraphics32BitConstants( RootParameters::TextureIndicesCB, textureIndices );
+            }
+            else
+            {
+                BindTexture( commandList, 0, m_Material->GetTexture( TextureType::Ambient ) );
+                BindTexture( commandList, 1, m_Material->GetTexture( TextureType::Emissive ) );
+                BindTexture( commandList, 2, m_Material->GetTexture( TextureType::Diffuse ) );
+                BindTexture( commandList, 3, m_Material->GetTexture( TextureType::Specular ) );
+                BindTexture( commandList, 4, m_Material->GetTexture( TextureType::SpecularPower ) );
+                BindTexture( commandList, 5, m_Material->GetTexture( TextureType::Normal ) );
+                BindTexture( commandList, 6, m_Material->GetTexture( TextureType::Bump ) );
+                BindTexture( commandList, 7, m_Material->GetTexture( TextureType::Opacity ) );
+            }
         }
     }
 